@@ -0,0 +1,262 @@
+#include "async_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "thread_topology.h"
+
+// io_uring só fora do Android (no app, io_uring_setup é SIGSYS pelo seccomp)
+#if defined(__linux__) && !defined(__ANDROID__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_FEAT_FAST_POLL)
+#define MTP_HAVE_IO_URING 1
+#endif
+#endif
+
+void AlignedFree::operator()(void* p) const { std::free(p); }
+
+AlignedBuffer allocAligned(size_t bytes) {
+    bytes = (std::max<size_t>(bytes, 1) + kIoAlign - 1) / kIoAlign * kIoAlign;
+    void* p = nullptr;
+    if (posix_memalign(&p, kIoAlign, bytes) != 0) return AlignedBuffer();
+    return AlignedBuffer(static_cast<uint8_t*>(p));
+}
+
+namespace {
+
+// Pool de pread: cada thread pega um pedido da fila, lê até completar (ou
+// erro/fim do arquivo) e põe a conclusão na fila de saída
+class PreadPool : public AsyncIo {
+public:
+    PreadPool(int queueDepth, int threads) {
+        mQueueDepth = queueDepth;
+        for (int i = 0; i < threads; ++i) mThreads.emplace_back([this]() { worker(); });
+    }
+
+    ~PreadPool() override {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWork.notify_all();
+        for (auto &t : mThreads) t.join();
+    }
+
+    IoBackend backend() const override { return IoBackend::PreadPool; }
+
+    int submit(const IoRequest* requests, int count) override {
+        const int n = std::min(count, capacity());
+        if (n <= 0) return 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mPending.insert(mPending.end(), requests, requests + n);
+        }
+        mInFlight += n;
+        if (n == 1) {
+            mWork.notify_one();
+        } else {
+            mWork.notify_all();
+        }
+        return n;
+    }
+
+    int reap(IoCompletion* out, int max, bool wait) override {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (wait && mInFlight > 0) mDone.wait(lock, [this]() { return !mCompleted.empty(); });
+        int n = 0;
+        while (n < max && !mCompleted.empty()) {
+            out[n++] = mCompleted.front();
+            mCompleted.pop_front();
+        }
+        mInFlight -= n;
+        return n;
+    }
+
+private:
+    void worker() {
+        setCurrentThreadClass(ThreadClass::Io);
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (;;) {
+            mWork.wait(lock, [this]() { return mStop || !mPending.empty(); });
+            if (mStop) return;
+            const IoRequest r = mPending.front();
+            mPending.pop_front();
+            lock.unlock();
+            int64_t done = 0;
+            int32_t result = 0;
+            while (done < (int64_t)r.bytes) {
+                const ssize_t got = ::pread(r.fd, static_cast<uint8_t*>(r.buffer) + done, r.bytes - (size_t)done,
+                                            (off_t)(r.offset + done));
+                if (got < 0 && errno == EINTR) continue;
+                if (got < 0) { result = -errno; break; }
+                if (got == 0) break;
+                done += got;
+            }
+            if (result == 0) result = (int32_t)done;
+            lock.lock();
+            mCompleted.push_back(IoCompletion{r.tag, result});
+            mDone.notify_one();
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWork;
+    std::condition_variable mDone;
+    std::deque<IoRequest> mPending;
+    std::deque<IoCompletion> mCompleted;
+    std::vector<std::thread> mThreads;
+    bool mStop = false;
+};
+
+#ifdef MTP_HAVE_IO_URING
+
+// io_uring pelas syscalls cruas (sem liburing): SQ e CQ mapeadas uma vez; o
+// lote inteiro entra com um io_uring_enter. Leituras curtas (fim do arquivo)
+// voltam como estão; quem pede decide o que fazer com elas.
+class IoUring : public AsyncIo {
+public:
+    ~IoUring() override {
+        if (mSqes) munmap(mSqes, mSqesBytes);
+        if (mCqRing && mCqRing != mSqRing) munmap(mCqRing, mCqBytes);
+        if (mSqRing) munmap(mSqRing, mSqBytes);
+        if (mFd >= 0) close(mFd);
+    }
+
+    bool init(int queueDepth) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        mFd = (int)syscall(__NR_io_uring_setup, (unsigned)queueDepth, &p);
+        if (mFd < 0) return false;
+        // IORING_OP_READ e a CQ que não perde conclusões vieram junto com FAST_POLL
+        if (!(p.features & IORING_FEAT_FAST_POLL)) return false;
+        mSqBytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        mCqBytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) mSqBytes = mCqBytes = std::max(mSqBytes, mCqBytes);
+        mSqRing = mmap(nullptr, mSqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQ_RING);
+        if (mSqRing == MAP_FAILED) { mSqRing = nullptr; return false; }
+        if (single) {
+            mCqRing = mSqRing;
+        } else {
+            mCqRing = mmap(nullptr, mCqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_CQ_RING);
+            if (mCqRing == MAP_FAILED) { mCqRing = nullptr; return false; }
+        }
+        mSqesBytes = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, mSqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        mSqes = static_cast<io_uring_sqe*>(sqes);
+
+        uint8_t* sq = static_cast<uint8_t*>(mSqRing);
+        uint8_t* cq = static_cast<uint8_t*>(mCqRing);
+        mSqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        mSqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        mSqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        mCqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        mCqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        mCqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        // Em voo nunca passa do tamanho da SQ, então a CQ (>= SQ) não enche
+        mQueueDepth = (int)p.sq_entries;
+        return true;
+    }
+
+    IoBackend backend() const override { return IoBackend::IoUring; }
+
+    int submit(const IoRequest* requests, int count) override {
+        const int n = std::min(count, capacity());
+        if (n <= 0) return 0;
+        unsigned tail = *mSqTail; // só este thread escreve o tail
+        for (int i = 0; i < n; ++i) {
+            const IoRequest &r = requests[i];
+            const unsigned idx = tail & mSqMask;
+            io_uring_sqe &sqe = mSqes[idx];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = r.fd;
+            sqe.off = (uint64_t)r.offset;
+            sqe.addr = (uint64_t)(uintptr_t)r.buffer;
+            sqe.len = r.bytes;
+            sqe.user_data = r.tag;
+            mSqArray[idx] = idx;
+            ++tail;
+        }
+        __atomic_store_n(mSqTail, tail, __ATOMIC_RELEASE);
+        mInFlight += n;
+        mUnsubmitted += (unsigned)n;
+        enter(0);
+        return n;
+    }
+
+    int reap(IoCompletion* out, int max, bool wait) override {
+        if (mUnsubmitted > 0) enter(0);
+        if (wait && mInFlight > 0 && ready() == 0) enter(1);
+        unsigned head = *mCqHead; // só este thread escreve o head
+        const unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+        int n = 0;
+        while (n < max && head != tail) {
+            const io_uring_cqe &cqe = mCqes[head & mCqMask];
+            out[n++] = IoCompletion{cqe.user_data, cqe.res};
+            ++head;
+        }
+        __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+        mInFlight -= n;
+        return n;
+    }
+
+private:
+    // Envia o que ainda está na SQ; com minComplete, espera conclusões. O
+    // que o kernel não aceitar (EAGAIN/EBUSY) fica para o próximo enter.
+    void enter(unsigned minComplete) {
+        for (;;) {
+            const int rc = (int)syscall(__NR_io_uring_enter, mFd, mUnsubmitted, minComplete,
+                                        minComplete > 0 ? (unsigned)IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (rc < 0 && errno == EINTR) continue;
+            if (rc > 0) mUnsubmitted -= std::min(mUnsubmitted, (unsigned)rc);
+            return;
+        }
+    }
+
+    unsigned ready() const { return __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE) - *mCqHead; }
+
+    int mFd = -1;
+    unsigned mUnsubmitted = 0;
+    void* mSqRing = nullptr;
+    void* mCqRing = nullptr;
+    size_t mSqBytes = 0, mCqBytes = 0, mSqesBytes = 0;
+    io_uring_sqe* mSqes = nullptr;
+    unsigned* mSqTail = nullptr;
+    unsigned* mSqArray = nullptr;
+    unsigned mSqMask = 0;
+    unsigned* mCqHead = nullptr;
+    unsigned* mCqTail = nullptr;
+    unsigned mCqMask = 0;
+    io_uring_cqe* mCqes = nullptr;
+};
+
+#endif // MTP_HAVE_IO_URING
+
+} // namespace
+
+std::unique_ptr<AsyncIo> AsyncIo::create(int queueDepth, int threads, bool allowUring) {
+    queueDepth = std::max(1, std::min(queueDepth, 4096));
+#ifdef MTP_HAVE_IO_URING
+    if (allowUring) {
+        std::unique_ptr<IoUring> ring(new IoUring());
+        if (ring->init(queueDepth)) return ring;
+    }
+#else
+    (void)allowUring;
+#endif
+    return std::unique_ptr<AsyncIo>(new PreadPool(queueDepth, std::max(1, std::min(threads, queueDepth))));
+}
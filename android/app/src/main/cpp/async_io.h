@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// Leitura assíncrona em lote para o streaming de stems. Quem lê monta o lote
+// inteiro (um pedido por trecho de arquivo) e envia de uma vez; depois colhe
+// as conclusões, em qualquer ordem, pela tag de cada pedido.
+//
+// Dois backends:
+//  - io_uring (builds Linux de host, kernel 5.7+): o lote vira uma chamada de
+//    io_uring_enter; se o kernel ou o seccomp recusar o setup, cai no pool.
+//  - pool de threads com pread: um thread por leitura em voo até o limite do
+//    pool. É o único no Android, onde o seccomp dos apps mata o processo em
+//    io_uring_setup.
+// Os buffers dos pedidos ficam com quem pede, alinhados em kIoAlign e vivos
+// até a conclusão chegar.
+
+constexpr int kIoAlign = 4096;
+
+enum class IoBackend { None = 0, PreadPool = 1, IoUring = 2 };
+
+struct IoRequest {
+    int fd = -1;
+    int64_t offset = 0;
+    void* buffer = nullptr;
+    uint32_t bytes = 0;
+    uint64_t tag = 0;
+};
+
+struct IoCompletion {
+    uint64_t tag = 0;
+    int32_t result = 0; // bytes lidos ou -errno
+};
+
+class AsyncIo {
+public:
+    virtual ~AsyncIo() = default;
+
+    // `queueDepth`: máximo de leituras em voo; `threads`: tamanho do pool de
+    // pread (se for ele). Com allowUring false, sempre o pool.
+    static std::unique_ptr<AsyncIo> create(int queueDepth, int threads, bool allowUring);
+
+    virtual IoBackend backend() const = 0;
+    int queueDepth() const { return mQueueDepth; }
+    int inFlight() const { return mInFlight; }
+    // Vagas na fila agora (queueDepth - inFlight)
+    int capacity() const { return mQueueDepth - mInFlight; }
+
+    // Envia até capacity() pedidos do lote de uma vez; devolve quantos entraram
+    virtual int submit(const IoRequest* requests, int count) = 0;
+    // Colhe até `max` conclusões; com `wait`, espera ao menos uma se houver
+    // leitura em voo. Devolve quantas vieram.
+    virtual int reap(IoCompletion* out, int max, bool wait) = 0;
+
+protected:
+    int mQueueDepth = 0;
+    int mInFlight = 0;
+};
+
+// Memória alinhada em kIoAlign (buffers de leitura)
+struct AlignedFree {
+    void operator()(void* p) const;
+};
+using AlignedBuffer = std::unique_ptr<uint8_t, AlignedFree>;
+// Tamanho arredondado para cima em kIoAlign; nullptr se faltar memória
+AlignedBuffer allocAligned(size_t bytes);
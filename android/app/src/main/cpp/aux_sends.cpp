@@ -0,0 +1,168 @@
+#include "aux_sends.h"
+
+#include <algorithm>
+#include <cstring>
+
+typedef float f32x8 __attribute__((vector_size(32)));
+
+static inline f32x8 load8(const Lane8& l) {
+    f32x8 v;
+    std::memcpy(&v, l.v, sizeof(v));
+    return v;
+}
+
+static inline void store8(Lane8& l, f32x8 v) {
+    std::memcpy(l.v, &v, sizeof(v));
+}
+
+static inline f32x8 splat8(float x) {
+    return f32x8{x, x, x, x, x, x, x, x};
+}
+
+static inline float sum8(const Lane8& l) {
+    return ((l.v[0] + l.v[1]) + (l.v[2] + l.v[3])) + ((l.v[4] + l.v[5]) + (l.v[6] + l.v[7]));
+}
+
+void AuxSendMatrix::configure(const InsertChain& inserts, int trackCount, const std::vector<int>& outputs,
+                              const std::vector<float>& sends) {
+    mAuxCount = std::min((int)outputs.size(), kMaxAuxMixes);
+    mTracks = std::max(0, trackCount);
+    mGroups = inserts.groupCount();
+    mOutputs.assign(outputs.begin(), outputs.begin() + mAuxCount);
+    mSends.assign((size_t)mTracks * mAuxCount, 0.0f);
+    const size_t srcAux = outputs.size();
+    for (int t = 0; t < mTracks; ++t) {
+        for (int a = 0; a < mAuxCount; ++a) {
+            const size_t k = (size_t)t * srcAux + (size_t)a;
+            if (k < sends.size()) mSends[(size_t)t * mAuxCount + a] = std::max(0.0f, std::min(1.0f, sends[k]));
+        }
+    }
+    mMuted.assign((size_t)mTracks, 0);
+    mFirstLane.assign((size_t)mTracks, 0);
+    mLaneCount.assign((size_t)mTracks, 0);
+    for (int t = 0; t < mTracks; ++t) {
+        mFirstLane[(size_t)t] = inserts.trackFirstLane(t);
+        mLaneCount[(size_t)t] = inserts.trackLaneCount(t);
+    }
+    mGroupTracks.assign((size_t)mGroups, {});
+    for (int g = 0; g < mGroups; ++g) mGroupTracks[(size_t)g] = inserts.groupTracks(g);
+
+    const size_t cells = (size_t)mGroups * mAuxCount;
+    mTargetL.assign(cells, Lane8{});
+    mTargetR.assign(cells, Lane8{});
+    mGroupSends.assign((size_t)mGroups, 0);
+    mAccL.assign((size_t)mAuxCount * kAuxTileFrames, Lane8{});
+    mAccR.assign((size_t)mAuxCount * kAuxTileFrames, Lane8{});
+    rebuildTargets();
+    // Começa já nos níveis configurados, sem rampa a partir do zero
+    mGainL = mTargetL;
+    mGainR = mTargetR;
+}
+
+void AuxSendMatrix::setSend(int track, int aux, float level) {
+    if (track < 0 || track >= mTracks || aux < 0 || aux >= mAuxCount) return;
+    mSends[(size_t)track * mAuxCount + aux] = std::max(0.0f, std::min(1.0f, level));
+    mDirty = true;
+}
+
+void AuxSendMatrix::setTrackMuted(int track, bool muted) {
+    if (track < 0 || track >= mTracks || (mMuted[(size_t)track] != 0) == muted) return;
+    mMuted[(size_t)track] = muted ? 1 : 0;
+    mDirty = true;
+}
+
+void AuxSendMatrix::rebuildTargets() {
+    mDirty = false;
+    std::fill(mTargetL.begin(), mTargetL.end(), Lane8{});
+    std::fill(mTargetR.begin(), mTargetR.end(), Lane8{});
+    for (int t = 0; t < mTracks; ++t) {
+        const int first = mFirstLane[(size_t)t];
+        const int g = first / kLaneWidth;
+        const int li = first % kLaneWidth;
+        const bool stereo = mLaneCount[(size_t)t] == 2;
+        for (int a = 0; a < mAuxCount; ++a) {
+            const float s = mMuted[(size_t)t] ? 0.0f : mSends[(size_t)t * mAuxCount + a];
+            const size_t cell = (size_t)g * mAuxCount + a;
+            // Mono vai para os dois lados do aux; estéreo L->L, R->R
+            mTargetL[cell].v[li] = s;
+            mTargetR[cell].v[stereo ? li + 1 : li] = s;
+        }
+    }
+}
+
+void AuxSendMatrix::render(const Lane8* lanes, int block, const uint8_t* trackQuiet, float* dst, int stride,
+                           int frames) {
+    if (mAuxCount == 0 || frames <= 0) return;
+    if (mDirty) rebuildTargets();
+    const size_t cells = (size_t)mGroups * mAuxCount;
+    const bool ramp = std::memcmp(mGainL.data(), mTargetL.data(), cells * sizeof(Lane8)) != 0 ||
+                      std::memcmp(mGainR.data(), mTargetR.data(), cells * sizeof(Lane8)) != 0;
+
+    // Grupos que entram: algum envio ligado e alguma track com som
+    for (int g = 0; g < mGroups; ++g) {
+        bool sends = false;
+        for (size_t c = (size_t)g * mAuxCount; c < (size_t)(g + 1) * mAuxCount && !sends; ++c) {
+            for (int l = 0; l < kLaneWidth; ++l) {
+                if (mGainL[c].v[l] != 0.0f || mGainR[c].v[l] != 0.0f ||
+                    mTargetL[c].v[l] != 0.0f || mTargetR[c].v[l] != 0.0f) { sends = true; break; }
+            }
+        }
+        bool sound = false;
+        for (int t : mGroupTracks[(size_t)g]) {
+            if (!trackQuiet || !trackQuiet[t]) { sound = true; break; }
+        }
+        mGroupSends[(size_t)g] = sends && sound ? 1 : 0;
+    }
+
+    const float inv = 1.0f / (float)frames;
+    for (int t0 = 0; t0 < frames; t0 += kAuxTileFrames) {
+        const int n = std::min(kAuxTileFrames, frames - t0);
+        std::fill(mAccL.begin(), mAccL.end(), Lane8{});
+        std::fill(mAccR.begin(), mAccR.end(), Lane8{});
+        for (int g = 0; g < mGroups; ++g) {
+            if (!mGroupSends[(size_t)g]) continue;
+            const Lane8* grp = lanes + (size_t)g * block + t0;
+            for (int a = 0; a < mAuxCount; ++a) {
+                const size_t cell = (size_t)g * mAuxCount + a;
+                Lane8* accL = mAccL.data() + (size_t)a * kAuxTileFrames;
+                Lane8* accR = mAccR.data() + (size_t)a * kAuxTileFrames;
+                const f32x8 gl = load8(mGainL[cell]);
+                const f32x8 gr = load8(mGainR[cell]);
+                if (ramp) {
+                    // Mesmo formato da rampa das tracks: ganho do frame f = atual + passo * (f + 1)
+                    const f32x8 sl = (load8(mTargetL[cell]) - gl) * splat8(inv);
+                    const f32x8 sr = (load8(mTargetR[cell]) - gr) * splat8(inv);
+                    for (int f = 0; f < n; ++f) {
+                        const f32x8 k = splat8((float)(t0 + f + 1));
+                        const f32x8 v = load8(grp[f]);
+                        store8(accL[f], load8(accL[f]) + v * (gl + sl * k));
+                        store8(accR[f], load8(accR[f]) + v * (gr + sr * k));
+                    }
+                } else {
+                    for (int f = 0; f < n; ++f) {
+                        const f32x8 v = load8(grp[f]);
+                        store8(accL[f], load8(accL[f]) + v * gl);
+                        store8(accR[f], load8(accR[f]) + v * gr);
+                    }
+                }
+            }
+        }
+        // Soma horizontal das lanes no par de saída de cada aux
+        for (int a = 0; a < mAuxCount; ++a) {
+            const int outL = mOutputs[(size_t)a];
+            if (outL < 0 || outL >= stride) continue;
+            const int outR = outL + 1 < stride ? outL + 1 : outL;
+            const Lane8* accL = mAccL.data() + (size_t)a * kAuxTileFrames;
+            const Lane8* accR = mAccR.data() + (size_t)a * kAuxTileFrames;
+            float* o = dst + (size_t)t0 * stride;
+            for (int f = 0; f < n; ++f) {
+                o[(size_t)f * stride + outL] += sum8(accL[f]);
+                o[(size_t)f * stride + outR] += sum8(accR[f]);
+            }
+        }
+    }
+    if (ramp) {
+        mGainL = mTargetL;
+        mGainR = mTargetR;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "insert_chain.h"
+
+// Mixes auxiliares (in-ear): cada track manda um nível próprio para cada aux,
+// e cada aux sai num par de canais da interface, independente da mix
+// principal. Os envios são pré-fader (o volume da track na FOH não mexe no
+// retorno) e pós-inserts; mute da track corta os envios também.
+//
+// A mixagem é uma multiplicação densa tracks x auxes sobre as lanes do
+// InsertChain: para cada grupo de 8 lanes e cada aux há um Lane8 de ganhos
+// para o L e outro para o R do aux (track mono vai para os dois, estéreo L->L
+// e R->R). O bloco é processado em fatias de kAuxTileFrames frames, com os
+// acumuladores de todos os auxes da fatia cabendo no L1; a soma horizontal das
+// lanes só acontece no fim da fatia.
+
+constexpr int kMaxAuxMixes = 16;
+constexpr int kAuxTileFrames = 32;
+
+class AuxSendMatrix {
+public:
+    // `outputs[a]`: primeiro canal do par do aux a. `sends`: níveis 0..1,
+    // trackCount x auxes (track-major); o que faltar vale 0.
+    void configure(const InsertChain& inserts, int trackCount, const std::vector<int>& outputs,
+                   const std::vector<float>& sends);
+    int auxCount() const { return mAuxCount; }
+
+    // Somente pelo thread de render (entre blocos)
+    void setSend(int track, int aux, float level);
+    void setTrackMuted(int track, bool muted);
+
+    // Soma os auxes em dst (`stride` floats por frame). `lanes` são os grupos
+    // do bloco (grupo-major, `block` frames cada); grupos só com tracks em
+    // silêncio (`trackQuiet`) ficam de fora. Ganhos mudados rampam no bloco.
+    void render(const Lane8* lanes, int block, const uint8_t* trackQuiet, float* dst, int stride, int frames);
+
+private:
+    void rebuildTargets();
+
+    int mAuxCount = 0;
+    int mGroups = 0;
+    int mTracks = 0;
+    std::vector<int> mOutputs;
+    std::vector<float> mSends;       // track x aux
+    std::vector<uint8_t> mMuted;
+    std::vector<int> mFirstLane;
+    std::vector<int> mLaneCount;
+    std::vector<std::vector<int>> mGroupTracks;
+    bool mDirty = false;
+    // Ganhos por (grupo, aux): atual e alvo, lado L e lado R
+    std::vector<Lane8> mGainL, mGainR, mTargetL, mTargetR;
+    std::vector<uint8_t> mGroupSends; // grupo tem algum envio != 0 (atual ou alvo)
+    std::vector<Lane8> mAccL, mAccR;  // aux x kAuxTileFrames
+};
@@ -0,0 +1,378 @@
+#include "capture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "thread_topology.h"
+#include "wav_io.h"
+
+// ~2,7 s a 48 kHz: cobre travadas longas do writer (GC, flush do disco)
+static const size_t kRingFrames = 1 << 17;
+// Frames que o writer tira do ring por vez
+static const size_t kWriterChunkFrames = 4096;
+// Espera do writer por um bloco cheio
+static const auto kWriterPoll = std::chrono::milliseconds(5);
+// Pré-alocação por arquivo, renovada quando acaba
+static const double kPreallocSec = 120.0;
+// Cabeçalho com JUNK: os dados começam alinhados à página
+static const size_t kCaptureHeaderBytes = 4096;
+// Fecha o segmento bem antes do limite de 4 GB do RIFF
+static const size_t kMaxSegmentDataBytes = 0xF0000000u;
+// Bloco da fonte sintética (tamanho típico de callback)
+static const int kSyntheticBlockFrames = 256;
+
+void FrameRing::allocate(int channels, size_t capacityFrames) {
+    size_t cap = 1;
+    while (cap < capacityFrames) cap <<= 1;
+    mChannels = std::max(1, channels);
+    mData.assign(cap * (size_t)mChannels, 0);
+    mMask = cap - 1;
+    mHead.store(0);
+    mTail.store(0);
+}
+
+size_t FrameRing::write(const int16_t* src, size_t frames) {
+    const size_t head = mHead.load(std::memory_order_relaxed);
+    const size_t tail = mTail.load(std::memory_order_acquire);
+    const size_t n = std::min(frames, capacity() - (head - tail));
+    for (size_t done = 0; done < n;) {
+        const size_t at = (head + done) & mMask;
+        const size_t run = std::min(n - done, capacity() - at);
+        std::memcpy(&mData[at * mChannels], src + done * mChannels, run * mChannels * sizeof(int16_t));
+        done += run;
+    }
+    mHead.store(head + n, std::memory_order_release);
+    return n;
+}
+
+size_t FrameRing::read(int16_t* dst, size_t maxFrames) {
+    const size_t tail = mTail.load(std::memory_order_relaxed);
+    const size_t head = mHead.load(std::memory_order_acquire);
+    const size_t n = std::min(maxFrames, head - tail);
+    for (size_t done = 0; done < n;) {
+        const size_t at = (tail + done) & mMask;
+        const size_t run = std::min(n - done, capacity() - at);
+        std::memcpy(dst + done * mChannels, &mData[at * mChannels], run * mChannels * sizeof(int16_t));
+        done += run;
+    }
+    mTail.store(tail + n, std::memory_order_release);
+    return n;
+}
+
+size_t FrameRing::available() const {
+    return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_relaxed);
+}
+
+CaptureWriter::~CaptureWriter() {
+    if (mRunning.load()) stop();
+}
+
+std::string CaptureWriter::segmentPath(int segment) const {
+    std::string path = mConfig.directory + "/" + mConfig.fileName;
+    if (segment > 1) path += "_" + std::to_string(segment);
+    return path + ".wav";
+}
+
+bool CaptureWriter::openFile(ChannelFile &f) {
+    const int channels = f.channel < 0 ? mConfig.deviceChannels : 1;
+    f.fd = ::open(f.path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (f.fd < 0) return false;
+    f.dataBytes = 0;
+    f.reservedBytes = 0;
+    unsigned char header[kCaptureHeaderBytes];
+    buildWavHeader(header, mConfig.sampleRate, channels, 16, 0, kCaptureHeaderBytes);
+    if (::pwrite(f.fd, header, kCaptureHeaderBytes, 0) != (ssize_t)kCaptureHeaderBytes) {
+        ::close(f.fd);
+        f.fd = -1;
+        return false;
+    }
+    // Sem suporte a fallocate o arquivo só cresce na escrita; não é erro
+    const size_t prealloc = (size_t)(kPreallocSec * mConfig.sampleRate) * channels * sizeof(int16_t);
+    if (posix_fallocate(f.fd, 0, (off_t)(kCaptureHeaderBytes + prealloc)) == 0) f.reservedBytes = prealloc;
+    return true;
+}
+
+void CaptureWriter::finalizeFile(ChannelFile &f) {
+    if (f.fd < 0) return;
+    const int channels = f.channel < 0 ? mConfig.deviceChannels : 1;
+    unsigned char header[kCaptureHeaderBytes];
+    buildWavHeader(header, mConfig.sampleRate, channels, 16, f.dataBytes, kCaptureHeaderBytes);
+    (void)::pwrite(f.fd, header, kCaptureHeaderBytes, 0);
+    (void)::ftruncate(f.fd, (off_t)(kCaptureHeaderBytes + f.dataBytes));
+    ::close(f.fd);
+    f.fd = -1;
+}
+
+bool CaptureWriter::start(const CaptureConfig &config) {
+    if (mRunning.load() || config.deviceChannels <= 0 || config.sampleRate <= 0) return false;
+    const bool interleaved = !config.fileName.empty();
+    if (!interleaved && config.channels.empty()) return false;
+    mConfig = config;
+    mFiles.clear();
+    mClosedSegments.clear();
+    if (interleaved) {
+        ChannelFile f;
+        f.channel = -1;
+        f.path = segmentPath(1);
+        if (!openFile(f)) return false;
+        mFiles.push_back(f);
+    } else {
+        for (int ch : config.channels) {
+            if (ch < 0 || ch >= config.deviceChannels) continue;
+            ChannelFile f;
+            f.channel = ch;
+            f.path = config.directory + "/in_" + std::to_string(ch + 1) + ".wav";
+            if (!openFile(f)) {
+                closeFiles();
+                return false;
+            }
+            mFiles.push_back(f);
+        }
+    }
+    if (mFiles.empty()) return false;
+
+    mRing.allocate(config.deviceChannels, kRingFrames);
+    mInterleaved.assign(kWriterChunkFrames * (size_t)config.deviceChannels, 0);
+    mPlanar.assign(interleaved ? 0 : kWriterChunkFrames, 0);
+    mFramesWritten.store(0);
+    mFramesDropped.store(0);
+    mBlocksDropped.store(0);
+    mFormatMismatches.store(0);
+    mStartSongFrame.store(kCaptureNotAligned);
+    mFirstFrameNs.store(-1);
+    mWriteFailed.store(false);
+    mStop.store(false);
+    mChannels.store(config.deviceChannels, std::memory_order_release);
+    mSampleRate.store(config.sampleRate, std::memory_order_release);
+    mRunning.store(true);
+    mWriter = std::thread([this]() { writerLoop(); });
+    // Ring e formato prontos: só agora os produtores escrevem
+    mAccepting.store(true);
+    return true;
+}
+
+void CaptureWriter::push(const int16_t* interleaved, int frames) {
+    pushAs(interleaved, frames, 0, 0);
+}
+
+CapturePush CaptureWriter::pushAs(const int16_t* interleaved, int frames, int channels, int sampleRate) {
+    if (frames <= 0) return CapturePush::Idle;
+    // Entra antes de olhar mAccepting (seq_cst dos dois lados): ou o stop()
+    // vê este produtor e espera, ou o produtor vê o stop() e não toca no ring
+    mProducers.fetch_add(1);
+    CapturePush result = CapturePush::Idle;
+    if (mAccepting.load()) {
+        // 0 = formato do produtor é o da gravação (a fonte foi aberta para ela)
+        if ((channels > 0 && channels != mRing.channels()) ||
+            (sampleRate > 0 && sampleRate != mSampleRate.load(std::memory_order_relaxed))) {
+            result = CapturePush::FormatMismatch;
+            mFormatMismatches.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            const size_t n = mRing.write(interleaved, (size_t)frames);
+            if (n < (size_t)frames) {
+                mFramesDropped.fetch_add((int64_t)(frames - n), std::memory_order_relaxed);
+                mBlocksDropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            result = CapturePush::Written;
+        }
+    }
+    mProducers.fetch_sub(1, std::memory_order_release);
+    return result;
+}
+
+void CaptureWriter::pushBlocking(const int16_t* interleaved, int frames) {
+    size_t done = 0;
+    while (done < (size_t)frames && !mWriteFailed.load(std::memory_order_relaxed)) {
+        done += mRing.write(interleaved + done * mRing.channels(), (size_t)frames - done);
+        if (done < (size_t)frames) std::this_thread::yield();
+    }
+}
+
+bool CaptureWriter::adoptFormat(int channels, int sampleRate) {
+    if (!mRunning.load() || channels <= 0 || sampleRate <= 0) return false;
+    if (channels == mChannels.load() && sampleRate == mSampleRate.load()) return true;
+    // Com o formato diferente nenhum pushAs escreve, então o ring vazio e os
+    // contadores em zero querem dizer que os arquivos ainda não têm áudio
+    if (mRing.available() > 0 || mFramesWritten.load() > 0 || mFramesDropped.load() > 0) return false;
+    CaptureConfig config = mConfig;
+    config.deviceChannels = channels;
+    config.sampleRate = sampleRate;
+    stop();
+    return start(config);
+}
+
+void CaptureWriter::markFirstFrame(int64_t timeNs) {
+    int64_t expected = -1;
+    mFirstFrameNs.compare_exchange_strong(expected, timeNs, std::memory_order_acq_rel);
+}
+
+int64_t CaptureWriter::pendingAlignmentNs() const {
+    if (!mRunning.load(std::memory_order_relaxed) ||
+        mStartSongFrame.load(std::memory_order_relaxed) != kCaptureNotAligned) {
+        return -1;
+    }
+    return mFirstFrameNs.load(std::memory_order_acquire);
+}
+
+void CaptureWriter::setStartSongFrame(int64_t frame) {
+    int64_t expected = kCaptureNotAligned;
+    mStartSongFrame.compare_exchange_strong(expected, frame);
+}
+
+void CaptureWriter::writerLoop() {
+    setCurrentThreadClass(ThreadClass::Io);
+    if (mConfig.writerNice != 0) setpriority(PRIO_PROCESS, 0, mConfig.writerNice);
+    for (;;) {
+        const bool stopping = mStop.load();
+        // Só blocos cheios (escritas grandes e alinhadas), exceto o resto no fim
+        if (!stopping && mRing.available() < kWriterChunkFrames) {
+            const auto due = std::chrono::steady_clock::now() + kWriterPoll;
+            std::this_thread::sleep_for(kWriterPoll);
+            recordThreadWake(ThreadClass::Io, due);
+            continue;
+        }
+        const size_t n = mRing.read(mInterleaved.data(), kWriterChunkFrames);
+        if (n == 0) break; // parada pedida e tudo que chegou já foi gravado
+        if (!writeChunk(n)) {
+            mWriteFailed.store(true);
+            break;
+        }
+    }
+}
+
+bool CaptureWriter::writeBytes(ChannelFile &f, const char* data, size_t bytes) {
+    if (f.reservedBytes > 0 && f.dataBytes + bytes > f.reservedBytes) {
+        const size_t frameBytes = (f.channel < 0 ? mConfig.deviceChannels : 1) * sizeof(int16_t);
+        const size_t more = (size_t)(kPreallocSec * mConfig.sampleRate) * frameBytes;
+        if (posix_fallocate(f.fd, (off_t)(kCaptureHeaderBytes + f.reservedBytes), (off_t)more) == 0) {
+            f.reservedBytes += more;
+        }
+    }
+    off_t at = (off_t)(kCaptureHeaderBytes + f.dataBytes);
+    for (size_t left = bytes; left > 0;) {
+        const ssize_t w = ::pwrite(f.fd, data, left, at);
+        if (w <= 0) return false;
+        data += w;
+        at += w;
+        left -= (size_t)w;
+    }
+    f.dataBytes += bytes;
+    return true;
+}
+
+bool CaptureWriter::writeChunk(size_t frames) {
+    const int inCh = mConfig.deviceChannels;
+    for (ChannelFile &f : mFiles) {
+        if (f.channel < 0) {
+            const size_t bytes = frames * inCh * sizeof(int16_t);
+            // Próximo segmento antes de estourar o tamanho de 32 bits do RIFF
+            if (f.dataBytes + bytes > kMaxSegmentDataBytes) {
+                finalizeFile(f);
+                mClosedSegments.push_back(f.path);
+                f.path = segmentPath(++f.segment);
+                if (!openFile(f)) return false;
+            }
+            if (!writeBytes(f, reinterpret_cast<const char*>(mInterleaved.data()), bytes)) return false;
+            continue;
+        }
+        const int16_t* src = mInterleaved.data() + f.channel;
+        for (size_t i = 0; i < frames; ++i) mPlanar[i] = src[i * inCh];
+        if (!writeBytes(f, reinterpret_cast<const char*>(mPlanar.data()), frames * sizeof(int16_t))) return false;
+    }
+    mFramesWritten.fetch_add((int64_t)frames, std::memory_order_relaxed);
+    return true;
+}
+
+void CaptureWriter::closeFiles() {
+    for (ChannelFile &f : mFiles) finalizeFile(f);
+}
+
+CaptureResult CaptureWriter::stop() {
+    CaptureResult r;
+    if (!mRunning.load()) return r;
+    mAccepting.store(false);
+    while (mProducers.load() != 0) std::this_thread::yield();
+    mStop.store(true);
+    if (mWriter.joinable()) mWriter.join();
+    closeFiles();
+    mRunning.store(false);
+    for (const std::string &path : mClosedSegments) {
+        r.files.push_back(path);
+        r.channels.push_back(-1);
+    }
+    for (const ChannelFile &f : mFiles) {
+        r.files.push_back(f.path);
+        r.channels.push_back(f.channel);
+    }
+    r.framesWritten = mFramesWritten.load();
+    r.framesDropped = mFramesDropped.load();
+    r.blocksDropped = mBlocksDropped.load();
+    r.formatMismatchBlocks = mFormatMismatches.load();
+    r.startSongFrame = mStartSongFrame.load();
+    mFiles.clear();
+    return r;
+}
+
+void runSyntheticCapture(CaptureWriter &writer, int channels, int sampleRate, int64_t frames, bool realtime) {
+    std::vector<int16_t> block((size_t)kSyntheticBlockFrames * channels);
+    std::vector<double> phase((size_t)channels, 0.0);
+    std::vector<double> step((size_t)channels);
+    for (int c = 0; c < channels; ++c) step[c] = 2.0 * M_PI * 110.0 * (c + 1) / sampleRate;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int64_t done = 0; done < frames;) {
+        const int n = (int)std::min<int64_t>(kSyntheticBlockFrames, frames - done);
+        for (int f = 0; f < n; ++f) {
+            for (int c = 0; c < channels; ++c) {
+                block[(size_t)f * channels + c] = (int16_t)(std::sin(phase[c]) * 8192.0);
+                phase[c] += step[c];
+            }
+        }
+        for (int c = 0; c < channels; ++c) phase[c] = std::fmod(phase[c], 2.0 * M_PI);
+        if (realtime) {
+            writer.push(block.data(), n);
+        } else {
+            writer.pushBlocking(block.data(), n);
+        }
+        done += n;
+        if (realtime) {
+            std::this_thread::sleep_until(t0 + std::chrono::microseconds((long long)(1.0e6 * done / sampleRate)));
+        }
+    }
+}
+
+extern "C" {
+
+int32_t mtp_capture_benchmark(const char* directory, int32_t channels, int32_t sampleRate,
+                              double seconds, MtpCaptureBenchmark* out) {
+    if (!directory || channels <= 0 || sampleRate <= 0 || !(seconds > 0.0)) return 0;
+    CaptureConfig config;
+    config.directory = directory;
+    config.deviceChannels = channels;
+    config.sampleRate = sampleRate;
+    for (int c = 0; c < channels; ++c) config.channels.push_back(c);
+    CaptureWriter writer;
+    if (!writer.start(config)) return 0;
+    const int64_t frames = (int64_t)(seconds * sampleRate);
+    const auto t0 = std::chrono::steady_clock::now();
+    runSyntheticCapture(writer, channels, sampleRate, frames, false);
+    const CaptureResult r = writer.stop();
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (out) {
+        out->channels = channels;
+        out->sampleRate = sampleRate;
+        out->framesWritten = r.framesWritten;
+        out->framesDropped = r.framesDropped;
+        out->audioSec = (double)r.framesWritten / sampleRate;
+        out->wallSec = wall;
+        out->megabytesPerSec = wall > 0.0 ? (double)r.framesWritten * channels * sizeof(int16_t) / (wall * 1.0e6) : 0.0;
+        out->realtimeFactor = wall > 0.0 ? out->audioSec / wall : 0.0;
+    }
+    return r.framesWritten == frames ? 1 : 0;
+}
+
+} // extern "C"
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine_shared.h"
+
+// Gravação multicanal. O thread de captura (callback AAudio de entrada, o
+// render do mixer no tap de saída ou a fonte sintética) só copia frames
+// intercalados para um ring lock-free; um thread de escrita grava WAVs 16-bit
+// em blocos grandes, com os dados começando em offset alinhado. Os arquivos
+// são pré-alocados em trechos grandes, então o writer não faz o sistema de
+// arquivos crescer o arquivo a cada bloco e o produtor nunca toca em disco.
+
+// Ring SPSC de frames int16 intercalados; não aloca depois de allocate()
+class FrameRing {
+public:
+    void allocate(int channels, size_t capacityFrames); // arredonda para potência de 2
+    // Produtor: devolve quantos frames couberam
+    size_t write(const int16_t* src, size_t frames);
+    // Consumidor: devolve quantos frames leu
+    size_t read(int16_t* dst, size_t maxFrames);
+    size_t available() const;
+    size_t capacity() const { return mMask + 1; }
+    int channels() const { return mChannels; }
+
+private:
+    std::vector<int16_t> mData;
+    size_t mMask = 0;
+    int mChannels = 1;
+    std::atomic<size_t> mHead{0};
+    std::atomic<size_t> mTail{0};
+};
+
+// startSongFrame de uma gravação que não chegou a tocar junto com o mixer
+static const int64_t kCaptureNotAligned = INT64_MIN;
+
+// Resultado de CaptureWriter::pushAs
+enum class CapturePush { Written, Idle, FormatMismatch };
+
+struct CaptureConfig {
+    std::string directory;      // grava "in_<canal>.wav" (1-based) por canal armado
+    int deviceChannels = 2;     // canais intercalados entregues pela fonte
+    std::vector<int> channels;  // canais armados (0-based)
+    int sampleRate = 48000;
+    // Não vazio: ignora `channels` e grava um único WAV intercalado com todos
+    // os canais, "<fileName>.wav", seguido de "<fileName>_2.wav"... perto do
+    // limite de 4 GB do RIFF
+    std::string fileName;
+    // Prioridade (nice) do thread de escrita; > 0 cede CPU ao áudio
+    int writerNice = 0;
+};
+
+struct CaptureResult {
+    std::vector<std::string> files;
+    std::vector<int> channels; // canal (0-based) de cada arquivo; -1 = intercalado
+    int64_t framesWritten = 0;
+    int64_t framesDropped = 0;
+    int64_t blocksDropped = 0; // pushes que perderam frames
+    // pushAs recusados por formato diferente do da gravação (nada gravado deles)
+    int64_t formatMismatchBlocks = 0;
+    // Frame da música correspondente ao primeiro frame gravado, na linha do
+    // tempo da primeira sessão que tocou durante a gravação. Negativo se a
+    // gravação começou antes do play (o frame 0 da música está -startSongFrame
+    // frames depois do início do take). kCaptureNotAligned sem playback.
+    int64_t startSongFrame = kCaptureNotAligned;
+};
+
+class CaptureWriter {
+public:
+    ~CaptureWriter();
+
+    // Cria e pré-aloca os arquivos e inicia o thread de escrita
+    bool start(const CaptureConfig &config);
+    // Thread de captura: nunca bloqueia; o que não couber no ring é contado
+    // como perdido. Pode correr junto com start/stop de outro thread: fora de
+    // uma gravação (ou durante a troca) os frames são descartados.
+    void push(const int16_t* interleaved, int frames);
+    // Igual a push() para um produtor com formato próprio (o tap de saída):
+    // só escreve se a gravação em curso tiver esses canais e taxa
+    CapturePush pushAs(const int16_t* interleaved, int frames, int channels, int sampleRate);
+    // Fonte sintética em modo benchmark: espera o writer em vez de perder frames
+    void pushBlocking(const int16_t* interleaved, int frames);
+    // Alinhamento com o playback: a captura marca o instante (CLOCK_MONOTONIC)
+    // do primeiro frame; o render, dono do stream de saída, converte esse
+    // instante em frame da música (mesmo que anterior ao play). Só o
+    // primeiro valor de cada um vale.
+    void markFirstFrame(int64_t timeNs);
+    int64_t firstFrameTimeNs() const { return mFirstFrameNs.load(std::memory_order_acquire); }
+    // Instante ainda não convertido; -1 se não houver
+    int64_t pendingAlignmentNs() const;
+    void setStartSongFrame(int64_t frame);
+    bool running() const { return mRunning.load(); }
+    int64_t framesWritten() const { return mFramesWritten.load(std::memory_order_relaxed); }
+    int64_t framesDropped() const { return mFramesDropped.load(std::memory_order_relaxed); }
+    int64_t blocksDropped() const { return mBlocksDropped.load(std::memory_order_relaxed); }
+    int64_t formatMismatchBlocks() const { return mFormatMismatches.load(std::memory_order_relaxed); }
+    // Gravação que ainda não recebeu nenhum frame passa para o formato dado
+    // (reabre os arquivos, ainda vazios). false se já tem áudio em outro
+    // formato ou se não há gravação. Não chamar junto com start/stop.
+    bool adoptFormat(int channels, int sampleRate);
+    // Formato da gravação atual (ou da última); seguros no thread de captura
+    int channels() const { return mChannels.load(std::memory_order_acquire); }
+    int sampleRate() const { return mSampleRate.load(std::memory_order_acquire); }
+    // Esvazia o ring, fecha os cabeçalhos e corta a pré-alocação não usada.
+    // Espera os push() em andamento saírem antes de soltar o ring.
+    CaptureResult stop();
+
+private:
+    struct ChannelFile {
+        int fd = -1;
+        int channel = 0; // -1 = todos os canais intercalados
+        int segment = 1;
+        std::string path;
+        size_t dataBytes = 0;
+        size_t reservedBytes = 0;
+    };
+
+    std::string segmentPath(int segment) const;
+    bool openFile(ChannelFile &f);
+    void finalizeFile(ChannelFile &f);
+    void writerLoop();
+    bool writeBytes(ChannelFile &f, const char* data, size_t bytes);
+    bool writeChunk(size_t frames);
+    void closeFiles();
+
+    CaptureConfig mConfig;
+    FrameRing mRing;
+    std::vector<ChannelFile> mFiles;
+    std::vector<std::string> mClosedSegments;
+    std::vector<int16_t> mInterleaved;
+    std::vector<int16_t> mPlanar;
+    std::thread mWriter;
+    std::atomic<bool> mRunning{false};
+    // push() só escreve no ring com mAccepting; mProducers conta quem está
+    // dentro dele, e stop() espera zerar antes do próximo start() realocar
+    std::atomic<bool> mAccepting{false};
+    std::atomic<int> mProducers{0};
+    std::atomic<int> mChannels{0};
+    std::atomic<int> mSampleRate{0};
+    std::atomic<bool> mStop{false};
+    std::atomic<bool> mWriteFailed{false};
+    std::atomic<int64_t> mFramesWritten{0};
+    std::atomic<int64_t> mFramesDropped{0};
+    std::atomic<int64_t> mBlocksDropped{0};
+    std::atomic<int64_t> mFormatMismatches{0};
+    std::atomic<int64_t> mStartSongFrame{kCaptureNotAligned};
+    std::atomic<int64_t> mFirstFrameNs{-1};
+};
+
+// Gera `frames` frames de senoides (uma frequência por canal) e entrega ao
+// writer em blocos de callback. realtime = ritmo de um dispositivo real (usa
+// push e pode perder frames); senão o mais rápido possível, sem perdas.
+void runSyntheticCapture(CaptureWriter &writer, int channels, int sampleRate, int64_t frames, bool realtime);
+
+// Resultado de mtp_capture_benchmark
+typedef struct MtpCaptureBenchmark {
+    int32_t channels;
+    int32_t sampleRate;
+    int64_t framesWritten;
+    int64_t framesDropped;
+    double audioSec;
+    double wallSec;
+    double megabytesPerSec;
+    double realtimeFactor; // segundos de áudio gravados por segundo de relógio
+} MtpCaptureBenchmark;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Grava `seconds` de entrada sintética com `channels` canais em `directory`
+// pelo mesmo caminho ring -> writer da captura real; devolve 0 se falhar.
+MTP_EXPORT int32_t mtp_capture_benchmark(const char* directory, int32_t channels, int32_t sampleRate,
+                                         double seconds, MtpCaptureBenchmark* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,115 @@
+#include "content_hash.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+static const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian, como todos os alvos do app
+static inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t val) {
+    acc ^= round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+ContentHasher::ContentHasher() {
+    mAcc[0] = kPrime1 + kPrime2;
+    mAcc[1] = kPrime2;
+    mAcc[2] = 0;
+    mAcc[3] = 0 - kPrime1;
+}
+
+void ContentHasher::update(const void* data, size_t n) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    mTotal += n;
+    if (mTailLen + n < 32) {
+        std::memcpy(mTail + mTailLen, p, n);
+        mTailLen += n;
+        return;
+    }
+    if (mTailLen > 0) {
+        const size_t take = 32 - mTailLen;
+        std::memcpy(mTail + mTailLen, p, take);
+        for (int i = 0; i < 4; ++i) mAcc[i] = round(mAcc[i], read64(mTail + 8 * i));
+        p += take;
+        n -= take;
+        mTailLen = 0;
+    }
+    // Quatro acumuladores independentes: o laço principal não espera multiplicações
+    uint64_t a0 = mAcc[0], a1 = mAcc[1], a2 = mAcc[2], a3 = mAcc[3];
+    for (; n >= 32; p += 32, n -= 32) {
+        a0 = round(a0, read64(p));
+        a1 = round(a1, read64(p + 8));
+        a2 = round(a2, read64(p + 16));
+        a3 = round(a3, read64(p + 24));
+    }
+    mAcc[0] = a0; mAcc[1] = a1; mAcc[2] = a2; mAcc[3] = a3;
+    std::memcpy(mTail, p, n);
+    mTailLen = n;
+}
+
+uint64_t ContentHasher::digest() const {
+    uint64_t h;
+    if (mTotal >= 32) {
+        h = rotl(mAcc[0], 1) + rotl(mAcc[1], 7) + rotl(mAcc[2], 12) + rotl(mAcc[3], 18);
+        for (int i = 0; i < 4; ++i) h = mergeRound(h, mAcc[i]);
+    } else {
+        h = mAcc[2] + kPrime5;
+    }
+    h += mTotal;
+    const unsigned char* p = mTail;
+    size_t n = mTailLen;
+    for (; n >= 8; p += 8, n -= 8) h = rotl(h ^ round(0, read64(p)), 27) * kPrime1 + kPrime4;
+    if (n >= 4) {
+        h = rotl(h ^ ((uint64_t)read32(p) * kPrime1), 23) * kPrime2 + kPrime3;
+        p += 4;
+        n -= 4;
+    }
+    for (; n > 0; ++p, --n) h = rotl(h ^ ((uint64_t)*p * kPrime5), 11) * kPrime1;
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string contentHashHex(uint64_t hash) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+    return buf;
+}
+
+std::string contentAddressedPath(const std::string &path, uint64_t hash) {
+    const size_t slash = path.find_last_of('/');
+    const size_t dot = path.find_last_of('.');
+    const std::string dir = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    const std::string ext = dot != std::string::npos && (slash == std::string::npos || dot > slash)
+                                ? path.substr(dot) : std::string();
+    return dir + contentHashHex(hash) + ext;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Hash de conteúdo dos stems (XXH64, semente 0), calculado em streaming na
+// mesma leitura da importação. Stems com os mesmos bytes têm o mesmo hash e
+// são gravados uma vez só, em audio/<hash em hex><extensão>; todas as músicas
+// apontam para esse arquivo, e os caches por caminho (probe, mapa de
+// silêncio, índice de análise, preload) passam a valer por conteúdo.
+
+class ContentHasher {
+public:
+    ContentHasher();
+    void update(const void* data, size_t n);
+    uint64_t digest() const;
+
+private:
+    uint64_t mAcc[4];
+    unsigned char mTail[32];
+    size_t mTailLen = 0;
+    uint64_t mTotal = 0;
+};
+
+// 16 dígitos hex minúsculos
+std::string contentHashHex(uint64_t hash);
+
+// Caminho endereçado pelo conteúdo no mesmo diretório e com a mesma
+// extensão de `path` (ex.: audio/<uuid>.wav -> audio/<hash>.wav)
+std::string contentAddressedPath(const std::string &path, uint64_t hash);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "capture.h"
+#include "mix_graph.h"
+
+// Engine do mixer visto pelas pontes de plataforma: o JNI do MainActivity
+// (jni_bridge.cpp) e o plugin do runner Linux (linux/audio_engine). As pontes
+// só convertem argumentos; a semântica é a dos métodos do MethodChannel
+// audio_usb/methods. O caminho rápido do Dart (faders, medidores, seek) fica
+// no C ABI de engine_shared.h, igual nas duas plataformas.
+
+struct EngineTrack {
+    std::string path;
+    int outputChannel = 0; // 0=L, 1=R, >=2 par LR
+    float volume = 1.0f;
+    float pan = 0.0f;
+};
+
+// BPM e confiança do WAV; false (valores padrão em bpm/confidence) se não
+// der para analisar
+bool engineDetectBpm(const std::string &path, double &bpm, double &confidence);
+// Taxa do WAV pelo probe compartilhado; 0 se inválido
+int engineProbeSampleRate(const std::string &path);
+
+// Buses do próximo enginePlayAll: trackBuses[i] é o bus da track i (-1 =
+// direto na saída)
+void engineSetMixGraph(std::vector<int> trackBuses, std::vector<MixBusConfig> buses);
+// Mixes auxiliares do próximo enginePlayAll: auxOutputs[a] é o primeiro canal
+// do par do aux a; `sends` tem os níveis track x aux (track-major)
+void engineSetAuxSends(const std::vector<int> &auxOutputs, const std::vector<float> &sends);
+
+// `deviceId` <= 0: saída padrão da plataforma
+bool enginePlayAll(std::vector<EngineTrack> tracks, int deviceId, int deviceChannels);
+// Abre e lê o início das fontes do próximo play (e o stream, com o mixer
+// parado). Chamar fora do thread da UI.
+bool enginePrepareAll(std::vector<std::string> paths, std::vector<int> outputChannels, int deviceId,
+                      int deviceChannels);
+void engineSeek(double positionSec);
+// Preview de um WAV PCM16 num canal (ou par) da interface
+bool enginePlayPreview(const std::string &path, int outputChannel, int deviceId, int deviceChannels);
+// Para o render e fecha o stream
+void engineStopPreview();
+// Troca de música: para o render e mantém o stream aberto para o próximo play
+void engineStopMixer();
+// Interface atual (id) ou nenhuma (-1); o mixer esperando a interface voltar
+// reabre o stream nela
+void engineSetOutputDevice(int deviceId);
+void engineSetPreviewVolume(float volume);
+void engineSetPreviewPan(float pan);
+bool engineSetTrackParam(int32_t track, int32_t param, float value);
+bool engineSetBusParam(int32_t bus, int32_t param, float value);
+bool engineSetAuxSend(int32_t track, int32_t aux, float level);
+
+// Tap de saída: grava o bloco final do mixer. Com o mixer tocando, o formato
+// vem da sessão; senão de config.deviceChannels/sampleRate, trocado pelo da
+// próxima sessão se nada tiver sido gravado até ela começar.
+bool engineStartOutputTap(CaptureConfig config);
+CaptureResult engineStopOutputTap();
+// [gravando (0/1), canais, sampleRate, framesWritten, framesDropped,
+//  blocksDropped, formatMismatchBlocks]; os contadores continuam valendo
+// depois do stop. formatMismatchBlocks > 0 = sessões em outro formato que o
+// tap não gravou.
+void engineOutputTapStats(int64_t out[7]);
+
+// Gravação da entrada. O stream de entrada é da plataforma (AAudio na ponte
+// JNI) e só alimenta o writer; o render alinha o primeiro frame com a música.
+extern CaptureWriter gCapture;
@@ -0,0 +1,18 @@
+#pragma once
+
+// Log do engine: logcat no Android, stderr nos builds de desktop
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, "multichannel_preview", __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "multichannel_preview", __VA_ARGS__)
+#else
+#include <cstdio>
+#define MTP_LOG_STDERR(level, ...)                                   \
+    do {                                                             \
+        std::fprintf(stderr, "multichannel_preview %s: ", level);    \
+        std::fprintf(stderr, __VA_ARGS__);                           \
+        std::fputc('\n', stderr);                                    \
+    } while (0)
+#define LOGI(...) MTP_LOG_STDERR("I", __VA_ARGS__)
+#define LOGE(...) MTP_LOG_STDERR("E", __VA_ARGS__)
+#endif
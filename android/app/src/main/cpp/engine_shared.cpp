@@ -0,0 +1,31 @@
+#include "engine_shared.h"
+
+MtpSharedBlock gShared = {};
+
+void engineSharedBeginSession(int sampleRate, int outputChannels, int trackCount, int busCount) {
+    sharedStore(gShared.status[MTP_STATUS_MIXING], (int32_t)0);
+    sharedStore(gShared.status[MTP_STATUS_SAMPLE_RATE], (int32_t)sampleRate);
+    sharedStore(gShared.status[MTP_STATUS_OUTPUT_CHANNELS], (int32_t)outputChannels);
+    sharedStore(gShared.status[MTP_STATUS_TRACK_COUNT], (int32_t)trackCount);
+    sharedStore(gShared.status[MTP_STATUS_BUS_COUNT], (int32_t)busCount);
+    sharedStore(gShared.status[MTP_STATUS_OUTPUT_LOST], (int32_t)0);
+    sharedStore(gShared.positionFrames, (int64_t)0);
+    for (float& p : gShared.outputPeaks) sharedStore(p, 0.0f);
+    for (float& p : gShared.trackPeaks) sharedStore(p, 0.0f);
+}
+
+extern "C" {
+
+uint32_t mtp_layout_version(void) { return MTP_LAYOUT_VERSION; }
+int32_t* mtp_status(void) { return gShared.status; }
+int64_t mtp_position_frames(void) { return sharedLoad(gShared.positionFrames); }
+float* mtp_output_peaks(void) { return gShared.outputPeaks; }
+float* mtp_track_peaks(void) { return gShared.trackPeaks; }
+float* mtp_track_volumes(void) { return gShared.trackVolumes; }
+float* mtp_track_pans(void) { return gShared.trackPans; }
+float* mtp_track_mutes(void) { return gShared.trackMutes; }
+float* mtp_bus_volumes(void) { return gShared.busVolumes; }
+float* mtp_bus_pans(void) { return gShared.busPans; }
+float* mtp_bus_mutes(void) { return gShared.busMutes; }
+
+} // extern "C"
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+
+// Bloco de memória compartilhado entre o controle (Dart via dart:ffi, ou JNI)
+// e o thread de render. Parâmetros contínuos (volume, pan, mute de tracks e
+// buses) são escritos diretamente aqui e o render lê o bloco inteiro a cada
+// bloco de áudio, então mexer num fader não passa por MethodChannel, JNI nem
+// fila. Cada campo é um float/int32 alinhado e independente; não há ordem
+// entre campos a respeitar.
+//
+// A parte "status" é escrita só pelo render e lida pelo Dart como views
+// tipadas (Float32List/Int32List) sem cópia. O layout é exportado campo a
+// campo pelas funções mtp_* abaixo; MTP_LAYOUT_VERSION muda quando ele mudar.
+
+#define MTP_LAYOUT_VERSION 3
+#define MTP_MAX_TRACKS 64
+#define MTP_MAX_BUSES 32
+#define MTP_MAX_OUT_CHANNELS 32
+// Bandas do analisador de espectro (spectrum.h) e piso delas em dBFS
+#define MTP_SPECTRUM_BINS 64
+#define MTP_SPECTRUM_MIN_DB -90.0f
+
+// Índices de mtp_status()
+enum MtpStatusIndex {
+    MTP_STATUS_MIXING = 0,      // 1 enquanto o mixer nativo está rodando
+    MTP_STATUS_SAMPLE_RATE,
+    MTP_STATUS_TRACK_COUNT,
+    MTP_STATUS_BUS_COUNT,
+    MTP_STATUS_OUTPUT_CHANNELS,
+    MTP_STATUS_OUTPUT_LOST,     // 1 enquanto o stream de saída caiu e está sendo reaberto
+    MTP_STATUS_COUNT
+};
+
+typedef struct MtpSharedBlock {
+    // Escritos pelo render
+    int32_t status[MTP_STATUS_COUNT];
+    int64_t positionFrames;
+    float outputPeaks[MTP_MAX_OUT_CHANNELS];
+    float trackPeaks[MTP_MAX_TRACKS];
+    // Escritos pelo thread de análise do espectro
+    int32_t spectrumFrame;
+    float spectrumCorrelation;
+    float spectrumBins[MTP_SPECTRUM_BINS];
+    // Escritos pelo controle
+    float trackVolumes[MTP_MAX_TRACKS];
+    float trackPans[MTP_MAX_TRACKS];
+    float trackMutes[MTP_MAX_TRACKS];
+    float busVolumes[MTP_MAX_BUSES];
+    float busPans[MTP_MAX_BUSES];
+    float busMutes[MTP_MAX_BUSES];
+} MtpSharedBlock;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MTP_EXPORT __attribute__((visibility("default"))) __attribute__((used))
+
+MTP_EXPORT uint32_t mtp_layout_version(void);
+MTP_EXPORT int32_t* mtp_status(void);
+MTP_EXPORT int64_t mtp_position_frames(void);
+MTP_EXPORT float* mtp_output_peaks(void);
+MTP_EXPORT float* mtp_track_peaks(void);
+MTP_EXPORT float* mtp_track_volumes(void);
+MTP_EXPORT float* mtp_track_pans(void);
+MTP_EXPORT float* mtp_track_mutes(void);
+MTP_EXPORT float* mtp_bus_volumes(void);
+MTP_EXPORT float* mtp_bus_pans(void);
+MTP_EXPORT float* mtp_bus_mutes(void);
+
+// Parâmetros discretos (inserts) seguem pela fila do render; devolve 0 se a fila estiver cheia.
+MTP_EXPORT int32_t mtp_set_track_param(int32_t track, int32_t param, float value);
+MTP_EXPORT int32_t mtp_set_bus_param(int32_t bus, int32_t param, float value);
+// Nível (0..1) do envio da track para o aux (mix de in-ear) em execução
+MTP_EXPORT int32_t mtp_set_aux_send(int32_t track, int32_t aux, float level);
+
+// Transporte
+MTP_EXPORT void mtp_seek_seconds(double positionSec);
+
+// Trim de loudness da música em dB (-24..+12), aplicado na saída com o volume
+// geral; vale para a sessão atual e as próximas até mudar
+MTP_EXPORT void mtp_set_song_trim_db(float db);
+
+#ifdef __cplusplus
+}
+
+extern MtpSharedBlock gShared;
+
+// Acesso do lado C++: loads/stores atômicos relaxados campo a campo (o Dart
+// escreve com stores simples alinhados, que já são atômicos nesses tamanhos).
+template <typename T>
+inline T sharedLoad(const T& field) {
+    T v;
+    __atomic_load(&field, &v, __ATOMIC_RELAXED);
+    return v;
+}
+
+template <typename T>
+inline void sharedStore(T& field, T v) {
+    __atomic_store(&field, &v, __ATOMIC_RELAXED);
+}
+
+// Zera medidores e posição e publica o formato da sessão; `mixing` fica em 0
+// até o thread de render começar.
+void engineSharedBeginSession(int sampleRate, int outputChannels, int trackCount, int busCount);
+#endif
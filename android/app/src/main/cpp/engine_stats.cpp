@@ -0,0 +1,110 @@
+#include "engine_stats.h"
+
+#include <algorithm>
+
+EngineStats gEngineStats;
+
+static const float kEwma = 0.05f;
+
+static void ewma(std::atomic<float>& slot, double sample) {
+    const float prev = slot.load(std::memory_order_relaxed);
+    slot.store(prev + kEwma * ((float)sample - prev), std::memory_order_relaxed);
+}
+
+// Média com vários escritores (threads de classes diferentes acordando ao
+// mesmo tempo): CAS em vez de load/store, para nenhuma amostra se perder
+static void ewmaShared(std::atomic<float>& slot, double sample) {
+    float prev = slot.load(std::memory_order_relaxed);
+    while (!slot.compare_exchange_weak(prev, prev + kEwma * ((float)sample - prev), std::memory_order_relaxed)) {}
+}
+
+void engineStatsReset(int trackCount, double blockBudgetUs) {
+    gEngineStats.blocks.store(0);
+    gEngineStats.paramsApplied.store(0);
+    gEngineStats.paramsDropped.store(0);
+    gEngineStats.avgBlockUs.store(0.0f);
+    gEngineStats.maxBlockUs.store(0.0f);
+    gEngineStats.avgInsertUs.store(0.0f);
+    gEngineStats.blockBudgetUs.store((float)blockBudgetUs);
+    gEngineStats.trackCount.store(std::max(0, std::min(trackCount, kMaxStatTracks)));
+    gEngineStats.inlineJobs.store(0);
+    gEngineStats.deadlineMisses.store(0);
+    gEngineStats.avgJoinWaitUs.store(0.0f);
+    gEngineStats.firstSampleUs.store(0.0f);
+    gEngineStats.streamRecoveries.store(0);
+    gEngineStats.silentTrackBlocks.store(0);
+    gEngineStats.sharedOutput.store(0);
+    gEngineStats.outputConverted.store(0);
+    gEngineStats.streamIoMisses.store(0);
+    for (int c = 0; c < kThreadClassCount; ++c) {
+        gEngineStats.wakeAvgUs[c].store(0.0f);
+        gEngineStats.wakeMaxUs[c].store(0.0f);
+    }
+    for (auto& t : gEngineStats.trackInsertUs) t.store(0.0f);
+}
+
+void engineStatsRecordBlock(double blockUs, double insertUs) {
+    gEngineStats.blocks.fetch_add(1, std::memory_order_relaxed);
+    ewma(gEngineStats.avgBlockUs, blockUs);
+    ewma(gEngineStats.avgInsertUs, insertUs);
+    if ((float)blockUs > gEngineStats.maxBlockUs.load(std::memory_order_relaxed)) {
+        gEngineStats.maxBlockUs.store((float)blockUs, std::memory_order_relaxed);
+    }
+}
+
+void engineStatsRecordTrackInsert(int track, double us) {
+    if (track < 0 || track >= kMaxStatTracks) return;
+    ewma(gEngineStats.trackInsertUs[track], us);
+}
+
+void engineStatsRecordJoin(int inlineJobs, bool missedDeadline, double joinWaitUs) {
+    if (inlineJobs > 0) gEngineStats.inlineJobs.fetch_add((uint64_t)inlineJobs, std::memory_order_relaxed);
+    if (missedDeadline) gEngineStats.deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+    ewma(gEngineStats.avgJoinWaitUs, joinWaitUs);
+}
+
+void engineStatsRecordWake(int threadClass, double us) {
+    if (threadClass < 0 || threadClass >= kThreadClassCount) return;
+    ewmaShared(gEngineStats.wakeAvgUs[threadClass], us);
+    std::atomic<float>& max = gEngineStats.wakeMaxUs[threadClass];
+    float prev = max.load(std::memory_order_relaxed);
+    while ((float)us > prev && !max.compare_exchange_weak(prev, (float)us, std::memory_order_relaxed)) {}
+}
+
+int engineStatsSnapshot(double* out, int cap) {
+    if (!out || cap < STAT_HEADER_COUNT) return 0;
+    const int tracks = gEngineStats.trackCount.load();
+    out[STAT_BLOCKS] = (double)gEngineStats.blocks.load();
+    out[STAT_AVG_BLOCK_US] = gEngineStats.avgBlockUs.load();
+    out[STAT_MAX_BLOCK_US] = gEngineStats.maxBlockUs.load();
+    out[STAT_AVG_INSERT_US] = gEngineStats.avgInsertUs.load();
+    out[STAT_BLOCK_BUDGET_US] = gEngineStats.blockBudgetUs.load();
+    out[STAT_PARAMS_APPLIED] = (double)gEngineStats.paramsApplied.load();
+    out[STAT_PARAMS_DROPPED] = (double)gEngineStats.paramsDropped.load();
+    out[STAT_TRACK_COUNT] = (double)tracks;
+    out[STAT_RENDER_WORKERS] = (double)gEngineStats.renderWorkers.load();
+    out[STAT_INLINE_JOBS] = (double)gEngineStats.inlineJobs.load();
+    out[STAT_DEADLINE_MISSES] = (double)gEngineStats.deadlineMisses.load();
+    out[STAT_AVG_JOIN_WAIT_US] = gEngineStats.avgJoinWaitUs.load();
+    out[STAT_BUS_COUNT] = (double)gEngineStats.busCount.load();
+    out[STAT_BUS_BUFFERS] = (double)gEngineStats.busBuffers.load();
+    out[STAT_FIRST_SAMPLE_US] = gEngineStats.firstSampleUs.load();
+    out[STAT_PREPARED_TRACKS] = (double)gEngineStats.preparedTracks.load();
+    out[STAT_PREPARED_STREAM] = (double)gEngineStats.preparedStream.load();
+    out[STAT_STREAM_RECOVERIES] = (double)gEngineStats.streamRecoveries.load();
+    out[STAT_SILENT_TRACK_BLOCKS] = (double)gEngineStats.silentTrackBlocks.load();
+    out[STAT_SHARED_OUTPUT] = (double)gEngineStats.sharedOutput.load();
+    out[STAT_OUTPUT_CONVERTED] = (double)gEngineStats.outputConverted.load();
+    out[STAT_RENDER_REALTIME] = (double)gEngineStats.renderRealtime.load();
+    for (int c = 0; c < kThreadClassCount; ++c) {
+        out[STAT_RENDER_WAKE_AVG_US + 2 * c] = gEngineStats.wakeAvgUs[c].load();
+        out[STAT_RENDER_WAKE_MAX_US + 2 * c] = gEngineStats.wakeMaxUs[c].load();
+    }
+    out[STAT_STREAM_IO_BACKEND] = (double)gEngineStats.streamIoBackend.load();
+    out[STAT_STREAM_IO_MISSES] = (double)gEngineStats.streamIoMisses.load();
+    int n = STAT_HEADER_COUNT;
+    for (int t = 0; t < tracks && n < cap; ++t) {
+        out[n++] = gEngineStats.trackInsertUs[t].load();
+    }
+    return n;
+}
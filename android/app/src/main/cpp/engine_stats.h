@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "thread_topology.h"
+
+// Estatísticas do thread de render. Escritas apenas pelo thread de render e
+// lidas a qualquer momento pelo JNI (nativeGetEngineStats); as médias são
+// móveis exponenciais para suavizar a leitura na UI.
+constexpr int kMaxStatTracks = 64;
+
+// Índices do vetor devolvido por engineStatsSnapshot. A ordem é espelhada em
+// MainActivity.kt (ENGINE_STAT_KEYS) e no plugin Linux (kEngineStatKeys); o
+// custo por track vem logo depois.
+enum EngineStatIndex {
+    STAT_BLOCKS = 0,
+    STAT_AVG_BLOCK_US,
+    STAT_MAX_BLOCK_US,
+    STAT_AVG_INSERT_US,
+    STAT_BLOCK_BUDGET_US,
+    STAT_PARAMS_APPLIED,
+    STAT_PARAMS_DROPPED,
+    STAT_TRACK_COUNT,
+    STAT_RENDER_WORKERS,
+    STAT_INLINE_JOBS,
+    STAT_DEADLINE_MISSES,
+    STAT_AVG_JOIN_WAIT_US,
+    STAT_BUS_COUNT,
+    STAT_BUS_BUFFERS,
+    STAT_FIRST_SAMPLE_US,   // do comando play até a interface aceitar o 1o bloco
+    STAT_PREPARED_TRACKS,   // tracks que vieram prontas de nativePrepareAllPreview
+    STAT_PREPARED_STREAM,   // 0 = stream novo, 1 = aberto pelo prepare, 2 = reaproveitado
+    STAT_STREAM_RECOVERIES, // streams reabertos depois de desconexão nesta sessão
+    STAT_SILENT_TRACK_BLOCKS, // blocos de track não somados por estarem em silêncio
+    STAT_SHARED_OUTPUT,     // 1 = stream de saída em modo compartilhado (exclusivo recusado)
+    STAT_OUTPUT_CONVERTED,  // 1 = render convertendo taxa/canais/formato para o stream
+    STAT_RENDER_REALTIME,   // 1 = render em SCHED_FIFO, 0 = só nice, -1 = nenhum dos dois
+    // Atraso de acordar por classe de thread (thread_topology.h), média e máximo
+    STAT_RENDER_WAKE_AVG_US,
+    STAT_RENDER_WAKE_MAX_US,
+    STAT_WORKER_WAKE_AVG_US,
+    STAT_WORKER_WAKE_MAX_US,
+    STAT_IO_WAKE_AVG_US,
+    STAT_IO_WAKE_MAX_US,
+    STAT_ANALYSIS_WAKE_AVG_US,
+    STAT_ANALYSIS_WAKE_MAX_US,
+    STAT_STREAM_IO_BACKEND, // IoBackend do streaming de stems (0 = nenhum, 1 = pread, 2 = io_uring)
+    STAT_STREAM_IO_MISSES,  // chunk não chegou a tempo: leitura direta do render (prefetcher) ou silêncio (pacote)
+    STAT_HEADER_COUNT
+};
+
+struct EngineStats {
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> paramsApplied{0};
+    std::atomic<uint64_t> paramsDropped{0};
+    std::atomic<float> avgBlockUs{0.0f};
+    std::atomic<float> maxBlockUs{0.0f};
+    std::atomic<float> avgInsertUs{0.0f};
+    std::atomic<float> blockBudgetUs{0.0f};
+    std::atomic<int> trackCount{0};
+    std::atomic<int> renderWorkers{0};
+    std::atomic<uint64_t> inlineJobs{0};
+    std::atomic<uint64_t> deadlineMisses{0};
+    std::atomic<float> avgJoinWaitUs{0.0f};
+    std::atomic<int> busCount{0};
+    std::atomic<int> busBuffers{0};
+    std::atomic<float> firstSampleUs{0.0f};
+    std::atomic<int> preparedTracks{0};
+    std::atomic<int> preparedStream{0};
+    std::atomic<int> streamRecoveries{0};
+    std::atomic<uint64_t> silentTrackBlocks{0};
+    std::atomic<int> sharedOutput{0};
+    std::atomic<int> outputConverted{0};
+    std::atomic<int> renderRealtime{-1};
+    std::atomic<int> streamIoBackend{0};
+    std::atomic<uint64_t> streamIoMisses{0};
+    std::atomic<float> wakeAvgUs[kThreadClassCount];
+    std::atomic<float> wakeMaxUs[kThreadClassCount];
+    std::atomic<float> trackInsertUs[kMaxStatTracks];
+};
+
+extern EngineStats gEngineStats;
+
+void engineStatsReset(int trackCount, double blockBudgetUs);
+void engineStatsRecordBlock(double blockUs, double insertUs);
+void engineStatsRecordTrackInsert(int track, double us);
+// Resultado do fork/join de um bloco (RenderPool::run)
+void engineStatsRecordJoin(int inlineJobs, bool missedDeadline, double joinWaitUs);
+// Atraso de acordar de um thread da classe `threadClass` (ThreadClass); chamado
+// de qualquer thread
+void engineStatsRecordWake(int threadClass, double us);
+
+// Copia um retrato das estatísticas para `out` e devolve quantos valores
+// foram escritos (STAT_HEADER_COUNT + trackCount, limitado a `cap`).
+int engineStatsSnapshot(double* out, int cap);
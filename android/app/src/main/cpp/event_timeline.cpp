@@ -0,0 +1,100 @@
+#include "event_timeline.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "param_queue.h"
+
+TimelineSlot gTimelineSlot;
+
+EventTimeline::EventTimeline(const MtpTimelineEvent* events, int count, int sampleRate)
+    : mRate(sampleRate > 0 ? sampleRate : 48000), mOutRate(mRate) {
+    if (events && count > 0) mEvents.assign(events, events + count);
+    mEvents.erase(std::remove_if(mEvents.begin(), mEvents.end(),
+                                 [](const MtpTimelineEvent &e) {
+                                     return e.frame < 0 || e.index < 0 || e.param < 0 || e.param >= PARAM_COUNT;
+                                 }),
+                  mEvents.end());
+    std::stable_sort(mEvents.begin(), mEvents.end(),
+                     [](const MtpTimelineEvent &a, const MtpTimelineEvent &b) { return a.frame < b.frame; });
+
+    std::map<std::tuple<int32_t, int32_t, int32_t>, int> keyIds;
+    mKeyOf.resize(mEvents.size());
+    mNextInKey.assign(mEvents.size(), -1);
+    for (size_t i = 0; i < mEvents.size(); ++i) {
+        MtpTimelineEvent &e = mEvents[i];
+        // Mute é sempre degrau; rampa sem ponto anterior vira degrau
+        if (e.param == PARAM_MUTE) e.curve = MTP_CURVE_STEP;
+        const auto id = std::make_tuple(e.target, e.index, e.param);
+        auto it = keyIds.find(id);
+        if (it == keyIds.end()) {
+            it = keyIds.emplace(id, (int)mKeys.size()).first;
+            mKeys.push_back(Key{e.target, e.index, e.param, {}});
+            e.curve = MTP_CURVE_STEP;
+        }
+        Key &key = mKeys[it->second];
+        if (!key.events.empty()) mNextInKey[key.events.back()] = (int)i;
+        key.events.push_back((int)i);
+        mKeyOf[i] = it->second;
+    }
+    mKeyLast.assign(mKeys.size(), -1);
+}
+
+// Primeiro frame da sessão em que o evento vale (arredonda para cima)
+int64_t EventTimeline::sessionFrame(int64_t frame) const {
+    if (mOutRate == mRate) return frame;
+    return (frame * mOutRate + mRate - 1) / mRate;
+}
+
+double EventTimeline::valueAt(int event, int64_t position) const {
+    const MtpTimelineEvent &a = mEvents[event];
+    const int next = mNextInKey[event];
+    if (next < 0 || mEvents[next].curve != MTP_CURVE_RAMP) return a.value;
+    const MtpTimelineEvent &b = mEvents[next];
+    const double t0 = (double)a.frame * mOutRate / mRate;
+    const double t1 = (double)b.frame * mOutRate / mRate;
+    if (t1 <= t0) return b.value;
+    const double u = std::max(0.0, std::min(1.0, ((double)position - t0) / (t1 - t0)));
+    return a.value + (b.value - a.value) * u;
+}
+
+int64_t EventTimeline::nextEventFrame() const {
+    return mCursor < mEvents.size() ? sessionFrame(mEvents[mCursor].frame) : -1;
+}
+
+void TimelineSlot::publish(EventTimeline* timeline) {
+    delete mRetired.exchange(nullptr, std::memory_order_acq_rel);
+    // Uma pendente que o render ainda não pegou nunca foi vista por ele
+    delete mPending.exchange(timeline ? timeline : new EventTimeline(nullptr, 0, 0), std::memory_order_acq_rel);
+}
+
+bool TimelineSlot::acquire(EventTimeline*& current) {
+    if (mPending.load(std::memory_order_acquire) == nullptr) return false;
+    // Slot de aposentadoria ocupado: o controle libera na próxima publicação
+    if (current && mRetired.load(std::memory_order_acquire) != nullptr) return false;
+    EventTimeline* next = mPending.exchange(nullptr, std::memory_order_acq_rel);
+    if (!next) return false;
+    if (current) mRetired.store(current, std::memory_order_release);
+    current = next;
+    return true;
+}
+
+void TimelineSlot::release(EventTimeline* current) {
+    if (!current) return;
+    EventTimeline* expected = nullptr;
+    // Se o controle já publicou outra, esta não serve mais; fora do tempo real, pode liberar aqui
+    if (!mPending.compare_exchange_strong(expected, current, std::memory_order_acq_rel)) delete current;
+}
+
+extern "C" {
+
+void mtp_timeline_set(const MtpTimelineEvent* events, int32_t count, int32_t sampleRate) {
+    gTimelineSlot.publish(new EventTimeline(events, count > 0 ? count : 0, sampleRate));
+}
+
+void mtp_timeline_clear(void) {
+    gTimelineSlot.publish(nullptr);
+}
+
+} // extern "C"
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "engine_shared.h"
+
+// Timeline de eventos agendados da música (automação de volume/pan, mutes,
+// parâmetros de insert e de bus). O controle publica a timeline inteira de
+// uma vez; o render a consome em frames exatos, cortando o bloco no frame do
+// próximo evento, então a automação não depende de timer no Dart e toca
+// igual em todo show.
+
+enum MtpTimelineCurve {
+    MTP_CURVE_STEP = 0, // vale a partir do frame do evento
+    MTP_CURVE_RAMP = 1  // rampa linear desde o evento anterior do mesmo parâmetro
+};
+
+// Layout C espelhado no Dart (32 bytes)
+typedef struct MtpTimelineEvent {
+    int64_t frame;   // na taxa declarada em mtp_timeline_set
+    int32_t target;  // ParamTarget (track ou bus)
+    int32_t index;   // índice da track ou do bus
+    int32_t param;   // ParamId
+    int32_t curve;   // MtpTimelineCurve
+    float value;
+    int32_t reserved;
+} MtpTimelineEvent;
+
+// Imutável depois de publicada, exceto pelo cursor de reprodução, que só o
+// render usa (a timeline pertence a um único thread de render por vez).
+class EventTimeline {
+public:
+    EventTimeline(const MtpTimelineEvent* events, int count, int sampleRate);
+
+    bool empty() const { return mEvents.empty(); }
+
+    // Tudo abaixo: só o render, com frames da sessão
+    void setSessionRate(int outRate) { mOutRate = outRate > 0 ? outRate : mRate; }
+    // Reposiciona o cursor (seek, salto, timeline nova) e aplica o valor
+    // vigente de cada parâmetro já automatizado antes de `position`
+    template <typename Apply> void locate(int64_t position, Apply apply);
+    // Aplica os eventos com frame <= position
+    template <typename Apply> void processUpTo(int64_t position, Apply apply);
+    // Parâmetros em rampa recebem o valor do fim do bloco
+    template <typename Apply> void updateRamps(int64_t blockEnd, Apply apply);
+    // Frame da sessão do próximo evento ainda não aplicado; -1 se não houver
+    int64_t nextEventFrame() const;
+
+private:
+    struct Key {
+        int32_t target, index, param;
+        std::vector<int> events; // índices em mEvents, ordenados por frame
+    };
+
+    int64_t sessionFrame(int64_t frame) const;
+    double valueAt(int event, int64_t position) const;
+
+    std::vector<MtpTimelineEvent> mEvents; // ordenado por frame (estável)
+    std::vector<int> mKeyOf;
+    std::vector<int> mNextInKey;
+    std::vector<Key> mKeys;
+    int mRate = 48000;
+
+    // Cursor do render
+    int mOutRate = 48000;
+    size_t mCursor = 0;
+    std::vector<int> mKeyLast; // último evento aplicado por chave (-1)
+};
+
+// Passagem da timeline do controle para o render sem lock nem alocação no
+// render: o controle publica num slot e libera a timeline que o render
+// aposentou na troca anterior.
+class TimelineSlot {
+public:
+    // Controle; nullptr limpa a timeline
+    void publish(EventTimeline* timeline);
+    // Render: troca `current` pela pendente, se houver; true se trocou
+    bool acquire(EventTimeline*& current);
+    // Fim da sessão (render): devolve a timeline para a próxima sessão
+    void release(EventTimeline* current);
+
+private:
+    std::atomic<EventTimeline*> mPending{nullptr};
+    std::atomic<EventTimeline*> mRetired{nullptr};
+};
+
+extern TimelineSlot gTimelineSlot;
+
+template <typename Apply>
+void EventTimeline::locate(int64_t position, Apply apply) {
+    mCursor = 0;
+    while (mCursor < mEvents.size() && sessionFrame(mEvents[mCursor].frame) < position) ++mCursor;
+    for (size_t k = 0; k < mKeys.size(); ++k) {
+        const Key &key = mKeys[k];
+        int last = -1;
+        for (int e : key.events) {
+            if (sessionFrame(mEvents[e].frame) >= position) break;
+            last = e;
+        }
+        mKeyLast[k] = last;
+        if (last >= 0) apply(key.target, key.index, key.param, (float)valueAt(last, position));
+    }
+}
+
+template <typename Apply>
+void EventTimeline::processUpTo(int64_t position, Apply apply) {
+    while (mCursor < mEvents.size() && sessionFrame(mEvents[mCursor].frame) <= position) {
+        const MtpTimelineEvent &e = mEvents[mCursor];
+        mKeyLast[mKeyOf[mCursor]] = (int)mCursor;
+        apply(e.target, e.index, e.param, e.value);
+        ++mCursor;
+    }
+}
+
+template <typename Apply>
+void EventTimeline::updateRamps(int64_t blockEnd, Apply apply) {
+    for (size_t k = 0; k < mKeys.size(); ++k) {
+        const int last = mKeyLast[k];
+        if (last < 0) continue;
+        const int next = mNextInKey[last];
+        if (next < 0 || mEvents[next].curve != MTP_CURVE_RAMP) continue;
+        apply(mKeys[k].target, mKeys[k].index, mKeys[k].param, (float)valueAt(last, blockEnd));
+    }
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Substitui a timeline (ordenada aqui); count <= 0 limpa. sampleRate é a
+// base dos frames dos eventos (ex.: 1000 para milissegundos).
+MTP_EXPORT void mtp_timeline_set(const MtpTimelineEvent* events, int32_t count, int32_t sampleRate);
+MTP_EXPORT void mtp_timeline_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,282 @@
+#include "file_probe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "wav_io.h"
+
+ProbeCache gProbeCache;
+
+static const char kCacheMagic[4] = { 'M', 'T', 'P', 'C' };
+// Muda quando MtpFileProbe, MtpLoudness ou o formato do arquivo mudarem
+static const uint32_t kCacheVersion = 3;
+// Threads de leitura por chamada; o custo é latência de abertura, não CPU
+static const int kMaxProbeThreads = 4;
+// Abaixo disso não compensa criar threads
+static const int kFilesPerThread = 8;
+// Caminhos, fingerprints e mapas maiores que isso indicam arquivo corrompido
+static const uint32_t kMaxKeyBytes = 1 << 20;
+
+bool ProbeCache::lookup(const std::string &path, int64_t fileSize, int64_t mtimeNs, MtpFileProbe &out) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(path);
+    if (it == mEntries.end() || it->second.probe.fileSize != fileSize || it->second.probe.mtimeNs != mtimeNs) return false;
+    out = it->second.probe;
+    return true;
+}
+
+void ProbeCache::store(const std::string &path, const MtpFileProbe &probe) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Arquivo novo ou alterado: loudness e mapa antigos não valem mais
+    mEntries[path] = Entry{ probe, MtpLoudness{}, nullptr };
+    mDirty = true;
+}
+
+bool ProbeCache::lookupLoudness(const std::string &path, int64_t fileSize, int64_t mtimeNs, MtpLoudness &out) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(path);
+    if (it == mEntries.end() || it->second.probe.fileSize != fileSize || it->second.probe.mtimeNs != mtimeNs ||
+        !it->second.loudness.valid) {
+        return false;
+    }
+    out = it->second.loudness;
+    out.cached = 1;
+    return true;
+}
+
+void ProbeCache::storeLoudness(const std::string &path, int64_t fileSize, int64_t mtimeNs, const MtpLoudness &loudness) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(path);
+    if (it == mEntries.end() || it->second.probe.fileSize != fileSize || it->second.probe.mtimeNs != mtimeNs) return;
+    it->second.loudness = loudness;
+    it->second.loudness.cached = 0;
+    mDirty = true;
+}
+
+bool ProbeCache::lookupSong(int32_t songId, const std::string &fingerprint, MtpLoudness &out) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mSongs.find(songId);
+    if (it == mSongs.end() || it->second.fingerprint != fingerprint || !it->second.loudness.valid) return false;
+    out = it->second.loudness;
+    out.cached = 1;
+    return true;
+}
+
+void ProbeCache::storeSong(int32_t songId, const std::string &fingerprint, const MtpLoudness &loudness) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    SongEntry &e = mSongs[songId];
+    e.fingerprint = fingerprint;
+    e.loudness = loudness;
+    e.loudness.cached = 0;
+    mDirty = true;
+}
+
+std::shared_ptr<const SilenceMap> ProbeCache::lookupSilence(const std::string &path, int64_t fileSize,
+                                                         int64_t mtimeNs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(path);
+    if (it == mEntries.end() || it->second.probe.fileSize != fileSize || it->second.probe.mtimeNs != mtimeNs) {
+        return nullptr;
+    }
+    return it->second.silence;
+}
+
+void ProbeCache::storeSilence(const std::string &path, int64_t fileSize, int64_t mtimeNs,
+                              std::shared_ptr<const SilenceMap> map) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(path);
+    if (!map || it == mEntries.end() || it->second.probe.fileSize != fileSize || it->second.probe.mtimeNs != mtimeNs) {
+        return;
+    }
+    it->second.silence = std::move(map);
+    mDirty = true;
+}
+
+static bool readKey(FILE* f, std::string &key) {
+    uint32_t len = 0;
+    if (std::fread(&len, sizeof(len), 1, f) != 1 || len == 0 || len > kMaxKeyBytes) return false;
+    key.resize(len);
+    return std::fread(&key[0], 1, len, f) == len;
+}
+
+static bool writeKey(FILE* f, const std::string &key) {
+    const uint32_t len = (uint32_t)key.size();
+    return std::fwrite(&len, sizeof(len), 1, f) == 1 && std::fwrite(key.data(), 1, len, f) == len;
+}
+
+// Mapa de silêncio: frames (-1 = sem mapa) seguidos das palavras do bitmap
+static bool readSilence(FILE* f, std::shared_ptr<const SilenceMap> &map) {
+    int64_t frames = 0;
+    if (std::fread(&frames, sizeof(frames), 1, f) != 1) return false;
+    if (frames < 0) return true;
+    const size_t count = SilenceMap::wordCount(frames);
+    if (count * sizeof(uint64_t) > kMaxKeyBytes) return false;
+    std::vector<uint64_t> words(count);
+    if (std::fread(words.data(), sizeof(uint64_t), count, f) != count) return false;
+    map = std::make_shared<const SilenceMap>(frames, std::move(words));
+    return true;
+}
+
+static bool writeSilence(FILE* f, const std::shared_ptr<const SilenceMap> &map) {
+    const int64_t frames = map ? map->frames() : -1;
+    if (std::fwrite(&frames, sizeof(frames), 1, f) != 1) return false;
+    return !map || std::fwrite(map->words().data(), sizeof(uint64_t), map->words().size(), f) == map->words().size();
+}
+
+int ProbeCache::load(const std::string &file) {
+    FILE* f = std::fopen(file.c_str(), "rb");
+    if (!f) return 0;
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t count = 0;
+    int loaded = 0;
+    if (std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, kCacheMagic, 4) == 0 &&
+        std::fread(&version, sizeof(version), 1, f) == 1 && version == kCacheVersion &&
+        std::fread(&count, sizeof(count), 1, f) == 1) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::string key;
+        bool ok = true;
+        for (uint32_t i = 0; i < count; ++i) {
+            Entry e;
+            if (!readKey(f, key) || std::fread(&e.probe, sizeof(e.probe), 1, f) != 1 ||
+                std::fread(&e.loudness, sizeof(e.loudness), 1, f) != 1 || !readSilence(f, e.silence)) {
+                ok = false;
+                break;
+            }
+            e.probe.cached = 1;
+            e.loudness.cached = 1;
+            // Entrada já validada nesta execução tem prioridade
+            if (mEntries.emplace(key, e).second) ++loaded;
+        }
+        uint32_t songs = 0;
+        if (ok && std::fread(&songs, sizeof(songs), 1, f) == 1) {
+            for (uint32_t i = 0; i < songs; ++i) {
+                int32_t songId = 0;
+                SongEntry e;
+                if (std::fread(&songId, sizeof(songId), 1, f) != 1 || !readKey(f, e.fingerprint) ||
+                    std::fread(&e.loudness, sizeof(e.loudness), 1, f) != 1) {
+                    break;
+                }
+                e.loudness.cached = 1;
+                mSongs.emplace(songId, std::move(e));
+            }
+        }
+    }
+    std::fclose(f);
+    return loaded;
+}
+
+bool ProbeCache::save(const std::string &file) {
+    std::vector<std::pair<std::string, Entry>> entries;
+    std::vector<std::pair<int32_t, SongEntry>> songs;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mDirty) return false;
+        entries.assign(mEntries.begin(), mEntries.end());
+        songs.assign(mSongs.begin(), mSongs.end());
+        mDirty = false;
+    }
+    // Grava num temporário e renomeia: um cache pela metade nunca é lido
+    const std::string tmp = file + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    const uint32_t count = (uint32_t)entries.size();
+    bool ok = std::fwrite(kCacheMagic, 1, 4, f) == 4 &&
+              std::fwrite(&kCacheVersion, sizeof(kCacheVersion), 1, f) == 1 &&
+              std::fwrite(&count, sizeof(count), 1, f) == 1;
+    for (size_t i = 0; ok && i < entries.size(); ++i) {
+        ok = writeKey(f, entries[i].first) &&
+             std::fwrite(&entries[i].second.probe, sizeof(MtpFileProbe), 1, f) == 1 &&
+             std::fwrite(&entries[i].second.loudness, sizeof(MtpLoudness), 1, f) == 1 &&
+             writeSilence(f, entries[i].second.silence);
+    }
+    const uint32_t songCount = (uint32_t)songs.size();
+    ok = ok && std::fwrite(&songCount, sizeof(songCount), 1, f) == 1;
+    for (size_t i = 0; ok && i < songs.size(); ++i) {
+        ok = std::fwrite(&songs[i].first, sizeof(int32_t), 1, f) == 1 &&
+             writeKey(f, songs[i].second.fingerprint) &&
+             std::fwrite(&songs[i].second.loudness, sizeof(MtpLoudness), 1, f) == 1;
+    }
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDirty = true;
+        return false;
+    }
+    return true;
+}
+
+static bool readProbe(const std::string &path, MtpFileProbe &out) {
+    std::ifstream ifs(path, std::ios::binary);
+    WavInfo info;
+    if (!ifs || !parseWavHeader(ifs, info)) return false;
+    const int frameBytes = info.channels * (info.bitsPerSample / 8);
+    if (frameBytes <= 0) return false;
+    // Gravação interrompida: o cabeçalho promete mais do que o arquivo tem
+    const int64_t available = std::max<int64_t>(0, out.fileSize - (int64_t)info.dataOffset);
+    out.valid = 1;
+    out.audioFormat = info.audioFormat;
+    out.channels = info.channels;
+    out.sampleRate = info.sampleRate;
+    out.bitsPerSample = info.bitsPerSample;
+    out.dataOffset = (int64_t)info.dataOffset;
+    out.dataBytes = std::min<int64_t>((int64_t)info.dataSize, available);
+    out.frames = out.dataBytes / frameBytes;
+    out.durationSec = (double)out.frames / info.sampleRate;
+    return true;
+}
+
+bool probeFile(const std::string &path, MtpFileProbe &out) {
+    std::memset(&out, 0, sizeof(out));
+    struct stat st;
+    if (path.empty() || ::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    const int64_t size = (int64_t)st.st_size;
+    const int64_t mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    if (gProbeCache.lookup(path, size, mtime, out)) {
+        out.cached = 1;
+        return out.valid != 0;
+    }
+    out.fileSize = size;
+    out.mtimeNs = mtime;
+    readProbe(path, out);
+    // Inválidos também entram: não reabrimos um arquivo que não mudou
+    gProbeCache.store(path, out);
+    return out.valid != 0;
+}
+
+extern "C" {
+
+int32_t mtp_probe_files(const char* const* paths, int32_t count, MtpFileProbe* out) {
+    if (!paths || !out || count <= 0) return 0;
+    std::atomic<int> next{0};
+    std::atomic<int> valid{0};
+    auto work = [&]() {
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            if (probeFile(paths[i] ? paths[i] : "", out[i])) valid.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    const int hw = std::max(1, (int)std::thread::hardware_concurrency());
+    const int threads = std::min({ kMaxProbeThreads, hw, 1 + (count - 1) / kFilesPerThread });
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto &th : pool) th.join();
+    return valid.load();
+}
+
+int32_t mtp_probe_cache_load(const char* file) {
+    return file ? gProbeCache.load(file) : 0;
+}
+
+int32_t mtp_probe_cache_save(const char* file) {
+    return file && gProbeCache.save(file) ? 1 : 0;
+}
+
+} // extern "C"
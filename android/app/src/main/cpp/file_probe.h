@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "engine_shared.h"
+#include "loudness.h"
+#include "silence_map.h"
+
+// Leitura de metadados de WAV (formato, canais, taxa, bits, offset e tamanho
+// dos dados) num lugar só para o app inteiro. Vários arquivos são lidos em
+// paralelo numa chamada, e o resultado fica num cache por caminho, validado
+// por tamanho e mtime; o cache pode ser salvo em disco, então biblioteca,
+// editor e player abrem sem reabrir centenas de stems. O mesmo cache guarda
+// a loudness por arquivo e por música (loudness.h) e o mapa de silêncio de
+// cada arquivo (silence_map.h).
+
+// Layout C espelhado no Dart (72 bytes)
+typedef struct MtpFileProbe {
+    int32_t valid;          // 1 = RIFF/WAVE com fmt e data legíveis
+    int32_t audioFormat;    // 1 = PCM inteiro, 3 = float
+    int32_t channels;
+    int32_t sampleRate;
+    int32_t bitsPerSample;
+    int32_t cached;         // 1 = veio do cache, o arquivo não foi aberto
+    int64_t dataOffset;
+    int64_t dataBytes;      // limitado ao que existe no arquivo
+    int64_t frames;
+    int64_t fileSize;
+    int64_t mtimeNs;
+    double durationSec;
+} MtpFileProbe;
+
+class ProbeCache {
+public:
+    // true e `out` preenchido se houver entrada com o mesmo tamanho e mtime
+    bool lookup(const std::string &path, int64_t fileSize, int64_t mtimeNs, MtpFileProbe &out);
+    void store(const std::string &path, const MtpFileProbe &probe);
+    // Loudness do arquivo, válida só para o mesmo tamanho e mtime do probe
+    bool lookupLoudness(const std::string &path, int64_t fileSize, int64_t mtimeNs, MtpLoudness &out);
+    void storeLoudness(const std::string &path, int64_t fileSize, int64_t mtimeNs, const MtpLoudness &loudness);
+    // Loudness da música somada; `fingerprint` identifica arquivos e mix
+    bool lookupSong(int32_t songId, const std::string &fingerprint, MtpLoudness &out);
+    void storeSong(int32_t songId, const std::string &fingerprint, const MtpLoudness &loudness);
+    // Mapa de silêncio do arquivo, com a mesma validação da loudness
+    std::shared_ptr<const SilenceMap> lookupSilence(const std::string &path, int64_t fileSize, int64_t mtimeNs);
+    void storeSilence(const std::string &path, int64_t fileSize, int64_t mtimeNs,
+                      std::shared_ptr<const SilenceMap> map);
+    // Arquivo binário próprio; entradas inválidas ou de outra versão são ignoradas
+    int load(const std::string &file);
+    // Só grava se algo mudou desde o último load/save
+    bool save(const std::string &file);
+
+private:
+    struct Entry {
+        MtpFileProbe probe;
+        MtpLoudness loudness; // valid = 0 até ser analisado
+        std::shared_ptr<const SilenceMap> silence; // nullptr até ser montado
+    };
+    struct SongEntry {
+        std::string fingerprint;
+        MtpLoudness loudness;
+    };
+
+    std::mutex mMutex;
+    std::unordered_map<std::string, Entry> mEntries;
+    std::unordered_map<int32_t, SongEntry> mSongs;
+    bool mDirty = false;
+};
+
+extern ProbeCache gProbeCache;
+
+// Lê (ou reaproveita do cache) os metadados de um arquivo; false se não for um WAV legível
+bool probeFile(const std::string &path, MtpFileProbe &out);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lê `count` arquivos em paralelo; out[i] corresponde a paths[i]. Devolve
+// quantos são válidos.
+MTP_EXPORT int32_t mtp_probe_files(const char* const* paths, int32_t count, MtpFileProbe* out);
+// Cache persistente: devolve o número de entradas lidas / 1 se gravou
+MTP_EXPORT int32_t mtp_probe_cache_load(const char* file);
+MTP_EXPORT int32_t mtp_probe_cache_save(const char* file);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,273 @@
+#include "import_job.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "content_hash.h"
+#include "file_probe.h"
+#include "silence_map.h"
+#include "thread_topology.h"
+#include "track_source.h"
+#include "wav_analysis.h"
+#include "wav_io.h"
+
+// Cópia em blocos grandes: poucas chamadas de sistema, bom para cartão SD/USB
+static const size_t kImportChunkBytes = 1 << 20;
+// Frames decodificados por vez para as análises
+static const size_t kDecodeFrames = 4096;
+// Maior resolução pedida pela UI (waveform do editor); as menores saem dela
+static const int kIndexPeakPoints = 4000;
+// Leitura e escrita disputam o mesmo armazenamento: poucos threads bastam
+static const int kMaxImportThreads = 3;
+
+static bool importCancelled(MtpImportProgress* progress) {
+    return progress && __atomic_load_n(&progress->cancel, __ATOMIC_RELAXED) != 0;
+}
+
+// Análises de um WAV alimentadas pelos blocos da cópia, na ordem do arquivo
+class StemAnalyzer {
+public:
+    StemAnalyzer(const WavInfo &info, int64_t fileSize)
+        : mInfo(info),
+          mFrameBytes(info.channels * (info.bitsPerSample / 8)),
+          mDataEnd(std::min<int64_t>((int64_t)info.dataOffset + (int64_t)info.dataSize, fileSize)),
+          mFramesTotal(info.dataSize / (size_t)mFrameBytes),
+          mPeaks(mFramesTotal, kIndexPeakPoints),
+          mEnvelope(info.sampleRate),
+          mMixable(isMixablePcm(info)),
+          mPartial((size_t)mFrameBytes),
+          mFrames(kDecodeFrames * (size_t)info.channels) {}
+
+    // Bytes [offset, offset + n) do arquivo; só o trecho de dados é analisado
+    void feed(const char* data, int64_t offset, size_t n) {
+        const int64_t begin = std::max<int64_t>(offset, (int64_t)mInfo.dataOffset);
+        const int64_t end = std::min<int64_t>(offset + (int64_t)n, mDataEnd);
+        if (begin >= end) return;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data) + (begin - offset);
+        size_t left = (size_t)(end - begin);
+        if (mCarry > 0) {
+            const size_t take = std::min(left, (size_t)mFrameBytes - mCarry);
+            std::copy(p, p + take, mPartial.begin() + (std::ptrdiff_t)mCarry);
+            mCarry += take;
+            p += take;
+            left -= take;
+            if (mCarry < (size_t)mFrameBytes) return;
+            decode(mPartial.data(), 1);
+            mCarry = 0;
+        }
+        for (size_t whole = left / (size_t)mFrameBytes; whole > 0;) {
+            const size_t frames = std::min(whole, kDecodeFrames);
+            decode(p, frames);
+            p += frames * (size_t)mFrameBytes;
+            left -= frames * (size_t)mFrameBytes;
+            whole -= frames;
+        }
+        std::copy(p, p + left, mPartial.begin());
+        mCarry = left;
+    }
+
+    // Grava mapa e índice do destino já renomeado
+    void finish(const std::string &path, MtpImportResult &r) {
+        MtpFileProbe probe;
+        if (!probeFile(path, probe)) {
+            r.status = MTP_IMPORT_COPIED;
+            return;
+        }
+        r.status = MTP_IMPORT_OK;
+        r.sampleRate = probe.sampleRate;
+        r.channels = probe.channels;
+        r.bitsPerSample = probe.bitsPerSample;
+        r.durationSec = probe.durationSec;
+        if (mMixable) {
+            std::shared_ptr<const SilenceMap> map = mSilence.finish();
+            gProbeCache.storeSilence(path, probe.fileSize, probe.mtimeNs, map);
+            r.silentFraction = map->silentFraction();
+        }
+
+        AnalysisIndex index;
+        index.fileSize = probe.fileSize;
+        index.mtimeNs = probe.mtimeNs;
+        index.framesTotal = (int64_t)mFramesTotal;
+        index.wave.sampleRate = mInfo.sampleRate;
+        index.wave.channels = mInfo.channels;
+        index.wave.bitsPerSample = mInfo.bitsPerSample;
+        index.wave.dataBytes = (int64_t)mInfo.dataSize;
+        index.wave.durationSec = (double)mFramesTotal / (double)mInfo.sampleRate;
+        index.peaks = mPeaks.finish();
+        index.wave.points = (int32_t)index.peaks.size();
+        std::vector<float> env;
+        float envFs = 200.0f;
+        if (mFramesTotal >= (size_t)mInfo.sampleRate && mEnvelope.finish(env, envFs)) {
+            beatGridFromEnvelope(env, envFs, index.wave.durationSec, index.grid);
+            index.hasGrid = true;
+            r.bpm = index.grid.bpm;
+        }
+        saveAnalysisIndex(path, index);
+    }
+
+private:
+    void decode(const unsigned char* p, size_t frames) {
+        decodeAnalyzableFrames(p, mInfo, frames, mFrames.data());
+        mPeaks.add(mFrames.data(), mInfo.channels, frames);
+        mEnvelope.add(mFrames.data(), mInfo.channels, frames);
+        if (mMixable) mSilence.addInterleaved(mFrames.data(), mInfo.channels, (int)frames);
+    }
+
+    WavInfo mInfo;
+    int mFrameBytes;
+    int64_t mDataEnd;
+    size_t mFramesTotal;
+    PeakBuilder mPeaks;
+    EnvelopeBuilder mEnvelope;
+    SilenceMapBuilder mSilence;
+    bool mMixable;
+    std::vector<unsigned char> mPartial; // frame partido entre blocos
+    size_t mCarry = 0;
+    std::vector<float> mFrames;
+};
+
+// Põe a cópia terminada no caminho do conteúdo sem sobrescrever: se o mesmo
+// conteúdo já está lá (outra música, ou outro stem desta importação), a cópia
+// é descartada. link() falha com EEXIST de forma atômica entre threads.
+static bool placeByContent(const std::string &part, std::string &dst, const std::string &fallback,
+                           int64_t bytes, bool &shared) {
+    shared = false;
+    if (::link(part.c_str(), dst.c_str()) == 0) {
+        std::remove(part.c_str());
+        return true;
+    }
+    struct stat st;
+    if (::stat(dst.c_str(), &st) == 0) {
+        if ((int64_t)st.st_size == bytes) {
+            std::remove(part.c_str());
+            shared = true;
+            return true;
+        }
+        // Mesmo hash com tamanho diferente: colisão, fica no nome pedido
+        dst = fallback;
+    }
+    // Sem hard link (ex.: FAT) e destino livre
+    return std::rename(part.c_str(), dst.c_str()) == 0;
+}
+
+static void importOne(const std::string &src, const std::string &target, bool contentAddressed,
+                      MtpImportProgress* progress, MtpImportResult &r) {
+    r = MtpImportResult{};
+    r.silentFraction = -1.0;
+    std::ifstream ifs(src, std::ios::binary);
+    struct stat st;
+    if (!ifs || target.empty() || ::stat(src.c_str(), &st) != 0) {
+        r.status = MTP_IMPORT_READ_ERROR;
+        return;
+    }
+    WavInfo info;
+    std::unique_ptr<StemAnalyzer> analyzer;
+    if (parseWavHeader(ifs, info) && isAnalyzableWav(info) && info.channels > 0 && info.sampleRate > 0) {
+        analyzer.reset(new StemAnalyzer(info, (int64_t)st.st_size));
+    }
+    ifs.clear();
+    ifs.seekg(0, std::ios::beg);
+
+    // Um destino pela metade nunca fica com o nome final
+    const std::string part = target + ".part";
+    FILE* out = std::fopen(part.c_str(), "wb");
+    if (!out) {
+        r.status = MTP_IMPORT_WRITE_ERROR;
+        return;
+    }
+    std::vector<char> buf(kImportChunkBytes);
+    ContentHasher hasher;
+    int32_t status = MTP_IMPORT_OK;
+    int64_t offset = 0;
+    while (true) {
+        if (importCancelled(progress)) {
+            status = MTP_IMPORT_CANCELLED;
+            break;
+        }
+        ifs.read(buf.data(), (std::streamsize)buf.size());
+        const size_t got = (size_t)ifs.gcount();
+        if (got == 0) {
+            if (!ifs.eof()) status = MTP_IMPORT_READ_ERROR;
+            break;
+        }
+        if (std::fwrite(buf.data(), 1, got, out) != got) {
+            status = MTP_IMPORT_WRITE_ERROR;
+            break;
+        }
+        hasher.update(buf.data(), got);
+        if (analyzer) analyzer->feed(buf.data(), offset, got);
+        offset += (int64_t)got;
+        if (progress) __atomic_fetch_add(&progress->bytesDone, (int64_t)got, __ATOMIC_RELAXED);
+        if (got < buf.size()) {
+            if (!ifs.eof()) status = MTP_IMPORT_READ_ERROR;
+            break;
+        }
+    }
+    if (std::fclose(out) != 0 && status == MTP_IMPORT_OK) status = MTP_IMPORT_WRITE_ERROR;
+    const uint64_t hash = hasher.digest();
+    std::string dst = contentAddressed ? contentAddressedPath(target, hash) : target;
+    if (status == MTP_IMPORT_OK) {
+        bool shared = false;
+        const bool placed = contentAddressed ? placeByContent(part, dst, target, offset, shared)
+                                             : std::rename(part.c_str(), dst.c_str()) == 0;
+        if (!placed) status = MTP_IMPORT_WRITE_ERROR;
+        r.shared = shared ? 1 : 0;
+    }
+    if (status != MTP_IMPORT_OK) {
+        std::remove(part.c_str());
+        r.status = status;
+        return;
+    }
+    r.bytes = offset;
+    // Colisão no modo endereçado: o arquivo ficou no nome pedido, sem hash
+    r.contentHash = contentAddressed && dst == target ? 0 : hash;
+    if (analyzer) analyzer->finish(dst, r);
+    else r.status = MTP_IMPORT_COPIED;
+}
+
+extern "C" {
+
+int32_t mtp_import_files(const char* const* sources, const char* const* destinations, int32_t count,
+                         int32_t flags, MtpImportProgress* progress, MtpImportResult* results) {
+    const bool contentAddressed = (flags & MTP_IMPORT_CONTENT_ADDRESSED) != 0;
+    if (!sources || !destinations || !results || count <= 0) return 0;
+    if (progress) {
+        int64_t total = 0;
+        for (int i = 0; i < count; ++i) {
+            struct stat st;
+            if (sources[i] && ::stat(sources[i], &st) == 0) total += (int64_t)st.st_size;
+        }
+        __atomic_store_n(&progress->bytesTotal, total, __ATOMIC_RELAXED);
+    }
+    std::atomic<int> next{0};
+    std::atomic<int> copied{0};
+    // Análise de fundo; threads criados aqui medem o atraso até rodar
+    auto work = [&](std::chrono::steady_clock::time_point readyAt) {
+        ScopedThreadClass background(ThreadClass::Analysis, readyAt);
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            importOne(sources[i] ? sources[i] : "", destinations[i] ? destinations[i] : "", contentAddressed,
+                      progress, results[i]);
+            if (results[i].status == MTP_IMPORT_OK || results[i].status == MTP_IMPORT_COPIED) {
+                copied.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (progress) __atomic_fetch_add(&progress->filesDone, 1, __ATOMIC_RELAXED);
+        }
+    };
+    const int hw = std::max(1, (int)std::thread::hardware_concurrency());
+    const int threads = std::min({ kMaxImportThreads, hw, (int)count });
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(work, std::chrono::steady_clock::now());
+    work(std::chrono::steady_clock::time_point{});
+    for (auto &th : pool) th.join();
+    return copied.load();
+}
+
+} // extern "C"
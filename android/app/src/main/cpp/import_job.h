@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "engine_shared.h"
+
+// Importação de stems numa passada só: cada arquivo é lido uma vez, em blocos
+// grandes, e cada bloco é gravado no destino e alimenta as análises (peaks,
+// envelope de BPM e mapa de silêncio). No fim o probe e o mapa de silêncio
+// estão no cache de file_probe e peaks/grade no índice de wav_analysis.h, então
+// editor, mixer e player abrem a música sem reler o áudio. Os arquivos são
+// importados em paralelo. Com MTP_IMPORT_CONTENT_ADDRESSED o destino final é
+// endereçado pelo hash do conteúdo (content_hash.h): stems iguais de músicas
+// diferentes ficam num arquivo só.
+
+// Estado de cada arquivo em MtpImportResult
+#define MTP_IMPORT_OK          0  // copiado e analisado
+#define MTP_IMPORT_COPIED      1  // copiado; formato sem análise (ex.: mp3)
+#define MTP_IMPORT_READ_ERROR  2
+#define MTP_IMPORT_WRITE_ERROR 3
+#define MTP_IMPORT_CANCELLED   4
+
+// Flags de mtp_import_files
+#define MTP_IMPORT_CONTENT_ADDRESSED 1 // destino = <dir do destino>/<xxh64 hex><ext>
+
+// Progresso compartilhado com o chamador, que pode ler os campos de outro
+// thread enquanto a importação roda. cancel != 0 interrompe os arquivos que
+// ainda não terminaram (o destino parcial é apagado).
+typedef struct MtpImportProgress {
+    int64_t bytesTotal;
+    int64_t bytesDone;
+    int32_t filesDone;
+    int32_t cancel;
+} MtpImportProgress;
+
+// Layout C espelhado no Dart (64 bytes)
+typedef struct MtpImportResult {
+    int32_t status;
+    int32_t sampleRate;     // 0 se não foi analisado
+    int32_t channels;
+    int32_t bitsPerSample;
+    int64_t bytes;          // copiados
+    double durationSec;
+    double bpm;             // 0 se o arquivo é curto demais para estimar
+    double silentFraction;  // -1 sem mapa de silêncio
+    uint64_t contentHash;   // XXH64 dos bytes; 0 se não copiado ou se ficou no nome pedido (colisão)
+    int32_t shared;         // 1 = conteúdo já existia no destino; a cópia foi descartada
+    int32_t reserved;
+} MtpImportResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Copia sources[i] para destinations[i] (grava em destino.part e renomeia no
+// fim) analisando na mesma leitura. Com MTP_IMPORT_CONTENT_ADDRESSED em
+// flags, destinations[i] só indica diretório e extensão; o arquivo fica em
+// contentAddressedPath(destinations[i], contentHash). progress pode ser nulo.
+// Devolve quantos arquivos foram copiados (MTP_IMPORT_OK ou MTP_IMPORT_COPIED).
+MTP_EXPORT int32_t mtp_import_files(const char* const* sources, const char* const* destinations, int32_t count,
+                                    int32_t flags, MtpImportProgress* progress, MtpImportResult* results);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,354 @@
+#include "insert_chain.h"
+#include "param_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+typedef float f32x8 __attribute__((vector_size(32)));
+
+static inline f32x8 load8(const Lane8& l) {
+    f32x8 v;
+    std::memcpy(&v, l.v, sizeof(v));
+    return v;
+}
+
+static inline void store8(Lane8& l, f32x8 v) {
+    std::memcpy(l.v, &v, sizeof(v));
+}
+
+static inline f32x8 splat8(float x) {
+    return f32x8{x, x, x, x, x, x, x, x};
+}
+
+// Detector/ganho do compressor rodam a cada kDynSub frames; o ganho é
+// interpolado linearmente dentro do sub-bloco.
+static const int kDynSub = 16;
+static const float kLimiterReleaseMs = 60.0f;
+
+void enableFlushToZero() {
+#if defined(__aarch64__)
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    fpcr |= (1ull << 24);
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+#elif defined(__arm__) && defined(__ARM_NEON)
+    uint32_t fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    fpscr |= (1u << 24);
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr));
+#elif defined(__x86_64__) || defined(__i386__)
+    _mm_setcsr(_mm_getcsr() | 0x8040); // FTZ | DAZ
+#endif
+}
+
+static void fillLanes(std::vector<Lane8>& v, size_t groups, float x) {
+    Lane8 l;
+    for (int i = 0; i < kLaneWidth; ++i) l.v[i] = x;
+    v.assign(groups, l);
+}
+
+void InsertChain::configure(const std::vector<int>& trackChannels, float sampleRate) {
+    mRate = sampleRate > 0.0f ? sampleRate : 48000.0f;
+    const size_t count = trackChannels.size();
+    mParams.assign(count, TrackInsertParams());
+    mFirstLane.assign(count, 0);
+    mLaneCount.assign(count, 0);
+    mGroupTracks.clear();
+
+    int lane = 0;
+    for (size_t t = 0; t < count; ++t) {
+        const int ch = std::max(1, std::min(2, trackChannels[t]));
+        // Não deixa uma track estéreo cruzar a fronteira do grupo
+        if ((lane % kLaneWidth) + ch > kLaneWidth) lane += kLaneWidth - (lane % kLaneWidth);
+        mFirstLane[t] = lane;
+        mLaneCount[t] = ch;
+        const size_t group = (size_t)(lane / kLaneWidth);
+        if (mGroupTracks.size() <= group) mGroupTracks.resize(group + 1);
+        mGroupTracks[group].push_back((int)t);
+        lane += ch;
+    }
+    const size_t groups = mGroupTracks.size();
+    const size_t lanes = groups * kLaneWidth;
+
+    mLinkLane.resize(lanes);
+    for (size_t i = 0; i < lanes; ++i) mLinkLane[i] = (int)i;
+    for (size_t t = 0; t < count; ++t) {
+        if (mLaneCount[t] == 2) {
+            mLinkLane[mFirstLane[t]] = mFirstLane[t] + 1;
+            mLinkLane[mFirstLane[t] + 1] = mFirstLane[t];
+        }
+    }
+
+    for (auto& bank : mBiquads) {
+        fillLanes(bank.b0, groups, 1.0f);
+        fillLanes(bank.b1, groups, 0.0f);
+        fillLanes(bank.b2, groups, 0.0f);
+        fillLanes(bank.a1, groups, 0.0f);
+        fillLanes(bank.a2, groups, 0.0f);
+        fillLanes(bank.z1, groups, 0.0f);
+        fillLanes(bank.z2, groups, 0.0f);
+        bank.active.assign(groups, 0);
+    }
+    fillLanes(mDyn.threshDb, groups, 0.0f);
+    fillLanes(mDyn.slope, groups, 0.0f);
+    fillLanes(mDyn.makeupDb, groups, 0.0f);
+    fillLanes(mDyn.ceilingDb, groups, 0.0f);
+    fillLanes(mDyn.attack, groups, 0.0f);
+    fillLanes(mDyn.release, groups, 0.0f);
+    fillLanes(mDyn.env, groups, 0.0f);
+    fillLanes(mDyn.limDb, groups, 0.0f);
+    fillLanes(mDyn.gain, groups, 1.0f);
+    mDyn.active.assign(groups, 0);
+    for (size_t t = 0; t < count; ++t) updateDynamics((int)t);
+}
+
+void InsertChain::setParam(int track, int param, float value) {
+    if (track < 0 || track >= (int)mParams.size() || !std::isfinite(value)) return;
+    TrackInsertParams& p = mParams[track];
+    switch (param) {
+        case PARAM_HPF_HZ: p.hpfHz = value; updateBiquad(track, STAGE_HPF); break;
+        case PARAM_LPF_HZ: p.lpfHz = value; updateBiquad(track, STAGE_LPF); break;
+        case PARAM_EQ1_HZ: p.eq1Hz = value; updateBiquad(track, STAGE_EQ1); break;
+        case PARAM_EQ1_GAIN_DB: p.eq1GainDb = value; updateBiquad(track, STAGE_EQ1); break;
+        case PARAM_EQ1_Q: p.eq1Q = value; updateBiquad(track, STAGE_EQ1); break;
+        case PARAM_EQ2_HZ: p.eq2Hz = value; updateBiquad(track, STAGE_EQ2); break;
+        case PARAM_EQ2_GAIN_DB: p.eq2GainDb = value; updateBiquad(track, STAGE_EQ2); break;
+        case PARAM_EQ2_Q: p.eq2Q = value; updateBiquad(track, STAGE_EQ2); break;
+        case PARAM_COMP_THRESHOLD_DB: p.compThresholdDb = value; updateDynamics(track); break;
+        case PARAM_COMP_RATIO: p.compRatio = value; updateDynamics(track); break;
+        case PARAM_COMP_ATTACK_MS: p.compAttackMs = value; updateDynamics(track); break;
+        case PARAM_COMP_RELEASE_MS: p.compReleaseMs = value; updateDynamics(track); break;
+        case PARAM_COMP_MAKEUP_DB: p.compMakeupDb = value; updateDynamics(track); break;
+        case PARAM_LIMIT_CEILING_DB: p.limitCeilingDb = value; updateDynamics(track); break;
+        default: break;
+    }
+}
+
+void InsertChain::updateBiquad(int track, Stage stage) {
+    const TrackInsertParams& p = mParams[track];
+    // Coeficientes do RBJ Audio EQ Cookbook, normalizados por a0
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+    auto design = [&](float hz, float q) {
+        const double f = std::max(10.0, std::min((double)hz, 0.45 * mRate));
+        const double w0 = 2.0 * M_PI * f / mRate;
+        const double alpha = std::sin(w0) / (2.0 * std::max(0.1, std::min((double)q, 18.0)));
+        return std::make_pair(std::cos(w0), alpha);
+    };
+    switch (stage) {
+        case STAGE_HPF:
+            if (p.hpfHz > 0.0f) {
+                auto [c, alpha] = design(p.hpfHz, 0.70710678f);
+                b0 = (1.0 + c) / 2.0; b1 = -(1.0 + c); b2 = (1.0 + c) / 2.0;
+                a0 = 1.0 + alpha; a1 = -2.0 * c; a2 = 1.0 - alpha;
+            }
+            break;
+        case STAGE_LPF:
+            if (p.lpfHz > 0.0f) {
+                auto [c, alpha] = design(p.lpfHz, 0.70710678f);
+                b0 = (1.0 - c) / 2.0; b1 = 1.0 - c; b2 = (1.0 - c) / 2.0;
+                a0 = 1.0 + alpha; a1 = -2.0 * c; a2 = 1.0 - alpha;
+            }
+            break;
+        case STAGE_EQ1:
+        case STAGE_EQ2: {
+            const float gainDb = stage == STAGE_EQ1 ? p.eq1GainDb : p.eq2GainDb;
+            if (std::fabs(gainDb) > 0.01f) {
+                auto [c, alpha] = design(stage == STAGE_EQ1 ? p.eq1Hz : p.eq2Hz,
+                                         stage == STAGE_EQ1 ? p.eq1Q : p.eq2Q);
+                const double A = std::pow(10.0, std::max(-24.0f, std::min(24.0f, gainDb)) / 40.0);
+                b0 = 1.0 + alpha * A; b1 = -2.0 * c; b2 = 1.0 - alpha * A;
+                a0 = 1.0 + alpha / A; a1 = -2.0 * c; a2 = 1.0 - alpha / A;
+            }
+            break;
+        }
+        default:
+            return;
+    }
+
+    BiquadBank& bank = mBiquads[stage];
+    const bool identity = (b1 == 0.0 && b2 == 0.0 && a1 == 0.0 && a2 == 0.0);
+    for (int i = 0; i < mLaneCount[track]; ++i) {
+        const int lane = mFirstLane[track] + i;
+        const int g = lane / kLaneWidth;
+        const int li = lane % kLaneWidth;
+        const bool wasIdentity = bank.b1[g].v[li] == 0.0f && bank.b2[g].v[li] == 0.0f &&
+                                 bank.a1[g].v[li] == 0.0f && bank.a2[g].v[li] == 0.0f;
+        if (wasIdentity && !identity) {
+            // Estado pode estar velho se o grupo foi pulado enquanto desligado
+            bank.z1[g].v[li] = 0.0f;
+            bank.z2[g].v[li] = 0.0f;
+        }
+        bank.b0[g].v[li] = (float)(b0 / a0);
+        bank.b1[g].v[li] = (float)(b1 / a0);
+        bank.b2[g].v[li] = (float)(b2 / a0);
+        bank.a1[g].v[li] = (float)(a1 / a0);
+        bank.a2[g].v[li] = (float)(a2 / a0);
+    }
+    refreshBiquadActive(stage, mFirstLane[track] / kLaneWidth);
+}
+
+void InsertChain::refreshBiquadActive(Stage stage, int group) {
+    BiquadBank& bank = mBiquads[stage];
+    uint8_t active = 0;
+    for (int li = 0; li < kLaneWidth; ++li) {
+        if (bank.b0[group].v[li] != 1.0f || bank.b1[group].v[li] != 0.0f || bank.b2[group].v[li] != 0.0f ||
+            bank.a1[group].v[li] != 0.0f || bank.a2[group].v[li] != 0.0f) {
+            active = 1;
+            break;
+        }
+    }
+    bank.active[group] = active;
+}
+
+void InsertChain::updateDynamics(int track) {
+    const TrackInsertParams& p = mParams[track];
+    const float ratio = std::max(1.0f, std::min(p.compRatio, 100.0f));
+    const float subRate = mRate / (float)kDynSub;
+    const float attack = std::exp(-1.0f / (std::max(0.1f, p.compAttackMs) * 0.001f * subRate));
+    const float release = std::exp(-1.0f / (std::max(1.0f, p.compReleaseMs) * 0.001f * subRate));
+    for (int i = 0; i < mLaneCount[track]; ++i) {
+        const int lane = mFirstLane[track] + i;
+        const int g = lane / kLaneWidth;
+        const int li = lane % kLaneWidth;
+        mDyn.threshDb[g].v[li] = p.compThresholdDb;
+        mDyn.slope[g].v[li] = 1.0f - 1.0f / ratio;
+        mDyn.makeupDb[g].v[li] = std::max(-24.0f, std::min(24.0f, p.compMakeupDb));
+        mDyn.ceilingDb[g].v[li] = std::min(0.0f, p.limitCeilingDb);
+        mDyn.attack[g].v[li] = attack;
+        mDyn.release[g].v[li] = release;
+    }
+    refreshDynamicsActive(mFirstLane[track] / kLaneWidth);
+}
+
+void InsertChain::refreshDynamicsActive(int group) {
+    uint8_t active = 0;
+    for (int li = 0; li < kLaneWidth; ++li) {
+        if (mDyn.slope[group].v[li] > 0.0f || mDyn.makeupDb[group].v[li] != 0.0f ||
+            mDyn.ceilingDb[group].v[li] < 0.0f) {
+            active = 1;
+            break;
+        }
+    }
+    if (active && !mDyn.active[group]) {
+        // Reinicia detector ao religar para não aplicar ganho de um estado antigo
+        for (int li = 0; li < kLaneWidth; ++li) {
+            mDyn.env[group].v[li] = 0.0f;
+            mDyn.limDb[group].v[li] = 0.0f;
+            mDyn.gain[group].v[li] = 1.0f;
+        }
+    }
+    mDyn.active[group] = active;
+}
+
+void InsertChain::settleGroup(int group) {
+    if (group < 0 || group >= groupCount()) return;
+    for (auto& bank : mBiquads) {
+        bank.z1[group] = Lane8{};
+        bank.z2[group] = Lane8{};
+    }
+    for (int li = 0; li < kLaneWidth; ++li) {
+        mDyn.env[group].v[li] = 0.0f;
+        mDyn.limDb[group].v[li] = 0.0f;
+        mDyn.gain[group].v[li] = std::pow(10.0f, mDyn.makeupDb[group].v[li] / 20.0f);
+    }
+}
+
+bool InsertChain::groupActive(int group) const {
+    if (group < 0 || group >= groupCount()) return false;
+    for (const auto& bank : mBiquads) {
+        if (bank.active[group]) return true;
+    }
+    return mDyn.active[group] != 0;
+}
+
+void InsertChain::processGroup(int group, Lane8* block, int frames) {
+    if (group < 0 || group >= groupCount() || frames <= 0) return;
+    for (auto& bank : mBiquads) {
+        if (bank.active[group]) runBiquad(bank, group, block, frames);
+    }
+    if (mDyn.active[group]) runDynamics(group, block, frames);
+}
+
+void InsertChain::runBiquad(BiquadBank& bank, int group, Lane8* block, int frames) {
+    // Transposed direct form II, 8 lanes por instrução
+    const f32x8 b0 = load8(bank.b0[group]);
+    const f32x8 b1 = load8(bank.b1[group]);
+    const f32x8 b2 = load8(bank.b2[group]);
+    const f32x8 a1 = load8(bank.a1[group]);
+    const f32x8 a2 = load8(bank.a2[group]);
+    f32x8 z1 = load8(bank.z1[group]);
+    f32x8 z2 = load8(bank.z2[group]);
+    for (int f = 0; f < frames; ++f) {
+        const f32x8 x = load8(block[f]);
+        const f32x8 y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        store8(block[f], y);
+    }
+    store8(bank.z1[group], z1);
+    store8(bank.z2[group], z2);
+}
+
+void InsertChain::runDynamics(int group, Lane8* block, int frames) {
+    const f32x8 zero = splat8(0.0f);
+    const float limRelease = std::exp(-1.0f / (kLimiterReleaseMs * 0.001f * (mRate / (float)kDynSub)));
+    const int laneBase = group * kLaneWidth;
+    Lane8& env = mDyn.env[group];
+    Lane8& limDb = mDyn.limDb[group];
+    Lane8& gain = mDyn.gain[group];
+
+    for (int f0 = 0; f0 < frames; f0 += kDynSub) {
+        const int n = std::min(kDynSub, frames - f0);
+
+        // Pico do sub-bloco por lane (vetorial)
+        f32x8 peakV = zero;
+        for (int f = 0; f < n; ++f) {
+            const f32x8 x = load8(block[f0 + f]);
+            const f32x8 ax = x < zero ? -x : x;
+            peakV = ax > peakV ? ax : peakV;
+        }
+        Lane8 peak;
+        store8(peak, peakV);
+
+        // Envelope e computador de ganho (escalar, 1x por sub-bloco)
+        for (int li = 0; li < kLaneWidth; ++li) {
+            const float pk = peak.v[li];
+            const float coef = pk > env.v[li] ? mDyn.attack[group].v[li] : mDyn.release[group].v[li];
+            env.v[li] = coef * env.v[li] + (1.0f - coef) * pk;
+        }
+        Lane8 target;
+        for (int li = 0; li < kLaneWidth; ++li) {
+            const int link = mLinkLane[laneBase + li] - laneBase;
+            const float level = std::max(env.v[li], env.v[link]);
+            const float levelDb = 20.0f * std::log10(std::max(level, 1e-6f));
+            const float over = levelDb - mDyn.threshDb[group].v[li];
+            float gainDb = mDyn.makeupDb[group].v[li];
+            if (over > 0.0f) gainDb -= over * mDyn.slope[group].v[li];
+
+            // Limitador: ataque instantâneo no pico linkado, release fixo
+            const float ceiling = mDyn.ceilingDb[group].v[li];
+            if (ceiling < 0.0f) {
+                const float pkDb = 20.0f * std::log10(std::max(std::max(peak.v[li], peak.v[link]), 1e-6f));
+                const float want = std::min(0.0f, ceiling - (pkDb + gainDb));
+                limDb.v[li] = want < limDb.v[li] ? want : limRelease * limDb.v[li] + (1.0f - limRelease) * want;
+            } else {
+                limDb.v[li] = 0.0f;
+            }
+            target.v[li] = std::pow(10.0f, (gainDb + limDb.v[li]) / 20.0f);
+        }
+
+        // Rampa linear do ganho anterior para o novo (vetorial)
+        f32x8 g = load8(gain);
+        const f32x8 step = (load8(target) - g) * splat8(1.0f / (float)n);
+        for (int f = 0; f < n; ++f) {
+            g += step;
+            store8(block[f0 + f], load8(block[f0 + f]) * g);
+        }
+        store8(gain, load8(target));
+    }
+}
@@ -0,0 +1,382 @@
+#include <jni.h>
+#include <aaudio/AAudio.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "engine_api.h"
+#include "engine_log.h"
+#include "engine_shared.h"
+#include "engine_stats.h"
+
+// Ponte JNI do MainActivity: converte os argumentos do Kotlin e chama o engine
+// (engine_api.h). A gravação da entrada fica aqui: o stream de entrada é AAudio.
+
+static std::string jstringToString(JNIEnv* env, jstring jstr) {
+    if (!jstr) return std::string();
+    const char* cstr = env->GetStringUTFChars(jstr, nullptr);
+    std::string out(cstr ? cstr : "");
+    if (cstr) env->ReleaseStringUTFChars(jstr, cstr);
+    return out;
+}
+
+static std::vector<std::string> jstringArray(JNIEnv* env, jobjectArray arr) {
+    std::vector<std::string> out;
+    const jsize count = arr ? env->GetArrayLength(arr) : 0;
+    for (jsize i = 0; i < count; ++i) {
+        jstring jstr = (jstring)env->GetObjectArrayElement(arr, i);
+        out.push_back(jstringToString(env, jstr));
+        env->DeleteLocalRef(jstr);
+    }
+    return out;
+}
+
+static std::vector<int> jintVector(JNIEnv* env, jintArray arr) {
+    const jsize count = arr ? env->GetArrayLength(arr) : 0;
+    std::vector<int> out((size_t)count);
+    if (count > 0) env->GetIntArrayRegion(arr, 0, count, out.data());
+    return out;
+}
+
+static std::vector<float> jfloatVector(JNIEnv* env, jfloatArray arr) {
+    const jsize count = arr ? env->GetArrayLength(arr) : 0;
+    std::vector<float> out((size_t)count);
+    if (count > 0) env->GetFloatArrayRegion(arr, 0, count, out.data());
+    return out;
+}
+
+extern "C" JNIEXPORT jdoubleArray JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeDetectBpmFromWav(JNIEnv* env, jobject /*thiz*/, jstring jpath) {
+    double bpm = 0.0;
+    double confidence = 0.0;
+    engineDetectBpm(jstringToString(env, jpath), bpm, confidence);
+    jdoubleArray arr = env->NewDoubleArray(2);
+    jdouble vals[2] = { bpm, confidence };
+    env->SetDoubleArrayRegion(arr, 0, 2, vals);
+    return arr;
+}
+
+// Taxa do WAV pelo probe compartilhado (cache por caminho/tamanho/mtime); 0 se inválido
+extern "C" JNIEXPORT jint JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeProbeSampleRate(JNIEnv* env, jobject /*thiz*/, jstring jpath) {
+    return (jint)engineProbeSampleRate(jstringToString(env, jpath));
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativePlayAllPreview(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jobjectArray jFilePaths,
+        jintArray jOutputChannels,
+        jfloatArray jVolumes,
+        jfloatArray jPans,
+        jint jDeviceId,
+        jint jDeviceChannels) {
+    const std::vector<std::string> paths = jstringArray(env, jFilePaths);
+    const std::vector<int> outputs = jintVector(env, jOutputChannels);
+    const std::vector<float> volumes = jfloatVector(env, jVolumes);
+    const std::vector<float> pans = jfloatVector(env, jPans);
+    std::vector<EngineTrack> tracks(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        tracks[i].path = paths[i];
+        if (i < outputs.size()) tracks[i].outputChannel = outputs[i];
+        if (i < volumes.size()) tracks[i].volume = volumes[i];
+        if (i < pans.size()) tracks[i].pan = pans[i];
+    }
+    return enginePlayAll(std::move(tracks), (int)jDeviceId, (int)jDeviceChannels) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSeekAllPreview(JNIEnv* /*env*/, jobject /*thiz*/, jdouble positionSec) {
+    engineSeek((double)positionSec);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativePlayWavPreview(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jstring jFilePath,
+        jint jOutputChannel,
+        jint jDeviceId,
+        jint jDeviceChannels) {
+    return enginePlayPreview(jstringToString(env, jFilePath), (int)jOutputChannel, (int)jDeviceId,
+                             (int)jDeviceChannels) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeStopPreview(JNIEnv* /*env*/, jobject /*thiz*/) {
+    engineStopPreview();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeStopMixer(JNIEnv* /*env*/, jobject /*thiz*/) {
+    engineStopMixer();
+}
+
+// deviceCallback do Kotlin: interface USB conectada (id) ou removida (-1)
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetOutputDevice(JNIEnv* /*env*/, jobject /*thiz*/, jint deviceId) {
+    engineSetOutputDevice((int)deviceId);
+}
+
+// Chamado fora do thread da UI
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativePrepareAllPreview(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jobjectArray jFilePaths,
+        jintArray jOutputChannels,
+        jint jDeviceId,
+        jint jDeviceChannels) {
+    return enginePrepareAll(jstringArray(env, jFilePaths), jintVector(env, jOutputChannels), (int)jDeviceId,
+                            (int)jDeviceChannels) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetPreviewVolume(JNIEnv* /*env*/, jobject /*thiz*/, jfloat vol) {
+    engineSetPreviewVolume((float)vol);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetPreviewPan(JNIEnv* /*env*/, jobject /*thiz*/, jfloat pan) {
+    engineSetPreviewPan((float)pan);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetAuxSend(JNIEnv* /*env*/, jobject /*thiz*/, jint trackIndex, jint auxIndex, jfloat level) {
+    return engineSetAuxSend((int32_t)trackIndex, (int32_t)auxIndex, (float)level) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetTrackParam(JNIEnv* /*env*/, jobject /*thiz*/, jint trackIndex, jint paramId, jfloat value) {
+    return engineSetTrackParam((int32_t)trackIndex, (int32_t)paramId, (float)value) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jdoubleArray JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeGetEngineStats(JNIEnv* env, jobject /*thiz*/) {
+    double vals[STAT_HEADER_COUNT + kMaxStatTracks];
+    const int n = engineStatsSnapshot(vals, STAT_HEADER_COUNT + kMaxStatTracks);
+    jdoubleArray arr = env->NewDoubleArray(n);
+    env->SetDoubleArrayRegion(arr, 0, n, vals);
+    return arr;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetBusParam(JNIEnv* /*env*/, jobject /*thiz*/, jint busIndex, jint paramId, jfloat value) {
+    return engineSetBusParam((int32_t)busIndex, (int32_t)paramId, (float)value) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Configura os buses usados pelo próximo nativePlayAllPreview. trackBuses[i] é o
+// índice do bus da track i (-1 = direto na saída); busParents[b] idem para buses.
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetMixGraph(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jintArray jTrackBuses,
+        jintArray jBusParents,
+        jfloatArray jBusVolumes,
+        jfloatArray jBusPans,
+        jintArray jBusMutes) {
+    std::vector<int> trackBuses = jintVector(env, jTrackBuses);
+    const std::vector<int> parents = jintVector(env, jBusParents);
+    const std::vector<float> vols = jfloatVector(env, jBusVolumes);
+    const std::vector<float> pans = jfloatVector(env, jBusPans);
+    const std::vector<int> mutes = jintVector(env, jBusMutes);
+    std::vector<MixBusConfig> buses;
+    if (!parents.empty()) {
+        if (vols.size() != parents.size() || pans.size() != parents.size() || mutes.size() != parents.size()) {
+            LOGE("nativeSetMixGraph: bus arrays size mismatch");
+            engineSetMixGraph({}, {});
+            return;
+        }
+        for (size_t b = 0; b < parents.size(); ++b) {
+            MixBusConfig cfg;
+            cfg.parent = parents[b];
+            cfg.volume = vols[b];
+            cfg.pan = pans[b];
+            cfg.mute = mutes[b] != 0;
+            buses.push_back(cfg);
+        }
+    }
+    engineSetMixGraph(std::move(trackBuses), std::move(buses));
+}
+
+// Mixes auxiliares do próximo play: `auxOutputs[a]` é o primeiro canal do par
+// do aux a; `sends` tem os níveis track x aux (track-major)
+extern "C" JNIEXPORT void JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeSetAuxSends(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jintArray jAuxOutputs,
+        jfloatArray jSends) {
+    engineSetAuxSends(jintVector(env, jAuxOutputs), jfloatVector(env, jSends));
+}
+
+// Gravação da interface USB: stream AAudio de entrada (callback) alimenta o
+// ring do writer do engine
+static AAudioStream* gInputStream = nullptr;
+
+static int64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Callback de entrada: só marca o instante do primeiro frame e copia para o
+// ring; nada de disco, lock ou alocação aqui
+static aaudio_data_callback_result_t captureDataCallback(AAudioStream* stream, void* /*userData*/,
+                                                         void* audioData, int32_t numFrames) {
+    if (gCapture.firstFrameTimeNs() < 0) {
+        const int rate = AAudioStream_getSampleRate(stream);
+        const int64_t first = AAudioStream_getFramesRead(stream);
+        int64_t framePos = 0;
+        int64_t timeNs = 0;
+        if (AAudioStream_getTimestamp(stream, CLOCK_MONOTONIC, &framePos, &timeNs) == AAUDIO_OK) {
+            gCapture.markFirstFrame(timeNs + (first - framePos) * 1000000000LL / rate);
+        } else {
+            gCapture.markFirstFrame(monotonicNs() - (int64_t)numFrames * 1000000000LL / rate);
+        }
+    }
+    gCapture.push(static_cast<const int16_t*>(audioData), numFrames);
+    return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
+
+static void closeInputStream() {
+    if (gInputStream) {
+        AAudioStream_requestStop(gInputStream);
+        AAudioStream_close(gInputStream);
+        gInputStream = nullptr;
+    }
+}
+
+// Grava os canais `armedChannels` (0-based) da entrada em `directory`/in_<n>.wav.
+// Usa a taxa da sessão do mixer, se estiver tocando, para os dois lados
+// andarem no mesmo relógio da interface.
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeStartCapture(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jstring jDirectory,
+        jint jDeviceId,
+        jint jDeviceChannels,
+        jintArray jArmedChannels) {
+    if (gInputStream || gCapture.running()) {
+        LOGE("nativeStartCapture: already recording");
+        return JNI_FALSE;
+    }
+    CaptureConfig config;
+    config.directory = jstringToString(env, jDirectory);
+    config.channels = jintVector(env, jArmedChannels);
+    const int armedCount = (int)config.channels.size();
+    if (config.directory.empty() || armedCount <= 0) return JNI_FALSE;
+
+    int rate = 48000;
+    if (sharedLoad(gShared.status[MTP_STATUS_MIXING]) != 0) {
+        const int sessionRate = sharedLoad(gShared.status[MTP_STATUS_SAMPLE_RATE]);
+        if (sessionRate > 0) rate = sessionRate;
+    }
+
+    AAudioStreamBuilder* builder = nullptr;
+    if (AAudio_createStreamBuilder(&builder) != AAUDIO_OK) {
+        LOGE("nativeStartCapture: createStreamBuilder failed");
+        return JNI_FALSE;
+    }
+    AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_INPUT);
+    AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_I16);
+    AAudioStreamBuilder_setChannelCount(builder, (int)jDeviceChannels > 0 ? (int)jDeviceChannels : 2);
+    AAudioStreamBuilder_setSampleRate(builder, rate);
+    AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_EXCLUSIVE);
+    AAudioStreamBuilder_setPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
+    AAudioStreamBuilder_setDataCallback(builder, captureDataCallback, nullptr);
+    if (jDeviceId > 0) {
+        AAudioStreamBuilder_setDeviceId(builder, (int)jDeviceId);
+    }
+    const aaudio_result_t res = AAudioStreamBuilder_openStream(builder, &gInputStream);
+    AAudioStreamBuilder_delete(builder);
+    if (res != AAUDIO_OK || !gInputStream) {
+        LOGE("nativeStartCapture: openStream failed %d", res);
+        gInputStream = nullptr;
+        return JNI_FALSE;
+    }
+    config.deviceChannels = AAudioStream_getChannelCount(gInputStream);
+    config.sampleRate = AAudioStream_getSampleRate(gInputStream);
+    if (config.sampleRate != rate) {
+        LOGE("nativeStartCapture: input rate %d differs from session rate %d", config.sampleRate, rate);
+    }
+    // Writer pronto antes do primeiro callback
+    if (!gCapture.start(config)) {
+        LOGE("nativeStartCapture: cannot create files in %s", config.directory.c_str());
+        AAudioStream_close(gInputStream);
+        gInputStream = nullptr;
+        return JNI_FALSE;
+    }
+    if (AAudioStream_requestStart(gInputStream) != AAUDIO_OK) {
+        LOGE("nativeStartCapture: requestStart failed");
+        closeInputStream();
+        gCapture.stop();
+        return JNI_FALSE;
+    }
+    LOGI("capture started: channels=%d rate=%d armed=%d", config.deviceChannels, config.sampleRate, armedCount);
+    return JNI_TRUE;
+}
+
+// [framesWritten, framesDropped, startSongFrame (negativo = gravação começou
+//  antes do play; Long.MIN_VALUE sem playback), sampleRate, canais gravados
+//  (0-based)...]
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeStopCapture(JNIEnv* env, jobject /*thiz*/) {
+    const int rate = gInputStream ? AAudioStream_getSampleRate(gInputStream) : 0;
+    closeInputStream();
+    const CaptureResult r = gCapture.stop();
+    std::vector<jlong> vals = { (jlong)r.framesWritten, (jlong)r.framesDropped, (jlong)r.startSongFrame, (jlong)rate };
+    for (int ch : r.channels) vals.push_back((jlong)ch);
+    LOGI("capture stopped: written=%lld dropped=%lld", (long long)r.framesWritten, (long long)r.framesDropped);
+    jlongArray arr = env->NewLongArray((jsize)vals.size());
+    env->SetLongArrayRegion(arr, 0, (jsize)vals.size(), vals.data());
+    return arr;
+}
+
+// Começa a gravar as saídas do mixer em `directory`/`fileName`.wav;
+// channels/sampleRate valem se o mixer ainda não estiver tocando
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeStartOutputTap(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jstring jDirectory,
+        jstring jFileName,
+        jint jChannels,
+        jint jSampleRate) {
+    CaptureConfig config;
+    config.directory = jstringToString(env, jDirectory);
+    config.fileName = jstringToString(env, jFileName);
+    config.deviceChannels = (int)jChannels;
+    config.sampleRate = (int)jSampleRate;
+    return engineStartOutputTap(std::move(config)) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Caminhos dos segmentos gravados, em ordem
+extern "C" JNIEXPORT jobjectArray JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeStopOutputTap(JNIEnv* env, jobject /*thiz*/) {
+    const CaptureResult r = engineStopOutputTap();
+    jclass stringClass = env->FindClass("java/lang/String");
+    jobjectArray arr = env->NewObjectArray((jsize)r.files.size(), stringClass, nullptr);
+    for (size_t i = 0; i < r.files.size(); ++i) {
+        jstring path = env->NewStringUTF(r.files[i].c_str());
+        env->SetObjectArrayElement(arr, (jsize)i, path);
+        env->DeleteLocalRef(path);
+    }
+    return arr;
+}
+
+// [gravando (0/1), canais, sampleRate, framesWritten, framesDropped, blocksDropped,
+//  formatMismatchBlocks]; os contadores continuam valendo depois do stop
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_example_multitrack_1app_MainActivity_nativeGetOutputTapStats(JNIEnv* env, jobject /*thiz*/) {
+    int64_t stats[7];
+    engineOutputTapStats(stats);
+    jlong vals[7];
+    for (int i = 0; i < 7; ++i) vals[i] = (jlong)stats[i];
+    jlongArray arr = env->NewLongArray(7);
+    env->SetLongArrayRegion(arr, 0, 7, vals);
+    return arr;
+}
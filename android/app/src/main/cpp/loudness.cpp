@@ -0,0 +1,438 @@
+#include "loudness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file_probe.h"
+#include "insert_chain.h"
+#include "preload_cache.h"
+#include "silence_map.h"
+#include "thread_topology.h"
+#include "track_source.h"
+
+typedef float f32x8 __attribute__((vector_size(32)));
+
+static inline f32x8 load8(const Lane8& l) {
+    f32x8 v;
+    std::memcpy(&v, l.v, sizeof(v));
+    return v;
+}
+
+static inline void store8(Lane8& l, f32x8 v) {
+    std::memcpy(l.v, &v, sizeof(v));
+}
+
+static inline f32x8 splat8(float x) {
+    return f32x8{x, x, x, x, x, x, x, x};
+}
+
+static inline f32x8 abs8(f32x8 x) {
+    const f32x8 zero = splat8(0.0f);
+    return x < zero ? -x : x;
+}
+
+static inline f32x8 max8(f32x8 a, f32x8 b) {
+    return a > b ? a : b;
+}
+
+namespace {
+
+const int kChunkFrames = 4096;
+// Interpolador do true peak: 4 fases de 12 taps (BS.1770-4, anexo 2)
+const int kTpPhases = 4;
+const int kTpTaps = 12;
+// Frames por teste de "não pode passar do pico atual" no true peak
+const int kTpSkipFrames = 16;
+// Gates relativos: loudness integrada (BS.1770) e loudness range (Tech 3342)
+const double kIntegratedGateLu = -10.0;
+const double kRangeGateLu = -20.0;
+// Blocos de 400 ms e janelas de 3 s, em sub-blocos de 100 ms
+const int kBlockSubs = 4;
+const int kShortTermSubs = 30;
+
+struct BiquadCoeffs {
+    float b0, b1, b2, a1, a2;
+};
+
+// Filtro K para qualquer taxa: shelf de ~+4 dB acima de ~1.7 kHz seguido do
+// passa-altas RLB (~38 Hz), pelas fórmulas analógicas da BS.1770
+void kWeighting(double rate, BiquadCoeffs &shelf, BiquadCoeffs &highPass) {
+    {
+        const double f0 = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(M_PI * f0 / rate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (float)((vh + vb * k / q + k * k) / a0);
+        shelf.b1 = (float)(2.0 * (k * k - vh) / a0);
+        shelf.b2 = (float)((vh - vb * k / q + k * k) / a0);
+        shelf.a1 = (float)(2.0 * (k * k - 1.0) / a0);
+        shelf.a2 = (float)((1.0 - k / q + k * k) / a0);
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(M_PI * f0 / rate);
+        const double a0 = 1.0 + k / q + k * k;
+        highPass.b0 = 1.0f;
+        highPass.b1 = -2.0f;
+        highPass.b2 = 1.0f;
+        highPass.a1 = (float)(2.0 * (k * k - 1.0) / a0);
+        highPass.a2 = (float)((1.0 - k / q + k * k) / a0);
+    }
+}
+
+// Sinc janelado (Blackman) de 48 taps em 4 fases; cada fase soma 1
+struct TruePeakFir {
+    float h[kTpPhases][kTpTaps];
+    float gain = 0.0f; // maior soma de |h| entre as fases: |saída| <= gain * max|entrada|
+
+    TruePeakFir() {
+        const int n = kTpPhases * kTpTaps;
+        const double center = (n - 1) / 2.0;
+        for (int p = 0; p < kTpPhases; ++p) {
+            double sum = 0.0;
+            for (int j = 0; j < kTpTaps; ++j) {
+                const int i = p + j * kTpPhases;
+                const double t = (i - center) / kTpPhases;
+                const double sinc = t == 0.0 ? 1.0 : std::sin(M_PI * t) / (M_PI * t);
+                const double w = 0.42 - 0.5 * std::cos(2.0 * M_PI * (i + 0.5) / n) +
+                                 0.08 * std::cos(4.0 * M_PI * (i + 0.5) / n);
+                h[p][j] = (float)(sinc * w);
+                sum += h[p][j];
+            }
+            double absSum = 0.0;
+            for (int j = 0; j < kTpTaps; ++j) {
+                h[p][j] = (float)(h[p][j] / sum);
+                absSum += std::fabs(h[p][j]);
+            }
+            gain = std::max(gain, (float)absSum * 1.0001f);
+        }
+    }
+};
+
+// Estado de um grupo de 8 lanes; todas as lanes usam os mesmos coeficientes
+struct GroupMeter {
+    Lane8 z1[2] = {}, z2[2] = {};     // estágios do filtro K
+    Lane8 energy = {};                // soma de y² do sub-bloco em curso
+    Lane8 samplePeak = {}, truePeak = {};
+    // Entrada do interpolador: últimos kTpTaps - 1 frames do segmento anterior + segmento atual
+    std::vector<Lane8> tpInput = std::vector<Lane8>(kTpTaps - 1);
+};
+
+struct TrackMeter {
+    int firstLane = 0;
+    int lanes = 0;
+    int64_t frames = 0;
+    std::vector<double> subPower;     // potência ponderada por sub-bloco de 100 ms
+};
+
+void processGroup(GroupMeter &g, const BiquadCoeffs (&k)[2], const TruePeakFir &fir, const Lane8* x, int frames) {
+    f32x8 c[kTpPhases][kTpTaps];
+    for (int p = 0; p < kTpPhases; ++p) {
+        for (int j = 0; j < kTpTaps; ++j) c[p][j] = splat8(fir.h[p][j]);
+    }
+    f32x8 b0[2], b1[2], b2[2], a1[2], a2[2], z1[2], z2[2];
+    for (int s = 0; s < 2; ++s) {
+        b0[s] = splat8(k[s].b0);
+        b1[s] = splat8(k[s].b1);
+        b2[s] = splat8(k[s].b2);
+        a1[s] = splat8(k[s].a1);
+        a2[s] = splat8(k[s].a2);
+        z1[s] = load8(g.z1[s]);
+        z2[s] = load8(g.z2[s]);
+    }
+    f32x8 energy = load8(g.energy);
+    f32x8 samplePeak = load8(g.samplePeak);
+    f32x8 truePeak = load8(g.truePeak);
+
+    // True peak: 4 saídas interpoladas por frame, entrada contígua em tpInput.
+    // Trechos em que nenhuma saída pode passar do pico já medido (limite pela
+    // soma dos |h|) não são interpolados; o resultado é o mesmo.
+    const int hist = kTpTaps - 1;
+    const f32x8 tpGain = splat8(fir.gain);
+    g.tpInput.resize((size_t)(hist + frames));
+    std::memcpy(g.tpInput.data() + hist, x, sizeof(Lane8) * (size_t)frames);
+    for (int f0 = 0; f0 < frames; f0 += kTpSkipFrames) {
+        const int n = std::min(kTpSkipFrames, frames - f0);
+        f32x8 inPeak = splat8(0.0f);
+        for (int i = 0; i < n + hist; ++i) inPeak = max8(inPeak, abs8(load8(g.tpInput[(size_t)(f0 + i)])));
+        Lane8 bound;
+        store8(bound, tpGain * inPeak - truePeak);
+        if (*std::max_element(bound.v, bound.v + kLaneWidth) <= 0.0f) continue;
+        for (int f = f0; f < f0 + n; ++f) {
+            const Lane8* in = g.tpInput.data() + f + hist; // in[-j] = entrada de j frames atrás
+            f32x8 acc[kTpPhases];
+            for (int p = 0; p < kTpPhases; ++p) acc[p] = c[p][0] * load8(in[0]);
+            for (int j = 1; j < kTpTaps; ++j) {
+                const f32x8 v = load8(in[-j]);
+                for (int p = 0; p < kTpPhases; ++p) acc[p] += c[p][j] * v;
+            }
+            for (int p = 0; p < kTpPhases; ++p) truePeak = max8(truePeak, abs8(acc[p]));
+        }
+    }
+    std::memmove(g.tpInput.data(), g.tpInput.data() + frames, sizeof(Lane8) * (size_t)hist);
+
+    for (int f = 0; f < frames; ++f) {
+        const f32x8 in = load8(x[f]);
+        samplePeak = max8(samplePeak, abs8(in));
+
+        // Filtro K (transposed direct form II) e energia
+        f32x8 y = in;
+        for (int s = 0; s < 2; ++s) {
+            const f32x8 v = b0[s] * y + z1[s];
+            z1[s] = b1[s] * y - a1[s] * v + z2[s];
+            z2[s] = b2[s] * y - a2[s] * v;
+            y = v;
+        }
+        energy += y * y;
+    }
+    for (int s = 0; s < 2; ++s) {
+        store8(g.z1[s], z1[s]);
+        store8(g.z2[s], z2[s]);
+    }
+    store8(g.energy, energy);
+    store8(g.samplePeak, samplePeak);
+    store8(g.truePeak, truePeak);
+}
+
+double powerToLufs(double power) {
+    return power > 0.0 ? -0.691 + 10.0 * std::log10(power) : -HUGE_VAL;
+}
+
+double peakToDb(float peak) {
+    return peak > 0.0f ? std::max(MTP_PEAK_SILENCE, 20.0 * std::log10((double)peak)) : MTP_PEAK_SILENCE;
+}
+
+// Potência de janelas de `subs` sub-blocos com passo de um sub-bloco
+std::vector<double> windowPowers(const std::vector<double> &subPower, int subs) {
+    std::vector<double> out;
+    if ((int)subPower.size() < subs) return out;
+    double sum = 0.0;
+    for (int i = 0; i < subs; ++i) sum += subPower[i];
+    out.push_back(sum / subs);
+    for (size_t i = (size_t)subs; i < subPower.size(); ++i) {
+        sum += subPower[i] - subPower[i - (size_t)subs];
+        out.push_back(std::max(0.0, sum) / subs);
+    }
+    return out;
+}
+
+// Potências acima do gate absoluto e depois do relativo (LU abaixo da média
+// das que passaram no absoluto)
+std::vector<double> gatedPowers(const std::vector<double> &powers, double relativeGateLu) {
+    std::vector<double> kept;
+    double sum = 0.0;
+    for (double z : powers) {
+        if (powerToLufs(z) > MTP_LUFS_SILENCE) {
+            kept.push_back(z);
+            sum += z;
+        }
+    }
+    if (kept.empty()) return kept;
+    const double threshold = powerToLufs(sum / kept.size()) + relativeGateLu;
+    kept.erase(std::remove_if(kept.begin(), kept.end(), [&](double z) { return powerToLufs(z) <= threshold; }),
+               kept.end());
+    return kept;
+}
+
+void summarize(const TrackMeter &t, const std::vector<GroupMeter> &groups, int rate, MtpLoudness &out) {
+    out = MtpLoudness{};
+    out.valid = 1;
+    out.durationSec = (double)t.frames / rate;
+
+    const std::vector<double> blocks = gatedPowers(windowPowers(t.subPower, kBlockSubs), kIntegratedGateLu);
+    double sum = 0.0;
+    for (double z : blocks) sum += z;
+    out.integratedLufs = blocks.empty() ? MTP_LUFS_SILENCE : std::max(MTP_LUFS_SILENCE, powerToLufs(sum / blocks.size()));
+
+    std::vector<double> shortTerm = gatedPowers(windowPowers(t.subPower, kShortTermSubs), kRangeGateLu);
+    if (shortTerm.size() >= 2) {
+        std::sort(shortTerm.begin(), shortTerm.end());
+        const size_t last = shortTerm.size() - 1;
+        const double lo = powerToLufs(shortTerm[(size_t)std::lround(last * 0.10)]);
+        const double hi = powerToLufs(shortTerm[(size_t)std::lround(last * 0.95)]);
+        out.loudnessRange = hi - lo;
+    }
+
+    float samplePeak = 0.0f, truePeak = 0.0f;
+    for (int l = t.firstLane; l < t.firstLane + t.lanes; ++l) {
+        const GroupMeter &g = groups[(size_t)(l / kLaneWidth)];
+        samplePeak = std::max(samplePeak, g.samplePeak.v[l % kLaneWidth]);
+        truePeak = std::max(truePeak, g.truePeak.v[l % kLaneWidth]);
+    }
+    out.samplePeakDbfs = peakToDb(samplePeak);
+    out.truePeakDbtp = peakToDb(std::max(samplePeak, truePeak));
+}
+
+// Fecha o sub-bloco de 100 ms: potência ponderada (peso 1 por canal) de cada track
+void closeSubBlock(std::vector<TrackMeter> &tracks, std::vector<GroupMeter> &groups, int subFrames) {
+    for (auto &t : tracks) {
+        double sum = 0.0;
+        for (int l = t.firstLane; l < t.firstLane + t.lanes; ++l) {
+            sum += groups[(size_t)(l / kLaneWidth)].energy.v[l % kLaneWidth];
+        }
+        t.subPower.push_back(sum / subFrames);
+    }
+    for (auto &g : groups) g.energy = Lane8{};
+}
+
+struct StemMix {
+    float gainL = 0.0f;
+    float gainR = 0.0f;
+};
+
+// Mesma lei de pan do mixer (mixTrackInto)
+StemMix stemMix(float volume, float pan, int outputChannel) {
+    const float vol = std::max(0.0f, std::min(1.0f, volume));
+    const double angle = (M_PI / 2.0) * ((double)std::max(-1.0f, std::min(1.0f, pan)) + 1.0) / 2.0;
+    const bool pair = outputChannel >= 2;
+    StemMix m;
+    m.gainL = outputChannel == 1 ? 0.0f : vol * (pair ? (float)std::cos(angle) : 1.0f);
+    m.gainR = outputChannel == 0 ? 0.0f : vol * (pair ? (float)std::sin(angle) : 1.0f);
+    return m;
+}
+
+// Uma passada pelos stems: cada um nas suas lanes e a soma estéreo numa track
+// extra. O mapa de silêncio de cada stem sai da mesma leitura.
+bool analyzeSong(const std::vector<std::string> &paths, const std::vector<StemMix> &mix,
+                 MtpLoudness* stems, MtpLoudness &song,
+                 std::vector<std::shared_ptr<const SilenceMap>> &silence) {
+    const size_t count = paths.size();
+    std::vector<std::unique_ptr<TrackSource>> sources;
+    std::vector<int> channels;
+    for (const auto &path : paths) {
+        std::unique_ptr<TrackSource> src = makeMemoryTrackSource(gPreloadCache.lookup(path));
+        if (!src) src = openFileTrackSource(path);
+        if (!src || (!sources.empty() && src->info().sampleRate != sources[0]->info().sampleRate)) return false;
+        channels.push_back(src->info().channels);
+        sources.push_back(std::move(src));
+    }
+    const int rate = sources[0]->info().sampleRate;
+    const int subFrames = std::max(1, rate / 10);
+    channels.push_back(2);
+
+    // Só o mapeamento de lanes do mixer; nenhum insert roda aqui
+    InsertChain layout;
+    layout.configure(channels, (float)rate);
+    const int groupCount = layout.groupCount();
+    std::vector<TrackMeter> tracks(count + 1);
+    for (size_t i = 0; i <= count; ++i) {
+        tracks[i].firstLane = layout.trackFirstLane((int)i);
+        tracks[i].lanes = layout.trackLaneCount((int)i);
+    }
+    BiquadCoeffs k[2];
+    kWeighting(rate, k[0], k[1]);
+    static const TruePeakFir fir;
+    std::vector<GroupMeter> groups((size_t)groupCount);
+    std::vector<Lane8> lanes((size_t)groupCount * kChunkFrames);
+    std::vector<uint8_t> ended(count, 0);
+    std::vector<SilenceMapBuilder> silenceBuilders(count);
+    TrackMeter &sum = tracks[count];
+    int subPos = 0;
+
+    for (;;) {
+        int frames = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const int first = tracks[i].firstLane;
+            Lane8* grp = lanes.data() + (size_t)(first / kLaneWidth) * kChunkFrames;
+            const int li = first % kLaneWidth;
+            const int got = ended[i] ? 0 : std::max(0, sources[i]->readLanes(grp, li, kChunkFrames));
+            if (got < kChunkFrames) ended[i] = 1;
+            for (int f = got; f < kChunkFrames; ++f) {
+                for (int c = 0; c < tracks[i].lanes; ++c) grp[f].v[li + c] = 0.0f;
+            }
+            silenceBuilders[i].add(grp, li, tracks[i].lanes, got);
+            tracks[i].frames += got;
+            frames = std::max(frames, got);
+        }
+        if (frames <= 0) break;
+
+        Lane8* sumGrp = lanes.data() + (size_t)(sum.firstLane / kLaneWidth) * kChunkFrames;
+        const int sumL = sum.firstLane % kLaneWidth;
+        for (int f = 0; f < frames; ++f) sumGrp[f].v[sumL] = sumGrp[f].v[sumL + 1] = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            if (mix[i].gainL == 0.0f && mix[i].gainR == 0.0f) continue;
+            const int first = tracks[i].firstLane;
+            const Lane8* grp = lanes.data() + (size_t)(first / kLaneWidth) * kChunkFrames;
+            const int liL = first % kLaneWidth;
+            const int liR = tracks[i].lanes == 2 ? liL + 1 : liL;
+            for (int f = 0; f < frames; ++f) {
+                sumGrp[f].v[sumL] += grp[f].v[liL] * mix[i].gainL;
+                sumGrp[f].v[sumL + 1] += grp[f].v[liR] * mix[i].gainR;
+            }
+        }
+        sum.frames += frames;
+
+        // Segmentos cortados na fronteira dos sub-blocos de 100 ms
+        for (int done = 0; done < frames;) {
+            const int n = std::min(frames - done, subFrames - subPos);
+            for (int g = 0; g < groupCount; ++g) {
+                processGroup(groups[(size_t)g], k, fir, lanes.data() + (size_t)g * kChunkFrames + done, n);
+            }
+            done += n;
+            subPos += n;
+            if (subPos == subFrames) {
+                closeSubBlock(tracks, groups, subFrames);
+                subPos = 0;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        // Sub-blocos depois do fim do stem são silêncio e não passam do gate
+        summarize(tracks[i], groups, rate, stems[i]);
+        silence.push_back(silenceBuilders[i].finish());
+    }
+    summarize(sum, groups, rate, song);
+    return true;
+}
+
+} // namespace
+
+extern "C" {
+
+int32_t mtp_loudness_song(int32_t songId, const char* const* paths, const float* volumes,
+                          const float* pans, const int32_t* outputChannels, int32_t count,
+                          MtpLoudness* stems, MtpLoudness* song) {
+    if (!paths || !volumes || !pans || !outputChannels || !stems || !song || count <= 0) return 0;
+    ScopedThreadClass background(ThreadClass::Analysis);
+    *song = MtpLoudness{};
+    std::vector<std::string> files;
+    std::vector<StemMix> mix;
+    std::vector<MtpFileProbe> probes((size_t)count);
+    std::string fingerprint;
+    bool cached = true;
+    for (int32_t i = 0; i < count; ++i) {
+        stems[i] = MtpLoudness{};
+        files.emplace_back(paths[i] ? paths[i] : "");
+        mix.push_back(stemMix(volumes[i], pans[i], outputChannels[i]));
+        if (!probeFile(files.back(), probes[(size_t)i])) return 0;
+        char line[160];
+        std::snprintf(line, sizeof(line), "|%lld|%lld|%.4f|%.4f|%d\n", (long long)probes[(size_t)i].fileSize,
+                      (long long)probes[(size_t)i].mtimeNs, volumes[i], pans[i], outputChannels[i]);
+        fingerprint += files.back();
+        fingerprint += line;
+        cached = gProbeCache.lookupLoudness(files.back(), probes[(size_t)i].fileSize, probes[(size_t)i].mtimeNs, stems[i]) && cached;
+    }
+    if (cached && gProbeCache.lookupSong(songId, fingerprint, *song)) return 1;
+
+    std::vector<std::shared_ptr<const SilenceMap>> silence;
+    if (!analyzeSong(files, mix, stems, *song, silence)) return 0;
+    for (int32_t i = 0; i < count; ++i) {
+        gProbeCache.storeLoudness(files[(size_t)i], probes[(size_t)i].fileSize, probes[(size_t)i].mtimeNs, stems[i]);
+        gProbeCache.storeSilence(files[(size_t)i], probes[(size_t)i].fileSize, probes[(size_t)i].mtimeNs,
+                                 silence[(size_t)i]);
+    }
+    gProbeCache.storeSong(songId, fingerprint, *song);
+    return 1;
+}
+
+} // extern "C"
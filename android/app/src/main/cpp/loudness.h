@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "engine_shared.h"
+
+// Loudness de stems e da música somada (ITU-R BS.1770 / EBU R128): loudness
+// integrada com gate, loudness range (EBU Tech 3342) e true peak com
+// oversampling 4x. Tudo numa passada só pelos arquivos: as fontes são lidas
+// como no mixer, nas mesmas lanes de 8 canais, e o filtro K, a energia e o
+// true peak rodam vetorizados por grupo. Os resultados ficam no cache de
+// análise de file_probe (stems por arquivo, música por id), junto com o mapa
+// de silêncio de cada stem, montado na mesma leitura.
+
+// Valores abaixo do gate absoluto / silêncio digital
+#define MTP_LUFS_SILENCE (-70.0)
+#define MTP_PEAK_SILENCE (-120.0)
+
+// Layout C espelhado no Dart (48 bytes)
+typedef struct MtpLoudness {
+    int32_t valid;          // 1 = analisado
+    int32_t cached;         // 1 = veio do cache, nada foi lido
+    double integratedLufs;  // MTP_LUFS_SILENCE se nada passou do gate
+    double loudnessRange;   // LU
+    double truePeakDbtp;
+    double samplePeakDbfs;
+    double durationSec;
+} MtpLoudness;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Analisa os stems de uma música e a soma deles com o volume, pan e saída de
+// cada um (mesma lei de pan do mixer; volume 0 tira o stem da soma, ex.:
+// metrônomo). stems[i] corresponde a paths[i]. Stems e música já analisados
+// com os mesmos arquivos e a mesma mix voltam do cache. Devolve 1 se a
+// música foi analisada.
+MTP_EXPORT int32_t mtp_loudness_song(int32_t songId, const char* const* paths, const float* volumes,
+                                     const float* pans, const int32_t* outputChannels, int32_t count,
+                                     MtpLoudness* stems, MtpLoudness* song);
+
+#ifdef __cplusplus
+}
+#endif
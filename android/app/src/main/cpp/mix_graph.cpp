@@ -0,0 +1,131 @@
+#include "mix_graph.h"
+#include "param_queue.h"
+
+#include <algorithm>
+#include <cmath>
+
+void MixGraph::prepare(const std::vector<MixBusConfig>& buses, const std::vector<int>& trackBus,
+                       int blockFrames, float sampleRate) {
+    const int count = (int)buses.size();
+    mBuses.assign((size_t)count, Bus());
+    mSteps.clear();
+    mBuffers.clear();
+
+    for (int b = 0; b < count; ++b) {
+        Bus& bus = mBuses[b];
+        bus.parent = buses[b].parent;
+        if (bus.parent < 0 || bus.parent >= count || bus.parent == b) bus.parent = -1;
+        bus.volume = std::max(0.0f, std::min(1.0f, buses[b].volume));
+        bus.pan = std::max(-1.0f, std::min(1.0f, buses[b].pan));
+        bus.mute = buses[b].mute;
+        bus.inserts.configure(std::vector<int>{2}, sampleRate);
+    }
+    // Quebra ciclos: um bus cuja cadeia de pais volta a ele vai para a saída
+    for (int b = 0; b < count; ++b) {
+        int p = mBuses[b].parent;
+        for (int hops = 0; p >= 0 && hops <= count; ++hops) {
+            if (p == b || hops == count) { mBuses[b].parent = -1; break; }
+            p = mBuses[p].parent;
+        }
+    }
+
+    mTrackBus.assign(trackBus.size(), -1);
+    for (size_t t = 0; t < trackBus.size(); ++t) {
+        const int b = trackBus[t];
+        if (b >= 0 && b < count) {
+            mTrackBus[t] = b;
+            mBuses[b].tracks.push_back((int)t);
+        }
+    }
+
+    // DFS iterativa a partir das raízes, atribuindo slots de buffer
+    std::vector<std::vector<int>> children((size_t)count);
+    for (int b = 0; b < count; ++b) {
+        if (mBuses[b].parent >= 0) children[mBuses[b].parent].push_back(b);
+    }
+    std::vector<int> freeSlots;
+    int slotCount = 0;
+    std::vector<std::pair<int, size_t>> stack; // (bus, próximo filho)
+    for (int root = 0; root < count; ++root) {
+        if (mBuses[root].parent >= 0) continue;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            const int b = top.first;
+            if (top.second == 0) {
+                if (freeSlots.empty()) freeSlots.push_back(slotCount++);
+                mBuses[b].slot = freeSlots.back();
+                freeSlots.pop_back();
+                mSteps.push_back({b, true});
+            }
+            if (top.second < children[b].size()) {
+                const int child = children[b][top.second++];
+                stack.emplace_back(child, 0);
+                continue;
+            }
+            mSteps.push_back({b, false});
+            freeSlots.push_back(mBuses[b].slot);
+            stack.pop_back();
+        }
+    }
+    mBuffers.assign((size_t)slotCount, std::vector<Lane8>((size_t)std::max(1, blockFrames)));
+}
+
+int MixGraph::trackBus(int track) const {
+    if (track < 0 || track >= (int)mTrackBus.size()) return -1;
+    return mTrackBus[track];
+}
+
+void MixGraph::setParam(int bus, int param, float value) {
+    if (bus < 0 || bus >= (int)mBuses.size() || !std::isfinite(value)) return;
+    Bus& b = mBuses[bus];
+    switch (param) {
+        case PARAM_TRACK_VOLUME: b.volume = std::max(0.0f, std::min(1.0f, value)); break;
+        case PARAM_TRACK_PAN: b.pan = std::max(-1.0f, std::min(1.0f, value)); break;
+        case PARAM_MUTE: b.mute = value >= 0.5f; break;
+        default: b.inserts.setParam(0, param, value); break;
+    }
+}
+
+void MixGraph::render(TrackMixFn mixTrack, void* ctx, float* master, int masterStride, int frames) {
+    if (frames <= 0) return;
+    for (const Step& step : mSteps) {
+        Bus& bus = mBuses[step.bus];
+        Lane8* buf = mBuffers[bus.slot].data();
+        float* raw = buf[0].v;
+        if (step.enter) {
+            for (int f = 0; f < frames; ++f) {
+                buf[f].v[0] = 0.0f;
+                buf[f].v[1] = 0.0f;
+            }
+            continue;
+        }
+
+        for (int t : bus.tracks) mixTrack(ctx, t, raw, kLaneWidth, frames);
+        if (bus.inserts.groupActive(0)) bus.inserts.processGroup(0, buf, frames);
+
+        // Pan de bus é balanço (centro = ganho unitário nos dois lados)
+        const float vol = bus.mute ? 0.0f : bus.volume;
+        const float gL = vol * std::min(1.0f, 1.0f - bus.pan);
+        const float gR = vol * std::min(1.0f, 1.0f + bus.pan);
+        if (bus.lastGainL < 0.0f) { bus.lastGainL = gL; bus.lastGainR = gR; }
+        const float stepL = (gL - bus.lastGainL) / (float)frames;
+        const float stepR = (gR - bus.lastGainR) / (float)frames;
+
+        float* dst = master;
+        int stride = masterStride;
+        if (bus.parent >= 0) {
+            dst = mBuffers[mBuses[bus.parent].slot][0].v;
+            stride = kLaneWidth;
+        }
+        float curL = bus.lastGainL, curR = bus.lastGainR;
+        for (int f = 0; f < frames; ++f) {
+            curL += stepL;
+            curR += stepR;
+            dst[(size_t)f * stride + 0] += buf[f].v[0] * curL;
+            dst[(size_t)f * stride + 1] += buf[f].v[1] * curR;
+        }
+        bus.lastGainL = gL;
+        bus.lastGainR = gR;
+    }
+}
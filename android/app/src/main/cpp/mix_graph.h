@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include "insert_chain.h"
+
+// Grafo de mixagem track -> bus -> saída. Cada bus tem um pai (outro bus ou a
+// saída principal), ganho, pan (balanço), mute e sua própria cadeia de inserts.
+//
+// Em prepare() os buses são validados (pais inválidos ou ciclos vão para a
+// saída) e ordenados uma única vez numa lista de passos em DFS: ENTER zera o
+// buffer do bus, EXIT soma as tracks dele, roda inserts/ganho e mistura no pai.
+// Os buffers são atribuídos por slot no ENTER e liberados no EXIT, então o
+// número de buffers vivos é a profundidade da árvore, não o número de buses.
+
+struct MixBusConfig {
+    int parent = -1; // -1 = saída principal
+    float volume = 1.0f;
+    float pan = 0.0f;
+    bool mute = false;
+};
+
+class MixGraph {
+public:
+    // Soma a track `track` em `dst` (canais L/R em dst[f*stride + 0/1]).
+    using TrackMixFn = void (*)(void* ctx, int track, float* dst, int stride, int frames);
+
+    void prepare(const std::vector<MixBusConfig>& buses, const std::vector<int>& trackBus,
+                 int blockFrames, float sampleRate);
+
+    int busCount() const { return (int)mBuses.size(); }
+    int bufferCount() const { return (int)mBuffers.size(); }
+    // Bus da track depois da validação (-1 = direto na saída)
+    int trackBus(int track) const;
+
+    // Deve ser chamado somente pelo thread de render (entre blocos).
+    void setParam(int bus, int param, float value);
+
+    // Processa os buses na ordem preparada e soma o resultado na saída
+    // principal (`master`, `masterStride` floats por frame, canais 0/1).
+    void render(TrackMixFn mixTrack, void* ctx, float* master, int masterStride, int frames);
+
+private:
+    struct Bus {
+        int parent = -1;
+        std::vector<int> tracks;
+        float volume = 1.0f;
+        float pan = 0.0f;
+        bool mute = false;
+        float lastGainL = -1.0f;
+        float lastGainR = -1.0f;
+        int slot = 0;
+        InsertChain inserts;
+    };
+    struct Step {
+        int bus;
+        bool enter;
+    };
+
+    std::vector<Bus> mBuses;
+    std::vector<Step> mSteps;
+    std::vector<std::vector<Lane8>> mBuffers;
+    std::vector<int> mTrackBus;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "output_adapter.h"
+
+// Stream de saída em que o render do mixer escreve, separado da API de áudio
+// da plataforma: AAudio no Android (mixer_output_aaudio.cpp), ALSA no desktop
+// Linux (mixer_output_alsa.cpp). O render só escreve blocos intercalados no
+// formato concedido; o que for diferente do pedido fica com o OutputAdapter.
+class MixerOutput {
+public:
+    virtual ~MixerOutput() = default;
+
+    // Formato concedido
+    virtual int channelCount() const = 0;
+    virtual int sampleRate() const = 0;
+    virtual OutputSampleFormat format() const = 0;
+    // Dispositivo só deste stream (AAudio exclusivo, hw: do ALSA)
+    virtual bool exclusive() const = 0;
+
+    virtual bool start() = 0;
+    // Iniciado e ainda usável (o play seguinte pode reaproveitar)
+    virtual bool running() const = 0;
+    // Escreve até `frames` frames, esperando no máximo `timeoutNs`; devolve os
+    // frames aceitos ou < 0 se o dispositivo caiu
+    virtual int write(const void* data, int frames, int64_t timeoutNs) = 0;
+    // Queda avisada fora do write (callback de erro do AAudio)
+    virtual bool lost() const = 0;
+    // Frame do stream apresentado em `timeNs` (CLOCK_MONOTONIC); false se o
+    // stream ainda não tem posição (recém-aberto)
+    virtual bool timestamp(int64_t &framePosition, int64_t &timeNs) = 0;
+    virtual int64_t framesWritten() const = 0;
+};
+
+// Stream aberto e ainda parado. Primeiro o exclusivo no formato da sessão
+// (int16, canais e taxa pedidos); com `allowShared` e sem ele (dispositivo
+// ocupado, contagem de canais recusada), o compartilhado no formato que o
+// sistema escolher. `deviceId` <= 0: saída padrão.
+std::unique_ptr<MixerOutput> openMixerOutput(int deviceId, int channels, int sampleRate, bool allowShared = true);
+
+// Dispositivo de saída visto pelo engine. No Android a lista vem do
+// AudioManager (Kotlin) e esta fica vazia.
+struct OutputDeviceInfo {
+    int id = -1;            // para openMixerOutput
+    std::string name;       // nome do produto
+    std::string pcm;        // nome do PCM na API nativa (hw:1,0)
+    int maxChannels = 0;
+    bool usb = false;
+};
+
+std::vector<OutputDeviceInfo> listOutputDevices();
+// Placas presentes (número, id e driver), sem abrir PCM: barata o bastante
+// para o poll de hotplug, que só relista (e sonda canais) quando ela muda.
+// Vazia no Android.
+std::string outputCardsSignature();
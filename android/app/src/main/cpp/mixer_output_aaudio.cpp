@@ -0,0 +1,121 @@
+#include "mixer_output.h"
+
+#include <aaudio/AAudio.h>
+#include <atomic>
+#include <time.h>
+
+#include "engine_log.h"
+
+namespace {
+
+class AAudioOutput : public MixerOutput {
+public:
+    ~AAudioOutput() override {
+        if (mStream) {
+            AAudioStream_requestStop(mStream);
+            AAudioStream_close(mStream);
+        }
+    }
+
+    // Stream de saída com modo de compartilhamento e formato dados
+    bool open(int deviceId, int channels, int sampleRate, aaudio_sharing_mode_t sharing, aaudio_format_t format) {
+        AAudioStreamBuilder* builder = nullptr;
+        aaudio_result_t res = AAudio_createStreamBuilder(&builder);
+        if (res != AAUDIO_OK || !builder) { LOGE("builder fail %d", res); return false; }
+        AAudioStreamBuilder_setFormat(builder, format);
+        AAudioStreamBuilder_setChannelCount(builder, channels);
+        AAudioStreamBuilder_setSampleRate(builder, sampleRate);
+        AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_OUTPUT);
+        AAudioStreamBuilder_setSharingMode(builder, sharing);
+        if (deviceId > 0) {
+            AAudioStreamBuilder_setDeviceId(builder, deviceId);
+        }
+        AAudioStreamBuilder_setErrorCallback(builder, errorCallback, this);
+        res = AAudioStreamBuilder_openStream(builder, &mStream);
+        AAudioStreamBuilder_delete(builder);
+        if (res != AAUDIO_OK || !mStream) {
+            LOGE("openStream fail %d (sharing=%d)", res, (int)sharing);
+            mStream = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // Formato de amostra do stream que o render sabe escrever
+    bool validFormat() const {
+        const aaudio_format_t f = AAudioStream_getFormat(mStream);
+        return (f == AAUDIO_FORMAT_PCM_I16 || f == AAUDIO_FORMAT_PCM_FLOAT) &&
+               AAudioStream_getChannelCount(mStream) >= 1 && AAudioStream_getSampleRate(mStream) > 0;
+    }
+
+    int channelCount() const override { return AAudioStream_getChannelCount(mStream); }
+    int sampleRate() const override { return AAudioStream_getSampleRate(mStream); }
+    OutputSampleFormat format() const override {
+        return AAudioStream_getFormat(mStream) == AAUDIO_FORMAT_PCM_FLOAT ? OutputSampleFormat::Float
+                                                                           : OutputSampleFormat::Int16;
+    }
+    bool exclusive() const override { return AAudioStream_getSharingMode(mStream) == AAUDIO_SHARING_MODE_EXCLUSIVE; }
+
+    bool start() override {
+        const aaudio_result_t res = AAudioStream_requestStart(mStream);
+        if (res != AAUDIO_OK) { LOGE("start fail %d", res); return false; }
+        return true;
+    }
+
+    bool running() const override {
+        return !mLost.load() && AAudioStream_getState(mStream) == AAUDIO_STREAM_STATE_STARTED;
+    }
+
+    int write(const void* data, int frames, int64_t timeoutNs) override {
+        return (int)AAudioStream_write(mStream, data, frames, timeoutNs);
+    }
+
+    bool lost() const override { return mLost.load(); }
+
+    bool timestamp(int64_t &framePosition, int64_t &timeNs) override {
+        return AAudioStream_getTimestamp(mStream, CLOCK_MONOTONIC, &framePosition, &timeNs) == AAUDIO_OK;
+    }
+
+    int64_t framesWritten() const override { return AAudioStream_getFramesWritten(mStream); }
+
+private:
+    // Queda do stream (interface USB desconectada): o callback só marca; o
+    // render para de escrever e reabre o stream fora dele
+    static void errorCallback(AAudioStream* /*stream*/, void* userData, aaudio_result_t error) {
+        LOGE("mixer stream error %d", error);
+        if (error == AAUDIO_ERROR_DISCONNECTED) static_cast<AAudioOutput*>(userData)->mLost.store(true);
+    }
+
+    AAudioStream* mStream = nullptr;
+    std::atomic<bool> mLost{false};
+};
+
+} // namespace
+
+std::unique_ptr<MixerOutput> openMixerOutput(int deviceId, int channels, int sampleRate, bool allowShared) {
+    std::unique_ptr<AAudioOutput> out(new AAudioOutput());
+    if (!out->open(deviceId, channels, sampleRate, AAUDIO_SHARING_MODE_EXCLUSIVE, AAUDIO_FORMAT_PCM_I16)) {
+        if (!allowShared) return nullptr;
+        out.reset(new AAudioOutput());
+        if (!out->open(deviceId, AAUDIO_UNSPECIFIED, AAUDIO_UNSPECIFIED, AAUDIO_SHARING_MODE_SHARED,
+                       AAUDIO_FORMAT_PCM_FLOAT)) {
+            return nullptr;
+        }
+    }
+    if (!out->validFormat()) {
+        LOGE("mixer stream: unsupported format");
+        return nullptr;
+    }
+    LOGI("mixer stream: sharing=%s %dch %dHz %s (session %dch %dHz)", out->exclusive() ? "exclusive" : "shared",
+         out->channelCount(), out->sampleRate(), out->format() == OutputSampleFormat::Float ? "float" : "i16",
+         channels, sampleRate);
+    return out;
+}
+
+std::vector<OutputDeviceInfo> listOutputDevices() {
+    return {};
+}
+
+std::string outputCardsSignature() {
+    return std::string();
+}
@@ -0,0 +1,365 @@
+#include "mixer_output.h"
+
+#include <alsa/asoundlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <time.h>
+
+#include "engine_log.h"
+
+// Saída ALSA do desktop Linux. Com um dispositivo escolhido (id > 0) o stream
+// abre hw:card,dev direto: sem dmix nem servidor de som no caminho, o
+// dispositivo fica só com o engine (o "exclusivo" do AAudio). Escreve por
+// mmap (snd_pcm_mmap_begin/commit no buffer do driver); PCMs sem mmap caem
+// no writei. Sem hw no formato da sessão, plughw converte; sem dispositivo
+// escolhido, a saída padrão, ou MTP_ALSA_DEVICE ("null", "hw:Loopback,0" do
+// snd-aloop) nas máquinas sem placa de som.
+//
+// id = 1 + card * kAlsaDevicesPerCard + device
+
+namespace {
+
+constexpr int kAlsaDevicesPerCard = 32;
+// Buffer de ~4 blocos do mixer em 48 kHz, em 4 períodos
+constexpr unsigned kAlsaBufferUs = 40000;
+constexpr unsigned kAlsaPeriods = 4;
+
+// Canais máximos já vistos por PCM: com o stream aberto pelo engine, o hw
+// fica ocupado e a enumeração seguinte não consegue abrir para perguntar
+std::mutex gChannelsMutex;
+std::map<std::string, int> gKnownChannels;
+
+std::string hwName(int deviceId, const char* prefix) {
+    const int index = deviceId - 1;
+    return std::string(prefix) + std::to_string(index / kAlsaDevicesPerCard) + "," +
+           std::to_string(index % kAlsaDevicesPerCard);
+}
+
+std::string defaultPcm() {
+    const char* env = std::getenv("MTP_ALSA_DEVICE");
+    return env && *env ? env : "default";
+}
+
+int64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+class AlsaOutput : public MixerOutput {
+public:
+    ~AlsaOutput() override {
+        if (mPcm) {
+            snd_pcm_drop(mPcm);
+            snd_pcm_close(mPcm);
+        }
+    }
+
+    // `exactFormat`: canais e taxa pedidos, sem aproximação (hw: direto)
+    bool open(const std::string &name, int channels, int sampleRate, snd_pcm_format_t format, bool exactFormat) {
+        int err = snd_pcm_open(&mPcm, name.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+        if (err < 0) {
+            LOGE("alsa: open %s failed: %s", name.c_str(), snd_strerror(err));
+            mPcm = nullptr;
+            return false;
+        }
+        mName = name;
+        mExclusive = name.compare(0, 3, "hw:") == 0 || name.compare(0, 6, "plughw") == 0;
+        if (!configure(channels, sampleRate, format, exactFormat, true) &&
+            !configure(channels, sampleRate, format, exactFormat, false)) {
+            return false;
+        }
+        return true;
+    }
+
+    int channelCount() const override { return mChannels; }
+    int sampleRate() const override { return mRate; }
+    OutputSampleFormat format() const override { return mFormat; }
+    bool exclusive() const override { return mExclusive; }
+    bool mmap() const { return mMmap; }
+    const std::string &name() const { return mName; }
+
+    // O PCM começa a tocar quando o buffer enche (start explícito no mmap)
+    bool start() override {
+        mStarted = true;
+        return true;
+    }
+
+    bool running() const override { return mStarted && !mLost; }
+
+    int write(const void* data, int frames, int64_t timeoutNs) override {
+        if (mLost) return -ENODEV;
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        const int timeoutMs = (int)std::max<int64_t>(1, timeoutNs / 1000000);
+        int done = 0;
+        while (done < frames) {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(mPcm);
+            if (avail < 0) {
+                if (!recover((int)avail)) return -ENODEV;
+                continue;
+            }
+            if (avail == 0) {
+                // Buffer cheio: começa a tocar (primeira escrita ou depois de um xrun)
+                if (snd_pcm_state(mPcm) == SND_PCM_STATE_PREPARED) {
+                    const int err = snd_pcm_start(mPcm);
+                    if (err < 0 && !recover(err)) return -ENODEV;
+                    continue;
+                }
+                const int ready = snd_pcm_wait(mPcm, timeoutMs);
+                if (ready == 0) return done; // timeout
+                if (ready < 0 && !recover(ready)) return -ENODEV;
+                continue;
+            }
+            const int chunk = (int)std::min<snd_pcm_sframes_t>(avail, frames - done);
+            const int wrote = mMmap ? writeMmap(src + (size_t)done * mFrameBytes, chunk)
+                                    : writeRw(src + (size_t)done * mFrameBytes, chunk);
+            if (wrote < 0) {
+                if (!recover(wrote)) return -ENODEV;
+                continue;
+            }
+            done += wrote;
+            mFramesWritten += wrote;
+        }
+        return done;
+    }
+
+    bool lost() const override { return mLost; }
+
+    // Frames escritos menos o que ainda está no buffer e no hardware (delay)
+    bool timestamp(int64_t &framePosition, int64_t &timeNs) override {
+        snd_pcm_sframes_t delay = 0;
+        if (snd_pcm_state(mPcm) != SND_PCM_STATE_RUNNING || snd_pcm_delay(mPcm, &delay) < 0) return false;
+        framePosition = mFramesWritten - delay;
+        timeNs = monotonicNs();
+        return true;
+    }
+
+    int64_t framesWritten() const override { return mFramesWritten; }
+
+private:
+    bool configure(int channels, int sampleRate, snd_pcm_format_t format, bool exact, bool useMmap) {
+        snd_pcm_hw_params_t* hw = nullptr;
+        snd_pcm_hw_params_alloca(&hw);
+        snd_pcm_hw_params_any(mPcm, hw);
+        snd_pcm_hw_params_set_rate_resample(mPcm, hw, exact ? 0 : 1);
+        const snd_pcm_access_t access = useMmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED;
+        if (snd_pcm_hw_params_set_access(mPcm, hw, access) < 0) return false;
+        if (snd_pcm_hw_params_set_format(mPcm, hw, format) < 0) return false;
+        unsigned ch = (unsigned)channels;
+        unsigned rate = (unsigned)sampleRate;
+        if (exact) {
+            if (snd_pcm_hw_params_set_channels(mPcm, hw, ch) < 0) return false;
+            if (snd_pcm_hw_params_set_rate(mPcm, hw, rate, 0) < 0) return false;
+        } else {
+            if (snd_pcm_hw_params_set_channels_near(mPcm, hw, &ch) < 0) return false;
+            if (snd_pcm_hw_params_set_rate_near(mPcm, hw, &rate, nullptr) < 0) return false;
+        }
+        unsigned bufferUs = kAlsaBufferUs;
+        unsigned periods = kAlsaPeriods;
+        snd_pcm_hw_params_set_buffer_time_near(mPcm, hw, &bufferUs, nullptr);
+        snd_pcm_hw_params_set_periods_near(mPcm, hw, &periods, nullptr);
+        int err = snd_pcm_hw_params(mPcm, hw);
+        if (err < 0) {
+            LOGE("alsa: hw_params %s (%s) failed: %s", mName.c_str(), useMmap ? "mmap" : "rw", snd_strerror(err));
+            return false;
+        }
+        snd_pcm_hw_params_get_channels(hw, &ch);
+        snd_pcm_hw_params_get_rate(hw, &rate, nullptr);
+        snd_pcm_uframes_t bufferFrames = 0;
+        snd_pcm_hw_params_get_buffer_size(hw, &bufferFrames);
+
+        // Os dois começam com o buffer cheio: o writei sozinho pelo limiar,
+        // o mmap pelo snd_pcm_start do write (limiar fora de alcance)
+        snd_pcm_sw_params_t* sw = nullptr;
+        snd_pcm_sw_params_alloca(&sw);
+        snd_pcm_sw_params_current(mPcm, sw);
+        snd_pcm_sw_params_set_start_threshold(mPcm, sw, useMmap ? bufferFrames * 2 : bufferFrames);
+        snd_pcm_sw_params_set_avail_min(mPcm, sw, bufferFrames / kAlsaPeriods);
+        err = snd_pcm_sw_params(mPcm, sw);
+        if (err < 0) {
+            LOGE("alsa: sw_params %s failed: %s", mName.c_str(), snd_strerror(err));
+            return false;
+        }
+        mChannels = (int)ch;
+        mRate = (int)rate;
+        mFormat = format == SND_PCM_FORMAT_FLOAT_LE ? OutputSampleFormat::Float : OutputSampleFormat::Int16;
+        mFrameBytes = mChannels * (mFormat == OutputSampleFormat::Float ? (int)sizeof(float) : (int)sizeof(int16_t));
+        mMmap = useMmap;
+        return snd_pcm_prepare(mPcm) >= 0;
+    }
+
+    // Copia direto na área do driver; intercalado = um bloco contíguo por frame
+    int writeMmap(const uint8_t* src, int frames) {
+        const snd_pcm_channel_area_t* areas = nullptr;
+        snd_pcm_uframes_t offset = 0;
+        snd_pcm_uframes_t n = (snd_pcm_uframes_t)frames;
+        int err = snd_pcm_mmap_begin(mPcm, &areas, &offset, &n);
+        if (err < 0) return err;
+        if ((int)areas[0].step != mFrameBytes * 8 || areas[0].first % 8 != 0) {
+            // Layout que não é intercalado simples: não acontece com MMAP_INTERLEAVED
+            snd_pcm_mmap_commit(mPcm, offset, 0);
+            return -EINVAL;
+        }
+        uint8_t* dst = static_cast<uint8_t*>(areas[0].addr) + areas[0].first / 8 + offset * (size_t)mFrameBytes;
+        std::memcpy(dst, src, (size_t)n * mFrameBytes);
+        const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(mPcm, offset, n);
+        if (committed < 0) return (int)committed;
+        if ((snd_pcm_uframes_t)committed != n) return -EPIPE;
+        return (int)committed;
+    }
+
+    int writeRw(const uint8_t* src, int frames) {
+        return (int)snd_pcm_writei(mPcm, src, (snd_pcm_uframes_t)frames);
+    }
+
+    // Underrun (EPIPE) e suspensão voltam ao PREPARED; dispositivo removido
+    // (ENODEV, interface USB desconectada) marca a queda
+    bool recover(int err) {
+        if (err == -EAGAIN || err == -EINTR) return true;
+        if (err == -EPIPE || err == -ESTRPIPE) {
+            if (snd_pcm_recover(mPcm, err, 1) >= 0) return true;
+        }
+        LOGE("alsa: %s lost: %s", mName.c_str(), snd_strerror(err));
+        mLost = true;
+        return false;
+    }
+
+    snd_pcm_t* mPcm = nullptr;
+    std::string mName;
+    int mChannels = 0;
+    int mRate = 0;
+    int mFrameBytes = 0;
+    OutputSampleFormat mFormat = OutputSampleFormat::Int16;
+    bool mExclusive = false;
+    bool mMmap = false;
+    bool mStarted = false;
+    bool mLost = false;
+    int64_t mFramesWritten = 0;
+};
+
+// Canais máximos do PCM de playback; 0 se não abrir (e nada no cache)
+int probeMaxChannels(const std::string &pcm) {
+    snd_pcm_t* handle = nullptr;
+    int channels = 0;
+    if (snd_pcm_open(&handle, pcm.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK) >= 0) {
+        snd_pcm_hw_params_t* hw = nullptr;
+        snd_pcm_hw_params_alloca(&hw);
+        unsigned maxCh = 0;
+        if (snd_pcm_hw_params_any(handle, hw) >= 0 && snd_pcm_hw_params_get_channels_max(hw, &maxCh) >= 0) {
+            // "null" e plugins sem limite respondem com UINT_MAX
+            channels = (int)std::min(maxCh, 64u);
+        }
+        snd_pcm_close(handle);
+    }
+    std::lock_guard<std::mutex> lock(gChannelsMutex);
+    if (channels > 0) {
+        gKnownChannels[pcm] = channels;
+    } else {
+        auto it = gKnownChannels.find(pcm);
+        if (it != gKnownChannels.end()) channels = it->second;
+    }
+    return channels;
+}
+
+} // namespace
+
+std::unique_ptr<MixerOutput> openMixerOutput(int deviceId, int channels, int sampleRate, bool allowShared) {
+    std::unique_ptr<AlsaOutput> out(new AlsaOutput());
+    bool ok = false;
+    if (deviceId > 0) {
+        ok = out->open(hwName(deviceId, "hw:"), channels, sampleRate, SND_PCM_FORMAT_S16_LE, true);
+        if (!ok && allowShared) {
+            // Mesmo dispositivo, com o plug convertendo formato/taxa/canais
+            out.reset(new AlsaOutput());
+            ok = out->open(hwName(deviceId, "plughw:"), channels, sampleRate, SND_PCM_FORMAT_FLOAT_LE, false);
+        }
+    } else {
+        const std::string name = defaultPcm();
+        ok = out->open(name, channels, sampleRate, SND_PCM_FORMAT_S16_LE, true);
+        if (!ok && allowShared) {
+            out.reset(new AlsaOutput());
+            ok = out->open(name, channels, sampleRate, SND_PCM_FORMAT_FLOAT_LE, false);
+        }
+    }
+    if (!ok) return nullptr;
+    LOGI("mixer stream: %s %s %s %dch %dHz %s (session %dch %dHz)", out->name().c_str(),
+         out->exclusive() ? "exclusive" : "shared", out->mmap() ? "mmap" : "rw", out->channelCount(),
+         out->sampleRate(), out->format() == OutputSampleFormat::Float ? "float" : "i16", channels, sampleRate);
+    return out;
+}
+
+// Placas com PCM de playback (hw:card,dev). MTP_ALSA_DEVICE ("null",
+// "hw:Loopback,0", um plugin do asoundrc) entra primeiro com id -1, e o
+// openMixerOutput da saída padrão abre ele.
+std::vector<OutputDeviceInfo> listOutputDevices() {
+    std::vector<OutputDeviceInfo> devices;
+    const char* env = std::getenv("MTP_ALSA_DEVICE");
+    const std::string custom = env && *env ? env : "";
+    if (!custom.empty()) {
+        OutputDeviceInfo info;
+        info.name = custom;
+        info.pcm = custom;
+        info.maxChannels = probeMaxChannels(custom);
+        devices.push_back(info);
+    }
+    int card = -1;
+    while (snd_card_next(&card) >= 0 && card >= 0) {
+        snd_ctl_t* ctl = nullptr;
+        const std::string ctlName = "hw:" + std::to_string(card);
+        if (snd_ctl_open(&ctl, ctlName.c_str(), 0) < 0) continue;
+        snd_ctl_card_info_t* cardInfo = nullptr;
+        snd_ctl_card_info_alloca(&cardInfo);
+        if (snd_ctl_card_info(ctl, cardInfo) < 0) {
+            snd_ctl_close(ctl);
+            continue;
+        }
+        const std::string cardName = snd_ctl_card_info_get_name(cardInfo);
+        const bool usb = std::strcmp(snd_ctl_card_info_get_driver(cardInfo), "USB-Audio") == 0;
+        int dev = -1;
+        while (snd_ctl_pcm_next_device(ctl, &dev) >= 0 && dev >= 0 && dev < kAlsaDevicesPerCard) {
+            snd_pcm_info_t* pcmInfo = nullptr;
+            snd_pcm_info_alloca(&pcmInfo);
+            snd_pcm_info_set_device(pcmInfo, (unsigned)dev);
+            snd_pcm_info_set_subdevice(pcmInfo, 0);
+            snd_pcm_info_set_stream(pcmInfo, SND_PCM_STREAM_PLAYBACK);
+            if (snd_ctl_pcm_info(ctl, pcmInfo) < 0) continue; // só captura
+            OutputDeviceInfo info;
+            info.id = 1 + card * kAlsaDevicesPerCard + dev;
+            info.name = dev == 0 ? cardName : cardName + " (" + std::to_string(dev) + ")";
+            info.pcm = "hw:" + std::to_string(card) + "," + std::to_string(dev);
+            if (info.pcm == custom) continue; // já é a primeira
+            info.maxChannels = probeMaxChannels(info.pcm);
+            info.usb = usb;
+            devices.push_back(info);
+        }
+        snd_ctl_close(ctl);
+    }
+    return devices;
+}
+
+std::string outputCardsSignature() {
+    std::string signature;
+    int card = -1;
+    while (snd_card_next(&card) >= 0 && card >= 0) {
+        signature += std::to_string(card);
+        snd_ctl_t* ctl = nullptr;
+        const std::string ctlName = "hw:" + std::to_string(card);
+        if (snd_ctl_open(&ctl, ctlName.c_str(), 0) >= 0) {
+            snd_ctl_card_info_t* cardInfo = nullptr;
+            snd_ctl_card_info_alloca(&cardInfo);
+            if (snd_ctl_card_info(ctl, cardInfo) >= 0) {
+                signature += ':';
+                signature += snd_ctl_card_info_get_id(cardInfo);
+                signature += ':';
+                signature += snd_ctl_card_info_get_driver(cardInfo);
+            }
+            snd_ctl_close(ctl);
+        }
+        signature += ';';
+    }
+    return signature;
+}
@@ -1,6 +1,3 @@
-#include <jni.h>
-#include <aaudio/AAudio.h>
-#include <android/log.h>
 #include <thread>
 #include <atomic>
 #include <fstream>
@@ -9,531 +6,1064 @@
 #include <cmath>
 #include <algorithm>
 #include <string>
+#include <chrono>
+#include <memory>
+#include <mutex>
 
+#include "insert_chain.h"
+#include "param_queue.h"
+#include "engine_stats.h"
+#include "render_pool.h"
+#include "mix_graph.h"
+#include "engine_shared.h"
+#include "wav_io.h"
+#include "wav_analysis.h"
+#include "track_source.h"
+#include "preload_cache.h"
+#include "transport.h"
+#include "scrub.h"
+#include "event_timeline.h"
+#include "capture.h"
+#include "file_probe.h"
+#include "silence_map.h"
+#include "song_bundle.h"
+#include "output_adapter.h"
+#include "aux_sends.h"
+#include "spectrum.h"
+#include "stem_prefetch.h"
+#include "mixer_output.h"
+#include "engine_api.h"
+#include "engine_log.h"
 
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, "multichannel_preview", __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "multichannel_preview", __VA_ARGS__)
+// Engine do mixer, sem nada da plataforma: o stream de saída é um
+// MixerOutput (AAudio ou ALSA) e as pontes (JNI, plugin Linux) chamam as
+// funções de engine_api.h.
 
-// WAV information structure and forward declaration for header parser
-struct WavInfo {
-    int sampleRate = 44100;
-    int channels = 2;
-    int bitsPerSample = 16;
-    int audioFormat = 1; // 1=PCM, 3=IEEE float
-    size_t dataOffset = 0;
-    size_t dataSize = 0;
-};
-static bool parseWavHeader(std::ifstream &ifs, WavInfo &info);
-
-static AAudioStream* gStream = nullptr;
+static std::unique_ptr<MixerOutput> gStream;
+// Dispositivo/canais/taxa pedidos ao abrir gStream: o play seguinte
+// reaproveita o stream em vez de fechar e reabrir quando forem os mesmos
+// (o concedido pode ser outro no modo compartilhado)
+static int gStreamDeviceId = -1;
+static int gStreamChannels = 0;
+static int gStreamRate = 0;
+// gStream aberto; lido pelo prepare, que roda fora do thread da UI
+static std::atomic<bool> gStreamHeld{false};
 static std::thread gThread;
 static std::atomic<bool> gStop{false};
 static std::atomic<bool> gDoSeek{false};
 static std::atomic<double> gSeekSec{0.0};
 static std::atomic<float> gVolume{1.0f};
+// Trim de loudness da música (linear), junto com o volume geral na saída
+static std::atomic<float> gSongTrim{1.0f};
 static std::atomic<float> gPan{0.0f};
 static int gDeviceChannels = 2;
+// Parâmetros discretos (inserts) enviados ao mixer em execução; volume, pan e
+// mute vão pelo bloco compartilhado (engine_shared.h)
+static ParamQueue gParamQueue;
+// A ponte da plataforma (thread do MethodChannel) e o Dart (thread de UI, via
+// FFI) produzem na mesma fila; o spinlock serializa só os produtores, o render
+// continua sem lock.
+static std::atomic_flag gParamPushLock = ATOMIC_FLAG_INIT;
+// Buses configurados por engineSetMixGraph para o próximo enginePlayAll
+static std::vector<MixBusConfig> gPendingBuses;
+static std::vector<int> gPendingTrackBus;
+// Mixes auxiliares (engineSetAuxSends) para o próximo enginePlayAll:
+// primeiro canal do par de cada aux e níveis track x aux
+static std::vector<int> gPendingAuxOutputs;
+static std::vector<float> gPendingAuxSends;
+// Gravação da interface USB: o stream de entrada da plataforma alimenta o
+// ring do writer; o render do mixer alinha o primeiro frame com a música
+CaptureWriter gCapture;
+// Tap de saída: o render copia o bloco final (o que vai para a interface)
+// para o ring; atravessa as trocas de música enquanto o formato não mudar
+static CaptureWriter gOutputTap;
+// Serializa start/stop do tap com a troca de formato no início da sessão
+static std::mutex gOutputTapLock;
 
-// --- BPM detection utilities (simple envelope + autocorrelation) ---
-static bool buildEnvelopeDownsampled(std::ifstream &ifs, const WavInfo &info, std::vector<float> &env, float &envFs) {
-    // Target envelope sampling rate ~200 Hz
-    const float targetFs = 200.0f;
-    const int bytesPerSample = info.bitsPerSample / 8; // 2 for 16-bit, 3 for 24-bit, 4 for float32
-    const int frameBytes = bytesPerSample * info.channels;
-    if (frameBytes <= 0 || info.sampleRate <= 0 || info.dataSize == 0) return false;
+bool engineDetectBpm(const std::string &path, double &outBpm, double &outConf) {
+    outBpm = 120.0;
+    outConf = 0.2;
+    ScopedThreadClass background(ThreadClass::Analysis);
 
-    int decim = std::max(1, (int)std::floor((float)info.sampleRate / targetFs));
-    envFs = (float)info.sampleRate / (float)decim;
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        LOGE("engineDetectBpm: cannot open file");
+        return false;
+    }
+    WavInfo info;
+    if (!parseWavHeader(ifs, info)) {
+        LOGE("engineDetectBpm: unsupported or invalid wav header\n");
+        return false;
+    }
+    // Support PCM16/PCM24/Float32
+    if (!isAnalyzableWav(info)) {
+        LOGE("engineDetectBpm: unsupported wav for BPM (need PCM16/24 or float32)\n");
+        return false;
+    }
 
-    const size_t totalFrames = info.dataSize / frameBytes;
-    if (totalFrames < (size_t)info.sampleRate) {
-        // menos de 1s de áudio
+    std::vector<float> envBuf;
+    float envFs = 200.0f;
+    if (!buildEnvelopeDownsampled(ifs, info, envBuf, envFs)) {
+        LOGE("engineDetectBpm: failed to build envelope");
         return false;
     }
 
-    const size_t chunkFrames = 4096; // frames por chunk
-    std::vector<unsigned char> buffer(chunkFrames * frameBytes);
-    ifs.seekg((std::streamoff)info.dataOffset, std::ios::beg);
-
-    int decimCount = 0;
-    double acc = 0.0;
-    size_t framesProcessed = 0;
-    while (framesProcessed < totalFrames) {
-        const size_t framesToRead = std::min(chunkFrames, totalFrames - framesProcessed);
-        const size_t bytesToRead = framesToRead * frameBytes;
-        ifs.read(reinterpret_cast<char*>(buffer.data()), (std::streamsize)bytesToRead);
-        if (!ifs) break;
-        // process frames
-        const unsigned char* p = buffer.data();
-        for (size_t f = 0; f < framesToRead; ++f) {
-            float mono = 0.0f;
-            if (info.audioFormat == 1 && info.bitsPerSample == 16) {
-                // PCM16
-                const int16_t* s = reinterpret_cast<const int16_t*>(p);
-                int sum = 0;
-                for (int ch = 0; ch < info.channels; ++ch) {
-                    sum += (int)s[ch];
-                }
-                mono = (float)sum / (float)(info.channels * 32768.0f);
-            } else if (info.audioFormat == 1 && info.bitsPerSample == 24) {
-                // PCM24 little-endian
-                const unsigned char* q = p;
-                double sum = 0.0;
-                for (int ch = 0; ch < info.channels; ++ch) {
-                    int b0 = q[0];
-                    int b1 = q[1];
-                    int b2 = q[2];
-                    int v = (b2 << 16) | (b1 << 8) | b0;
-                    if (v & 0x800000) v |= ~0xFFFFFF; // sign extend
-                    sum += (double)v / 8388608.0; // 2^23
-                    q += 3;
-                }
-                mono = (float)(sum / (double)info.channels);
-            } else if (info.audioFormat == 3 && info.bitsPerSample == 32) {
-                // IEEE float32 little-endian
-                const unsigned char* q = p;
-                double sum = 0.0;
-                for (int ch = 0; ch < info.channels; ++ch) {
-                    float fv;
-                    std::memcpy(&fv, q, sizeof(float));
-                    // clamp just in case
-                    if (fv > 1.5f) fv = 1.5f;
-                    if (fv < -1.5f) fv = -1.5f;
-                    sum += (double)fv;
-                    q += 4;
-                }
-                mono = (float)(sum / (double)info.channels);
-            } else {
-                // Unsupported
-                return false;
-            }
-            const float v = std::fabs(mono);
-            acc += v;
-            decimCount++;
-            if (decimCount >= decim) {
-                env.push_back((float)(acc / (double)decim));
-                acc = 0.0;
-                decimCount = 0;
+    const BpmEstimate est = estimateBpmFromEnvelope(envBuf, envFs);
+    outBpm = est.bpm;
+    outConf = est.confidence;
+    return true;
+}
+
+// Taxa do WAV pelo probe compartilhado (cache por caminho/tamanho/mtime); 0 se inválido
+int engineProbeSampleRate(const std::string &path) {
+    MtpFileProbe probe;
+    return probeFile(path, probe) ? probe.sampleRate : 0;
+}
+
+static void closeStream() {
+    gStream.reset();
+    gStreamDeviceId = -1;
+    gStreamChannels = 0;
+    gStreamRate = 0;
+    gStreamHeld.store(false);
+}
+
+// Para o thread de render/preview; o stream continua aberto
+static void stopRenderThread() {
+    gStop.store(true);
+    if (gThread.joinable()) {
+        try { gThread.join(); } catch (...) {}
+    }
+}
+
+// Queda do stream do mixer (interface USB desconectada): o render para de
+// escrever e um thread auxiliar reabre o stream
+static std::atomic<MixerOutput*> gRecoveredStream{nullptr};
+// Interface USB atual, informada pela plataforma (deviceCallback do Kotlin,
+// plugin Linux); -1 = nenhuma. Reconectada, a mesma interface volta com outro id.
+static std::atomic<int> gTargetDeviceId{-1};
+
+// Thread auxiliar da recuperação: espera a interface voltar (sessão em USB)
+// e reabre; o render adota o stream pronto e refaz a conversão de saída se o
+// formato concedido mudou.
+static void recoverMixerStream(bool usb, int deviceChannels, int sessionRate) {
+    while (!gStop.load()) {
+        const int deviceId = usb ? gTargetDeviceId.load() : -1;
+        if (!usb || deviceId > 0) {
+            std::unique_ptr<MixerOutput> stream = openMixerOutput(deviceId, deviceChannels, sessionRate);
+            if (stream && stream->start()) {
+                LOGI("mixer stream reopened on device %d", deviceId);
+                gRecoveredStream.store(stream.release());
+                return;
             }
-            p += frameBytes;
         }
-        framesProcessed += framesToRead;
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
     }
+}
 
-    if (env.size() < (size_t)(envFs * 3)) {
-        // menos de 3s de envelope
-        return false;
+struct MixTrack {
+    std::string path;
+    int outputChannel = 0; // 0=L,1=R,>=2 pair LR
+    float volume = 1.0f;
+    float pan = 0.0f; // used when pair
+    WavInfo info;
+    std::unique_ptr<TrackSource> source; // arquivo ou imagem do cache de preload
+    bool ended = false;
+    bool muted = false;
+    // Blocos seguidos em silêncio (mapa de silêncio ou fim do arquivo)
+    int silentBlocks = 0;
+    // Ganhos aplicados no bloco anterior; o próximo bloco faz rampa a partir deles
+    float lastGainL = -1.0f;
+    float lastGainR = -1.0f;
+};
+
+// Render (dono de gStream): converte o instante do primeiro frame gravado no
+// frame da música que estava soando nele. Os frames escritos e ainda não
+// apresentados pela saída ficam atrás de `position`. Gravação que começou
+// antes do play dá frame negativo: a relação tempo -> frame da sessão é
+// estendida para trás, e o take continua alinhado a partir do play.
+static void alignCaptureToPlayback(int64_t captureNs, int64_t position, const OutputAdapter& output) {
+    int64_t outFrame = 0;
+    int64_t outNs = 0;
+    // Sem timestamp ainda (stream recém-aberto): tenta no próximo bloco
+    if (!gStream->timestamp(outFrame, outNs)) return;
+    // Frames do stream (taxa concedida) convertidos para frames da sessão
+    const int64_t presented = outFrame + (captureNs - outNs) * output.streamRate() / 1000000000LL;
+    const int64_t queued = output.toMixFrames(gStream->framesWritten() - presented);
+    gCapture.setStartSongFrame(position - queued);
+}
+
+// Próximo play preparado por enginePrepareAll: fontes abertas,
+// validadas e com o início já lido na posição de partida; com o mixer
+// ocioso, também o stream de saída aberto (o dispositivo é exclusivo, então
+// com uma sessão tocando o play seguinte reaproveita o stream dela).
+struct PreparedSession {
+    std::vector<std::string> paths;
+    std::vector<int> outputChannels;
+    std::vector<std::unique_ptr<TrackSource>> sources;
+    std::unique_ptr<MixerOutput> stream;
+    int deviceId = -1;
+    int deviceChannels = 0;
+    int sampleRate = 0;
+};
+
+// Prepare roda fora do thread da UI. O play segura o mutex da escolha da
+// sessão até o stream estar definido, então o prepare nunca abre um segundo
+// stream no dispositivo enquanto um play começa.
+static std::mutex gPreparedMutex;
+static std::unique_ptr<PreparedSession> gPrepared;
+
+// Entrega a sessão preparada se ela for exatamente o que o play pediu. Se não
+// for, as fontes continuam guardadas, mas o stream preparado é fechado (o
+// play vai abrir o dele no mesmo dispositivo). Chamar com gPreparedMutex.
+static std::unique_ptr<PreparedSession> takePreparedSession(const std::vector<std::string> &paths,
+                                                            const std::vector<int> &outputChannels) {
+    if (!gPrepared) return nullptr;
+    if (gPrepared->paths == paths && gPrepared->outputChannels == outputChannels) return std::move(gPrepared);
+    gPrepared->stream.reset();
+    return nullptr;
+}
+
+// Outro uso do dispositivo (preview de arquivo único): solta o stream
+// preparado e já marca gStreamHeld na mesma seção, antes de quem chama abrir
+// o dele; um prepare em background não abre um segundo stream no meio
+static void releasePreparedStream() {
+    std::lock_guard<std::mutex> lock(gPreparedMutex);
+    if (gPrepared) gPrepared->stream.reset();
+    gStreamHeld.store(true);
+}
+
+// Frames por bloco de render do mixer multifaixa
+static const int kMixBlockFrames = 512;
+// Limite de mensagens de parâmetro aplicadas por bloco (o resto fica para o próximo)
+static const int kMaxParamsPerBlock = 256;
+
+static void applyParam(std::vector<MixTrack>& tracks, InsertChain& inserts, MixGraph& graph,
+                       AuxSendMatrix& sends, int32_t target, int32_t index, int32_t param, float value) {
+    if (target == PARAM_TARGET_BUS) {
+        graph.setParam(index, param, value);
+        return;
     }
+    if (target == PARAM_TARGET_AUX_SEND) {
+        sends.setSend(index, param, value);
+        return;
+    }
+    if (index < 0 || index >= (int)tracks.size()) return;
+    if (param == PARAM_TRACK_VOLUME) {
+        tracks[index].volume = std::max(0.0f, std::min(1.0f, value));
+    } else if (param == PARAM_TRACK_PAN) {
+        tracks[index].pan = std::max(-1.0f, std::min(1.0f, value));
+    } else if (param == PARAM_MUTE) {
+        tracks[index].muted = value >= 0.5f;
+    } else {
+        inserts.setParam(index, param, value);
+    }
+}
 
-    // Smooth envelope with small moving average (~50 ms)
-    const int w = std::max(1, (int)std::round(envFs * 0.05f));
-    if (w > 1) {
-        std::vector<float> sm(env.size(), 0.0f);
-        double sum = 0.0;
-        for (size_t i = 0; i < env.size(); ++i) {
-            sum += env[i];
-            if (i >= (size_t)w) sum -= env[i - w];
-            sm[i] = (float)(sum / (double)std::min((size_t)w, i + 1));
+static void applyParamChanges(std::vector<MixTrack>& tracks, InsertChain& inserts, MixGraph& graph,
+                              AuxSendMatrix& sends) {
+    ParamChange pc;
+    int applied = 0;
+    while (applied < kMaxParamsPerBlock && gParamQueue.pop(pc)) {
+        ++applied;
+        applyParam(tracks, inserts, graph, sends, pc.target, pc.track, pc.param, pc.value);
+    }
+    if (applied > 0) gEngineStats.paramsApplied.fetch_add((uint64_t)applied, std::memory_order_relaxed);
+}
+
+// Valor vindo da timeline: vale já neste bloco e também vai para o bloco
+// compartilhado, senão o sync do bloco seguinte desfaria a automação (e as
+// views do Dart mostram o fader se mexendo).
+static void applyTimelineParam(std::vector<MixTrack>& tracks, InsertChain& inserts, MixGraph& graph,
+                               AuxSendMatrix& sends, int32_t target, int32_t index, int32_t param, float value) {
+    const bool bus = target == PARAM_TARGET_BUS;
+    // Envios de aux não têm espelho no bloco compartilhado
+    if (target != PARAM_TARGET_AUX_SEND && index >= 0 && index < (bus ? MTP_MAX_BUSES : MTP_MAX_TRACKS)) {
+        if (param == PARAM_TRACK_VOLUME) {
+            sharedStore(bus ? gShared.busVolumes[index] : gShared.trackVolumes[index], value);
+        } else if (param == PARAM_TRACK_PAN) {
+            sharedStore(bus ? gShared.busPans[index] : gShared.trackPans[index], value);
+        } else if (param == PARAM_MUTE) {
+            sharedStore(bus ? gShared.busMutes[index] : gShared.trackMutes[index], value >= 0.5f ? 1.0f : 0.0f);
         }
-        env.swap(sm);
     }
-    return true;
+    applyParam(tracks, inserts, graph, sends, target, index, param, value);
+}
+
+// Lê volume/pan/mute do bloco compartilhado; roda a cada bloco, então o último
+// valor escrito pelo controle vale no próximo bloco sem passar pela fila.
+static void syncSharedParams(std::vector<MixTrack>& tracks, MixGraph& graph) {
+    const int n = std::min((int)tracks.size(), MTP_MAX_TRACKS);
+    for (int i = 0; i < n; ++i) {
+        const float v = sharedLoad(gShared.trackVolumes[i]);
+        const float p = sharedLoad(gShared.trackPans[i]);
+        if (std::isfinite(v)) tracks[i].volume = std::max(0.0f, std::min(1.0f, v));
+        if (std::isfinite(p)) tracks[i].pan = std::max(-1.0f, std::min(1.0f, p));
+        tracks[i].muted = sharedLoad(gShared.trackMutes[i]) >= 0.5f;
+    }
+    const int buses = std::min(graph.busCount(), MTP_MAX_BUSES);
+    for (int b = 0; b < buses; ++b) {
+        graph.setParam(b, PARAM_TRACK_VOLUME, sharedLoad(gShared.busVolumes[b]));
+        graph.setParam(b, PARAM_TRACK_PAN, sharedLoad(gShared.busPans[b]));
+        graph.setParam(b, PARAM_MUTE, sharedLoad(gShared.busMutes[b]));
+    }
+}
+
+// Medidores de pico com queda de ~300 ms, publicados no bloco compartilhado
+static const double kMeterFallSec = 0.3;
+
+static void publishPeak(float& slot, float blockPeak, float decay) {
+    sharedStore(slot, std::max(blockPeak, sharedLoad(slot) * decay));
+}
+
+// Fatia do período do bloco que o fork/join pode usar antes de contar como atraso
+static const double kRenderSliceFraction = 0.5;
+// Máximo de workers de render além do próprio thread de escrita
+static const int kMaxRenderWorkers = 3;
+// Silêncio antes de um grupo com inserts deixar de ser processado: as caudas
+// dos filtros e o release do compressor já terminaram (settleGroup)
+static const double kSilenceSettleSec = 0.5;
+
+// Estado compartilhado entre o thread de escrita e os workers durante um bloco.
+// Cada job é um grupo de lanes: lê as tracks do grupo e roda os inserts dele,
+// então jobs diferentes nunca tocam a mesma track nem as mesmas lanes.
+struct MixRenderCtx {
+    std::vector<MixTrack>* tracks = nullptr;
+    InsertChain* inserts = nullptr;
+    Lane8* lanes = nullptr;
+    int block = 0;
+    int frames = 0; // a ler neste bloco; menor que `block` quando corta numa fronteira de loop/salto
+    // Primeiro bloco depois de um salto: lanes = destino * xfadeIn + fim do trecho antigo * xfadeOut
+    int xfadeFrames = 0;
+    const Lane8* xfadeTail = nullptr; // kTransportXfadeFrames frames por grupo
+    const float* xfadeIn = nullptr;
+    const float* xfadeOut = nullptr;
+    std::vector<int> groupFrames;
+    std::vector<double> groupInsertUs;
+    std::vector<float> trackPeak; // pico pós-fader do bloco atual
+    // Tracks em silêncio neste bloco: não são somadas na saída
+    std::vector<uint8_t> trackQuiet;
+    // Grupos parados por silêncio (estado já em settleGroup)
+    std::vector<uint8_t> groupSettled;
+    int settleBlocks = 0;
+    // Scrub: posição de leitura fracionária e ganho de cada frame do bloco
+    // (scrubPos == nullptr = leitura normal)
+    const double* scrubPos = nullptr;
+    const float* scrubGain = nullptr;
+    Lane8* scrubScratch = nullptr; // scrubSpan frames por grupo
+    int scrubSpan = 0;
+    int64_t scrubCue = -1; // alvo novo do gesto neste bloco (-1 = o mesmo)
+};
+
+// Track com lanes em zero que não precisa ir para a mixagem; com inserts no
+// grupo, só depois das caudas terminarem
+static bool trackQuiet(const MixTrack& t, bool insertsActive, int settleBlocks) {
+    return t.silentBlocks > (insertsActive ? settleBlocks : 0);
 }
 
-static void autocorrelationRange(const std::vector<float> &env, float envFs, int lagMin, int lagMax, double &bestCorr, int &bestLag, double &avgCorr) {
-    // Zero-mean
-    double mean = 0.0;
-    for (float v : env) mean += v;
-    mean /= (double)env.size();
-
-    double var = 0.0;
-    std::vector<float> z(env.size());
-    for (size_t i = 0; i < env.size(); ++i) {
-        float d = env[i] - (float)mean;
-        z[i] = d;
-        var += (double)d * (double)d;
-    }
-    if (var <= 1e-12) { bestCorr = 0.0; bestLag = lagMin; avgCorr = 0.0; return; }
-
-    bestCorr = -1.0; bestLag = lagMin; avgCorr = 0.0;
-    int count = 0;
-    for (int L = lagMin; L <= lagMax; ++L) {
-        const size_t N = z.size() - (size_t)L;
-        if (N <= 10) continue;
-        double num = 0.0;
-        for (size_t i = 0; i < N; ++i) {
-            num += (double)z[i] * (double)z[i + L];
+// Lê o mesmo número de frames de cada track (mono e estéreo avançam juntos)
+static int readGroupTracks(MixRenderCtx& ctx, int g, Lane8* grp) {
+    const int BLOCK = ctx.block;
+    InsertChain& inserts = *ctx.inserts;
+    int frames = 0;
+    for (int i : inserts.groupTracks(g)) {
+        auto &t = (*ctx.tracks)[i];
+        const int inCh = t.info.channels;
+        const int li = inserts.trackFirstLane(i) % kLaneWidth;
+        int got = 0;
+        if (!t.ended) {
+            got = t.source->readLanes(grp, li, ctx.frames);
+            if (got <= 0) { t.ended = true; got = 0; }
+        }
+        // Fim do arquivo ou trecho servido pelo mapa de silêncio (lanes em zero)
+        const bool silent = got == 0 || t.source->lastReadSilent();
+        t.silentBlocks = silent ? t.silentBlocks + 1 : 0;
+        for (int f = got; f < BLOCK; ++f) {
+            for (int c = 0; c < inCh; ++c) grp[f].v[li + c] = 0.0f;
         }
-        // Normalize by variance part (approx): var is sum(z^2)
-        double corr = num / var;
-        if (corr > bestCorr) { bestCorr = corr; bestLag = L; }
-        avgCorr += corr;
-        count++;
+        frames = std::max(frames, got);
     }
-    if (count > 0) avgCorr /= (double)count; else avgCorr = 0.0;
+    return frames;
 }
 
-extern "C" JNIEXPORT jdoubleArray JNICALL
-Java_com_example_multitrack_1app_MainActivity_nativeDetectBpmFromWav(JNIEnv* env, jobject /*thiz*/, jstring jpath) {
-    const char* cpath = env->GetStringUTFChars(jpath, nullptr);
-    std::string path(cpath ? cpath : "");
-    if (cpath) env->ReleaseStringUTFChars(jpath, cpath);
+// Scrub: cada track lê o trecho que o bloco percorre (em qualquer sentido) e
+// as lanes recebem a interpolação linear nas posições fracionárias, já com o
+// ganho do movimento. Fora do arquivo, zeros; o bloco sai sempre inteiro.
+// Só lê o que já está na memória (readResident): trecho que o Io ainda não
+// trouxe sai em silêncio e conta um miss, sem disco no render.
+static int readScrubGroup(MixRenderCtx& ctx, int g, Lane8* grp) {
+    const int BLOCK = ctx.block;
+    const int frames = ctx.frames;
+    InsertChain& inserts = *ctx.inserts;
+    const double* pos = ctx.scrubPos;
+    double lo = pos[0], hi = pos[0];
+    for (int f = 1; f < frames; ++f) {
+        lo = std::min(lo, pos[f]);
+        hi = std::max(hi, pos[f]);
+    }
+    const int64_t first = (int64_t)std::floor(lo);
+    const int span = (int)std::min<int64_t>(ctx.scrubSpan, (int64_t)std::floor(hi) - first + 2);
+    Lane8* src = ctx.scrubScratch + (size_t)g * ctx.scrubSpan;
+    for (int i : inserts.groupTracks(g)) {
+        auto &t = (*ctx.tracks)[i];
+        const int inCh = t.info.channels;
+        const int li = inserts.trackFirstLane(i) % kLaneWidth;
+        int got = 0;
+        const int64_t total = t.source->totalFrames();
+        if (ctx.scrubCue >= 0) t.source->scrubCue(ctx.scrubCue);
+        if (first < total) {
+            got = std::max(0, t.source->readResident(src, li, first, span));
+            if (got < std::min<int64_t>(span, total - first)) {
+                gEngineStats.streamIoMisses.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        for (int f = got; f < span; ++f) {
+            for (int c = 0; c < inCh; ++c) src[f].v[li + c] = 0.0f;
+        }
+        for (int f = 0; f < frames; ++f) {
+            const double x = pos[f] - (double)first;
+            const int k = std::min((int)x, span - 2);
+            const float a = std::min(1.0f, (float)(x - k));
+            const float g1 = ctx.scrubGain[f] * a, g0 = ctx.scrubGain[f] - g1;
+            for (int c = 0; c < inCh; ++c) grp[f].v[li + c] = src[k].v[li + c] * g0 + src[k + 1].v[li + c] * g1;
+        }
+        for (int f = frames; f < BLOCK; ++f) {
+            for (int c = 0; c < inCh; ++c) grp[f].v[li + c] = 0.0f;
+        }
+        t.silentBlocks = 0;
+    }
+    return frames;
+}
 
-    double outBpm = 120.0;
-    double outConf = 0.2;
+static void renderGroupJob(void* p, int g) {
+    MixRenderCtx& ctx = *static_cast<MixRenderCtx*>(p);
+    InsertChain& inserts = *ctx.inserts;
+    Lane8* grp = ctx.lanes + (size_t)g * ctx.block;
 
-    std::ifstream ifs(path, std::ios::binary);
-    if (!ifs) {
-        LOGE("nativeDetectBpm: cannot open file");
-        jdoubleArray arr = env->NewDoubleArray(2);
-        jdouble vals[2] = { outBpm, outConf };
-        env->SetDoubleArrayRegion(arr, 0, 2, vals);
-        return arr;
+    int frames = ctx.scrubPos ? readScrubGroup(ctx, g, grp) : readGroupTracks(ctx, g, grp);
+    if (ctx.xfadeFrames > 0) {
+        const Lane8* tail = ctx.xfadeTail + (size_t)g * kTransportXfadeFrames;
+        const int n = std::min(ctx.xfadeFrames, ctx.frames);
+        for (int f = 0; f < n; ++f) {
+            const float gi = ctx.xfadeIn[f], go = ctx.xfadeOut[f];
+            for (int l = 0; l < kLaneWidth; ++l) grp[f].v[l] = grp[f].v[l] * gi + tail[f].v[l] * go;
+        }
+        frames = std::max(frames, n);
+        // A cauda do trecho antigo entra em todas as lanes
+        for (int i : inserts.groupTracks(g)) (*ctx.tracks)[i].silentBlocks = 0;
     }
-    WavInfo info;
-    if (!parseWavHeader(ifs, info)) {
-        LOGE("nativeDetectBpm: unsupported or invalid wav header\n");
-        jdoubleArray arr = env->NewDoubleArray(2);
-        jdouble vals[2] = { outBpm, outConf };
-        env->SetDoubleArrayRegion(arr, 0, 2, vals);
-        return arr;
+    ctx.groupFrames[g] = frames;
+
+    const bool active = inserts.groupActive(g);
+    bool groupQuiet = true;
+    int quietTracks = 0;
+    for (int i : inserts.groupTracks(g)) {
+        const bool quiet = trackQuiet((*ctx.tracks)[i], active, ctx.settleBlocks);
+        ctx.trackQuiet[i] = quiet ? 1 : 0;
+        quietTracks += quiet ? 1 : 0;
+        groupQuiet = groupQuiet && quiet;
     }
-    // Support PCM16/PCM24/Float32
-    bool supported = (info.audioFormat == 1 && (info.bitsPerSample == 16 || info.bitsPerSample == 24))
-                     || (info.audioFormat == 3 && info.bitsPerSample == 32);
-    if (!supported) {
-        LOGE("nativeDetectBpm: unsupported wav for BPM (need PCM16/24 or float32)\n");
-        jdoubleArray arr = env->NewDoubleArray(2);
-        jdouble vals[2] = { outBpm, outConf };
-        env->SetDoubleArrayRegion(arr, 0, 2, vals);
-        return arr;
+    if (quietTracks > 0) gEngineStats.silentTrackBlocks.fetch_add((uint64_t)quietTracks, std::memory_order_relaxed);
+
+    // Inserts do grupo; o custo medido é rateado pelas lanes de cada track
+    ctx.groupInsertUs[g] = 0.0;
+    if (frames <= 0 || !active) return;
+    if (groupQuiet) {
+        if (!ctx.groupSettled[g]) inserts.settleGroup(g);
+        ctx.groupSettled[g] = 1;
+        return;
+    }
+    ctx.groupSettled[g] = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    inserts.processGroup(g, grp, frames);
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    ctx.groupInsertUs[g] = us;
+    int groupLanes = 0;
+    for (int ti : inserts.groupTracks(g)) groupLanes += inserts.trackLaneCount(ti);
+    for (int ti : inserts.groupTracks(g)) {
+        engineStatsRecordTrackInsert(ti, us * inserts.trackLaneCount(ti) / std::max(1, groupLanes));
     }
+}
 
-    std::vector<float> envBuf;
-    float envFs = 200.0f;
-    if (!buildEnvelopeDownsampled(ifs, info, envBuf, envFs)) {
-        LOGE("nativeDetectBpm: failed to build envelope");
-        jdoubleArray arr = env->NewDoubleArray(2);
-        jdouble vals[2] = { outBpm, outConf };
-        env->SetDoubleArrayRegion(arr, 0, 2, vals);
-        return arr;
-    }
-
-    // BPM range: 60..200
-    int lagMax = std::max(1, (int)std::round(envFs * 60.0f / 60.0f));
-    int lagMin = std::max(1, (int)std::round(envFs * 60.0f / 200.0f));
-    if (lagMax <= lagMin + 2) lagMax = lagMin + 3;
-
-    double bestCorr = 0.0, avgCorr = 0.0; int bestLag = lagMin;
-    autocorrelationRange(envBuf, envFs, lagMin, lagMax, bestCorr, bestLag, avgCorr);
-    if (bestLag < 1) bestLag = std::max(1, lagMin);
-    outBpm = 60.0 * (double)envFs / (double)bestLag;
-
-    // Confidence heuristic: ratio of bestCorr to avgCorr
-    if (bestCorr <= 1e-9) outConf = 0.2;
-    else if (avgCorr <= 1e-9) outConf = std::min(1.0, std::max(0.3, bestCorr));
-    else outConf = std::min(1.0, std::max(0.3, bestCorr / std::max(1e-6, avgCorr)));
-
-    jdoubleArray arr = env->NewDoubleArray(2);
-    jdouble vals[2] = { outBpm, outConf };
-    env->SetDoubleArrayRegion(arr, 0, 2, vals);
-    return arr;
-}
-
-static bool parseWavHeader(std::ifstream &ifs, WavInfo &info) {
-    // Read RIFF header
-    char riff[12];
-    ifs.seekg(0, std::ios::beg);
-    ifs.read(riff, 12);
-    if (ifs.gcount() < 12) return false;
-    if (std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) return false;
-
-    bool haveFmt = false;
-    bool haveData = false;
-    while (ifs) {
-        char hdr[8];
-        ifs.read(hdr, 8);
-        if (!ifs || ifs.gcount() < 8) break;
-        int size = *(int32_t*)(hdr + 4);
-        // Ensure little-endian on Android; assuming LE
-        if (std::memcmp(hdr, "fmt ", 4) == 0) {
-            std::vector<char> buf(size);
-            ifs.read(buf.data(), size);
-            if ((int)ifs.gcount() < size) return false;
-            // Parse fmt
-            auto rd16 = [&](int off) { return *(int16_t*)(buf.data() + off); };
-            auto rd32 = [&](int off) { return *(int32_t*)(buf.data() + off); };
-            info.audioFormat = rd16(0);
-            info.channels = rd16(2);
-            info.sampleRate = rd32(4);
-            // byteRate = rd32(8);
-            // blockAlign = rd16(12);
-            if (size >= 16) info.bitsPerSample = rd16(14); else info.bitsPerSample = 0;
-            haveFmt = true;
-        } else if (std::memcmp(hdr, "data", 4) == 0) {
-            std::streampos pos = ifs.tellg();
-            info.dataOffset = (size_t)pos;
-            info.dataSize = (size_t)size;
-            // skip payload to continue scanning if needed
-            ifs.seekg(size, std::ios::cur);
-            haveData = true;
-        } else {
-            // skip unknown chunk
-            ifs.seekg(size, std::ios::cur);
+// Frame da sessão (taxa de saída) -> frame do arquivo da track
+static int64_t trackFrameAt(const MixTrack& t, int64_t frame, int outRate) {
+    if (t.info.sampleRate == outRate || outRate <= 0) return frame;
+    return (int64_t)((double)frame * t.info.sampleRate / outRate);
+}
+
+// Guarda o que cada track tocaria a seguir (kTransportXfadeFrames por grupo)
+// para o crossfade de uma transição
+static void readTransitionTail(std::vector<MixTrack>& tracks, const InsertChain& inserts,
+                               std::vector<Lane8>& tail) {
+    const int X = kTransportXfadeFrames;
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        auto &t = tracks[i];
+        const int first = inserts.trackFirstLane((int)i);
+        Lane8* grp = tail.data() + (size_t)(first / kLaneWidth) * X;
+        const int li = first % kLaneWidth;
+        const int got = t.ended ? 0 : std::max(0, t.source->readLanes(grp, li, X));
+        for (int f = got; f < X; ++f) {
+            for (int c = 0; c < t.info.channels; ++c) grp[f].v[li + c] = 0.0f;
         }
-        if (haveFmt && haveData) break;
     }
-    return haveFmt && haveData && info.sampleRate > 0 && info.channels > 0 && info.bitsPerSample > 0 && info.dataSize > 0;
 }
 
-static void closeStream() {
-    if (gStream) {
-        AAudioStream_requestStop(gStream);
-        AAudioStream_close(gStream);
-        gStream = nullptr;
+// Salto do loop/transporte: guarda a cauda (crossfade) e continua todas as
+// tracks no destino já preparado por cueFrame.
+static void jumpTracksToCue(std::vector<MixTrack>& tracks, const InsertChain& inserts,
+                            std::vector<Lane8>& tail, int64_t target, int outRate) {
+    readTransitionTail(tracks, inserts, tail);
+    for (auto &t : tracks) {
+        t.source->jumpToCue();
+        t.ended = trackFrameAt(t, target, outRate) >= t.source->totalFrames();
     }
 }
 
-struct MixTrack {
-    std::string path;
-    int outputChannel = 0; // 0=L,1=R,>=2 pair LR
-    float volume = 1.0f;
-    float pan = 0.0f; // used when pair
-    WavInfo info;
-    std::ifstream ifs;
-    bool ended = false;
-};
+// Soma a track (já com inserts) em dst[f*stride + 0/1], com rampa de ganho por bloco.
+// Usado tanto para a saída principal quanto para os buffers de bus (MixGraph).
+static void mixTrackInto(void* p, int i, float* dst, int stride, int frames) {
+    MixRenderCtx& ctx = *static_cast<MixRenderCtx*>(p);
+    auto &t = (*ctx.tracks)[i];
+    float vol = t.muted ? 0.0f : std::max(0.0f, std::min(1.0f, t.volume));
+    float pan = std::max(-1.0f, std::min(1.0f, t.pan));
+    double tt = (double(pan) + 1.0) / 2.0;
+    double angle = (M_PI / 2.0) * tt;
+    const bool pair = t.outputChannel >= 2;
+    const float gL = t.outputChannel == 1 ? 0.0f : vol * (pair ? (float)std::cos(angle) : 1.0f);
+    const float gR = t.outputChannel == 0 ? 0.0f : vol * (pair ? (float)std::sin(angle) : 1.0f);
+    if (t.lastGainL < 0.0f || ctx.trackQuiet[i]) {
+        t.lastGainL = gL;
+        t.lastGainR = gR;
+    }
+    // Só zeros nas lanes: nada a somar
+    if (ctx.trackQuiet[i]) {
+        ctx.trackPeak[i] = 0.0f;
+        return;
+    }
+    const float stepL = (gL - t.lastGainL) / (float)frames;
+    const float stepR = (gR - t.lastGainR) / (float)frames;
+    const int first = ctx.inserts->trackFirstLane(i);
+    const Lane8* grp = ctx.lanes + (size_t)(first / kLaneWidth) * ctx.block;
+    const int liL = first % kLaneWidth;
+    const int liR = t.info.channels == 2 ? liL + 1 : liL;
+    float curL = t.lastGainL, curR = t.lastGainR;
+    float peak = 0.0f;
+    for (int f = 0; f < frames; ++f) {
+        curL += stepL;
+        curR += stepR;
+        const float l = grp[f].v[liL] * curL;
+        const float r = grp[f].v[liR] * curR;
+        dst[(size_t)f * stride + 0] += l;
+        dst[(size_t)f * stride + 1] += r;
+        peak = std::max(peak, std::max(std::fabs(l), std::fabs(r)));
+    }
+    ctx.trackPeak[i] = peak;
+    t.lastGainL = gL;
+    t.lastGainR = gR;
+}
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_example_multitrack_1app_MainActivity_nativePlayAllPreview(
-        JNIEnv* env,
-        jobject /*thiz*/,
-        jobjectArray jFilePaths,
-        jintArray jOutputChannels,
-        jfloatArray jVolumes,
-        jfloatArray jPans,
-        jint jDeviceId,
-        jint jDeviceChannels) {
+bool enginePlayAll(std::vector<EngineTrack> specs, int deviceId, int requestedChannels) {
+    const auto playStart = std::chrono::steady_clock::now();
     // Build track list
-    jsize count = env->GetArrayLength(jFilePaths);
-    if (count <= 0) return JNI_FALSE;
+    if (specs.empty()) { closeStream(); return false; }
     std::vector<MixTrack> tracks;
-    tracks.reserve(count);
-    // Extract arrays
-    jint* outCh = env->GetIntArrayElements(jOutputChannels, nullptr);
-    jfloat* vols = env->GetFloatArrayElements(jVolumes, nullptr);
-    jfloat* pans = env->GetFloatArrayElements(jPans, nullptr);
-    for (jsize i = 0; i < count; ++i) {
-        jstring jstr = (jstring)env->GetObjectArrayElement(jFilePaths, i);
-        const char* cstr = env->GetStringUTFChars(jstr, nullptr);
+    tracks.reserve(specs.size());
+    for (auto &spec : specs) {
         MixTrack mt;
-        mt.path = cstr ? std::string(cstr) : std::string();
-        env->ReleaseStringUTFChars(jstr, cstr);
-        env->DeleteLocalRef(jstr);
-        mt.outputChannel = outCh ? outCh[i] : 0;
-        mt.volume = vols ? std::max(0.0f, std::min(1.0f, vols[i])) : 1.0f;
-        mt.pan = pans ? std::max(-1.0f, std::min(1.0f, pans[i])) : 0.0f;
+        mt.path = std::move(spec.path);
+        mt.outputChannel = spec.outputChannel;
+        mt.volume = std::max(0.0f, std::min(1.0f, spec.volume));
+        mt.pan = std::max(-1.0f, std::min(1.0f, spec.pan));
         if (mt.path.empty()) { tracks.clear(); break; }
-        mt.ifs = std::ifstream(mt.path, std::ios::binary);
-        if (!mt.ifs.is_open()) { tracks.clear(); break; }
-        if (!parseWavHeader(mt.ifs, mt.info)) { tracks.clear(); break; }
-        mt.ifs.seekg(mt.info.dataOffset, std::ios::beg);
         tracks.push_back(std::move(mt));
     }
-    if (outCh) env->ReleaseIntArrayElements(jOutputChannels, outCh, JNI_ABORT);
-    if (vols) env->ReleaseFloatArrayElements(jVolumes, vols, JNI_ABORT);
-    if (pans) env->ReleaseFloatArrayElements(jPans, pans, JNI_ABORT);
-    if (tracks.empty()) return JNI_FALSE;
+    if (tracks.empty()) { closeStream(); return false; }
 
-    // Validate sample rate consistency
+    // Fontes preparadas (abertas e com o início lido) quando o play é o mesmo do prepare
+    std::vector<std::string> paths;
+    std::vector<int> outputs;
+    for (const auto& t : tracks) {
+        paths.push_back(t.path);
+        outputs.push_back(t.outputChannel);
+    }
+    std::unique_lock<std::mutex> preparedLock(gPreparedMutex);
+    std::unique_ptr<PreparedSession> prepared = takePreparedSession(paths, outputs);
+    const int preparedTracks = prepared ? (int)tracks.size() : 0;
+    std::vector<std::unique_ptr<TrackSource>> bundled;
+    if (!prepared) bundled = openBundleTrackSources(paths);
+    for (size_t i = 0; i < tracks.size(); ++i) {
+        auto &mt = tracks[i];
+        if (prepared) {
+            mt.source = std::move(prepared->sources[i]);
+        } else {
+            // Música já carregada pelo preload toca da RAM, sem I/O de disco;
+            // senão do pacote da música (uma leitura por chunk, adiantada pelo
+            // Io do pacote no AsyncIo) ou do arquivo, lido adiantado pelo
+            // prefetcher
+            mt.source = makeMemoryTrackSource(gPreloadCache.lookup(mt.path));
+            if (!mt.source && !bundled.empty()) mt.source = std::move(bundled[i]);
+            if (!mt.source) mt.source = gStemPrefetcher.open(mt.path);
+            if (!mt.source) mt.source = openFileTrackSource(mt.path);
+            if (mt.source) mt.source->setSilenceMap(silenceMapFor(mt.path));
+        }
+        if (!mt.source) { closeStream(); return false; }
+        mt.info = mt.source->info();
+    }
+
+    // Validate sample rate consistency (formato já validado pela fonte: PCM 16/24, 1-2 canais)
     int baseRate = tracks[0].info.sampleRate;
+    int inMemory = 0;
     for (const auto& t : tracks) {
-        if (t.info.sampleRate != baseRate || t.info.bitsPerSample != 16) {
-            LOGE("sample rate/bits mismatch");
-            for (auto& tt : tracks) { if (tt.ifs.is_open()) tt.ifs.close(); }
-            return JNI_FALSE;
+        if (t.info.sampleRate != baseRate) {
+            LOGE("sample rate mismatch");
+            closeStream();
+            return false;
         }
+        if (t.source->inMemory()) ++inMemory;
     }
 
-    // Setup AAudio stream
-    closeStream();
+    // Stream de saída: o da sessão anterior ainda rodando no mesmo
+    // dispositivo/formato, o aberto pelo prepare, ou um novo
     gStop = false;
-    AAudioStreamBuilder* builder = nullptr;
-    aaudio_result_t res = AAudio_createStreamBuilder(&builder);
-    if (res != AAUDIO_OK || !builder) { LOGE("builder fail %d", res); return JNI_FALSE; }
-    int deviceChannels = (int)jDeviceChannels;
+    int deviceChannels = requestedChannels;
     if (deviceChannels < 2) deviceChannels = 2;
     gDeviceChannels = deviceChannels;
-    AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_I16);
-    AAudioStreamBuilder_setChannelCount(builder, deviceChannels);
-    AAudioStreamBuilder_setSampleRate(builder, baseRate);
-    AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_OUTPUT);
-    AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_EXCLUSIVE);
-    if (jDeviceId > 0) {
-        AAudioStreamBuilder_setDeviceId(builder, (int)jDeviceId);
-    }
-    res = AAudioStreamBuilder_openStream(builder, &gStream);
-    AAudioStreamBuilder_delete(builder);
-    if (res != AAUDIO_OK || !gStream) { LOGE("openStream fail %d", res); return JNI_FALSE; }
-    res = AAudioStream_requestStart(gStream);
-    if (res != AAUDIO_OK) { LOGE("start fail %d", res); closeStream(); return JNI_FALSE; }
-    int outChannels = AAudioStream_getChannelCount(gStream);
-    if (outChannels < 2) outChannels = 2;
-    int outRate = AAudioStream_getSampleRate(gStream);
-    LOGI("AAudio mixer started: outChannels=%d outRate=%d tracks=%d", outChannels, outRate, (int)tracks.size());
+    int streamSource = 0; // 0 = novo, 1 = do prepare, 2 = reaproveitado
+    if (gStream && gStreamDeviceId == deviceId && gStreamChannels == deviceChannels && gStreamRate == baseRate &&
+        gStream->running()) {
+        streamSource = 2;
+    } else {
+        closeStream();
+        if (prepared && prepared->stream && prepared->deviceId == deviceId &&
+            prepared->deviceChannels == deviceChannels && prepared->sampleRate == baseRate) {
+            gStream = std::move(prepared->stream);
+            streamSource = 1;
+        } else {
+            // Dispositivo exclusivo: o stream preparado que não serve fecha antes
+            prepared.reset();
+            gStream = openMixerOutput(deviceId, deviceChannels, baseRate);
+            if (!gStream) return false;
+        }
+        gStreamDeviceId = deviceId;
+        gStreamChannels = deviceChannels;
+        gStreamRate = baseRate;
+        gStreamHeld.store(true);
+        if (!gStream->start()) { closeStream(); return false; }
+    }
+    prepared.reset();
+    preparedLock.unlock();
+    gTargetDeviceId.store(deviceId);
+    // O mixer roda no formato da sessão (canais pedidos, taxa dos stems); o
+    // que o stream concedeu de diferente fica com o OutputAdapter
+    const int outChannels = deviceChannels;
+    const int outRate = baseRate;
+    OutputAdapter output;
+    output.configure(outChannels, outRate, gStream->channelCount(), gStream->sampleRate(), gStream->format(),
+                     kMixBlockFrames);
+    LOGI("mixer started: outChannels=%d outRate=%d stream=%dch/%dHz%s tracks=%d fromRam=%d bundle=%d stream=%s",
+         outChannels, outRate, output.streamChannels(), output.streamRate(), output.passthrough() ? "" : " (converted)",
+         (int)tracks.size(), inMemory, bundled.empty() ? 0 : 1,
+         streamSource == 2 ? "reused" : streamSource == 1 ? "prepared" : "new");
+
+    // Mensagens de uma sessão anterior não se aplicam às novas tracks
+    gParamQueue.clear();
+    gTransport.reset();
+    gScrub.reset();
+    engineStatsReset((int)tracks.size(), 1.0e6 * kMixBlockFrames / (double)outRate);
+    gEngineStats.preparedTracks.store(preparedTracks);
+    gEngineStats.preparedStream.store(streamSource);
+    gEngineStats.streamIoBackend.store((int)gStemPrefetcher.backend());
+    gEngineStats.sharedOutput.store(gStream->exclusive() ? 0 : 1);
+    gEngineStats.outputConverted.store(output.passthrough() ? 0 : 1);
 
     // Writer thread: mix to device
-    gThread = std::thread([tracks = std::move(tracks), outChannels]() mutable {
-        const size_t BYTES = 4096;
-        std::vector<std::vector<char>> bytes(tracks.size(), std::vector<char>(BYTES));
-        std::vector<std::vector<int16_t>> samples(tracks.size(), std::vector<int16_t>(BYTES/2));
+    std::vector<MixBusConfig> buses;
+    buses.swap(gPendingBuses);
+    std::vector<int> trackBus;
+    trackBus.swap(gPendingTrackBus);
+    trackBus.resize(tracks.size(), -1);
+    std::vector<int> auxOutputs;
+    auxOutputs.swap(gPendingAuxOutputs);
+    std::vector<float> auxSends;
+    auxSends.swap(gPendingAuxSends);
+
+    // Valores iniciais do bloco compartilhado; a partir daqui o controle escreve nele
+    engineSharedBeginSession(outRate, outChannels, (int)tracks.size(), (int)buses.size());
+    // Tap ligado antes do play (formato ainda adivinhado): passa para o da
+    // sessão. Já com áudio em outro formato, os blocos desta sessão ficam de
+    // fora e aparecem em engineOutputTapStats.
+    {
+        std::lock_guard<std::mutex> lock(gOutputTapLock);
+        if (gOutputTap.running() && !gOutputTap.adoptFormat(outChannels, outRate)) {
+            LOGE("output tap: session format %dch/%dHz differs from tap %dch/%dHz, not recording",
+                 outChannels, outRate, gOutputTap.channels(), gOutputTap.sampleRate());
+        }
+    }
+    for (size_t i = 0; i < tracks.size() && i < (size_t)MTP_MAX_TRACKS; ++i) {
+        sharedStore(gShared.trackVolumes[i], tracks[i].volume);
+        sharedStore(gShared.trackPans[i], tracks[i].pan);
+        sharedStore(gShared.trackMutes[i], 0.0f);
+    }
+    for (size_t b = 0; b < buses.size() && b < (size_t)MTP_MAX_BUSES; ++b) {
+        sharedStore(gShared.busVolumes[b], buses[b].volume);
+        sharedStore(gShared.busPans[b], buses[b].pan);
+        sharedStore(gShared.busMutes[b], buses[b].mute ? 1.0f : 0.0f);
+    }
+
+    gThread = std::thread([tracks = std::move(tracks), buses = std::move(buses), trackBus = std::move(trackBus),
+                           auxOutputs = std::move(auxOutputs), auxSends = std::move(auxSends),
+                           output = std::move(output), outChannels, outRate, playStart, deviceId,
+                           deviceChannels]() mutable {
+        enableFlushToZero();
+        gEngineStats.renderRealtime.store(setCurrentThreadClass(ThreadClass::Render));
+        const int BLOCK = kMixBlockFrames;
+        std::vector<int> trackChannels;
+        trackChannels.reserve(tracks.size());
+        for (const auto& t : tracks) trackChannels.push_back(t.info.channels);
+        InsertChain inserts;
+        inserts.configure(trackChannels, (float)outRate);
+        const int groups = inserts.groupCount();
+        MixGraph graph;
+        graph.prepare(buses, trackBus, BLOCK, (float)outRate);
+        gEngineStats.busCount.store(graph.busCount());
+        gEngineStats.busBuffers.store(graph.bufferCount());
+        AuxSendMatrix sends;
+        sends.configure(inserts, (int)tracks.size(), auxOutputs, auxSends);
+
+        // Amostras de todas as tracks em lanes (grupo-major, frame-major dentro do grupo)
+        std::vector<Lane8> lanes((size_t)groups * BLOCK);
+        std::vector<float> acc((size_t)BLOCK * outChannels);
+        // Mixes auxiliares à parte: o fader master e o trim da música não mexem no in-ear
+        std::vector<float> auxAcc(sends.auxCount() > 0 ? (size_t)BLOCK * outChannels : 0);
+        std::vector<int16_t> out((size_t)BLOCK * outChannels);
+
+        MixRenderCtx ctx;
+        ctx.tracks = &tracks;
+        ctx.inserts = &inserts;
+        ctx.lanes = lanes.data();
+        ctx.block = BLOCK;
+        ctx.groupFrames.assign((size_t)groups, 0);
+        ctx.groupInsertUs.assign((size_t)groups, 0.0);
+        ctx.trackPeak.assign(tracks.size(), 0.0f);
+        ctx.trackQuiet.assign(tracks.size(), 0);
+        ctx.groupSettled.assign((size_t)groups, 0);
+        ctx.settleBlocks = (int)std::ceil(kSilenceSettleSec * outRate / BLOCK);
+        // Crossfade equal-power dos saltos (trechos em geral não correlacionados)
+        std::vector<Lane8> xfadeTail((size_t)groups * kTransportXfadeFrames);
+        std::vector<float> xfadeIn(kTransportXfadeFrames), xfadeOut(kTransportXfadeFrames);
+        for (int f = 0; f < kTransportXfadeFrames; ++f) {
+            const double a = (M_PI / 2.0) * (f + 0.5) / kTransportXfadeFrames;
+            xfadeIn[f] = (float)std::sin(a);
+            xfadeOut[f] = (float)std::cos(a);
+        }
+        ctx.xfadeTail = xfadeTail.data();
+        ctx.xfadeIn = xfadeIn.data();
+        ctx.xfadeOut = xfadeOut.data();
+        // Scrub: o bloco lê no máximo kScrubMaxRate * BLOCK frames (+ vizinho da interpolação)
+        ScrubMotion scrub;
+        bool scrubbing = false;
+        bool scrubEnding = false; // bloco de release já tocou: volta ao play no próximo
+        int64_t scrubResume = 0;
+        int64_t scrubCued = -1;
+        std::vector<double> scrubPos(BLOCK);
+        std::vector<float> scrubGain(BLOCK);
+        ctx.scrubSpan = (int)std::ceil(kScrubMaxRate * BLOCK) + 2;
+        std::vector<Lane8> scrubScratch((size_t)groups * ctx.scrubSpan);
+        ctx.scrubScratch = scrubScratch.data();
+        TransportState transport;
+        int64_t cuedTarget = -1;
+        EventTimeline* timeline = nullptr;
+        int64_t timelineExpected = -1; // posição sem seek/salto desde o último bloco
+        auto applyTimeline = [&](int32_t target, int32_t index, int32_t param, float value) {
+            applyTimelineParam(tracks, inserts, graph, sends, target, index, param, value);
+        };
+        auto cueTracks = [&](int64_t target) {
+            for (auto &t : tracks) t.source->cueFrame(trackFrameAt(t, target, outRate));
+            cuedTarget = target;
+        };
+        std::vector<float> outPeak((size_t)outChannels, 0.0f);
+        const float meterDecay = (float)std::exp(-(double)BLOCK / (kMeterFallSec * outRate));
+        int64_t position = 0;
+        bool firstSample = true;
+        bool streamLost = false;
+        std::thread recovery;
+        float lastTrim = gSongTrim.load();
+        // Início previsto do próximo bloco pelo período nominal; o quanto o
+        // render acorda depois disso vai para as stats (classe Render)
+        std::chrono::steady_clock::time_point blockDue{};
+
+        // Um grupo só não compensa acordar workers
+        RenderPool pool;
+        const int bigCores = (int)detectBigCores().size();
+        const int workers = std::min(groups - 1, std::min(kMaxRenderWorkers, std::max(1, bigCores) - 1));
+        if (workers > 0) pool.start(workers);
+        gEngineStats.renderWorkers.store(pool.workerCount());
+        const auto slice = std::chrono::microseconds((long long)(1.0e6 * kRenderSliceFraction * BLOCK / (double)outRate));
+        sharedStore(gShared.status[MTP_STATUS_MIXING], (int32_t)1);
+
         while (!gStop.load()) {
+            // Stream caiu: fecha, reabre num thread auxiliar e retoma no mesmo frame
+            if (streamLost || gStream->lost()) {
+                streamLost = true;
+                blockDue = {};
+                if (!recovery.joinable()) {
+                    LOGE("mixer stream lost at frame %lld, reopening", (long long)position);
+                    sharedStore(gShared.status[MTP_STATUS_OUTPUT_LOST], (int32_t)1);
+                    gStream.reset();
+                    recovery = std::thread(recoverMixerStream, deviceId > 0, deviceChannels, outRate);
+                }
+                MixerOutput* stream = gRecoveredStream.exchange(nullptr);
+                if (!stream) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+                recovery.join();
+                gStream.reset(stream);
+                gStreamDeviceId = gTargetDeviceId.load();
+                output.configure(outChannels, outRate, stream->channelCount(), stream->sampleRate(), stream->format(),
+                                 BLOCK);
+                gEngineStats.sharedOutput.store(stream->exclusive() ? 0 : 1);
+                gEngineStats.outputConverted.store(output.passthrough() ? 0 : 1);
+                streamLost = false;
+                for (auto &t : tracks) {
+                    const int64_t frame = trackFrameAt(t, position, outRate);
+                    t.source->seekFrame(frame);
+                    t.ended = frame >= t.source->totalFrames();
+                }
+                cuedTarget = -1;
+                gEngineStats.streamRecoveries.fetch_add(1);
+                sharedStore(gShared.status[MTP_STATUS_OUTPUT_LOST], (int32_t)0);
+            }
+            const auto blockStart = std::chrono::steady_clock::now();
+            if (blockDue != std::chrono::steady_clock::time_point{}) recordThreadWake(ThreadClass::Render, blockDue);
+            applyParamChanges(tracks, inserts, graph, sends);
+            syncSharedParams(tracks, graph);
+
             // Apply pending seek request atomically
             if (gDoSeek.load()) {
                 double sec = gSeekSec.load();
                 if (sec < 0.0) sec = 0.0;
                 for (auto &t : tracks) {
-                    long long frames = (long long)(sec * t.info.sampleRate);
-                    long long bps = (long long)(t.info.bitsPerSample / 8);
-                    long long bytes = frames * t.info.channels * bps;
-                    if (bytes < 0) bytes = 0;
-                    if ((size_t)bytes >= t.info.dataSize) {
-                        t.ended = true;
-                        t.ifs.clear();
-                        t.ifs.seekg((std::streamoff)(t.info.dataOffset + t.info.dataSize), std::ios::beg);
-                    } else {
-                        t.ended = false;
-                        t.ifs.clear();
-                        t.ifs.seekg((std::streamoff)(t.info.dataOffset + bytes), std::ios::beg);
-                    }
+                    const int64_t frame = (int64_t)(sec * t.info.sampleRate);
+                    t.source->seekFrame(frame);
+                    t.ended = frame >= t.source->totalFrames();
                 }
+                position = (int64_t)(sec * outRate);
+                sharedStore(gShared.positionFrames, position);
                 gDoSeek.store(false);
             }
-            bool anyData = false;
-            std::vector<int> framesPerTrack(tracks.size(), 0);
-            for (size_t i = 0; i < tracks.size(); ++i) {
-                auto &t = tracks[i];
-                if (t.ended) { framesPerTrack[i] = 0; continue; }
-                t.ifs.read(bytes[i].data(), BYTES);
-                std::streamsize n = t.ifs.gcount();
-                if (n <= 0) { t.ended = true; framesPerTrack[i] = 0; continue; }
-                anyData = true;
-                int shorts = ((int)n) / 2;
-                std::memcpy(samples[i].data(), bytes[i].data(), shorts * sizeof(int16_t));
-                framesPerTrack[i] = shorts / t.info.channels;
+
+            // Scrub: o varispeed toma o lugar da leitura normal; transporte e
+            // timeline esperam a reprodução voltar
+            const bool scrubWanted = gScrub.active();
+            ctx.xfadeFrames = 0;
+            ctx.scrubPos = nullptr;
+            ctx.scrubCue = -1;
+            if (scrubEnding) {
+                // O release terminou em silêncio: o play volta no alvo com fade-in
+                for (auto &t : tracks) {
+                    const int64_t frame = trackFrameAt(t, scrubResume, outRate);
+                    t.source->seekFrame(frame);
+                    t.ended = frame >= t.source->totalFrames();
+                }
+                position = scrubResume;
+                sharedStore(gShared.positionFrames, position);
+                std::fill(xfadeTail.begin(), xfadeTail.end(), Lane8{});
+                ctx.xfadeFrames = kTransportXfadeFrames;
+                cuedTarget = -1;
+                timelineExpected = -1;
+                scrubbing = false;
+                scrubEnding = false;
+            }
+            if (scrubWanted && !scrubbing) {
+                // O scrub começa parado (ganho zero): crossfade do que tocaria a seguir
+                readTransitionTail(tracks, inserts, xfadeTail);
+                ctx.xfadeFrames = kTransportXfadeFrames;
+                scrub.start(position);
+                scrubbing = true;
+                scrubCued = -1;
+            }
+            if (scrubbing) {
+                const double targetSec = gScrub.targetSec();
+                const double target = targetSec < 0.0 ? scrub.position() : targetSec * outRate;
+                scrub.render(target, !scrubWanted, BLOCK, scrubPos.data(), scrubGain.data());
+                ctx.scrubPos = scrubPos.data();
+                ctx.scrubGain = scrubGain.data();
+                // Alvo novo: as fontes que leem adiantado já pedem o trecho dele
+                const int64_t cue = (int64_t)std::llround(target);
+                if (cue != scrubCued) ctx.scrubCue = scrubCued = cue;
+                ctx.frames = BLOCK;
+                if (!scrubWanted) {
+                    scrubEnding = true;
+                    scrubResume = (int64_t)std::llround(target);
+                }
+            } else {
+                // Loop/salto: o destino fica lido antes (cue) e o bloco termina
+                // exatamente na fronteira; o salto acontece no começo do bloco seguinte.
+                if (gTransport.poll(transport)) cuedTarget = -1;
+                TransportEvent ev = transportNextEvent(transport, position);
+                if (ev.target >= 0 && ev.target != cuedTarget) cueTracks(ev.target);
+                if (ev.at >= 0 && ev.at == position) {
+                    jumpTracksToCue(tracks, inserts, xfadeTail, ev.target, outRate);
+                    if (ev.isJump) gTransport.jumpDone(transport);
+                    position = ev.target;
+                    sharedStore(gShared.positionFrames, position);
+                    ctx.xfadeFrames = kTransportXfadeFrames;
+                    // Vamp: o próximo giro do loop já fica preparado
+                    ev = transportNextEvent(transport, position);
+                    cuedTarget = -1;
+                    if (ev.target >= 0) cueTracks(ev.target);
+                }
+                ctx.frames = BLOCK;
+                if (ev.at > position && ev.at - position < BLOCK) ctx.frames = (int)(ev.at - position);
+
+                // Timeline: eventos no frame exato, bloco cortado antes do próximo
+                const bool newTimeline = gTimelineSlot.acquire(timeline);
+                if (timeline) {
+                    if (newTimeline) timeline->setSessionRate(outRate);
+                    if (newTimeline || position != timelineExpected) timeline->locate(position, applyTimeline);
+                    timeline->processUpTo(position, applyTimeline);
+                    const int64_t next = timeline->nextEventFrame();
+                    if (next > position && next - position < ctx.frames) ctx.frames = (int)(next - position);
+                    timeline->updateRamps(position + ctx.frames, applyTimeline);
+                }
             }
-            if (!anyData) break;
+
+            // Fork/join: leitura + inserts por grupo espalhados pelos workers
+            const RenderPoolResult rr = pool.run(groups, renderGroupJob, &ctx, blockStart + slice);
+            if (pool.workerCount() > 0) engineStatsRecordJoin(rr.inlineJobs, rr.missedDeadline, rr.joinWaitUs);
             int frames = 0;
-            for (auto f : framesPerTrack) { if (f > 0) { frames = (frames == 0 ? f : std::min(frames, f)); } }
-            if (frames <= 0) continue;
-            // Accumulate to int32 per channel
-            std::vector<int32_t> acc(frames * outChannels);
-            std::fill(acc.begin(), acc.end(), 0);
+            double insertUs = 0.0;
+            for (int g = 0; g < groups; ++g) {
+                frames = std::max(frames, ctx.groupFrames[g]);
+                insertUs += ctx.groupInsertUs[g];
+            }
+            if (frames <= 0) break;
+
+            // Mix em float: tracks sem bus direto na saída, depois o grafo de buses
+            std::fill(acc.begin(), acc.begin() + (size_t)frames * outChannels, 0.0f);
             for (size_t i = 0; i < tracks.size(); ++i) {
-                auto &t = tracks[i];
-                if (framesPerTrack[i] <= 0) continue;
-                float vol = std::max(0.0f, std::min(1.0f, t.volume));
-                float pan = std::max(-1.0f, std::min(1.0f, t.pan));
-                double tt = (double(pan) + 1.0) / 2.0;
-                double angle = (M_PI / 2.0) * tt;
-                float lg = (float)std::cos(angle);
-                float rg = (float)std::sin(angle);
-                int inCh = t.info.channels;
-                if (inCh == 2) {
-                    for (int f = 0; f < frames; ++f) {
-                        int16_t l = samples[i][f*2];
-                        int16_t r = samples[i][f*2 + 1];
-                        if (t.outputChannel == 0) {
-                            int idx = f*outChannels + 0;
-                            acc[idx] += int32_t(float(l) * vol);
-                        } else if (t.outputChannel == 1) {
-                            int idx = f*outChannels + 1;
-                            acc[idx] += int32_t(float(r) * vol);
-                        } else {
-                            // pair to 0/1
-                            int idxL = f*outChannels + 0;
-                            int idxR = f*outChannels + 1;
-                            acc[idxL] += int32_t(float(l) * lg * vol);
-                            acc[idxR] += int32_t(float(r) * rg * vol);
-                        }
-                    }
-                } else { // mono
-                    for (int f = 0; f < frames; ++f) {
-                        int16_t m = samples[i][f];
-                        if (t.outputChannel == 0) {
-                            int idx = f*outChannels + 0;
-                            acc[idx] += int32_t(float(m) * vol);
-                        } else if (t.outputChannel == 1) {
-                            int idx = f*outChannels + 1;
-                            acc[idx] += int32_t(float(m) * vol);
-                        } else {
-                            int idxL = f*outChannels + 0;
-                            int idxR = f*outChannels + 1;
-                            acc[idxL] += int32_t(float(m) * lg * vol);
-                            acc[idxR] += int32_t(float(m) * rg * vol);
-                        }
-                    }
-                }
+                if (graph.trackBus((int)i) < 0) mixTrackInto(&ctx, (int)i, acc.data(), outChannels, frames);
+            }
+            graph.render(mixTrackInto, &ctx, acc.data(), outChannels, frames);
+            // Mixes auxiliares (in-ear) nos pares deles, direto das lanes
+            const bool hasAux = !auxAcc.empty();
+            if (hasAux) {
+                std::fill(auxAcc.begin(), auxAcc.begin() + (size_t)frames * outChannels, 0.0f);
+                for (size_t i = 0; i < tracks.size(); ++i) sends.setTrackMuted((int)i, tracks[i].muted);
+                sends.render(lanes.data(), BLOCK, ctx.trackQuiet.data(), auxAcc.data(), outChannels, frames);
             }
             // Apply bus volume and clamp
             float busVol = gVolume.load();
             if (busVol < 0.0f) busVol = 0.0f;
             if (busVol > 1.0f) busVol = 1.0f;
-            std::vector<int16_t> out(frames * outChannels);
+            // Trim em rampa ao longo do bloco: mudar de música tocando não estala
+            const float trim = gSongTrim.load();
+            const float trimStep = (trim - lastTrim) / (float)frames;
+            std::fill(outPeak.begin(), outPeak.end(), 0.0f);
             for (int f = 0; f < frames; ++f) {
+                lastTrim += trimStep;
+                const float scale = busVol * lastTrim * 32768.0f;
                 for (int c = 0; c < outChannels; ++c) {
-                    int idx = f*outChannels + c;
-                    float s = float(acc[idx]) * busVol;
+                    const int idx = f * outChannels + c;
+                    float s = acc[idx] * scale;
+                    if (hasAux) s += auxAcc[idx] * 32768.0f;
                     if (s > 32767.0f) s = 32767.0f;
                     if (s < -32768.0f) s = -32768.0f;
                     out[idx] = (int16_t)s;
+                    acc[idx] = s * (1.0f / 32768.0f);
+                    outPeak[c] = std::max(outPeak[c], std::fabs(s));
                 }
             }
+            for (int c = 0; c < outChannels && c < MTP_MAX_OUT_CHANNELS; ++c) {
+                publishPeak(gShared.outputPeaks[c], outPeak[c] * (1.0f / 32768.0f), meterDecay);
+            }
+            for (size_t i = 0; i < tracks.size() && i < (size_t)MTP_MAX_TRACKS; ++i) {
+                publishPeak(gShared.trackPeaks[i], ctx.trackPeak[i], meterDecay);
+            }
+            // O formato é conferido dentro do push: um stop/start do tap no meio
+            // da sessão não deixa o render escrever num ring de outro tamanho
+            if (gOutputTap.running()) gOutputTap.pushAs(out.data(), frames, outChannels, outRate);
+            // Analisador de espectro: aqui só a cópia do tap escolhido
+            const int spectrumTrack = gSpectrum.trackTap();
+            if (spectrumTrack >= 0 && spectrumTrack < (int)tracks.size()) {
+                gSpectrum.feedLanes(lanes.data(), BLOCK, inserts.trackFirstLane(spectrumTrack),
+                                    inserts.trackLaneCount(spectrumTrack), frames);
+            } else {
+                gSpectrum.feedOutput(acc.data(), outChannels, frames);
+            }
+            const double blockUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - blockStart).count();
+            engineStatsRecordBlock(blockUs, insertUs);
+
+            // Formato concedido diferente do da sessão: converte; senão escreve o bloco
+            const uint8_t* streamData = reinterpret_cast<const uint8_t*>(out.data());
+            int streamFrames = frames;
+            if (!output.passthrough()) {
+                streamFrames = output.process(acc.data(), frames);
+                streamData = static_cast<const uint8_t*>(output.data());
+            }
+            const size_t streamFrameBytes = (size_t)output.frameBytes();
             int written = 0;
-            while (written < frames && !gStop.load()) {
-                aaudio_result_t wr = AAudioStream_write(gStream, out.data() + written * outChannels, frames - written, 1000000);
-                if (wr < 0) { LOGE("write err %d", wr); break; }
+            while (written < streamFrames && !gStop.load()) {
+                const int wr = gStream->write(streamData + (size_t)written * streamFrameBytes,
+                                              streamFrames - written, 1000000);
+                if (wr < 0) { LOGE("write err %d", wr); streamLost = true; break; }
                 written += wr;
+                // Tempo do play até o stream aceitar as primeiras amostras
+                if (firstSample && wr > 0) {
+                    firstSample = false;
+                    gEngineStats.firstSampleUs.store((float)std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - playStart).count());
+                }
             }
+            blockDue = blockStart + std::chrono::microseconds((long long)(1.0e6 * frames / outRate));
+            // Na queda conta só o que a interface aceitou: a retomada parte daí
+            position += streamLost ? std::min<int64_t>(frames, output.toMixFrames(written)) : frames;
+            if (ctx.scrubPos) position = (int64_t)std::llround(scrub.position());
+            timelineExpected = position;
+            sharedStore(gShared.positionFrames, position);
+            const int64_t captureNs = gCapture.pendingAlignmentNs();
+            if (captureNs >= 0 && !streamLost) alignCaptureToPlayback(captureNs, position, output);
         }
-        // Close files
-        for (auto &t : tracks) { if (t.ifs.is_open()) t.ifs.close(); }
+        if (recovery.joinable()) recovery.join();
+        delete gRecoveredStream.exchange(nullptr);
+        sharedStore(gShared.status[MTP_STATUS_OUTPUT_LOST], (int32_t)0);
+        sharedStore(gShared.status[MTP_STATUS_MIXING], (int32_t)0);
+        gTimelineSlot.release(timeline);
+        pool.stop();
+        gEngineStats.renderWorkers.store(0);
+        // Close files / solta as imagens do preload
+        for (auto &t : tracks) t.source.reset();
     });
-    return JNI_TRUE;
+    return true;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_example_multitrack_1app_MainActivity_nativeSeekAllPreview(JNIEnv* /*env*/, jobject /*thiz*/, jdouble positionSec) {
-    double p = (double)positionSec;
-    if (p < 0.0) p = 0.0;
+static void requestSeek(double positionSec) {
+    double p = positionSec;
+    if (!(p > 0.0)) p = 0.0;
     gSeekSec.store(p);
     gDoSeek.store(true);
 }
 
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_example_multitrack_1app_MainActivity_nativePlayWavPreview(
-        JNIEnv* env,
-        jobject /*thiz*/,
-        jstring jFilePath,
-        jint jOutputChannel,
-        jint jDeviceId,
-        jint jDeviceChannels) {
-    const char* cpath = env->GetStringUTFChars(jFilePath, nullptr);
-    std::string filePath = cpath ? std::string(cpath) : std::string();
-    env->ReleaseStringUTFChars(jFilePath, cpath);
-    if (filePath.empty()) return JNI_FALSE;
+void engineSeek(double positionSec) {
+    requestSeek(positionSec);
+}
+
+bool enginePlayPreview(const std::string &path, int outputChannel, int deviceId, int requestedChannels) {
+    std::string filePath = path;
+    if (filePath.empty()) return false;
 
     // Abrir arquivo e parse header
     std::ifstream ifs(filePath, std::ios::binary);
-    if (!ifs.is_open()) { LOGE("falha ao abrir arquivo"); return JNI_FALSE; }
+    if (!ifs.is_open()) { LOGE("falha ao abrir arquivo"); return false; }
     WavInfo winfo;
     if (!parseWavHeader(ifs, winfo)) {
         LOGE("wav inválido/unsupported");
-        return JNI_FALSE;
+        return false;
     }
     if (!(winfo.audioFormat == 1 && winfo.bitsPerSample == 16)) {
         LOGE("playWavPreview: only PCM16 supported for playback");
-        return JNI_FALSE;
+        return false;
     }
     LOGI("WAV header: rate=%d channels=%d bits=%d dataOffset=%zu dataSize=%zu",
          winfo.sampleRate, winfo.channels, winfo.bitsPerSample, winfo.dataOffset, winfo.dataSize);
@@ -541,43 +1071,29 @@ Java_com_example_multitrack_1app_MainActivity_nativePlayWavPreview(
     // Reposiciona para o início dos dados
     ifs.seekg(winfo.dataOffset, std::ios::beg);
 
-    // Configurar stream AAudio
+    // Configurar stream de saída
     closeStream();
+    releasePreparedStream();
     gStop = false;
 
-    AAudioStreamBuilder* builder = nullptr;
-    aaudio_result_t res = AAudio_createStreamBuilder(&builder);
-    if (res != AAUDIO_OK || !builder) { LOGE("builder fail %d", res); return JNI_FALSE; }
-
-    int deviceChannels = (int)jDeviceChannels;
+    int deviceChannels = requestedChannels;
     if (deviceChannels < 2) deviceChannels = 2; // mínimo
-    AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_I16);
-    AAudioStreamBuilder_setChannelCount(builder, deviceChannels);
-    AAudioStreamBuilder_setSampleRate(builder, winfo.sampleRate);
-    AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_OUTPUT);
-    AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_EXCLUSIVE);
-    // selecionar dispositivo, se fornecido
-    if (jDeviceId > 0) {
-        AAudioStreamBuilder_setDeviceId(builder, (int)jDeviceId);
-    }
-    LOGI("AAudio builder: deviceId=%d requestedChannels=%d requestedRate=%d",
-         (int)jDeviceId, deviceChannels, winfo.sampleRate);
-
-    res = AAudioStreamBuilder_openStream(builder, &gStream);
-    AAudioStreamBuilder_delete(builder);
-    if (res != AAUDIO_OK || !gStream) { LOGE("openStream fail %d", res); return JNI_FALSE; }
+    LOGI("preview stream: deviceId=%d requestedChannels=%d requestedRate=%d",
+         deviceId, deviceChannels, winfo.sampleRate);
+    // Só o exclusivo (int16 na taxa do arquivo): as amostras vão como estão
+    gStream = openMixerOutput(deviceId, deviceChannels, winfo.sampleRate, false);
+    if (!gStream) { closeStream(); return false; }
 
     // Inicia stream
-    res = AAudioStream_requestStart(gStream);
-    if (res != AAUDIO_OK) { LOGE("start fail %d", res); closeStream(); return JNI_FALSE; }
+    if (!gStream->start()) { closeStream(); return false; }
 
-    int outChannels = AAudioStream_getChannelCount(gStream);
+    int outChannels = gStream->channelCount();
     if (outChannels < 2) outChannels = 2;
-    int outRate = AAudioStream_getSampleRate(gStream);
+    int outRate = gStream->sampleRate();
     (void)outRate;
-    LOGI("AAudio started: outChannels=%d outRate=%d", outChannels, outRate);
+    LOGI("preview started: outChannels=%d outRate=%d", outChannels, outRate);
 
-    int sel = (int)jOutputChannel;
+    int sel = outputChannel;
     bool pair = false;
     if (sel < 0) sel = 0;
     // valor >=2 indica par em dispositivos estéreo
@@ -587,6 +1103,7 @@ Java_com_example_multitrack_1app_MainActivity_nativePlayWavPreview(
 
     // Thread de escrita
     gThread = std::thread([sel, outChannels, winfo, pair, fp = std::move(filePath)](){
+        setCurrentThreadClass(ThreadClass::Render);
         std::ifstream s(fp, std::ios::binary);
         if (!s.is_open()) { LOGE("reopen fail"); return; }
         s.seekg(winfo.dataOffset, std::ios::beg);
@@ -666,7 +1183,7 @@ Java_com_example_multitrack_1app_MainActivity_nativePlayWavPreview(
                         out[idx] = static_cast<int16_t>(s);
                     }
                 }
-                aaudio_result_t wr = AAudioStream_write(gStream, out.data() + written * outChannels, frames - written, 1000000 /*1s*/);
+                const int wr = gStream->write(out.data() + written * outChannels, frames - written, 1000000 /*1s*/);
                 if (wr < 0) { LOGE("write err %d", wr); break; }
                 written += wr;
             }
@@ -676,33 +1193,214 @@ Java_com_example_multitrack_1app_MainActivity_nativePlayWavPreview(
             }
         }
     });
-    return JNI_TRUE;
+    return true;
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_example_multitrack_1app_MainActivity_nativeStopPreview(JNIEnv* /*env*/, jobject /*thiz*/) {
-    LOGI("nativeStopPreview called");
-    gStop.store(true);
-    if (gThread.joinable()) {
-        try { gThread.join(); } catch (...) {}
-    }
+void engineStopPreview() {
+    LOGI("engineStopPreview called");
+    stopRenderThread();
     closeStream();
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_example_multitrack_1app_MainActivity_nativeSetPreviewVolume(JNIEnv* /*env*/, jobject /*thiz*/, jfloat vol) {
+// Troca de música: para o mixer mas mantém o stream aberto e rodando; o
+// enginePlayAll seguinte o reaproveita se o formato for o mesmo (ou fecha)
+void engineStopMixer() {
+    stopRenderThread();
+}
+
+void engineSetOutputDevice(int deviceId) {
+    gTargetDeviceId.store(deviceId > 0 ? deviceId : -1);
+}
+
+// Prepara o próximo play: abre as fontes (RAM do preload ou arquivo), confere
+// a taxa e lê o início de cada uma; com o mixer parado, abre também o stream
+// de saída (sem iniciar).
+bool enginePrepareAll(std::vector<std::string> paths, std::vector<int> outputChannels, int deviceId,
+                      int deviceChannels) {
+    const size_t count = paths.size();
+    if (count == 0 || outputChannels.size() != count) return false;
+    const auto t0 = std::chrono::steady_clock::now();
+    auto session = std::make_unique<PreparedSession>();
+    session->paths = std::move(paths);
+    session->outputChannels = std::move(outputChannels);
+    int rate = 0;
+    std::vector<std::unique_ptr<TrackSource>> bundled = openBundleTrackSources(session->paths);
+    for (size_t i = 0; i < session->paths.size(); ++i) {
+        const std::string &path = session->paths[i];
+        if (path.empty()) return false;
+        std::unique_ptr<TrackSource> src = makeMemoryTrackSource(gPreloadCache.lookup(path));
+        if (!src && !bundled.empty()) src = std::move(bundled[i]);
+        if (!src) src = gStemPrefetcher.open(path);
+        if (!src) src = openFileTrackSource(path);
+        if (!src) { LOGE("prepare: cannot open %s", path.c_str()); return false; }
+        src->setSilenceMap(silenceMapFor(path));
+        if (rate == 0) rate = src->info().sampleRate;
+        if (src->info().sampleRate != rate) { LOGE("prepare: sample rate mismatch"); return false; }
+        // Primeiro bloco já no buffer: o play começa sem esperar o disco
+        src->prime(0);
+        session->sources.push_back(std::move(src));
+    }
+
+    std::lock_guard<std::mutex> lock(gPreparedMutex);
+    gPrepared.reset();
+    if (!gStreamHeld.load()) {
+        session->deviceId = deviceId;
+        session->deviceChannels = std::max(2, deviceChannels);
+        session->sampleRate = rate;
+        session->stream = openMixerOutput(session->deviceId, session->deviceChannels, rate);
+    }
+    LOGI("prepared %d tracks in %.1f ms (stream=%s)", (int)count,
+         std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count(),
+         session->stream ? "open" : "none");
+    gPrepared = std::move(session);
+    return true;
+}
+
+void engineSetPreviewVolume(float vol) {
     float v = vol;
     if (v < 0.0f) v = 0.0f;
     if (v > 1.0f) v = 1.0f;
     gVolume.store(v);
-    LOGI("nativeSetPreviewVolume: %f", v);
+    LOGI("engineSetPreviewVolume: %f", v);
 }
 
-extern "C" JNIEXPORT void JNICALL
-Java_com_example_multitrack_1app_MainActivity_nativeSetPreviewPan(JNIEnv* /*env*/, jobject /*thiz*/, jfloat pan) {
+void engineSetPreviewPan(float pan) {
     float p = pan;
     if (p < -1.0f) p = -1.0f;
     if (p > 1.0f) p = 1.0f;
     gPan.store(p);
-    LOGI("nativeSetPreviewPan: %f", p);
-}
\ No newline at end of file
+    LOGI("engineSetPreviewPan: %f", p);
+}
+
+static bool pushParamChange(const ParamChange& pc) {
+    while (gParamPushLock.test_and_set(std::memory_order_acquire)) {}
+    const bool ok = gParamQueue.push(pc);
+    gParamPushLock.clear(std::memory_order_release);
+    if (!ok) gEngineStats.paramsDropped.fetch_add(1, std::memory_order_relaxed);
+    return ok;
+}
+
+// Volume/pan/mute dentro da capacidade do bloco compartilhado são escritos
+// direto nele; o resto (inserts, tracks/buses além do limite) vai pela fila.
+static bool setEngineParam(int32_t target, int32_t index, int32_t param, float value) {
+    if (index < 0 || param < 0 || param >= PARAM_COUNT) return false;
+    const bool isBus = target == PARAM_TARGET_BUS;
+    if (index < (isBus ? MTP_MAX_BUSES : MTP_MAX_TRACKS)) {
+        float* slot = nullptr;
+        if (param == PARAM_TRACK_VOLUME) slot = isBus ? gShared.busVolumes : gShared.trackVolumes;
+        else if (param == PARAM_TRACK_PAN) slot = isBus ? gShared.busPans : gShared.trackPans;
+        else if (param == PARAM_MUTE) slot = isBus ? gShared.busMutes : gShared.trackMutes;
+        if (slot) {
+            sharedStore(slot[index], value);
+            return true;
+        }
+    }
+    ParamChange pc;
+    pc.track = index;
+    pc.param = param;
+    pc.value = value;
+    pc.target = target;
+    return pushParamChange(pc);
+}
+
+// Envio de aux: sempre pela fila (não há espelho no bloco compartilhado)
+static bool setAuxSend(int32_t track, int32_t aux, float level) {
+    if (track < 0 || aux < 0 || aux >= kMaxAuxMixes || !std::isfinite(level)) return false;
+    ParamChange pc;
+    pc.track = track;
+    pc.param = aux;
+    pc.value = std::max(0.0f, std::min(1.0f, level));
+    pc.target = PARAM_TARGET_AUX_SEND;
+    return pushParamChange(pc);
+}
+
+bool engineSetAuxSend(int32_t track, int32_t aux, float level) {
+    return setAuxSend(track, aux, level);
+}
+
+bool engineSetTrackParam(int32_t track, int32_t param, float value) {
+    return setEngineParam(PARAM_TARGET_TRACK, track, param, value);
+}
+
+bool engineSetBusParam(int32_t bus, int32_t param, float value) {
+    return setEngineParam(PARAM_TARGET_BUS, bus, param, value);
+}
+
+void engineSetMixGraph(std::vector<int> trackBuses, std::vector<MixBusConfig> buses) {
+    gPendingTrackBus = std::move(trackBuses);
+    gPendingBuses = std::move(buses);
+}
+
+void engineSetAuxSends(const std::vector<int> &auxOutputs, const std::vector<float> &sends) {
+    gPendingAuxOutputs.clear();
+    gPendingAuxSends.clear();
+    const size_t auxCount = auxOutputs.size();
+    if (auxCount == 0) return;
+    for (size_t a = 0; a < auxCount && a < (size_t)kMaxAuxMixes; ++a) gPendingAuxOutputs.push_back(auxOutputs[a]);
+    // Mais auxes que o limite: reempacota só as colunas que cabem
+    const size_t kept = gPendingAuxOutputs.size();
+    for (size_t k = 0; k < sends.size(); ++k) {
+        if (k % auxCount < kept) gPendingAuxSends.push_back(sends[k]);
+    }
+}
+
+bool engineStartOutputTap(CaptureConfig config) {
+    std::lock_guard<std::mutex> lock(gOutputTapLock);
+    if (gOutputTap.running()) return false;
+    if (config.directory.empty() || config.fileName.empty()) return false;
+    if (sharedLoad(gShared.status[MTP_STATUS_MIXING]) != 0) {
+        config.deviceChannels = sharedLoad(gShared.status[MTP_STATUS_OUTPUT_CHANNELS]);
+        config.sampleRate = sharedLoad(gShared.status[MTP_STATUS_SAMPLE_RATE]);
+    }
+    // Escrita em segundo plano: não disputa CPU com o render
+    config.writerNice = 10;
+    if (!gOutputTap.start(config)) {
+        LOGE("engineStartOutputTap: cannot create %s/%s.wav", config.directory.c_str(), config.fileName.c_str());
+        return false;
+    }
+    LOGI("output tap started: channels=%d rate=%d", config.deviceChannels, config.sampleRate);
+    return true;
+}
+
+CaptureResult engineStopOutputTap() {
+    std::lock_guard<std::mutex> lock(gOutputTapLock);
+    const CaptureResult r = gOutputTap.stop();
+    LOGI("output tap stopped: written=%lld droppedBlocks=%lld", (long long)r.framesWritten, (long long)r.blocksDropped);
+    return r;
+}
+
+void engineOutputTapStats(int64_t out[7]) {
+    out[0] = gOutputTap.running() ? 1 : 0;
+    out[1] = gOutputTap.channels();
+    out[2] = gOutputTap.sampleRate();
+    out[3] = gOutputTap.framesWritten();
+    out[4] = gOutputTap.framesDropped();
+    out[5] = gOutputTap.blocksDropped();
+    out[6] = gOutputTap.formatMismatchBlocks();
+}
+
+// --- C ABI para dart:ffi (ver engine_shared.h) ---
+extern "C" {
+
+int32_t mtp_set_track_param(int32_t track, int32_t param, float value) {
+    return setEngineParam(PARAM_TARGET_TRACK, track, param, value) ? 1 : 0;
+}
+
+int32_t mtp_set_bus_param(int32_t bus, int32_t param, float value) {
+    return setEngineParam(PARAM_TARGET_BUS, bus, param, value) ? 1 : 0;
+}
+
+int32_t mtp_set_aux_send(int32_t track, int32_t aux, float level) {
+    return setAuxSend(track, aux, level) ? 1 : 0;
+}
+
+void mtp_seek_seconds(double positionSec) {
+    requestSeek(positionSec);
+}
+
+void mtp_set_song_trim_db(float db) {
+    const float clamped = std::max(-24.0f, std::min(12.0f, std::isfinite(db) ? db : 0.0f));
+    gSongTrim.store(std::pow(10.0f, clamped / 20.0f));
+}
+
+} // extern "C"
@@ -0,0 +1,121 @@
+#include "output_adapter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void OutputAdapter::configure(int mixChannels, int mixRate, int streamChannels, int streamRate,
+                              OutputSampleFormat format, int maxBlockFrames) {
+    mMixChannels = std::max(1, mixChannels);
+    mMixRate = mixRate > 0 ? mixRate : 48000;
+    mStreamChannels = std::max(1, streamChannels);
+    mStreamRate = streamRate > 0 ? streamRate : mMixRate;
+    mFormat = format;
+    mPassthrough = mStreamChannels == mMixChannels && mStreamRate == mMixRate &&
+                   mFormat == OutputSampleFormat::Int16;
+
+    // Dobra c -> c % canais do stream: com saída par, L fica em L e R em R
+    std::vector<int> folded((size_t)mStreamChannels, 0);
+    for (int c = 0; c < mMixChannels; ++c) ++folded[(size_t)(c % mStreamChannels)];
+    mFoldGain.assign((size_t)mStreamChannels, 1.0f);
+    for (int c = 0; c < mStreamChannels; ++c) {
+        if (folded[(size_t)c] > 1) mFoldGain[(size_t)c] = 1.0f / std::sqrt((float)folded[(size_t)c]);
+    }
+
+    mStep = (double)mMixRate / (double)mStreamRate;
+    const int block = std::max(1, maxBlockFrames);
+    const int maxOut = (int)std::ceil((block + 4) / mStep) + 2;
+    mSrc.assign((size_t)(block + 4) * mStreamChannels, 0.0f);
+    mFolded.assign((size_t)block * mStreamChannels, 0.0f);
+    mOutFloat.assign((size_t)maxOut * mStreamChannels, 0.0f);
+    mOutI16.assign((size_t)maxOut * mStreamChannels, 0);
+    reset();
+}
+
+void OutputAdapter::reset() {
+    // Um frame de silêncio antes do primeiro: o Hermite precisa de x[-1]
+    std::fill(mSrc.begin(), mSrc.end(), 0.0f);
+    mSrcFrames = 1;
+    mPhase = 1.0;
+}
+
+void OutputAdapter::downmix(const float* mix, int frames, float* dst) const {
+    const int S = mStreamChannels;
+    const int M = mMixChannels;
+    if (S >= M) {
+        for (int f = 0; f < frames; ++f) {
+            float* o = dst + (size_t)f * S;
+            std::memcpy(o, mix + (size_t)f * M, sizeof(float) * (size_t)M);
+            for (int c = M; c < S; ++c) o[c] = 0.0f;
+        }
+        return;
+    }
+    for (int f = 0; f < frames; ++f) {
+        const float* in = mix + (size_t)f * M;
+        float* o = dst + (size_t)f * S;
+        for (int c = 0; c < S; ++c) o[c] = 0.0f;
+        for (int c = 0; c < M; ++c) o[c % S] += in[c];
+        for (int c = 0; c < S; ++c) o[c] *= mFoldGain[(size_t)c];
+    }
+}
+
+int OutputAdapter::process(const float* mix, int frames) {
+    const int S = mStreamChannels;
+    int outFrames = 0;
+    if (mStreamRate == mMixRate) {
+        downmix(mix, frames, mOutFloat.data());
+        outFrames = frames;
+    } else {
+        downmix(mix, frames, mSrc.data() + (size_t)mSrcFrames * S);
+        mSrcFrames += frames;
+        // Hermite cúbico (Catmull-Rom) em x[-1..2] ao redor da fase
+        while ((int)mPhase + 2 < mSrcFrames) {
+            const int i = (int)mPhase;
+            const float t = (float)(mPhase - i);
+            const float* xm1 = mSrc.data() + (size_t)(i - 1) * S;
+            const float* x0 = xm1 + S;
+            const float* x1 = x0 + S;
+            const float* x2 = x1 + S;
+            float* o = mOutFloat.data() + (size_t)outFrames * S;
+            for (int c = 0; c < S; ++c) {
+                const float c1 = 0.5f * (x1[c] - xm1[c]);
+                const float c2 = xm1[c] - 2.5f * x0[c] + 2.0f * x1[c] - 0.5f * x2[c];
+                const float c3 = 0.5f * (x2[c] - xm1[c]) + 1.5f * (x0[c] - x1[c]);
+                o[c] = ((c3 * t + c2) * t + c1) * t + x0[c];
+            }
+            ++outFrames;
+            mPhase += mStep;
+        }
+        // Mantém só x[-1] em diante para o próximo bloco
+        const int drop = std::min(mSrcFrames, std::max(0, (int)mPhase - 1));
+        if (drop > 0) {
+            std::memmove(mSrc.data(), mSrc.data() + (size_t)drop * S,
+                         sizeof(float) * (size_t)(mSrcFrames - drop) * S);
+            mSrcFrames -= drop;
+            mPhase -= drop;
+        }
+    }
+
+    const int n = outFrames * S;
+    if (mFormat == OutputSampleFormat::Float) {
+        for (int k = 0; k < n; ++k) mOutFloat[(size_t)k] = std::max(-1.0f, std::min(1.0f, mOutFloat[(size_t)k]));
+    } else {
+        for (int k = 0; k < n; ++k) {
+            float s = mOutFloat[(size_t)k] * 32768.0f;
+            if (s > 32767.0f) s = 32767.0f;
+            if (s < -32768.0f) s = -32768.0f;
+            mOutI16[(size_t)k] = (int16_t)s;
+        }
+    }
+    return outFrames;
+}
+
+const void* OutputAdapter::data() const {
+    if (mFormat == OutputSampleFormat::Float) return mOutFloat.data();
+    return mOutI16.data();
+}
+
+int64_t OutputAdapter::toMixFrames(int64_t streamFrames) const {
+    if (mStreamRate == mMixRate) return streamFrames;
+    return (int64_t)std::llround((double)streamFrames * mMixRate / mStreamRate);
+}
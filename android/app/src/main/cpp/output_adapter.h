@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Saída do mixer para o formato que o stream concedeu. O mixer sempre roda no
+// formato da sessão: canais da interface pedidos e taxa dos stems. Em modo
+// exclusivo o stream concede exatamente isso, e o bloco vai direto em int16.
+// Em modo compartilhado (ou com outra taxa/contagem concedida) o adaptador
+// dobra os canais do mixer sobre os do stream (pares L/R preservados), converte
+// a taxa (Hermite cúbico) e entrega em int16 ou float. Tudo pré-alocado em
+// configure(); process() roda no thread de render sem alocar.
+
+enum class OutputSampleFormat { Int16, Float };
+
+class OutputAdapter {
+public:
+    void configure(int mixChannels, int mixRate, int streamChannels, int streamRate,
+                   OutputSampleFormat format, int maxBlockFrames);
+    // Formato igual ao da sessão em int16: o render escreve o próprio bloco
+    bool passthrough() const { return mPassthrough; }
+    int streamChannels() const { return mStreamChannels; }
+    int streamRate() const { return mStreamRate; }
+    int frameBytes() const {
+        return mStreamChannels * (mFormat == OutputSampleFormat::Float ? (int)sizeof(float) : (int)sizeof(int16_t));
+    }
+
+    // `mix`: frames intercalados com mixChannels canais, escala ±1, já
+    // limitados. Devolve quantos frames do stream ficaram em data().
+    int process(const float* mix, int frames);
+    const void* data() const;
+    // Frames da sessão que correspondem a `streamFrames` frames do stream
+    int64_t toMixFrames(int64_t streamFrames) const;
+
+private:
+    void reset();
+    void downmix(const float* mix, int frames, float* dst) const;
+
+    int mMixChannels = 2;
+    int mMixRate = 48000;
+    int mStreamChannels = 2;
+    int mStreamRate = 48000;
+    OutputSampleFormat mFormat = OutputSampleFormat::Int16;
+    bool mPassthrough = true;
+    // Ganho de cada canal do stream: 1/sqrt(canais do mixer dobrados nele)
+    std::vector<float> mFoldGain;
+    // Conversor de taxa: frames pendentes (canais do stream) e fase do próximo
+    // frame de saída, em frames de entrada a partir de mSrc[0]
+    std::vector<float> mSrc;
+    int mSrcFrames = 0;
+    double mPhase = 1.0;
+    double mStep = 1.0;
+    std::vector<float> mFolded;
+    std::vector<float> mOutFloat;
+    std::vector<int16_t> mOutI16;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Identificadores dos parâmetros que o thread de controle (JNI) pode alterar
+// enquanto o mixer está tocando. A ordem é espelhada em MainActivity.kt
+// (INSERT_PARAM_IDS); não reordenar sem atualizar o lado Kotlin. O plugin
+// Linux (linux/audio_engine) usa o enum direto.
+enum ParamId : int32_t {
+    PARAM_TRACK_VOLUME = 0,
+    PARAM_TRACK_PAN,
+    PARAM_HPF_HZ,            // 0 = desligado
+    PARAM_LPF_HZ,            // 0 = desligado
+    PARAM_EQ1_HZ,
+    PARAM_EQ1_GAIN_DB,       // 0 dB = desligado
+    PARAM_EQ1_Q,
+    PARAM_EQ2_HZ,
+    PARAM_EQ2_GAIN_DB,
+    PARAM_EQ2_Q,
+    PARAM_COMP_THRESHOLD_DB,
+    PARAM_COMP_RATIO,        // <= 1 = desligado
+    PARAM_COMP_ATTACK_MS,
+    PARAM_COMP_RELEASE_MS,
+    PARAM_COMP_MAKEUP_DB,
+    PARAM_LIMIT_CEILING_DB,  // >= 0 dBFS = desligado
+    PARAM_MUTE,              // >= 0.5 = mudo
+    PARAM_COUNT
+};
+
+// A quem a mensagem se destina: `track` é o índice da track ou do bus. Em
+// PARAM_TARGET_AUX_SEND, `track` é a track, `param` o índice do aux e `value`
+// o nível do envio (0..1).
+enum ParamTarget : int32_t {
+    PARAM_TARGET_TRACK = 0,
+    PARAM_TARGET_BUS = 1,
+    PARAM_TARGET_AUX_SEND = 2
+};
+
+struct ParamChange {
+    int32_t track = 0;
+    int32_t param = 0;
+    float value = 0.0f;
+    int32_t target = PARAM_TARGET_TRACK;
+};
+
+// Fila lock-free single-producer/single-consumer. O consumidor é o thread de
+// render, que drena a fila no início de cada bloco; quem tiver mais de um
+// produtor (JNI e FFI) serializa os push do seu lado. Nenhum dos lados aloca
+// e o consumidor nunca bloqueia.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+    bool push(const T& v) {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        const size_t tail = mTail.load(std::memory_order_acquire);
+        if (head - tail >= Capacity) return false;
+        mSlots[head & (Capacity - 1)] = v;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        const size_t head = mHead.load(std::memory_order_acquire);
+        if (tail == head) return false;
+        out = mSlots[tail & (Capacity - 1)];
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Descarta mensagens pendentes; só pode ser chamado com o consumidor parado.
+    void clear() {
+        mTail.store(mHead.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    T mSlots[Capacity];
+    alignas(64) std::atomic<size_t> mHead{0};
+    alignas(64) std::atomic<size_t> mTail{0};
+};
+
+using ParamQueue = SpscRing<ParamChange, 1024>;
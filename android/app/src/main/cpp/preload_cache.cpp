@@ -0,0 +1,290 @@
+#include "preload_cache.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "silence_map.h"
+#include "thread_topology.h"
+
+PreloadCache gPreloadCache;
+
+// Leitura em blocos para conseguir abortar no meio de um arquivo grande
+static const size_t kLoadChunkBytes = 1 << 20;
+
+PreloadCache::~PreloadCache() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCv.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+void PreloadCache::setBudgetBytes(int64_t bytes) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBudget = std::max<int64_t>(0, bytes);
+    makeRoomLocked(0, -1);
+}
+
+void PreloadCache::requestSong(int songId, const std::vector<std::string> &paths, bool urgent) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Song &song = mSongs[songId];
+    song.lastUsed = ++mClock;
+    if (song.state == PRELOAD_READY || song.state == PRELOAD_LOADING) {
+        if (song.paths == paths) return;
+        if (song.state == PRELOAD_LOADING) return; // o loader confere os caminhos ao terminar
+        evictLocked(songId);
+    }
+    song.paths = paths;
+    if (song.state == PRELOAD_QUEUED) {
+        if (!urgent) return;
+        mQueue.erase(std::remove(mQueue.begin(), mQueue.end(), songId), mQueue.end());
+    }
+    song.state = PRELOAD_QUEUED;
+    if (urgent) mQueue.push_front(songId); else mQueue.push_back(songId);
+    mQueuedAt = std::chrono::steady_clock::now();
+    ensureThreadLocked();
+    mCv.notify_one();
+}
+
+void PreloadCache::touch(int songId) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mSongs.find(songId);
+    if (it != mSongs.end()) it->second.lastUsed = ++mClock;
+}
+
+PreloadState PreloadCache::state(int songId) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mSongs.find(songId);
+    return it == mSongs.end() ? PRELOAD_NONE : it->second.state;
+}
+
+std::shared_ptr<const PcmImage> PreloadCache::lookup(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mImages.find(path);
+    return it == mImages.end() ? nullptr : it->second.pcm;
+}
+
+int64_t PreloadCache::residentBytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mReserved;
+}
+
+void PreloadCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mGeneration;
+    mQueue.clear();
+    for (auto &kv : mSongs) {
+        if (kv.second.state == PRELOAD_LOADING) continue; // o loader solta a reserva
+        evictLocked(kv.first);
+    }
+}
+
+void PreloadCache::ensureThreadLocked() {
+    if (mThread.joinable()) return;
+    mThread = std::thread([this]() { loaderLoop(); });
+}
+
+// Solta as imagens da música; as que ficam sem música saem do orçamento
+void PreloadCache::releaseLocked(Song &song) {
+    for (const auto &p : song.held) {
+        auto it = mImages.find(p);
+        if (it == mImages.end() || --it->second.refs > 0) continue;
+        mReserved -= it->second.bytes;
+        mImages.erase(it);
+    }
+    song.held.clear();
+    mReserved -= song.pending;
+    song.pending = 0;
+}
+
+void PreloadCache::evictLocked(int songId) {
+    auto it = mSongs.find(songId);
+    if (it == mSongs.end()) return;
+    releaseLocked(it->second);
+    it->second.state = PRELOAD_NONE;
+}
+
+// Despeja músicas prontas, da menos recente para a mais recente, até `bytes`
+// caberem no orçamento. Não mexe em `keepSong` nem na que está carregando.
+bool PreloadCache::makeRoomLocked(int64_t bytes, int keepSong) {
+    while (mReserved + bytes > mBudget) {
+        int victim = -1;
+        uint64_t oldest = UINT64_MAX;
+        for (const auto &kv : mSongs) {
+            if (kv.first == keepSong || kv.second.state != PRELOAD_READY) continue;
+            if (kv.second.lastUsed < oldest) { oldest = kv.second.lastUsed; victim = kv.first; }
+        }
+        if (victim < 0) return false;
+        evictLocked(victim);
+    }
+    return true;
+}
+
+// Trechos silenciosos pelo mapa não são lidos: ficam em zero na imagem
+static bool loadImage(const std::string &path, PcmImage &image, const std::atomic<bool> &stop) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open() || !parseWavHeader(ifs, image.info) || !isMixablePcm(image.info)) return false;
+    const std::shared_ptr<const SilenceMap> silence = silenceMapFor(path);
+    const size_t frameBytes = (size_t)image.info.channels * (image.info.bitsPerSample / 8);
+    image.data.resize(image.info.dataSize);
+    ifs.clear();
+    ifs.seekg((std::streamoff)image.info.dataOffset, std::ios::beg);
+    size_t done = 0;
+    bool skipped = false;
+    while (done < image.data.size()) {
+        if (stop.load()) return false;
+        size_t n = std::min(kLoadChunkBytes, image.data.size() - done);
+        if (silence) {
+            const int64_t frame = (int64_t)(done / frameBytes);
+            const int64_t quiet = silence->silentFramesFrom(frame);
+            if (quiet > 0) {
+                done = std::min(image.data.size(), (size_t)(frame + quiet) * frameBytes);
+                skipped = true;
+                continue;
+            }
+            // Lê até o próximo trecho silencioso, em frames inteiros
+            const int64_t active = silence->activeFramesFrom(frame);
+            if (active > 0) n = std::min(n, (size_t)active * frameBytes);
+            n -= n % frameBytes;
+            if (n == 0) n = std::min(frameBytes, image.data.size() - done);
+        }
+        if (skipped) {
+            ifs.clear();
+            ifs.seekg((std::streamoff)(image.info.dataOffset + done), std::ios::beg);
+            skipped = false;
+        }
+        ifs.read(reinterpret_cast<char*>(image.data.data() + done), (std::streamsize)n);
+        const size_t got = (size_t)ifs.gcount();
+        done += got;
+        if (got < n) break;
+    }
+    // Arquivo truncado: fica com o que existe, alinhado ao frame
+    image.data.resize(done - done % frameBytes);
+    image.info.dataSize = image.data.size();
+    return !image.data.empty();
+}
+
+void PreloadCache::loaderLoop() {
+    // Prefetch de disco: abaixo do render, acima da análise de fundo
+    setCurrentThreadClass(ThreadClass::Io);
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mCv.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+        if (mStop) return;
+        if (mQueuedAt != std::chrono::steady_clock::time_point{}) {
+            recordThreadWake(ThreadClass::Io, mQueuedAt);
+            mQueuedAt = {};
+        }
+        const int songId = mQueue.front();
+        mQueue.pop_front();
+        Song &song = mSongs[songId];
+        if (song.state != PRELOAD_QUEUED) continue;
+        const std::vector<std::string> paths = song.paths;
+        const uint64_t generation = mGeneration;
+        // Um arquivo repetido na música é uma imagem só
+        std::vector<std::string> unique;
+        for (const auto &p : paths) {
+            if (std::find(unique.begin(), unique.end(), p) == unique.end()) unique.push_back(p);
+        }
+
+        // Tamanho pelos cabeçalhos; reserva antes de ler
+        std::vector<int64_t> sizes;
+        bool ok = !unique.empty();
+        lock.unlock();
+        for (const auto &p : unique) {
+            std::ifstream ifs(p, std::ios::binary);
+            WavInfo info;
+            if (!ifs.is_open() || !parseWavHeader(ifs, info) || !isMixablePcm(info)) { ok = false; break; }
+            sizes.push_back((int64_t)info.dataSize);
+        }
+        lock.lock();
+        if (mStop) return;
+        Song &s = mSongs[songId];
+        if (s.state != PRELOAD_QUEUED || generation != mGeneration) continue;
+        // Imagens já em RAM (de outras músicas) ganham a referência antes do
+        // despejo, para não saírem; só as que faltam entram na conta
+        int64_t need = 0;
+        std::vector<size_t> missing;
+        for (size_t i = 0; ok && i < unique.size(); ++i) {
+            auto it = mImages.find(unique[i]);
+            if (it != mImages.end()) {
+                ++it->second.refs;
+                s.held.push_back(unique[i]);
+            } else {
+                need += sizes[i];
+                missing.push_back(i);
+            }
+        }
+        if (!ok || need > mBudget || !makeRoomLocked(need, songId)) {
+            releaseLocked(s);
+            s.state = PRELOAD_REJECTED;
+            continue;
+        }
+        mReserved += need;
+        s.pending = need;
+        s.state = PRELOAD_LOADING;
+
+        std::vector<std::shared_ptr<const PcmImage>> images;
+        lock.unlock();
+        for (size_t i : missing) {
+            auto image = std::make_shared<PcmImage>();
+            if (!loadImage(unique[i], *image, mStop)) { ok = false; break; }
+            images.push_back(std::move(image));
+        }
+        lock.lock();
+        if (mStop) return;
+        Song &done = mSongs[songId];
+        if (!ok || generation != mGeneration || done.paths != paths) {
+            releaseLocked(done);
+            done.state = ok ? PRELOAD_NONE : PRELOAD_REJECTED;
+            // Caminhos mudaram durante a carga: carrega de novo com os atuais
+            if (ok && generation == mGeneration) {
+                done.state = PRELOAD_QUEUED;
+                mQueue.push_front(songId);
+            }
+            continue;
+        }
+        // A reserva da carga passa para as imagens
+        for (size_t k = 0; k < missing.size(); ++k) {
+            const std::string &p = unique[missing[k]];
+            Image &image = mImages[p];
+            image.pcm = std::move(images[k]);
+            image.bytes += sizes[missing[k]];
+            ++image.refs;
+            done.held.push_back(p);
+        }
+        done.pending = 0;
+        done.state = PRELOAD_READY;
+    }
+}
+
+extern "C" {
+
+void mtp_preload_set_budget(int64_t bytes) {
+    gPreloadCache.setBudgetBytes(bytes);
+}
+
+void mtp_preload_song(int32_t songId, const char* const* paths, int32_t count, int32_t urgent) {
+    std::vector<std::string> list;
+    for (int32_t i = 0; paths && i < count; ++i) list.emplace_back(paths[i] ? paths[i] : "");
+    gPreloadCache.requestSong(songId, list, urgent != 0);
+}
+
+void mtp_preload_touch(int32_t songId) {
+    gPreloadCache.touch(songId);
+}
+
+int32_t mtp_preload_state(int32_t songId) {
+    return gPreloadCache.state(songId);
+}
+
+int64_t mtp_preload_resident_bytes(void) {
+    return gPreloadCache.residentBytes();
+}
+
+void mtp_preload_clear(void) {
+    gPreloadCache.clear();
+}
+
+} // extern "C"
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "track_source.h"
+#include "engine_shared.h"
+
+// Cache de músicas inteiras em RAM para tocar sem I/O de disco. Cada música é
+// carregada por um thread de baixa prioridade, no formato empacotado do
+// arquivo, e só entra se couber no orçamento; para abrir espaço saem as
+// músicas usadas há mais tempo. O orçamento é reservado antes da leitura, então
+// nunca é ultrapassado. Uma imagem despejada enquanto toca continua viva até o
+// mixer soltar a referência.
+//
+// As imagens são guardadas por arquivo, não por música: stems importados são
+// endereçados pelo conteúdo (content_hash.h), então o mesmo click ou pad em
+// várias músicas do show é o mesmo caminho, lido e mantido em RAM uma vez só
+// e contado uma vez no orçamento. A imagem sai quando a última música
+// carregada que a usa é despejada.
+
+enum PreloadState : int32_t {
+    PRELOAD_NONE = 0,
+    PRELOAD_QUEUED,
+    PRELOAD_LOADING,
+    PRELOAD_READY,
+    PRELOAD_REJECTED   // não cabe no orçamento ou arquivo inválido
+};
+
+class PreloadCache {
+public:
+    ~PreloadCache();
+
+    void setBudgetBytes(int64_t bytes);
+    // Enfileira a carga da música; `urgent` fura a fila (música atual)
+    void requestSong(int songId, const std::vector<std::string> &paths, bool urgent);
+    // Marca a música como tocada agora (LRU)
+    void touch(int songId);
+    PreloadState state(int songId) const;
+    // Imagem pronta de um arquivo, se alguma música carregada o contém
+    std::shared_ptr<const PcmImage> lookup(const std::string &path) const;
+    int64_t residentBytes() const;
+    void clear();
+
+private:
+    struct Image {
+        std::shared_ptr<const PcmImage> pcm;
+        int64_t bytes = 0; // reservado no orçamento
+        int refs = 0;      // músicas prontas ou carregando que a usam
+    };
+    struct Song {
+        std::vector<std::string> paths;
+        std::vector<std::string> held; // imagens com referência desta música
+        int64_t pending = 0;           // reserva das imagens novas durante a carga
+        uint64_t lastUsed = 0;
+        PreloadState state = PRELOAD_NONE;
+    };
+
+    void ensureThreadLocked();
+    void loaderLoop();
+    bool makeRoomLocked(int64_t bytes, int keepSong);
+    void evictLocked(int songId);
+    void releaseLocked(Song &song);
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCv;
+    std::unordered_map<int, Song> mSongs;
+    std::unordered_map<std::string, Image> mImages;
+    std::deque<int> mQueue;
+    // Pedido que acordou o loader (atraso de acordar da classe Io)
+    std::chrono::steady_clock::time_point mQueuedAt{};
+    int64_t mBudget = 0;
+    int64_t mReserved = 0;
+    uint64_t mClock = 0;
+    uint64_t mGeneration = 0; // muda em clear(); cargas antigas são descartadas
+    std::thread mThread;
+    std::atomic<bool> mStop{false};
+};
+
+extern PreloadCache gPreloadCache;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+MTP_EXPORT void mtp_preload_set_budget(int64_t bytes);
+MTP_EXPORT void mtp_preload_song(int32_t songId, const char* const* paths, int32_t count, int32_t urgent);
+MTP_EXPORT void mtp_preload_touch(int32_t songId);
+MTP_EXPORT int32_t mtp_preload_state(int32_t songId);
+MTP_EXPORT int64_t mtp_preload_resident_bytes(void);
+MTP_EXPORT void mtp_preload_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,136 @@
+#include "render_pool.h"
+#include "insert_chain.h"
+
+#include <algorithm>
+
+// Tempo que um worker fica girando esperando o próximo bloco antes de dormir
+static const auto kWorkerSpin = std::chrono::microseconds(200);
+
+void RenderPool::start(int workers) {
+    stop();
+    workers = std::max(0, workers);
+    mParticipants = workers + 1;
+    mParts.reset(new Partition[mParticipants]);
+    mQuit.store(false);
+    mOpen.store(false);
+    mDone.store(0);
+    mActive.store(0);
+    mSleeping.store(0);
+    for (int i = 0; i < workers; ++i) {
+        mThreads.emplace_back([this, i]() { workerLoop(i + 1); });
+    }
+}
+
+void RenderPool::stop() {
+    if (mThreads.empty()) return;
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        mQuit.store(true);
+    }
+    mCv.notify_all();
+    for (auto& t : mThreads) {
+        if (t.joinable()) t.join();
+    }
+    mThreads.clear();
+    mParticipants = 1;
+}
+
+bool RenderPool::claim(int participant, int& job, bool& stolen) {
+    // Primeiro a própria partição, depois as dos outros participantes
+    for (int k = 0; k < mParticipants; ++k) {
+        Partition& p = mParts[(participant + k) % mParticipants];
+        if (p.next.load(std::memory_order_relaxed) >= p.end.load(std::memory_order_relaxed)) continue;
+        const int j = p.next.fetch_add(1, std::memory_order_acq_rel);
+        if (j < p.end.load(std::memory_order_relaxed)) {
+            job = j;
+            stolen = k != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderPool::drain(int participant, int* stolenCount) {
+    int job = 0;
+    bool stolen = false;
+    while (claim(participant, job, stolen)) {
+        mFn(mCtx, job);
+        if (stolen && stolenCount) ++(*stolenCount);
+        mDone.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+void RenderPool::workerLoop(int participant) {
+    enableFlushToZero();
+    setCurrentThreadClass(ThreadClass::RenderWorker);
+    uint32_t seen = mEpoch.load();
+    while (!mQuit.load()) {
+        // Gira um pouco esperando o próximo bloco; depois dorme
+        const auto spinUntil = std::chrono::steady_clock::now() + kWorkerSpin;
+        while (mEpoch.load() == seen && !mQuit.load() && std::chrono::steady_clock::now() < spinUntil) {
+            std::this_thread::yield();
+        }
+        if (mEpoch.load() == seen && !mQuit.load()) {
+            std::unique_lock<std::mutex> lk(mMutex);
+            mSleeping.fetch_add(1);
+            mCv.wait(lk, [&] { return mEpoch.load() != seen || mQuit.load(); });
+            mSleeping.fetch_sub(1);
+        }
+        if (mQuit.load()) break;
+        seen = mEpoch.load();
+        recordThreadWake(ThreadClass::RenderWorker,
+                         std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(mReleasedAt.load())));
+        // run() abre o bloco logo depois de avançar o epoch
+        for (int i = 0; i < 64 && !mOpen.load() && mEpoch.load() == seen; ++i) std::this_thread::yield();
+        mActive.fetch_add(1);
+        // Só participa se o bloco que acordou este worker ainda estiver aberto.
+        // mOpen só fica true depois do epoch avançar, então um worker atrasado
+        // de um bloco anterior nunca pega partições no meio do reset.
+        if (mOpen.load() && mEpoch.load() == seen) drain(participant, nullptr);
+        mActive.fetch_sub(1);
+    }
+}
+
+RenderPoolResult RenderPool::run(int jobs, JobFn fn, void* ctx, std::chrono::steady_clock::time_point deadline) {
+    RenderPoolResult r;
+    if (jobs <= 0) return r;
+    if (mThreads.empty()) {
+        for (int j = 0; j < jobs; ++j) fn(ctx, j);
+        return r;
+    }
+
+    mFn = fn;
+    mCtx = ctx;
+    mDone.store(0);
+    // Particiona em faixas contíguas; o chamador (0) fica com a primeira
+    const int per = jobs / mParticipants;
+    const int extra = jobs % mParticipants;
+    int begin = 0;
+    for (int p = 0; p < mParticipants; ++p) {
+        const int n = per + (p < extra ? 1 : 0);
+        mParts[p].end.store(begin + n, std::memory_order_relaxed);
+        mParts[p].next.store(begin, std::memory_order_release);
+        begin += n;
+    }
+    mReleasedAt.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    mEpoch.fetch_add(1);
+    mOpen.store(true);
+    if (mSleeping.load() > 0) {
+        std::lock_guard<std::mutex> lk(mMutex);
+        mCv.notify_all();
+    }
+
+    drain(0, &r.inlineJobs);
+    mOpen.store(false);
+
+    // Restam apenas jobs já iniciados por workers; não dá para refazê-los
+    // (escrevem no mesmo buffer), então espera e registra o atraso.
+    const auto waitStart = std::chrono::steady_clock::now();
+    while (mDone.load(std::memory_order_acquire) < jobs) {
+        if (!r.missedDeadline && std::chrono::steady_clock::now() > deadline) r.missedDeadline = true;
+        std::this_thread::yield();
+    }
+    while (mActive.load() > 0) std::this_thread::yield();
+    r.joinWaitUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - waitStart).count();
+    return r;
+}
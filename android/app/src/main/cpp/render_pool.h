@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_topology.h"
+
+// Pool fork/join para o render de blocos. Cada bloco é dividido em jobs
+// (um por grupo de lanes); os jobs são particionados entre os workers e o
+// próprio thread de render, e quem termina a sua partição rouba jobs das
+// partições dos outros. Como o chamador também rouba, um worker que não acordou
+// a tempo simplesmente tem seus jobs processados inline pelo thread de render.
+//
+// Workers são threads RenderWorker (thread_topology.h): prioridade de
+// render e fixados nos big cores; o atraso entre a liberação do bloco e o
+// worker acordar vai para as engine stats.
+
+struct RenderPoolResult {
+    int inlineJobs = 0;      // jobs executados pelo chamador além da sua partição
+    bool missedDeadline = false;
+    double joinWaitUs = 0.0; // tempo esperando workers depois de esgotar os jobs
+};
+
+class RenderPool {
+public:
+    using JobFn = void (*)(void* ctx, int job);
+
+    ~RenderPool() { stop(); }
+
+    // Cria `workers` threads (0 = tudo inline). Não é seguro chamar durante run().
+    void start(int workers);
+    void stop();
+    int workerCount() const { return (int)mThreads.size(); }
+
+    // Executa fn(ctx, job) para job em [0, jobs) e só retorna quando todos
+    // terminaram. `deadline` marca o fim da fatia do bloco; se for atingido
+    // com jobs ainda em andamento, o resultado sinaliza missedDeadline.
+    RenderPoolResult run(int jobs, JobFn fn, void* ctx, std::chrono::steady_clock::time_point deadline);
+
+private:
+    struct alignas(64) Partition {
+        std::atomic<int> next{0};
+        std::atomic<int> end{0};
+    };
+
+    void workerLoop(int participant);
+    bool claim(int participant, int& job, bool& stolen);
+    void drain(int participant, int* stolenCount);
+
+    std::vector<std::thread> mThreads;
+    std::unique_ptr<Partition[]> mParts; // workers + 1 (índice 0 = chamador)
+    int mParticipants = 1;
+
+    JobFn mFn = nullptr;
+    void* mCtx = nullptr;
+    std::atomic<uint32_t> mEpoch{0};
+    std::atomic<int64_t> mReleasedAt{0}; // steady_clock do último bloco liberado
+    std::atomic<bool> mOpen{false};
+    std::atomic<int> mDone{0};
+    std::atomic<int> mActive{0};
+    std::atomic<int> mSleeping{0};
+    std::atomic<bool> mQuit{false};
+    std::mutex mMutex;
+    std::condition_variable mCv;
+};
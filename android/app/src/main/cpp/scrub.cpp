@@ -0,0 +1,73 @@
+#include "scrub.h"
+
+#include <algorithm>
+#include <cmath>
+
+ScrubControl gScrub;
+
+// A velocidade desejada cobre a distância até o alvo em ~2 blocos; a real
+// anda metade do caminho até ela por bloco (sem degraus de pitch)
+static const double kScrubFollowBlocks = 2.0;
+static const double kScrubSmoothing = 0.5;
+
+void ScrubControl::begin() {
+    mTargetSec.store(-1.0, std::memory_order_relaxed);
+    mActive.store(true, std::memory_order_release);
+}
+
+void ScrubControl::moveTo(double positionSec) {
+    if (!(positionSec > 0.0)) positionSec = 0.0;
+    mTargetSec.store(positionSec, std::memory_order_release);
+}
+
+void ScrubControl::end() {
+    mActive.store(false, std::memory_order_release);
+}
+
+void ScrubControl::reset() {
+    mActive.store(false, std::memory_order_relaxed);
+    mTargetSec.store(-1.0, std::memory_order_relaxed);
+}
+
+void ScrubMotion::start(int64_t positionFrame) {
+    mPos = (double)std::max<int64_t>(0, positionFrame);
+    mRate = 0.0;
+}
+
+void ScrubMotion::render(double targetFrame, bool release, int frames, double* pos, float* gain) {
+    if (frames <= 0) return;
+    double want = release ? 0.0 : (targetFrame - mPos) / (kScrubFollowBlocks * frames);
+    want = std::max(-kScrubMaxRate, std::min(kScrubMaxRate, want));
+    const double r0 = mRate;
+    const double r1 = r0 + (want - r0) * kScrubSmoothing;
+    for (int f = 0; f < frames; ++f) {
+        double r = r0 + (r1 - r0) * (f + 1) / frames;
+        // Antes do início não há o que ler: segura em zero
+        if (mPos <= 0.0 && r < 0.0) {
+            mPos = 0.0;
+            r = 0.0;
+        }
+        pos[f] = mPos;
+        float g = (float)std::min(1.0, std::fabs(r) / kScrubGateRate);
+        if (release) g *= (float)(frames - 1 - f) / (float)frames;
+        gain[f] = g;
+        mPos = std::max(0.0, mPos + r);
+    }
+    mRate = mPos > 0.0 ? r1 : std::max(0.0, r1);
+}
+
+extern "C" {
+
+void mtp_scrub_begin(void) {
+    gScrub.begin();
+}
+
+void mtp_scrub_to(double positionSec) {
+    gScrub.moveTo(positionSec);
+}
+
+void mtp_scrub_end(void) {
+    gScrub.end();
+}
+
+} // extern "C"
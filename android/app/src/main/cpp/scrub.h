@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "engine_shared.h"
+
+// Scrub: enquanto o usuário arrasta a waveform, o controle (dart:ffi) manda a
+// posição do dedo em alta taxa e o render toca um varispeed que persegue essa
+// posição (inclusive de ré), com leitura interpolada das mesmas fontes do
+// play, só do que já está na memória (TrackSource::readResident). Parado, o ganho cai a zero; ao soltar, a reprodução normal volta no
+// último alvo com um fade-in curto.
+
+// Velocidade máxima da leitura (em vezes a normal, nos dois sentidos)
+static const double kScrubMaxRate = 4.0;
+// Abaixo desta velocidade o ganho cai linearmente até zero (sem DC nem estalo parado)
+static const double kScrubGateRate = 0.25;
+
+class ScrubControl {
+public:
+    // Lado do controle; um único chamador (UI) e sem espera
+    void begin();
+    // Alvo em segundos da sessão; chamado a cada evento do gesto
+    void moveTo(double positionSec);
+    void end();
+    // Início de sessão: sem scrub
+    void reset();
+
+    // Lado do render
+    bool active() const { return mActive.load(std::memory_order_acquire); }
+    // Alvo atual; < 0 = nenhum ainda (segura a posição onde o scrub começou)
+    double targetSec() const { return mTargetSec.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<bool> mActive{false};
+    std::atomic<double> mTargetSec{-1.0};
+};
+
+extern ScrubControl gScrub;
+
+// Movimento da leitura no render: posição fracionária e velocidade que
+// perseguem o alvo, amaciadas bloco a bloco. Só o thread de escrita usa.
+class ScrubMotion {
+public:
+    void start(int64_t positionFrame);
+    // Posição de leitura (frames da sessão) e ganho de cada frame do bloco.
+    // `release` = último bloco: o ganho vai a zero até o fim dele.
+    void render(double targetFrame, bool release, int frames, double* pos, float* gain);
+    double position() const { return mPos; }
+
+private:
+    double mPos = 0.0;
+    double mRate = 0.0;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Segundos da sessão. begin/end delimitam o gesto; to() pode ser chamado a
+// cada evento de ponteiro (só grava o alvo).
+MTP_EXPORT void mtp_scrub_begin(void);
+MTP_EXPORT void mtp_scrub_to(double positionSec);
+MTP_EXPORT void mtp_scrub_end(void);
+
+#ifdef __cplusplus
+}
+#endif
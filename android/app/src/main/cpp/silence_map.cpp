@@ -0,0 +1,153 @@
+#include "silence_map.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "file_probe.h"
+#include "thread_topology.h"
+#include "track_source.h"
+
+// Leitura de montagem: limitada pelo disco, poucos threads bastam
+static const int kMaxBuildThreads = 2;
+static const int kBuildChunkFrames = 4096;
+
+SilenceMap::SilenceMap(int64_t frames, std::vector<uint64_t> active)
+    : mFrames(std::max<int64_t>(0, frames)), mActive(std::move(active)) {
+    mActive.resize(wordCount(mFrames), 0);
+}
+
+size_t SilenceMap::wordCount(int64_t frames) {
+    const int64_t blocks = (std::max<int64_t>(0, frames) + kSilenceBlockFrames - 1) / kSilenceBlockFrames;
+    return (size_t)((blocks + 63) / 64);
+}
+
+bool SilenceMap::silent(int64_t frame, int count) const {
+    if (count <= 0 || frame < 0 || frame + count > mFrames) return false;
+    const int64_t last = (frame + count - 1) / kSilenceBlockFrames;
+    for (int64_t b = frame / kSilenceBlockFrames; b <= last; ++b) {
+        if (blockActive(b)) return false;
+    }
+    return true;
+}
+
+int64_t SilenceMap::silentFramesFrom(int64_t frame) const {
+    if (frame < 0 || frame >= mFrames) return 0;
+    const int64_t blocks = blockCount();
+    int64_t b = frame / kSilenceBlockFrames;
+    while (b < blocks && !blockActive(b)) {
+        // Palavra inteira silenciosa: pula 64 blocos de uma vez
+        if ((b & 63) == 0 && mActive[(size_t)(b >> 6)] == 0) b += 64;
+        else ++b;
+    }
+    return std::max<int64_t>(0, std::min(b * kSilenceBlockFrames, mFrames) - frame);
+}
+
+int64_t SilenceMap::activeFramesFrom(int64_t frame) const {
+    if (frame < 0 || frame >= mFrames) return 0;
+    const int64_t blocks = blockCount();
+    int64_t b = frame / kSilenceBlockFrames;
+    while (b < blocks && blockActive(b)) {
+        if ((b & 63) == 0 && mActive[(size_t)(b >> 6)] == ~0ull) b += 64;
+        else ++b;
+    }
+    return std::max<int64_t>(0, std::min(b * kSilenceBlockFrames, mFrames) - frame);
+}
+
+double SilenceMap::silentFraction() const {
+    const int64_t blocks = blockCount();
+    if (blocks <= 0) return 0.0;
+    int64_t active = 0;
+    for (uint64_t w : mActive) active += __builtin_popcountll(w);
+    return 1.0 - (double)std::min(active, blocks) / (double)blocks;
+}
+
+void SilenceMapBuilder::endFrame() {
+    if (++mBlockFill == kSilenceBlockFrames) {
+        mBlocks.push_back(mBlockPeak > kSilenceThreshold ? 1 : 0);
+        mBlockFill = 0;
+        mBlockPeak = 0.0f;
+    }
+}
+
+void SilenceMapBuilder::add(const Lane8* grp, int lane, int channels, int frames) {
+    for (int f = 0; f < frames; ++f) {
+        for (int c = 0; c < channels; ++c) mBlockPeak = std::max(mBlockPeak, std::fabs(grp[f].v[lane + c]));
+        endFrame();
+    }
+    mFrames += frames;
+}
+
+void SilenceMapBuilder::addInterleaved(const float* frames, int channels, int count) {
+    for (int f = 0; f < count; ++f, frames += channels) {
+        for (int c = 0; c < channels; ++c) mBlockPeak = std::max(mBlockPeak, std::fabs(frames[c]));
+        endFrame();
+    }
+    mFrames += count;
+}
+
+std::shared_ptr<const SilenceMap> SilenceMapBuilder::finish() {
+    if (mBlockFill > 0) {
+        mBlocks.push_back(mBlockPeak > kSilenceThreshold ? 1 : 0);
+        mBlockFill = 0;
+        mBlockPeak = 0.0f;
+    }
+    std::vector<uint64_t> words(SilenceMap::wordCount(mFrames), 0);
+    const size_t n = mBlocks.size();
+    for (size_t b = 0; b < n; ++b) {
+        const bool active = mBlocks[b] || (b > 0 && mBlocks[b - 1]) || (b + 1 < n && mBlocks[b + 1]);
+        if (active) words[b >> 6] |= 1ull << (b & 63);
+    }
+    return std::make_shared<const SilenceMap>(mFrames, std::move(words));
+}
+
+std::shared_ptr<const SilenceMap> silenceMapFor(const std::string &path) {
+    MtpFileProbe probe;
+    if (!probeFile(path, probe)) return nullptr;
+    return gProbeCache.lookupSilence(path, probe.fileSize, probe.mtimeNs);
+}
+
+std::shared_ptr<const SilenceMap> buildSilenceMap(const std::string &path) {
+    MtpFileProbe probe;
+    if (!probeFile(path, probe)) return nullptr;
+    std::unique_ptr<TrackSource> src = openFileTrackSource(path);
+    if (!src) return nullptr;
+    const int channels = src->info().channels;
+    std::vector<Lane8> scratch(kBuildChunkFrames);
+    SilenceMapBuilder builder;
+    for (int got; (got = src->readLanes(scratch.data(), 0, kBuildChunkFrames)) > 0;) {
+        builder.add(scratch.data(), 0, channels, got);
+    }
+    std::shared_ptr<const SilenceMap> map = builder.finish();
+    gProbeCache.storeSilence(path, probe.fileSize, probe.mtimeNs, map);
+    return map;
+}
+
+extern "C" {
+
+int32_t mtp_silence_maps_build(const char* const* paths, int32_t count, float* silentRatio) {
+    if (!paths || count <= 0) return 0;
+    std::atomic<int> next{0};
+    std::atomic<int> built{0};
+    // Análise de fundo; threads criados aqui medem o atraso até rodar
+    auto work = [&](std::chrono::steady_clock::time_point readyAt) {
+        ScopedThreadClass background(ThreadClass::Analysis, readyAt);
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            const std::string path = paths[i] ? paths[i] : "";
+            std::shared_ptr<const SilenceMap> map = silenceMapFor(path);
+            if (!map) map = buildSilenceMap(path);
+            if (map) built.fetch_add(1, std::memory_order_relaxed);
+            if (silentRatio) silentRatio[i] = map ? (float)map->silentFraction() : -1.0f;
+        }
+    };
+    const int hw = std::max(1, (int)std::thread::hardware_concurrency());
+    const int threads = std::min({ kMaxBuildThreads, hw, (int)count });
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(work, std::chrono::steady_clock::now());
+    work(std::chrono::steady_clock::time_point{});
+    for (auto &th : pool) th.join();
+    return built.load();
+}
+
+} // extern "C"
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "engine_shared.h"
+#include "insert_chain.h"
+
+// Mapa de atividade de um stem: 1 bit por bloco de kSilenceBlockFrames frames
+// do arquivo. Um bloco é ativo se alguma amostra dele ou de um bloco vizinho
+// passa de kSilenceThreshold; os vizinhos protegem entradas e finais suaves.
+// Blocos silenciosos não são lidos do disco nem decodificados pelo mixer (a
+// track fica em zeros), e o preload não os carrega. O mapa é montado na
+// importação ou na análise de loudness e guardado no cache de file_probe.
+
+constexpr int kSilenceBlockFrames = 1024;
+// -72 dBFS: abaixo do ruído de qualquer stem gravado
+constexpr float kSilenceThreshold = 0.00025f;
+
+class SilenceMap {
+public:
+    SilenceMap(int64_t frames, std::vector<uint64_t> active);
+
+    int64_t frames() const { return mFrames; }
+    const std::vector<uint64_t>& words() const { return mActive; }
+    // true se todos os blocos de [frame, frame + count) são silenciosos
+    bool silent(int64_t frame, int count) const;
+    // Frames silenciosos seguidos a partir de `frame` (0 se ele é ativo)
+    int64_t silentFramesFrom(int64_t frame) const;
+    // Frames ativos seguidos a partir de `frame` (até o fim do mapa)
+    int64_t activeFramesFrom(int64_t frame) const;
+    // Fração do arquivo em blocos silenciosos (0..1)
+    double silentFraction() const;
+
+    static size_t wordCount(int64_t frames);
+
+private:
+    bool blockActive(int64_t block) const {
+        return (mActive[(size_t)(block >> 6)] >> (block & 63)) & 1u;
+    }
+    int64_t blockCount() const { return (mFrames + kSilenceBlockFrames - 1) / kSilenceBlockFrames; }
+
+    int64_t mFrames = 0;
+    std::vector<uint64_t> mActive;
+};
+
+// Monta o mapa enquanto o arquivo é lido (mixer, análise, importação)
+class SilenceMapBuilder {
+public:
+    void add(const Lane8* grp, int lane, int channels, int frames);
+    // Frames intercalados (importação, direto do arquivo decodificado)
+    void addInterleaved(const float* frames, int channels, int count);
+    std::shared_ptr<const SilenceMap> finish();
+
+private:
+    void endFrame();
+
+    int64_t mFrames = 0;
+    int mBlockFill = 0;
+    float mBlockPeak = 0.0f;
+    std::vector<uint8_t> mBlocks; // pico acima do limiar, por bloco
+};
+
+// Mapa em cache para o arquivo como ele está agora; nullptr se ainda não
+// foi montado ou se o arquivo mudou
+std::shared_ptr<const SilenceMap> silenceMapFor(const std::string &path);
+// Lê o arquivo inteiro e guarda o mapa no cache; nullptr se não for tocável
+std::shared_ptr<const SilenceMap> buildSilenceMap(const std::string &path);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Monta (em paralelo) os mapas que ainda não estão no cache. silentRatio[i],
+// se não for nulo, recebe a fração silenciosa de paths[i] (-1 se não deu).
+// Devolve quantos arquivos têm mapa.
+MTP_EXPORT int32_t mtp_silence_maps_build(const char* const* paths, int32_t count, float* silentRatio);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,752 @@
+#include "song_bundle.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "async_io.h"
+#include "engine_log.h"
+#include "engine_stats.h"
+#include "file_probe.h"
+#include "silence_map.h"
+#include "stem_prefetch.h"
+#include "thread_topology.h"
+
+BundleRegistry gBundleRegistry;
+
+static const char kBundleMagic[4] = { 'M', 'T', 'P', 'B' };
+static const uint32_t kBundleVersion = 1;
+// Caminhos maiores que isso indicam arquivo corrompido
+static const uint32_t kMaxPathBytes = 1 << 16;
+static const uint32_t kMaxBundleStems = 256;
+
+// Frames do stem dentro do chunk (0 depois do fim dele)
+static int framesInChunk(const BundleStem &stem, int64_t chunk) {
+    return (int)std::max<int64_t>(0, std::min<int64_t>(kBundleChunkFrames, stem.frames - chunk * kBundleChunkFrames));
+}
+
+static size_t maskWords(size_t stems) {
+    return (stems + 63) / 64;
+}
+
+static int64_t alignUp(int64_t v) {
+    return (v + kBundleAlign - 1) / kBundleAlign * kBundleAlign;
+}
+
+template <typename T>
+static bool readValue(FILE* f, T &v) {
+    return std::fread(&v, sizeof(T), 1, f) == 1;
+}
+
+template <typename T>
+static bool writeValue(FILE* f, const T &v) {
+    return std::fwrite(&v, sizeof(T), 1, f) == 1;
+}
+
+static bool writeHeader(FILE* f, const std::vector<BundleStem> &stems, uint64_t chunkCount, uint64_t indexOffset) {
+    const uint32_t stemCount = (uint32_t)stems.size();
+    const uint32_t chunkFrames = kBundleChunkFrames;
+    bool ok = std::fwrite(kBundleMagic, 1, 4, f) == 4 && writeValue(f, kBundleVersion) &&
+              writeValue(f, stemCount) && writeValue(f, chunkFrames) &&
+              writeValue(f, chunkCount) && writeValue(f, indexOffset);
+    for (size_t i = 0; ok && i < stems.size(); ++i) {
+        const BundleStem &s = stems[i];
+        const uint32_t len = (uint32_t)s.path.size();
+        const int32_t fmt[4] = { s.info.sampleRate, s.info.channels, s.info.bitsPerSample, s.info.audioFormat };
+        ok = writeValue(f, len) && std::fwrite(s.path.data(), 1, len, f) == len &&
+             writeValue(f, s.fileSize) && writeValue(f, s.mtimeNs) &&
+             std::fwrite(fmt, sizeof(int32_t), 4, f) == 4 && writeValue(f, s.frames);
+    }
+    return ok;
+}
+
+std::shared_ptr<const SongBundle> SongBundle::open(const std::string &file) {
+    FILE* f = std::fopen(file.c_str(), "rb");
+    if (!f) return nullptr;
+    std::shared_ptr<SongBundle> b(new SongBundle());
+    b->mFile = file;
+    char magic[4];
+    uint32_t version = 0, stemCount = 0, chunkFrames = 0;
+    uint64_t chunkCount = 0, indexOffset = 0;
+    bool ok = std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, kBundleMagic, 4) == 0 &&
+              readValue(f, version) && version == kBundleVersion &&
+              readValue(f, stemCount) && stemCount > 0 && stemCount <= kMaxBundleStems &&
+              readValue(f, chunkFrames) && chunkFrames == (uint32_t)kBundleChunkFrames &&
+              readValue(f, chunkCount) && readValue(f, indexOffset);
+    for (uint32_t i = 0; ok && i < stemCount; ++i) {
+        BundleStem s;
+        uint32_t len = 0;
+        int32_t fmt[4];
+        ok = readValue(f, len) && len > 0 && len <= kMaxPathBytes;
+        if (!ok) break;
+        s.path.resize(len);
+        ok = std::fread(&s.path[0], 1, len, f) == len && readValue(f, s.fileSize) && readValue(f, s.mtimeNs) &&
+             std::fread(fmt, sizeof(int32_t), 4, f) == 4 && readValue(f, s.frames) && s.frames >= 0;
+        if (!ok) break;
+        s.info.sampleRate = fmt[0];
+        s.info.channels = fmt[1];
+        s.info.bitsPerSample = fmt[2];
+        s.info.audioFormat = fmt[3];
+        s.frameBytes = s.info.channels * (s.info.bitsPerSample / 8);
+        s.info.dataOffset = 0;
+        s.info.dataSize = (size_t)s.frames * (size_t)s.frameBytes;
+        ok = isMixablePcm(s.info);
+        b->mStems.push_back(std::move(s));
+    }
+    // Índice: offset e tamanho de cada chunk e os stems presentes nele
+    const size_t words = maskWords(stemCount);
+    int64_t framesMax = 0;
+    for (const auto &s : b->mStems) framesMax = std::max(framesMax, s.frames);
+    ok = ok && chunkCount == (uint64_t)((framesMax + kBundleChunkFrames - 1) / kBundleChunkFrames) &&
+         fseeko(f, (off_t)indexOffset, SEEK_SET) == 0;
+    if (ok) {
+        b->mChunkOffsets.resize((size_t)chunkCount);
+        b->mChunkBytes.resize((size_t)chunkCount);
+        b->mSlots.assign((size_t)chunkCount * stemCount, -1);
+    }
+    std::vector<uint64_t> mask(words);
+    for (uint64_t c = 0; ok && c < chunkCount; ++c) {
+        int64_t offset = 0;
+        uint32_t bytes = 0, reserved = 0;
+        ok = readValue(f, offset) && readValue(f, bytes) && readValue(f, reserved) &&
+             std::fread(mask.data(), sizeof(uint64_t), words, f) == words &&
+             offset >= 0 && (uint64_t)offset + bytes <= indexOffset;
+        int64_t at = 0;
+        for (uint32_t s = 0; ok && s < stemCount; ++s) {
+            if (!((mask[s >> 6] >> (s & 63)) & 1u)) continue;
+            b->mSlots[(size_t)c * stemCount + s] = at;
+            at += (int64_t)framesInChunk(b->mStems[s], (int64_t)c) * b->mStems[s].frameBytes;
+        }
+        ok = ok && at == (int64_t)bytes;
+        if (!ok) break;
+        b->mChunkOffsets[(size_t)c] = offset;
+        b->mChunkBytes[(size_t)c] = bytes;
+        b->mMaxChunkBytes = std::max(b->mMaxChunkBytes, bytes);
+    }
+    std::fclose(f);
+    return ok ? b : nullptr;
+}
+
+int SongBundle::stemIndex(const std::string &path) const {
+    for (size_t i = 0; i < mStems.size(); ++i) {
+        if (mStems[i].path == path) return (int)i;
+    }
+    return -1;
+}
+
+bool SongBundle::upToDate() const {
+    for (const auto &s : mStems) {
+        MtpFileProbe probe;
+        if (!probeFile(s.path, probe) || probe.fileSize != s.fileSize || probe.mtimeNs != s.mtimeNs) return false;
+    }
+    return true;
+}
+
+void BundleRegistry::add(std::shared_ptr<const SongBundle> bundle) {
+    if (!bundle) return;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBundles.erase(std::remove_if(mBundles.begin(), mBundles.end(),
+                                  [&](const std::shared_ptr<const SongBundle> &b) { return b->file() == bundle->file(); }),
+                   mBundles.end());
+    mBundles.push_back(std::move(bundle));
+}
+
+bool BundleRegistry::remove(const std::string &file) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const size_t before = mBundles.size();
+    mBundles.erase(std::remove_if(mBundles.begin(), mBundles.end(),
+                                  [&](const std::shared_ptr<const SongBundle> &b) { return b->file() == file; }),
+                   mBundles.end());
+    return mBundles.size() != before;
+}
+
+std::shared_ptr<const SongBundle> BundleRegistry::find(const std::vector<std::string> &paths) {
+    if (paths.empty()) return nullptr;
+    std::vector<std::shared_ptr<const SongBundle>> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto &b : mBundles) {
+            bool all = true;
+            for (const auto &p : paths) {
+                if (b->stemIndex(p) < 0) { all = false; break; }
+            }
+            if (all) candidates.push_back(b);
+        }
+    }
+    // O mais novo primeiro; stat dos stems fora do lock
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+        if ((*it)->upToDate()) return *it;
+    }
+    return nullptr;
+}
+
+namespace {
+
+// Chunks à frente da posição que o Io do pacote mantém lidos (~0,7 s a 48 kHz)
+static const int kBundleAhead = 8;
+// Chunks lidos a partir do cue: o salto para perto do fim de um chunk ainda
+// tem um chunk inteiro pela frente
+static const int kBundleCueChunks = 2;
+// Chunks mantidos atrás de `want`: no scrub, lidos para a ré; fora dele só o
+// anterior fica, para a primeira track que vira o chunk não tirá-lo das
+// outras no mesmo bloco
+static const int kBundleScrubBehind = 2;
+static const int kBundleSlots = kBundleAhead + kBundleCueChunks + kBundleScrubBehind;
+// Espera do primeiro chunk na abertura (fora do render)
+static const auto kBundleFirstChunkWait = std::chrono::milliseconds(500);
+// Pool de pread do AsyncIo do pacote (quando não é io_uring)
+static const int kBundleIoThreads = 2;
+// Com leituras em voo o Io também confere as conclusões neste intervalo
+static const auto kBundleReapInterval = std::chrono::milliseconds(2);
+
+// Estados de um slot do anel. FREE e PENDING são do thread Io; READY é
+// publicado por ele (release). As tracks seguram um slot READY pelo contador
+// `readers`; o Io só recicla com o contador travado em -1 (CAS de 0).
+enum BundleSlotState : int { BUNDLE_FREE = 0, BUNDLE_PENDING, BUNDLE_READY };
+
+struct BundleSlot {
+    std::atomic<int> state{BUNDLE_FREE};
+    std::atomic<int64_t> index{-1};
+    std::atomic<int> readers{0};
+    bool ok = false; // leitura completa, publicado junto com READY
+    AlignedBuffer data;
+};
+
+// Leitura compartilhada pelas tracks de uma sessão. Um thread Io do pacote
+// pede os chunks inteiros (todas as tracks) que faltam à frente da posição e
+// no cue num lote só ao AsyncIo (io_uring no host Linux, pool de pread no
+// Android), em um anel fixo de buffers alinhados; o render só pega chunks
+// prontos e nunca lê disco nem aloca. Chunk que não chegou a tempo vira silêncio e conta um
+// miss nas stats.
+class BundleStream {
+public:
+    explicit BundleStream(std::shared_ptr<const SongBundle> bundle) : mBundle(std::move(bundle)) {
+        mFd = ::open(mBundle->file().c_str(), O_RDONLY | O_CLOEXEC);
+        if (mFd < 0) return;
+        for (int i = 0; i < kBundleSlots; ++i) {
+            mSlots[i].data = allocAligned(std::max<size_t>(1, mBundle->maxChunkBytes()));
+            if (!mSlots[i].data) {
+                close(mFd);
+                mFd = -1;
+                return;
+            }
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        mThread = std::thread([this]() { ioLoop(); });
+    }
+
+    ~BundleStream() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWake.notify_one();
+        if (mThread.joinable()) mThread.join();
+        if (mFd >= 0) close(mFd);
+    }
+
+    bool ok() const { return mFd >= 0; }
+    const SongBundle& bundle() const { return *mBundle; }
+
+    // Render: slot pronto com o chunk `index` (seguro até release) ou nullptr
+    BundleSlot* acquire(int64_t index) {
+        for (BundleSlot &slot : mSlots) {
+            if (slot.state.load(std::memory_order_acquire) != BUNDLE_READY ||
+                slot.index.load(std::memory_order_relaxed) != index) continue;
+            int r = slot.readers.load();
+            while (r >= 0 && !slot.readers.compare_exchange_weak(r, r + 1)) {}
+            if (r < 0) continue; // sendo reciclado
+            // O slot pode ter sido reciclado entre a conferência e o contador
+            if (slot.state.load(std::memory_order_acquire) == BUNDLE_READY &&
+                slot.index.load(std::memory_order_relaxed) == index) return &slot;
+            slot.readers.fetch_sub(1);
+        }
+        return nullptr;
+    }
+
+    void release(BundleSlot* slot) {
+        if (slot) slot->readers.fetch_sub(1);
+    }
+
+    // Render: chunk lido agora e chunk do cue (-1 = nenhum); acordam o Io
+    void follow(int64_t index) {
+        if (mWant.load(std::memory_order_relaxed) == index) return;
+        mWant.store(index, std::memory_order_release);
+        wakeIo();
+    }
+
+    void cue(int64_t index) {
+        if (mCue.load(std::memory_order_relaxed) == index) return;
+        mCue.store(index, std::memory_order_release);
+        wakeIo();
+    }
+
+    // Render: liga ou desliga a leitura dos chunks de trás (scrub)
+    void scrubbing(bool on) {
+        const int behind = on ? kBundleScrubBehind : 0;
+        if (mBehind.load(std::memory_order_relaxed) == behind) return;
+        mBehind.store(behind, std::memory_order_release);
+        wakeIo();
+    }
+
+    // Fora do render: espera o chunk da posição atual (início do play)
+    bool waitReady(int64_t index, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mReady.wait_for(lock, timeout, [&]() {
+            for (const BundleSlot &slot : mSlots) {
+                if (slot.state.load(std::memory_order_acquire) == BUNDLE_READY &&
+                    slot.index.load(std::memory_order_relaxed) == index) return true;
+            }
+            return false;
+        });
+    }
+
+private:
+    // No render não trava nada a menos que o Io esteja dormindo (como no RenderPool)
+    void wakeIo() {
+        mWakeSeq.fetch_add(1);
+        if (mIdle.exchange(false)) {
+            mWokenAt.store(std::chrono::steady_clock::now().time_since_epoch().count());
+            std::lock_guard<std::mutex> lock(mMutex);
+            mWake.notify_one();
+        }
+    }
+
+    bool inWindow(int64_t k, int64_t want, int64_t cue, int behind) const {
+        return (k >= want - std::max(1, behind) && k < want + kBundleAhead) || (cue >= 0 && k >= cue && k < cue + kBundleCueChunks);
+    }
+
+    bool present(int64_t k) const {
+        for (const BundleSlot &slot : mSlots) {
+            if (slot.state.load(std::memory_order_relaxed) != BUNDLE_FREE &&
+                slot.index.load(std::memory_order_relaxed) == k) return true;
+        }
+        return false;
+    }
+
+    // Pedidos dos chunks que faltam: o de agora, os do cue, os de trás (scrub)
+    // e o resto da janela, nessa ordem. Devolve quantos ficaram prontos sem
+    // leitura (chunk todo em silêncio).
+    int plan(int64_t want, int64_t cue, int behind, std::vector<IoRequest> &batch) {
+        int64_t order[kBundleSlots];
+        int count = 0;
+        order[count++] = want;
+        for (int j = 0; j < kBundleCueChunks; ++j) order[count++] = cue >= 0 ? cue + j : -1;
+        for (int j = 1; j <= behind; ++j) order[count++] = want - j;
+        for (int j = 1; j < kBundleAhead; ++j) order[count++] = want + j;
+        int ready = 0;
+        for (int i = 0; i < count; ++i) {
+            const int64_t k = order[i];
+            if (k < 0 || k >= mBundle->chunkCount() || present(k)) continue;
+            BundleSlot* free = nullptr;
+            for (BundleSlot &slot : mSlots) {
+                if (slot.state.load(std::memory_order_relaxed) == BUNDLE_FREE) {
+                    free = &slot;
+                    break;
+                }
+            }
+            if (!free) break;
+            free->index.store(k, std::memory_order_relaxed);
+            const uint32_t bytes = mBundle->chunkBytes(k);
+            if (bytes == 0) {
+                // Chunk todo em silêncio: nada a ler
+                free->ok = true;
+                free->state.store(BUNDLE_READY, std::memory_order_release);
+                ++ready;
+                continue;
+            }
+            free->state.store(BUNDLE_PENDING, std::memory_order_relaxed);
+            IoRequest r;
+            r.fd = mFd;
+            r.offset = mBundle->chunkOffset(k);
+            r.buffer = free->data.get();
+            r.bytes = bytes;
+            r.tag = (uint64_t)(uintptr_t)free;
+            batch.push_back(r);
+        }
+        return ready;
+    }
+
+    void complete(const IoCompletion &c) {
+        BundleSlot* slot = reinterpret_cast<BundleSlot*>((uintptr_t)c.tag);
+        slot->ok = c.result == (int32_t)mBundle->chunkBytes(slot->index.load(std::memory_order_relaxed));
+        slot->state.store(BUNDLE_READY, std::memory_order_release);
+    }
+
+    void ioLoop() {
+        setCurrentThreadClass(ThreadClass::Io);
+        std::unique_ptr<AsyncIo> io =
+            AsyncIo::create(kBundleSlots, kBundleIoThreads, gStemPrefetcher.config().allowUring);
+        std::vector<IoRequest> batch;
+        IoCompletion done[kBundleSlots];
+        for (;;) {
+            // Aviso que chegar depois daqui não se perde: o sono abaixo compara
+            const uint64_t seen = mWakeSeq.load();
+            // cue antes de want: o render grava want e depois solta o cue
+            const int64_t cue = mCue.load(std::memory_order_acquire);
+            const int64_t want = mWant.load(std::memory_order_acquire);
+            const int behind = mBehind.load(std::memory_order_acquire);
+            for (BundleSlot &slot : mSlots) {
+                if (slot.state.load(std::memory_order_relaxed) != BUNDLE_READY ||
+                    inWindow(slot.index.load(std::memory_order_relaxed), want, cue, behind)) continue;
+                int idle = 0;
+                if (!slot.readers.compare_exchange_strong(idle, -1)) continue; // track ainda lendo
+                slot.state.store(BUNDLE_FREE, std::memory_order_relaxed);
+                slot.index.store(-1, std::memory_order_relaxed);
+                slot.readers.store(0);
+            }
+
+            batch.clear();
+            const int ready = plan(want, cue, behind, batch);
+            const int submitted = batch.empty() ? 0 : io->submit(batch.data(), (int)batch.size());
+            // Pedido que não entrou na fila volta a FREE e sai no próximo lote
+            for (size_t i = (size_t)submitted; i < batch.size(); ++i) {
+                BundleSlot* slot = reinterpret_cast<BundleSlot*>((uintptr_t)batch[i].tag);
+                slot->index.store(-1, std::memory_order_relaxed);
+                slot->state.store(BUNDLE_FREE, std::memory_order_relaxed);
+            }
+            const int reaped = io->reap(done, kBundleSlots, false);
+            for (int i = 0; i < reaped; ++i) complete(done[i]);
+            if (reaped > 0 || ready > 0) {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mReady.notify_all();
+            }
+            if (submitted > 0 || reaped > 0 || ready > 0) continue;
+
+            // Dorme até o render mudar de chunk, marcar um cue ou soltar um
+            // slot, ou (com leituras em voo) a hora de conferir as conclusões
+            const auto wake = [&]() { return mStop || mWakeSeq.load() != seen; };
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (mStop) break;
+            mWokenAt.store(0);
+            mIdle.store(true);
+            if (io->inFlight() > 0) {
+                mWake.wait_for(lock, kBundleReapInterval, wake);
+            } else {
+                mWake.wait(lock, wake);
+            }
+            mIdle.store(false);
+            const int64_t wokenAt = mWokenAt.load();
+            lock.unlock();
+            if (wokenAt != 0) {
+                recordThreadWake(ThreadClass::Io, std::chrono::steady_clock::time_point(
+                                                      std::chrono::steady_clock::duration(wokenAt)));
+            }
+        }
+        // Os buffers precisam estar vivos até a última leitura em voo voltar
+        while (io->inFlight() > 0) {
+            const int n = io->reap(done, kBundleSlots, true);
+            for (int i = 0; i < n; ++i) complete(done[i]);
+        }
+    }
+
+    std::shared_ptr<const SongBundle> mBundle;
+    int mFd = -1;
+    BundleSlot mSlots[kBundleSlots];
+    std::atomic<int64_t> mWant{0};
+    std::atomic<int64_t> mCue{-1};
+    std::atomic<int> mBehind{0};
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mReady;
+    bool mStop = false;
+    std::atomic<uint64_t> mWakeSeq{0};
+    std::atomic<bool> mIdle{false};
+    std::atomic<int64_t> mWokenAt{0}; // steady_clock do aviso que acordou o Io
+    std::thread mThread;
+};
+
+class BundleTrackSource : public TrackSource {
+public:
+    BundleTrackSource(std::shared_ptr<BundleStream> stream, int stem)
+        : mStream(std::move(stream)), mStem(stem) {
+        const BundleStem &s = mStream->bundle().stems()[(size_t)stem];
+        mInfo = s.info;
+        mFrames = s.frames;
+        mFrameBytes = s.frameBytes;
+    }
+
+    ~BundleTrackSource() override { drop(); }
+
+    int readLanes(Lane8* grp, int lane, int frames) override {
+        mLastSilent = false;
+        if (mScrubbing) {
+            mScrubbing = false;
+            mStream->scrubbing(false);
+        }
+        const int n = (int)std::max<int64_t>(0, std::min<int64_t>(frames, mFrames - mPos));
+        if (n <= 0) {
+            // Fim da track: o chunk volta para o anel
+            drop();
+            return 0;
+        }
+        if (skipSilent(grp, lane, mPos, n)) {
+            mPos += n;
+            mStream->follow(mPos / kBundleChunkFrames);
+            mLastSilent = true;
+            return n;
+        }
+        const SongBundle &bundle = mStream->bundle();
+        int done = 0;
+        bool missed = false;
+        while (done < n) {
+            const int64_t index = mPos / kBundleChunkFrames;
+            const int within = (int)(mPos - index * kBundleChunkFrames);
+            const int m = std::min(n - done, kBundleChunkFrames - within);
+            const int64_t slot = bundle.slot(index, mStem);
+            if (!mSlot || mSlot->index.load(std::memory_order_relaxed) != index) {
+                drop();
+                mStream->follow(index);
+                // Trecho em silêncio no pacote: nada a esperar
+                if (slot >= 0) mSlot = mStream->acquire(index);
+            }
+            if (mSlot && !mSlot->ok) break; // erro de leitura: a track termina aqui
+            if (slot < 0 || !mSlot) {
+                missed = missed || slot >= 0;
+                for (int f = 0; f < m; ++f) {
+                    for (int c = 0; c < mInfo.channels; ++c) grp[done + f].v[lane + c] = 0.0f;
+                }
+            } else {
+                decodePcmToLanes(mSlot->data.get() + slot + (int64_t)within * mFrameBytes,
+                                 mInfo.bitsPerSample / 8, mInfo.channels, grp + done, lane, m);
+            }
+            done += m;
+            mPos += m;
+        }
+        if (missed) gEngineStats.streamIoMisses.fetch_add(1, std::memory_order_relaxed);
+        return done;
+    }
+
+    void seekFrame(int64_t frame) override {
+        mPos = std::max<int64_t>(0, std::min(frame, mFrames));
+        mStream->follow(mPos / kBundleChunkFrames);
+    }
+
+    bool inMemory() const override { return false; }
+
+    // Como readLanes, mas o chunk que não chegou encerra (sem contar miss:
+    // quem chama conta)
+    int readResident(Lane8* grp, int lane, int64_t frame, int frames) override {
+        mLastSilent = false;
+        if (!mScrubbing) {
+            mScrubbing = true;
+            mStream->scrubbing(true);
+        }
+        mPos = std::max<int64_t>(0, std::min(frame, mFrames));
+        mStream->follow(mPos / kBundleChunkFrames);
+        const int n = (int)std::max<int64_t>(0, std::min<int64_t>(frames, mFrames - mPos));
+        if (n <= 0) return 0;
+        if (skipSilent(grp, lane, mPos, n)) {
+            mPos += n;
+            mLastSilent = true;
+            return n;
+        }
+        const SongBundle &bundle = mStream->bundle();
+        int done = 0;
+        while (done < n) {
+            const int64_t index = mPos / kBundleChunkFrames;
+            const int within = (int)(mPos - index * kBundleChunkFrames);
+            const int m = std::min(n - done, kBundleChunkFrames - within);
+            const int64_t slot = bundle.slot(index, mStem);
+            if (!mSlot || mSlot->index.load(std::memory_order_relaxed) != index) {
+                drop();
+                mStream->follow(index);
+                if (slot >= 0) mSlot = mStream->acquire(index);
+            }
+            if (slot < 0) {
+                for (int f = 0; f < m; ++f) {
+                    for (int c = 0; c < mInfo.channels; ++c) grp[done + f].v[lane + c] = 0.0f;
+                }
+            } else if (mSlot && mSlot->ok) {
+                decodePcmToLanes(mSlot->data.get() + slot + (int64_t)within * mFrameBytes,
+                                 mInfo.bitsPerSample / 8, mInfo.channels, grp + done, lane, m);
+            } else {
+                break;
+            }
+            done += m;
+            mPos += m;
+        }
+        return done;
+    }
+
+    void scrubCue(int64_t frame) override { cueFrame(frame); }
+
+    // O Io lê o chunk do destino junto com a janela atual; as outras tracks
+    // da sessão marcam o mesmo chunk
+    void cueFrame(int64_t frame) override {
+        mCueFrame = std::max<int64_t>(0, std::min(frame, mFrames));
+        mStream->cue(mCueFrame / kBundleChunkFrames);
+    }
+
+    void jumpToCue() override {
+        if (mCueFrame < 0) return;
+        mPos = mCueFrame;
+        mCueFrame = -1;
+        // Janela nova antes de soltar o cue: o Io nunca vê o chunk fora dos dois
+        mStream->follow(mPos / kBundleChunkFrames);
+        mStream->cue(-1);
+    }
+
+private:
+    void drop() {
+        mStream->release(mSlot);
+        mSlot = nullptr;
+    }
+
+    std::shared_ptr<BundleStream> mStream;
+    int mStem = 0;
+    int64_t mFrames = 0;
+    int mFrameBytes = 0;
+    int64_t mPos = 0;
+    BundleSlot* mSlot = nullptr; // seguro (readers) enquanto for nosso
+    bool mScrubbing = false;
+};
+
+} // namespace
+
+std::vector<std::unique_ptr<TrackSource>> openBundleTrackSources(const std::vector<std::string> &paths) {
+    std::vector<std::unique_ptr<TrackSource>> sources;
+    std::shared_ptr<const SongBundle> bundle = gBundleRegistry.find(paths);
+    if (!bundle) return sources;
+    auto stream = std::make_shared<BundleStream>(bundle);
+    if (!stream->ok()) return sources;
+    // O primeiro chunk já lido: o play começa sem miss
+    if (bundle->chunkCount() > 0 && !stream->waitReady(0, kBundleFirstChunkWait)) {
+        LOGE("bundle: first chunk of %s not ready", bundle->file().c_str());
+    }
+    for (const auto &p : paths) {
+        sources.emplace_back(new BundleTrackSource(stream, bundle->stemIndex(p)));
+    }
+    return sources;
+}
+
+static bool buildBundle(const std::string &file, const std::vector<std::string> &paths) {
+    if (file.empty() || paths.empty() || paths.size() > kMaxBundleStems) return false;
+    std::vector<BundleStem> stems;
+    std::vector<std::unique_ptr<std::ifstream>> inputs;
+    std::vector<std::shared_ptr<const SilenceMap>> silence;
+    std::vector<size_t> dataOffsets;
+    int64_t framesMax = 0;
+    for (const auto &path : paths) {
+        MtpFileProbe probe;
+        if (!probeFile(path, probe)) return false;
+        BundleStem s;
+        s.path = path;
+        s.fileSize = probe.fileSize;
+        s.mtimeNs = probe.mtimeNs;
+        s.info.sampleRate = probe.sampleRate;
+        s.info.channels = probe.channels;
+        s.info.bitsPerSample = probe.bitsPerSample;
+        s.info.audioFormat = probe.audioFormat;
+        s.frames = probe.frames;
+        s.frameBytes = probe.channels * (probe.bitsPerSample / 8);
+        s.info.dataOffset = 0;
+        s.info.dataSize = (size_t)s.frames * (size_t)s.frameBytes;
+        if (!isMixablePcm(s.info)) return false;
+        if (!stems.empty() && s.info.sampleRate != stems[0].info.sampleRate) return false;
+        std::unique_ptr<std::ifstream> in(new std::ifstream(path, std::ios::binary));
+        if (!in->is_open()) return false;
+        framesMax = std::max(framesMax, s.frames);
+        dataOffsets.push_back((size_t)probe.dataOffset);
+        silence.push_back(silenceMapFor(path));
+        inputs.push_back(std::move(in));
+        stems.push_back(std::move(s));
+    }
+    const uint64_t chunkCount = (uint64_t)((framesMax + kBundleChunkFrames - 1) / kBundleChunkFrames);
+    const size_t words = maskWords(stems.size());
+
+    // Temporário + rename: um pacote pela metade nunca é aberto
+    const std::string tmp = file + ".tmp";
+    FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out) return false;
+    bool ok = writeHeader(out, stems, chunkCount, 0);
+    int64_t pos = ok ? alignUp((int64_t)ftello(out)) : 0;
+    ok = ok && fseeko(out, (off_t)pos, SEEK_SET) == 0;
+
+    std::vector<int64_t> offsets((size_t)chunkCount, 0);
+    std::vector<uint32_t> sizes((size_t)chunkCount, 0);
+    std::vector<uint64_t> masks((size_t)chunkCount * words, 0);
+    std::vector<uint8_t> chunk;
+    for (uint64_t c = 0; ok && c < chunkCount; ++c) {
+        chunk.clear();
+        const int64_t first = (int64_t)c * kBundleChunkFrames;
+        for (size_t s = 0; ok && s < stems.size(); ++s) {
+            const int n = framesInChunk(stems[s], (int64_t)c);
+            if (n <= 0 || (silence[s] && silence[s]->silent(first, n))) continue;
+            const size_t bytes = (size_t)n * stems[s].frameBytes;
+            const size_t at = chunk.size();
+            chunk.resize(at + bytes);
+            std::ifstream &in = *inputs[s];
+            in.seekg((std::streamoff)(dataOffsets[s] + (size_t)first * stems[s].frameBytes), std::ios::beg);
+            in.read(reinterpret_cast<char*>(chunk.data() + at), (std::streamsize)bytes);
+            ok = (size_t)in.gcount() == bytes;
+            masks[(size_t)c * words + (s >> 6)] |= 1ull << (s & 63);
+        }
+        offsets[(size_t)c] = pos;
+        sizes[(size_t)c] = (uint32_t)chunk.size();
+        if (!ok || chunk.empty()) continue;
+        chunk.resize((size_t)alignUp((int64_t)chunk.size()), 0);
+        ok = std::fwrite(chunk.data(), 1, chunk.size(), out) == chunk.size();
+        pos += (int64_t)chunk.size();
+    }
+    // Índice no fim; o cabeçalho é regravado com o offset dele
+    const uint64_t indexOffset = (uint64_t)pos;
+    const uint32_t reserved = 0;
+    for (uint64_t c = 0; ok && c < chunkCount; ++c) {
+        ok = writeValue(out, offsets[(size_t)c]) && writeValue(out, sizes[(size_t)c]) && writeValue(out, reserved) &&
+             std::fwrite(&masks[(size_t)c * words], sizeof(uint64_t), words, out) == words;
+    }
+    ok = ok && fseeko(out, 0, SEEK_SET) == 0 && writeHeader(out, stems, chunkCount, indexOffset);
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+extern "C" {
+
+int32_t mtp_bundle_build(const char* file, const char* const* paths, int32_t count) {
+    if (!file || !paths || count <= 0) return 0;
+    ScopedThreadClass background(ThreadClass::Analysis);
+    std::vector<std::string> list;
+    for (int32_t i = 0; i < count; ++i) {
+        if (!paths[i]) return 0;
+        list.emplace_back(paths[i]);
+    }
+    if (!buildBundle(file, list)) return 0;
+    std::shared_ptr<const SongBundle> bundle = SongBundle::open(file);
+    if (!bundle) return 0;
+    gBundleRegistry.add(std::move(bundle));
+    return 1;
+}
+
+int32_t mtp_bundle_open(const char* file, const char* const* paths, int32_t count) {
+    if (!file || !paths || count <= 0) return 0;
+    std::shared_ptr<const SongBundle> bundle = SongBundle::open(file);
+    if (!bundle || bundle->stems().size() != (size_t)count) return 0;
+    for (int32_t i = 0; i < count; ++i) {
+        if (!paths[i] || bundle->stemIndex(paths[i]) < 0) return 0;
+    }
+    if (!bundle->upToDate()) return 0;
+    gBundleRegistry.add(std::move(bundle));
+    return 1;
+}
+
+int32_t mtp_bundle_forget(const char* file) {
+    return file && gBundleRegistry.remove(file) ? 1 : 0;
+}
+
+} // extern "C"
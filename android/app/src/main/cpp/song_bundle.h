@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "engine_shared.h"
+#include "track_source.h"
+
+// Pacote de música (.mtpb): todos os stems de uma música num arquivo só,
+// intercalados em chunks de kBundleChunkFrames frames alinhados em
+// kBundleAlign bytes. No play, um chunk inteiro (todas as tracks) vem numa
+// leitura sequencial grande, em vez de uma leitura pequena por stem a cada
+// bloco, feita adiantada por um thread Io do pacote (o render só pega chunks
+// já lidos). Cada stem mantém o formato empacotado do WAV. Trechos silenciosos no
+// mapa de silêncio ficam fora do chunk. Um índice no fim do arquivo guarda o
+// offset de cada chunk e quais stems estão nele.
+//
+// O pacote é uma cópia: os WAVs continuam sendo a fonte (editor, análise).
+// Ele só é usado se cada stem ainda tiver o tamanho e o mtime da montagem.
+
+constexpr int kBundleChunkFrames = 4096;
+constexpr int kBundleAlign = 4096;
+
+struct BundleStem {
+    std::string path;
+    int64_t fileSize = 0;
+    int64_t mtimeNs = 0;
+    WavInfo info;          // dataOffset 0, dataSize = frames * frameBytes
+    int64_t frames = 0;
+    int frameBytes = 0;
+};
+
+// Cabeçalho e índice de um pacote aberto; imutável
+class SongBundle {
+public:
+    static std::shared_ptr<const SongBundle> open(const std::string &file);
+
+    const std::string& file() const { return mFile; }
+    const std::vector<BundleStem>& stems() const { return mStems; }
+    int64_t chunkCount() const { return (int64_t)mChunkOffsets.size(); }
+    int64_t chunkOffset(int64_t chunk) const { return mChunkOffsets[(size_t)chunk]; }
+    uint32_t chunkBytes(int64_t chunk) const { return mChunkBytes[(size_t)chunk]; }
+    uint32_t maxChunkBytes() const { return mMaxChunkBytes; }
+    // Offset do stem dentro do chunk; -1 se o trecho é silêncio (fora do pacote)
+    int64_t slot(int64_t chunk, int stem) const { return mSlots[(size_t)chunk * mStems.size() + (size_t)stem]; }
+    // Índice do stem com esse caminho; -1 se não está no pacote
+    int stemIndex(const std::string &path) const;
+    // Todos os stems ainda iguais aos WAVs de onde saíram
+    bool upToDate() const;
+
+private:
+    std::string mFile;
+    std::vector<BundleStem> mStems;
+    std::vector<int64_t> mChunkOffsets;
+    std::vector<uint32_t> mChunkBytes;
+    std::vector<int64_t> mSlots; // chunk x stem
+    uint32_t mMaxChunkBytes = 0;
+};
+
+// Pacotes conhecidos pelo engine; o play procura aqui um que contenha
+// todas as tracks pedidas
+class BundleRegistry {
+public:
+    void add(std::shared_ptr<const SongBundle> bundle);
+    bool remove(const std::string &file);
+    std::shared_ptr<const SongBundle> find(const std::vector<std::string> &paths);
+
+private:
+    std::mutex mMutex;
+    std::vector<std::shared_ptr<const SongBundle>> mBundles;
+};
+
+extern BundleRegistry gBundleRegistry;
+
+// Fontes das tracks tocando do mesmo pacote; o chunk é lido uma vez e
+// entregue a todas. Vazio se nenhum pacote atualizado cobre `paths`.
+std::vector<std::unique_ptr<TrackSource>> openBundleTrackSources(const std::vector<std::string> &paths);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Monta o pacote dos stems (PCM tocável, mesma taxa) em `file` e o registra.
+// Devolve 1 se montou.
+MTP_EXPORT int32_t mtp_bundle_build(const char* file, const char* const* paths, int32_t count);
+// Registra um pacote já montado se ele tem exatamente esses stems e nenhum
+// mudou desde a montagem; devolve 1 se registrou (senão é preciso remontar)
+MTP_EXPORT int32_t mtp_bundle_open(const char* file, const char* const* paths, int32_t count);
+// Tira o pacote do registro (ex.: música apagada); 1 se ele estava lá
+MTP_EXPORT int32_t mtp_bundle_forget(const char* file);
+
+#ifdef __cplusplus
+}
+#endif
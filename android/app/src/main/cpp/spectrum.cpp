@@ -0,0 +1,322 @@
+#include "spectrum.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "thread_topology.h"
+
+typedef float f32x8 __attribute__((vector_size(32)));
+
+// ~0,7 s a 48 kHz: folga de sobra para a cópia da janela
+static const size_t kRingFrames = 1 << 15;
+static const float kMinFreqHz = 20.0f;
+static const float kMaxFreqHz = 20000.0f;
+// Queda das bandas e inércia da correlação (por segundo)
+static const float kFallDbPerSec = 24.0f;
+static const float kCorrelationTauSec = 0.3f;
+static const int kMinRateHz = 30;
+static const int kMaxRateHz = 60;
+
+SpectrumAnalyzer gSpectrum;
+
+static inline f32x8 load8(const float* p) {
+    f32x8 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store8(float* p, f32x8 v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+RealFft::RealFft(int size) : mSize(size), mHalf(size / 2) {
+    const double pi = 3.14159265358979323846;
+    int bits = 0;
+    while ((1 << bits) < mHalf) ++bits;
+    mBitrev.resize((size_t)mHalf);
+    for (int n = 0; n < mHalf; ++n) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) r |= ((n >> b) & 1) << (bits - 1 - b);
+        mBitrev[(size_t)n] = r;
+    }
+    // Hann periódica: soma = size / 2
+    mWindow.resize((size_t)mSize);
+    for (int n = 0; n < mSize; ++n) mWindow[(size_t)n] = (float)(0.5 - 0.5 * std::cos(2.0 * pi * n / mSize));
+    mTwRe.assign((size_t)std::max(1, mHalf - 1), 0.0f);
+    mTwIm.assign((size_t)std::max(1, mHalf - 1), 0.0f);
+    for (int h = 1; h < mHalf; h <<= 1) {
+        for (int j = 0; j < h; ++j) {
+            mTwRe[(size_t)(h - 1 + j)] = (float)std::cos(pi * j / h);
+            mTwIm[(size_t)(h - 1 + j)] = (float)-std::sin(pi * j / h);
+        }
+    }
+    mSplitRe.resize((size_t)mHalf + 1);
+    mSplitIm.resize((size_t)mHalf + 1);
+    for (int k = 0; k <= mHalf; ++k) {
+        mSplitRe[(size_t)k] = (float)std::cos(2.0 * pi * k / mSize);
+        mSplitIm[(size_t)k] = (float)-std::sin(2.0 * pi * k / mSize);
+    }
+    mRe.resize((size_t)mHalf);
+    mIm.resize((size_t)mHalf);
+}
+
+void RealFft::power(const float* in, float* power) {
+    const int M = mHalf;
+    float* re = mRe.data();
+    float* im = mIm.data();
+    // Pares de amostras viram um sinal complexo de metade do tamanho
+    for (int n = 0; n < M; ++n) {
+        const int r = mBitrev[(size_t)n];
+        re[r] = in[2 * n] * mWindow[(size_t)(2 * n)];
+        im[r] = in[2 * n + 1] * mWindow[(size_t)(2 * n + 1)];
+    }
+    for (int h = 1; h < M; h <<= 1) {
+        const float* twr = mTwRe.data() + (h - 1);
+        const float* twi = mTwIm.data() + (h - 1);
+        for (int a = 0; a < M; a += 2 * h) {
+            float* ar = re + a;
+            float* ai = im + a;
+            float* br = re + a + h;
+            float* bi = im + a + h;
+            int j = 0;
+            if (h >= 8) {
+                for (; j < h; j += 8) {
+                    const f32x8 wr = load8(twr + j), wi = load8(twi + j);
+                    const f32x8 xr = load8(br + j), xi = load8(bi + j);
+                    const f32x8 tr = xr * wr - xi * wi;
+                    const f32x8 ti = xr * wi + xi * wr;
+                    const f32x8 ur = load8(ar + j), ui = load8(ai + j);
+                    store8(br + j, ur - tr);
+                    store8(bi + j, ui - ti);
+                    store8(ar + j, ur + tr);
+                    store8(ai + j, ui + ti);
+                }
+            }
+            for (; j < h; ++j) {
+                const float tr = br[j] * twr[j] - bi[j] * twi[j];
+                const float ti = br[j] * twi[j] + bi[j] * twr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+    // Desdobra Z[k] no espectro real: X[k] = E[k] + W^k * O[k]
+    for (int k = 0; k <= M; ++k) {
+        const int p = k % M, q = (M - k) % M;
+        const float er = 0.5f * (re[p] + re[q]), ei = 0.5f * (im[p] - im[q]);
+        const float or_ = 0.5f * (im[p] + im[q]), oi = -0.5f * (re[p] - re[q]);
+        const float xr = er + mSplitRe[(size_t)k] * or_ - mSplitIm[(size_t)k] * oi;
+        const float xi = ei + mSplitRe[(size_t)k] * oi + mSplitIm[(size_t)k] * or_;
+        power[k] = xr * xr + xi * xi;
+    }
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    setTap(SPECTRUM_TAP_OFF, 0, 0);
+}
+
+bool SpectrumAnalyzer::setTap(int kind, int index, int rateHz) {
+    if (kind < SPECTRUM_TAP_OFF || kind > SPECTRUM_TAP_TRACK) return false;
+    if (kind == SPECTRUM_TAP_OUTPUT && (index < 0 || index >= MTP_MAX_OUT_CHANNELS)) return false;
+    if (kind == SPECTRUM_TAP_TRACK && (index < 0 || index >= MTP_MAX_TRACKS)) return false;
+    std::lock_guard<std::mutex> lock(mControl);
+    if (kind == SPECTRUM_TAP_OFF) {
+        mKind.store(SPECTRUM_TAP_OFF, std::memory_order_release);
+        if (mThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> wl(mWakeLock);
+                mStop = true;
+            }
+            mWake.notify_all();
+            mThread.join();
+        }
+        return true;
+    }
+    // O ring é alocado uma vez, antes de o render poder escrever nele
+    if (mRing.empty()) {
+        mRing.assign(kRingFrames * 2, 0.0f);
+        mRingMask = kRingFrames - 1;
+    }
+    mRateHz.store(std::max(kMinRateHz, std::min(kMaxRateHz, rateHz)));
+    mIndex.store(index, std::memory_order_relaxed);
+    mTapGeneration.fetch_add(1, std::memory_order_relaxed);
+    mKind.store(kind, std::memory_order_release);
+    if (!mThread.joinable()) {
+        mStop = false;
+        mThread = std::thread([this] { analysisLoop(); });
+    }
+    return true;
+}
+
+int SpectrumAnalyzer::trackTap() const {
+    if (mKind.load(std::memory_order_acquire) != SPECTRUM_TAP_TRACK) return -1;
+    return mIndex.load(std::memory_order_relaxed);
+}
+
+void SpectrumAnalyzer::feedOutput(const float* interleaved, int channels, int frames) {
+    if (mKind.load(std::memory_order_acquire) != SPECTRUM_TAP_OUTPUT || channels <= 0 || frames <= 0) return;
+    const int l = mIndex.load(std::memory_order_relaxed);
+    if (l >= channels) return;
+    const int r = l + 1 < channels ? l + 1 : l;
+    const uint64_t head = mHead.load(std::memory_order_relaxed);
+    for (int f = 0; f < frames; ++f) {
+        float* at = slot(head + (uint64_t)f);
+        at[0] = interleaved[(size_t)f * channels + l];
+        at[1] = interleaved[(size_t)f * channels + r];
+    }
+    mHead.store(head + (uint64_t)frames, std::memory_order_release);
+}
+
+void SpectrumAnalyzer::feedLanes(const Lane8* lanes, int block, int firstLane, int laneCount, int frames) {
+    if (frames <= 0) return;
+    const Lane8* grp = lanes + (size_t)(firstLane / kLaneWidth) * block;
+    const int l = firstLane % kLaneWidth;
+    const int r = laneCount == 2 ? l + 1 : l;
+    const uint64_t head = mHead.load(std::memory_order_relaxed);
+    for (int f = 0; f < frames; ++f) {
+        float* at = slot(head + (uint64_t)f);
+        at[0] = grp[f].v[l];
+        at[1] = grp[f].v[r];
+    }
+    mHead.store(head + (uint64_t)frames, std::memory_order_release);
+}
+
+void SpectrumAnalyzer::rebuildBands(int sampleRate) {
+    const int N = mFft.size();
+    const int M = N / 2;
+    mBandRate = sampleRate;
+    mBandLo.resize(MTP_SPECTRUM_BINS);
+    mBandHi.resize(MTP_SPECTRUM_BINS);
+    mBandPos.resize(MTP_SPECTRUM_BINS);
+    const float ratio = kMaxFreqHz / kMinFreqHz;
+    const float binHz = (float)sampleRate / (float)N;
+    for (int b = 0; b < MTP_SPECTRUM_BINS; ++b) {
+        const float lo = kMinFreqHz * std::pow(ratio, (float)b / MTP_SPECTRUM_BINS);
+        const float hi = kMinFreqHz * std::pow(ratio, (float)(b + 1) / MTP_SPECTRUM_BINS);
+        mBandLo[(size_t)b] = std::min(M + 1, (int)std::ceil(lo / binHz));
+        mBandHi[(size_t)b] = std::min(M, (int)std::ceil(hi / binHz) - 1);
+        mBandPos[(size_t)b] = std::min((float)M, std::sqrt(lo * hi) / binHz);
+    }
+}
+
+void SpectrumAnalyzer::analyze(int sampleRate) {
+    const int N = mFft.size();
+    const int M = N / 2;
+    if (sampleRate != mBandRate) rebuildBands(sampleRate);
+    mFft.power(mL.data(), mPowerL.data());
+    mFft.power(mR.data(), mPowerR.data());
+    // Senoide de pico 1 com Hann: |X| = N / 4 -> 0 dBFS
+    const float norm = 16.0f / ((float)N * (float)N);
+    const float fall = kFallDbPerSec / (float)mRateHz.load(std::memory_order_relaxed);
+    for (int b = 0; b < MTP_SPECTRUM_BINS; ++b) {
+        float p = 0.0f;
+        const int lo = mBandLo[(size_t)b], hi = mBandHi[(size_t)b];
+        if (lo <= hi) {
+            for (int k = lo; k <= hi; ++k) p = std::max(p, 0.5f * (mPowerL[(size_t)k] + mPowerR[(size_t)k]));
+        } else {
+            // Banda mais estreita que um bin (graves): interpola no centro
+            const float pos = mBandPos[(size_t)b];
+            const int k = std::min(M - 1, (int)pos);
+            const float t = pos - (float)k;
+            const float p0 = 0.5f * (mPowerL[(size_t)k] + mPowerR[(size_t)k]);
+            const float p1 = 0.5f * (mPowerL[(size_t)k + 1] + mPowerR[(size_t)k + 1]);
+            p = p0 + (p1 - p0) * t;
+        }
+        const float db = std::max(MTP_SPECTRUM_MIN_DB, 10.0f * std::log10(p * norm + 1e-12f));
+        float& band = mBandDb[(size_t)b];
+        band = std::max(db, band - fall);
+    }
+    double lr = 0.0, ll = 0.0, rr = 0.0;
+    for (int n = 0; n < N; ++n) {
+        lr += (double)mL[(size_t)n] * mR[(size_t)n];
+        ll += (double)mL[(size_t)n] * mL[(size_t)n];
+        rr += (double)mR[(size_t)n] * mR[(size_t)n];
+    }
+    // Silêncio não tem fase: deixa a correlação voltar para 0
+    const float corr = ll > 1e-9 && rr > 1e-9 ? (float)(lr / std::sqrt(ll * rr)) : 0.0f;
+    const float alpha = 1.0f - std::exp(-1.0f / (kCorrelationTauSec * (float)mRateHz.load(std::memory_order_relaxed)));
+    mCorrelation += (corr - mCorrelation) * alpha;
+}
+
+void SpectrumAnalyzer::publish(bool decayOnly) {
+    if (decayOnly) {
+        const float fall = kFallDbPerSec / (float)mRateHz.load(std::memory_order_relaxed);
+        for (float& band : mBandDb) band = std::max(MTP_SPECTRUM_MIN_DB, band - fall);
+        mCorrelation *= 0.9f;
+    }
+    for (int b = 0; b < MTP_SPECTRUM_BINS; ++b) sharedStore(gShared.spectrumBins[b], mBandDb[(size_t)b]);
+    sharedStore(gShared.spectrumCorrelation, mCorrelation);
+    sharedStore(gShared.spectrumFrame, sharedLoad(gShared.spectrumFrame) + 1);
+}
+
+void SpectrumAnalyzer::analysisLoop() {
+    setCurrentThreadClass(ThreadClass::Analysis);
+    const int N = mFft.size();
+    mL.assign((size_t)N, 0.0f);
+    mR.assign((size_t)N, 0.0f);
+    mPowerL.assign((size_t)N / 2 + 1, 0.0f);
+    mPowerR.assign((size_t)N / 2 + 1, 0.0f);
+    mBandDb.assign(MTP_SPECTRUM_BINS, MTP_SPECTRUM_MIN_DB);
+    mCorrelation = 0.0f;
+    mSeenGeneration = mTapGeneration.load() - 1;
+    publish(false);
+
+    auto due = std::chrono::steady_clock::now();
+    while (true) {
+        due += std::chrono::microseconds(1000000 / mRateHz.load(std::memory_order_relaxed));
+        {
+            std::unique_lock<std::mutex> lock(mWakeLock);
+            if (mWake.wait_until(lock, due, [this] { return mStop; })) break;
+        }
+        recordThreadWake(ThreadClass::Analysis, due);
+        // Atrasou mais de um período: não tenta recuperar os ticks perdidos
+        const auto now = std::chrono::steady_clock::now();
+        if (now - due > std::chrono::milliseconds(100)) due = now;
+
+        const uint64_t head = mHead.load(std::memory_order_acquire);
+        const uint32_t generation = mTapGeneration.load(std::memory_order_relaxed);
+        if (generation != mSeenGeneration) {
+            // Tap novo: só vale o que chegou depois da troca
+            mSeenGeneration = generation;
+            mTapStart = head;
+            std::fill(mBandDb.begin(), mBandDb.end(), MTP_SPECTRUM_MIN_DB);
+            mCorrelation = 0.0f;
+        }
+        // Render parado (pausa, fim da sessão) ou janela ainda incompleta: só cai
+        if (head == mLastHead || head - mTapStart < (uint64_t)N) {
+            publish(true);
+            continue;
+        }
+        mLastHead = head;
+        const uint64_t start = head - (uint64_t)N;
+        for (int n = 0; n < N; ++n) {
+            const size_t at = (size_t)((start + (uint64_t)n) & mRingMask) * 2;
+            mL[(size_t)n] = mRing[at];
+            mR[(size_t)n] = mRing[at + 1];
+        }
+        // O render deu a volta no ring durante a cópia: janela misturada
+        if (mHead.load(std::memory_order_acquire) - start > kRingFrames) continue;
+        const int rate = sharedLoad(gShared.status[MTP_STATUS_SAMPLE_RATE]);
+        if (rate <= 0) continue;
+        analyze(rate);
+        publish(false);
+    }
+}
+
+extern "C" {
+
+int32_t mtp_spectrum_set_tap(int32_t kind, int32_t index, int32_t rateHz) {
+    return gSpectrum.setTap(kind, index, rateHz) ? 1 : 0;
+}
+
+float* mtp_spectrum_bins(void) { return gShared.spectrumBins; }
+
+float mtp_spectrum_correlation(void) { return sharedLoad(gShared.spectrumCorrelation); }
+
+int32_t mtp_spectrum_frame(void) { return sharedLoad(gShared.spectrumFrame); }
+
+} // extern "C"
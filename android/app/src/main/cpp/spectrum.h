@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "engine_shared.h"
+#include "insert_chain.h"
+
+// Analisador de espectro e correlação L/R para a passagem de som. O render só
+// copia o tap escolhido (um par da saída ou uma track) para um ring float
+// estéreo; um thread de análise (classe Analysis) roda FFTs reais com janela
+// de Hann sobre os últimos kSpectrumFftSize frames, 30 a 60 vezes por
+// segundo, e publica MTP_SPECTRUM_BINS bandas em escala log de frequência no
+// bloco compartilhado, lidas pelo Dart como Float32List sem cópia.
+//
+// O ring nunca recusa escrita: o render sobrescreve o mais antigo e a análise
+// só quer a janela mais recente. Se o render der a volta no ring durante a
+// cópia, a janela é descartada e a análise tenta no próximo tick.
+
+constexpr int kSpectrumFftSize = 4096;
+
+// Fonte do analisador (mtp_spectrum_set_tap)
+enum SpectrumTap {
+    SPECTRUM_TAP_OFF = 0,
+    SPECTRUM_TAP_OUTPUT = 1, // índice = primeiro canal do par da saída (pós-master)
+    SPECTRUM_TAP_TRACK = 2,  // índice = track (pós-inserts, pré-fader)
+};
+
+// FFT real de tamanho fixo (potência de 2) pela FFT complexa de metade do
+// tamanho. O plano (bit-reverse, twiddles por estágio em sequência e os do
+// desdobramento real) e a janela são montados uma vez no construtor; os
+// estágios com 8 ou mais butterflies por grupo rodam em vetores de 8 floats.
+class RealFft {
+public:
+    explicit RealFft(int size);
+    int size() const { return mSize; }
+    // `in`: size amostras; `power`: size/2 + 1 valores |X[k]|^2 com janela de Hann
+    void power(const float* in, float* power);
+
+private:
+    int mSize;
+    int mHalf;
+    std::vector<int> mBitrev;
+    std::vector<float> mWindow;
+    std::vector<float> mTwRe, mTwIm;       // estágio de meia-largura h em [h - 1, 2h - 1)
+    std::vector<float> mSplitRe, mSplitIm; // e^(-2*pi*i*k/size), k = 0..size/2
+    std::vector<float> mRe, mIm;
+};
+
+class SpectrumAnalyzer {
+public:
+    ~SpectrumAnalyzer();
+
+    // Controle: escolhe o tap e a taxa de publicação (30..60 Hz); OFF para o
+    // thread de análise. Devolve false para tap inválido.
+    bool setTap(int kind, int index, int rateHz);
+
+    // Render: track do tap (-1 se o tap não for de track)
+    int trackTap() const;
+    // Render: copia o par do tap de saída de `interleaved` (só se o tap for de saída)
+    void feedOutput(const float* interleaved, int channels, int frames);
+    // Render: copia as lanes de uma track (mono vai para os dois lados)
+    void feedLanes(const Lane8* lanes, int block, int firstLane, int laneCount, int frames);
+
+private:
+    float* slot(uint64_t frame) { return mRing.data() + (size_t)(frame & mRingMask) * 2; }
+    void analysisLoop();
+    void analyze(int sampleRate);
+    void publish(bool decayOnly);
+    void rebuildBands(int sampleRate);
+
+    std::atomic<int> mKind{SPECTRUM_TAP_OFF};
+    std::atomic<int> mIndex{0};
+    std::atomic<int> mRateHz{30};
+    std::atomic<uint32_t> mTapGeneration{0};
+
+    // Ring estéreo intercalado; mHead conta frames desde sempre
+    std::vector<float> mRing;
+    size_t mRingMask = 0;
+    std::atomic<uint64_t> mHead{0};
+
+    std::mutex mControl;
+    std::mutex mWakeLock;
+    std::condition_variable mWake;
+    std::thread mThread;
+    bool mStop = false;
+
+    // Só do thread de análise
+    RealFft mFft{kSpectrumFftSize};
+    std::vector<float> mL, mR, mPowerL, mPowerR;
+    std::vector<float> mBandDb;     // valor publicado (com queda)
+    std::vector<int> mBandLo, mBandHi; // bins da FFT de cada banda; lo > hi = interpolar
+    std::vector<float> mBandPos;    // bin fracionário do centro da banda
+    int mBandRate = 0;
+    float mCorrelation = 0.0f;
+    uint32_t mSeenGeneration = 0;
+    uint64_t mTapStart = 0;
+    uint64_t mLastHead = 0;
+};
+
+extern SpectrumAnalyzer gSpectrum;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Escolhe a fonte do analisador (SpectrumTap) e a taxa de atualização em Hz
+// (limitada a 30..60); devolve 0 se o tap for inválido.
+MTP_EXPORT int32_t mtp_spectrum_set_tap(int32_t kind, int32_t index, int32_t rateHz);
+// Bandas em dBFS (MTP_SPECTRUM_MIN_DB..0), de 20 Hz a 20 kHz; view sem cópia
+MTP_EXPORT float* mtp_spectrum_bins(void);
+// Correlação de fase L/R suavizada (-1..1)
+MTP_EXPORT float mtp_spectrum_correlation(void);
+// Número da publicação atual; muda a cada atualização das bandas
+MTP_EXPORT int32_t mtp_spectrum_frame(void);
+
+#ifdef __cplusplus
+}
+#endif
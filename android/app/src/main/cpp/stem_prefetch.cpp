@@ -0,0 +1,553 @@
+#include "stem_prefetch.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+#include "engine_stats.h"
+#include "thread_topology.h"
+
+StemPrefetcher gStemPrefetcher(&gEngineStats.streamIoMisses);
+
+// Leitura direta do render quando o chunk não chegou
+static const int kDirectFrames = 1024;
+// Com leituras em voo o Io também confere as conclusões neste intervalo; sem
+// nenhuma, só acorda por aviso
+static const auto kIoReapInterval = std::chrono::milliseconds(2);
+static const int kBenchmarkBlockFrames = 512;
+
+// Estados de um slot do anel. FREE e PENDING são do thread Io; READY é
+// publicado pelo Io (release) e pode voltar a FREE por ele; READING é do
+// render, que troca READY -> READING por CAS e devolve READY ao terminar.
+enum SlotState : int { SLOT_FREE = 0, SLOT_PENDING, SLOT_READY, SLOT_READING };
+
+struct PrefetchSlot {
+    std::atomic<int> state{SLOT_FREE};
+    std::atomic<int64_t> chunk{-1};
+    int frames = 0; // frames válidos, publicado junto com READY
+    uint8_t* data = nullptr;
+    PrefetchStream* owner = nullptr;
+};
+
+struct PrefetchStream {
+    ~PrefetchStream() {
+        if (fd >= 0) close(fd);
+    }
+
+    int fd = -1;
+    WavInfo info;
+    int frameBytes = 0;
+    int64_t frames = 0;
+    int chunkFrames = 0;
+    int64_t chunkCount = 0;
+    int ahead = 0;
+    AlignedBuffer storage;
+    std::unique_ptr<PrefetchSlot[]> slots;
+    int slotCount = 0;
+    // Escritos pelo render: chunk lido agora, chunk do cue (-1 = nenhum) e
+    // chunks mantidos atrás de want (só no scrub)
+    std::atomic<int64_t> want{0};
+    std::atomic<int64_t> cue{-1};
+    std::atomic<int> behind{0};
+    std::atomic<bool> closed{false};
+    // Só do thread Io
+    int inFlight = 0;
+    int64_t lastWant = -1;
+    int64_t lastCue = -1;
+
+    int64_t chunkOffset(int64_t chunk) const {
+        return (int64_t)info.dataOffset + chunk * chunkFrames * frameBytes;
+    }
+};
+
+static void adviseWillNeed(const PrefetchStream &s, int64_t chunk, int chunks) {
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(s.fd, (off_t)s.chunkOffset(chunk), (off_t)chunks * s.chunkFrames * s.frameBytes,
+                  POSIX_FADV_WILLNEED);
+#else
+    (void)s; (void)chunk; (void)chunks;
+#endif
+}
+
+// Fonte de um stem do prefetcher. Só o render (ou o worker do grupo) usa.
+class PrefetchTrackSource : public TrackSource {
+public:
+    PrefetchTrackSource(StemPrefetcher* owner, std::shared_ptr<PrefetchStream> stream, bool waitForIo)
+        : mOwner(owner), mStream(std::move(stream)), mWaitForIo(waitForIo) {
+        mInfo = mStream->info;
+        mScratch.resize((size_t)kDirectFrames * mStream->frameBytes);
+    }
+
+    ~PrefetchTrackSource() override {
+        if (mSlot) mSlot->state.store(SLOT_READY, std::memory_order_release);
+        mStream->closed.store(true);
+        mOwner->wakeIo();
+    }
+
+    int readLanes(Lane8* grp, int lane, int frames) override {
+        PrefetchStream &s = *mStream;
+        mLastSilent = false;
+        if (mScrubbing) {
+            mScrubbing = false;
+            s.behind.store(0, std::memory_order_release);
+        }
+        const int n = (int)std::max<int64_t>(0, std::min<int64_t>(frames, s.frames - mPos));
+        if (n <= 0) return 0;
+        if (skipSilent(grp, lane, mPos, n)) {
+            mPos += n;
+            follow();
+            mLastSilent = true;
+            return n;
+        }
+        int done = 0;
+        while (done < n) {
+            const int64_t chunk = mPos / s.chunkFrames;
+            const int within = (int)(mPos - chunk * s.chunkFrames);
+            int m = std::min(n - done, s.chunkFrames - within);
+            if (!mSlot || mSlot->chunk.load(std::memory_order_relaxed) != chunk) {
+                follow();
+                mSlot = acquire(chunk);
+                while (!mSlot && mWaitForIo) {
+                    std::this_thread::yield();
+                    mSlot = acquire(chunk);
+                }
+            }
+            if (mSlot && within + m <= mSlot->frames) {
+                decodePcmToLanes(mSlot->data + (size_t)within * s.frameBytes, mInfo.bitsPerSample / 8,
+                                 mInfo.channels, grp + done, lane, m);
+            } else {
+                m = readDirect(grp + done, lane, std::min(m, kDirectFrames));
+                if (m <= 0) break; // erro de leitura: a track termina aqui
+            }
+            done += m;
+            mPos += m;
+        }
+        follow();
+        return done;
+    }
+
+    void seekFrame(int64_t frame) override {
+        mPos = std::max<int64_t>(0, std::min(frame, mStream->frames));
+        follow();
+    }
+
+    bool inMemory() const override { return false; }
+
+    // Como readLanes, mas sem leitura direta: chunk que não chegou encerra
+    int readResident(Lane8* grp, int lane, int64_t frame, int frames) override {
+        PrefetchStream &s = *mStream;
+        mLastSilent = false;
+        if (!mScrubbing) {
+            mScrubbing = true;
+            s.behind.store(kPrefetchScrubBehind, std::memory_order_release);
+        }
+        mPos = std::max<int64_t>(0, std::min(frame, s.frames));
+        const int n = (int)std::max<int64_t>(0, std::min<int64_t>(frames, s.frames - mPos));
+        if (n <= 0) {
+            follow();
+            return 0;
+        }
+        if (skipSilent(grp, lane, mPos, n)) {
+            mPos += n;
+            follow();
+            mLastSilent = true;
+            return n;
+        }
+        int done = 0;
+        while (done < n) {
+            const int64_t chunk = mPos / s.chunkFrames;
+            const int within = (int)(mPos - chunk * s.chunkFrames);
+            const int m = std::min(n - done, s.chunkFrames - within);
+            if (!mSlot || mSlot->chunk.load(std::memory_order_relaxed) != chunk) {
+                follow();
+                mSlot = acquire(chunk);
+            }
+            if (!mSlot || within + m > mSlot->frames) break;
+            decodePcmToLanes(mSlot->data + (size_t)within * s.frameBytes, mInfo.bitsPerSample / 8,
+                             mInfo.channels, grp + done, lane, m);
+            done += m;
+            mPos += m;
+        }
+        follow();
+        return done;
+    }
+
+    void scrubCue(int64_t frame) override { cueFrame(frame); }
+
+    // O Io lê o chunk do destino junto com a janela atual
+    void cueFrame(int64_t frame) override {
+        mCueFrame = std::max<int64_t>(0, std::min(frame, mStream->frames));
+        mStream->cue.store(mCueFrame / mStream->chunkFrames, std::memory_order_release);
+        mOwner->wakeIo();
+    }
+
+    void jumpToCue() override {
+        if (mCueFrame < 0) return;
+        mPos = mCueFrame;
+        mCueFrame = -1;
+        // Janela nova antes de soltar o cue: o Io nunca vê o chunk fora dos dois
+        follow();
+        mStream->cue.store(-1, std::memory_order_release);
+        mOwner->wakeIo();
+    }
+
+private:
+    // Solta o slot que ficou para trás e avisa o Io da posição atual
+    void follow() {
+        const int64_t chunk = mPos / mStream->chunkFrames;
+        bool moved = false;
+        if (mSlot && mSlot->chunk.load(std::memory_order_relaxed) != chunk) {
+            mSlot->state.store(SLOT_READY, std::memory_order_release);
+            mSlot = nullptr;
+            moved = true;
+        }
+        if (mStream->want.load(std::memory_order_relaxed) != chunk) {
+            mStream->want.store(chunk, std::memory_order_release);
+            moved = true;
+        }
+        if (moved) mOwner->wakeIo();
+    }
+
+    PrefetchSlot* acquire(int64_t chunk) {
+        PrefetchStream &s = *mStream;
+        for (int i = 0; i < s.slotCount; ++i) {
+            PrefetchSlot &slot = s.slots[i];
+            if (slot.state.load(std::memory_order_acquire) != SLOT_READY ||
+                slot.chunk.load(std::memory_order_relaxed) != chunk) continue;
+            int expected = SLOT_READY;
+            if (!slot.state.compare_exchange_strong(expected, SLOT_READING, std::memory_order_acq_rel)) continue;
+            // O slot pode ter sido reciclado entre a leitura do chunk e o CAS
+            if (slot.chunk.load(std::memory_order_relaxed) == chunk) return &slot;
+            slot.state.store(SLOT_READY, std::memory_order_release);
+        }
+        return nullptr;
+    }
+
+    int readDirect(Lane8* grp, int lane, int frames) {
+        const PrefetchStream &s = *mStream;
+        const size_t want = (size_t)frames * s.frameBytes;
+        const off_t at = (off_t)(s.info.dataOffset + (size_t)mPos * s.frameBytes);
+        size_t got = 0;
+        while (got < want) {
+            const ssize_t r = ::pread(s.fd, mScratch.data() + got, want - got, at + (off_t)got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) break;
+            got += (size_t)r;
+        }
+        if (mOwner->mMisses) mOwner->mMisses->fetch_add(1, std::memory_order_relaxed);
+        const int n = (int)(got / s.frameBytes);
+        if (n > 0) decodePcmToLanes(mScratch.data(), mInfo.bitsPerSample / 8, mInfo.channels, grp, lane, n);
+        return n;
+    }
+
+    StemPrefetcher* mOwner;
+    std::shared_ptr<PrefetchStream> mStream;
+    bool mWaitForIo;
+    PrefetchSlot* mSlot = nullptr; // em READING enquanto for nosso
+    int64_t mPos = 0;
+    bool mScrubbing = false;
+    std::vector<uint8_t> mScratch;
+};
+
+StemPrefetcher::~StemPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    if (mThread.joinable()) mThread.join();
+}
+
+void StemPrefetcher::configure(const PrefetchConfig &config) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    PrefetchConfig c = config;
+    c.chunkFrames = (std::max(4096, std::min(c.chunkFrames, 65536)) + 4095) / 4096 * 4096;
+    c.ahead = std::max(2, std::min(c.ahead, 16));
+    c.queueDepth = std::max(4, std::min(c.queueDepth, 1024));
+    c.ioThreads = std::max(1, std::min(c.ioThreads, 16));
+    mConfig = c;
+    ++mConfigGeneration;
+}
+
+PrefetchConfig StemPrefetcher::config() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mConfig;
+}
+
+std::unique_ptr<TrackSource> StemPrefetcher::open(const std::string &path, bool waitForIo) {
+    auto s = std::make_shared<PrefetchStream>();
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs.is_open() || !parseWavHeader(ifs, s->info) || !isMixablePcm(s->info)) return nullptr;
+    }
+    s->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (s->fd < 0) return nullptr;
+    const PrefetchConfig c = config();
+    s->frameBytes = s->info.channels * (s->info.bitsPerSample / 8);
+    s->frames = (int64_t)(s->info.dataSize / (size_t)s->frameBytes);
+    s->chunkFrames = c.chunkFrames;
+    s->chunkCount = (s->frames + c.chunkFrames - 1) / c.chunkFrames;
+    s->ahead = c.ahead;
+    // Janela à frente, um slot para o cue e os de trás do scrub
+    s->slotCount = c.ahead + 1 + kPrefetchScrubBehind;
+    const size_t chunkBytes = (size_t)c.chunkFrames * s->frameBytes;
+    s->storage = allocAligned(chunkBytes * s->slotCount);
+    if (!s->storage) return nullptr;
+    s->slots.reset(new PrefetchSlot[s->slotCount]);
+    for (int i = 0; i < s->slotCount; ++i) {
+        s->slots[i].data = s->storage.get() + chunkBytes * i;
+        s->slots[i].owner = s.get();
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(s->fd, (off_t)s->info.dataOffset, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    std::unique_ptr<TrackSource> src(new PrefetchTrackSource(this, s, waitForIo));
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ensureThread();
+        mStreams.push_back(std::move(s));
+    }
+    wakeIo();
+    return src;
+}
+
+void StemPrefetcher::wakeIo() {
+    mWakeSeq.fetch_add(1);
+    // Só o primeiro aviso depois de o Io dormir trava e acorda; os outros
+    // já caem no predicado
+    if (mIdle.exchange(false)) {
+        mWokenAt.store(std::chrono::steady_clock::now().time_since_epoch().count());
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWake.notify_one();
+    }
+}
+
+// Com mMutex
+void StemPrefetcher::ensureThread() {
+    if (mThread.joinable()) return;
+    mIo = AsyncIo::create(mConfig.queueDepth, mConfig.ioThreads, mConfig.allowUring);
+    mIoGeneration = mConfigGeneration;
+    mBackend.store((int)mIo->backend());
+    mThread = std::thread([this]() { ioLoop(); });
+}
+
+// Pedidos dos chunks que faltam na janela do stream (no máximo `budget`)
+int StemPrefetcher::plan(PrefetchStream &s, std::vector<IoRequest> &batch, int budget) {
+    // cue antes de want: o render grava want e depois solta o cue
+    const int64_t cue = s.cue.load(std::memory_order_acquire);
+    const int64_t want = s.want.load(std::memory_order_acquire);
+    const int behind = s.behind.load(std::memory_order_acquire);
+    for (int i = 0; i < s.slotCount; ++i) {
+        PrefetchSlot &slot = s.slots[i];
+        if (slot.state.load(std::memory_order_relaxed) != SLOT_READY) continue;
+        const int64_t k = slot.chunk.load(std::memory_order_relaxed);
+        if ((k >= want - behind && k < want + s.ahead) || k == cue) continue;
+        int expected = SLOT_READY;
+        slot.state.compare_exchange_strong(expected, SLOT_FREE, std::memory_order_acq_rel);
+    }
+    // Salto (seek, jumpToCue) ou cue novo: avisa o kernel da janela nova
+    if (want != s.lastWant && want != s.lastWant + 1) adviseWillNeed(s, want, s.ahead);
+    if (cue >= 0 && cue != s.lastCue) adviseWillNeed(s, cue, 1);
+    s.lastWant = want;
+    s.lastCue = cue;
+
+    // O chunk de agora, o do cue, os de trás (scrub) e o resto da janela,
+    // nessa ordem
+    int added = 0;
+    const int steps = 2 + behind + s.ahead - 1;
+    for (int j = 0; j < steps && added < budget; ++j) {
+        const int64_t k = j == 0 ? want : j == 1 ? cue : j < 2 + behind ? want - (j - 1) : want + (j - 1 - behind);
+        if (k < 0 || k >= s.chunkCount) continue;
+        PrefetchSlot* free = nullptr;
+        bool present = false;
+        for (int i = 0; i < s.slotCount; ++i) {
+            PrefetchSlot &slot = s.slots[i];
+            const int st = slot.state.load(std::memory_order_acquire);
+            if (st == SLOT_FREE) {
+                if (!free) free = &slot;
+            } else if (slot.chunk.load(std::memory_order_relaxed) == k) {
+                present = true;
+                break;
+            }
+        }
+        if (present) continue;
+        if (!free) break;
+        free->chunk.store(k, std::memory_order_relaxed);
+        free->frames = 0;
+        free->state.store(SLOT_PENDING, std::memory_order_relaxed);
+        IoRequest r;
+        r.fd = s.fd;
+        r.offset = s.chunkOffset(k);
+        r.buffer = free->data;
+        r.bytes = (uint32_t)(std::min<int64_t>(s.chunkFrames, s.frames - k * s.chunkFrames) * s.frameBytes);
+        r.tag = (uint64_t)(uintptr_t)free;
+        batch.push_back(r);
+        ++s.inFlight;
+        ++added;
+    }
+    return added;
+}
+
+void StemPrefetcher::complete(const IoCompletion &c) {
+    PrefetchSlot* slot = reinterpret_cast<PrefetchSlot*>((uintptr_t)c.tag);
+    PrefetchStream &s = *slot->owner;
+    --s.inFlight;
+    // Erro ou leitura curta: o que faltar o render lê direto
+    slot->frames = c.result > 0 ? c.result / s.frameBytes : 0;
+    if (c.result > 0) mBytesRead.fetch_add((uint64_t)c.result, std::memory_order_relaxed);
+    slot->state.store(SLOT_READY, std::memory_order_release);
+}
+
+void StemPrefetcher::ioLoop() {
+    setCurrentThreadClass(ThreadClass::Io);
+    std::vector<std::shared_ptr<PrefetchStream>> streams;
+    std::vector<IoRequest> batch;
+    std::vector<IoCompletion> done;
+    for (;;) {
+        // Aviso que chegar depois daqui não se perde: o sono abaixo compara
+        const uint64_t seen = mWakeSeq.load();
+        bool recreate = false;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStreams.erase(std::remove_if(mStreams.begin(), mStreams.end(),
+                                          [](const std::shared_ptr<PrefetchStream> &s) {
+                                              return s->closed.load() && s->inFlight == 0;
+                                          }),
+                           mStreams.end());
+            if (mStop) break;
+            if (mStreams.empty() && mIo->inFlight() == 0) {
+                mIdle.store(true);
+                mWake.wait(lock, [this]() { return mStop || !mStreams.empty(); });
+                mIdle.store(false);
+                if (mStop) break;
+            }
+            streams = mStreams;
+            // Config nova de fila/backend: só com o AsyncIo parado
+            recreate = mIoGeneration != mConfigGeneration && mIo->inFlight() == 0 &&
+                       std::all_of(streams.begin(), streams.end(),
+                                   [](const std::shared_ptr<PrefetchStream> &s) { return s->closed.load(); });
+            if (recreate) {
+                mIo.reset();
+                mIo = AsyncIo::create(mConfig.queueDepth, mConfig.ioThreads, mConfig.allowUring);
+                mIoGeneration = mConfigGeneration;
+                mBackend.store((int)mIo->backend());
+            }
+        }
+
+        // Um lote com os chunks que faltam em todos os stems
+        batch.clear();
+        for (const auto &s : streams) {
+            if (s->closed.load()) continue;
+            plan(*s, batch, mIo->capacity() - (int)batch.size());
+        }
+        const int submitted = batch.empty() ? 0 : mIo->submit(batch.data(), (int)batch.size());
+
+        done.resize((size_t)std::max(1, mIo->queueDepth()));
+        const int reaped = mIo->reap(done.data(), (int)done.size(), false);
+        for (int i = 0; i < reaped; ++i) complete(done[(size_t)i]);
+
+        if (submitted == 0 && reaped == 0) {
+            // Dorme até o render mudar de chunk, um stem abrir/fechar ou (com
+            // leituras em voo) a hora de conferir as conclusões
+            const auto wake = [&]() { return mStop || mWakeSeq.load() != seen; };
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWokenAt.store(0);
+            mIdle.store(true);
+            if (mIo->inFlight() > 0) {
+                mWake.wait_for(lock, kIoReapInterval, wake);
+            } else {
+                mWake.wait(lock, wake);
+            }
+            mIdle.store(false);
+            const int64_t wokenAt = mWokenAt.load();
+            lock.unlock();
+            if (wokenAt != 0) {
+                recordThreadWake(ThreadClass::Io, std::chrono::steady_clock::time_point(
+                                                      std::chrono::steady_clock::duration(wokenAt)));
+            }
+        }
+    }
+    // Os buffers precisam estar vivos até a última leitura em voo voltar
+    while (mIo->inFlight() > 0) {
+        const int n = mIo->reap(done.data(), (int)done.size(), true);
+        for (int i = 0; i < n; ++i) complete(done[(size_t)i]);
+    }
+}
+
+extern "C" {
+
+int32_t mtp_stream_benchmark(const char* const* paths, int32_t count, int32_t streams, double seconds,
+                             int32_t chunkFrames, int32_t ahead, int32_t queueDepth, int32_t flags,
+                             MtpStreamBenchmark* out) {
+    if (!paths || count <= 0 || streams <= 0 || !(seconds > 0.0)) return 0;
+    StemPrefetcher prefetcher;
+    PrefetchConfig config;
+    if (chunkFrames > 0) config.chunkFrames = chunkFrames;
+    if (ahead > 0) config.ahead = ahead;
+    if (queueDepth > 0) config.queueDepth = queueDepth;
+    config.allowUring = (flags & MTP_STREAM_IO_NO_URING) == 0;
+    prefetcher.configure(config);
+#ifdef POSIX_FADV_DONTNEED
+    for (int32_t i = 0; i < count; ++i) {
+        const int fd = paths[i] ? ::open(paths[i], O_RDONLY | O_CLOEXEC) : -1;
+        if (fd < 0) continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+
+    // Cópias do mesmo arquivo começam em pontos diferentes dele
+    const int copies = (streams + count - 1) / count;
+    std::vector<std::unique_ptr<TrackSource>> sources;
+    for (int32_t i = 0; i < streams; ++i) {
+        if (!paths[i % count]) return 0;
+        std::unique_ptr<TrackSource> src = prefetcher.open(paths[i % count], true);
+        if (!src || src->totalFrames() <= 0) return 0;
+        src->seekFrame(src->totalFrames() * (i / count) / copies);
+        sources.push_back(std::move(src));
+    }
+
+    const int rate = sources[0]->info().sampleRate;
+    const int64_t frames = (int64_t)(seconds * rate);
+    std::vector<Lane8> lanes((size_t)kBenchmarkBlockFrames);
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int64_t pos = 0; pos < frames; pos += kBenchmarkBlockFrames) {
+        const int n = (int)std::min<int64_t>(kBenchmarkBlockFrames, frames - pos);
+        for (auto &src : sources) {
+            // Fim do arquivo: volta ao começo (nada lido logo depois = erro)
+            bool wrapped = false;
+            for (int got = 0; got < n;) {
+                const int r = src->readLanes(lanes.data() + got, 0, n - got);
+                if (r > 0) {
+                    got += r;
+                    wrapped = false;
+                } else if (wrapped) {
+                    return 0;
+                } else {
+                    src->seekFrame(0);
+                    wrapped = true;
+                }
+            }
+        }
+    }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (out) {
+        const PrefetchConfig used = prefetcher.config();
+        out->streams = streams;
+        out->backend = (int32_t)prefetcher.backend();
+        out->chunkFrames = used.chunkFrames;
+        out->queueDepth = used.queueDepth;
+        out->bytesRead = (int64_t)prefetcher.bytesRead();
+        out->audioSec = (double)frames / rate;
+        out->wallSec = wall;
+        out->megabytesPerSec = wall > 0.0 ? (double)prefetcher.bytesRead() / (wall * 1.0e6) : 0.0;
+        out->realtimeFactor = wall > 0.0 ? out->audioSec / wall : 0.0;
+        out->sustainedStems = streams * out->realtimeFactor;
+    }
+    return 1;
+}
+
+} // extern "C"
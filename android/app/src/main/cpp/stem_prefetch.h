@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_io.h"
+#include "engine_shared.h"
+#include "track_source.h"
+
+// Streaming de stems do disco com leitura adiantada. Cada stem aberto pelo
+// prefetcher tem um anel de chunks (kPrefetchAhead por padrão) à frente da
+// posição do render; um thread Io junta os chunks que faltam de todas as
+// tracks num lote só e manda para o AsyncIo (io_uring no host Linux, pool de
+// pread no Android), colhendo as conclusões nos buffers alinhados do anel.
+// O render só decodifica de chunks prontos; se o chunk ainda não chegou
+// (salto sem cue, disco lento), lê o trecho na hora com pread, como a leitura
+// síncrona de antes, e conta um miss nas stats.
+//
+// Dicas de posix_fadvise: SEQUENTIAL na abertura e WILLNEED na janela nova
+// depois de seek ou cue.
+//
+// No scrub (readResident) o render nunca lê: a janela cobre também
+// kPrefetchScrubBehind chunks atrás da posição (scrub de ré), o alvo do
+// gesto fica como cue, e o que não estiver pronto sai em silêncio.
+
+constexpr int kPrefetchChunkFrames = 8192;
+constexpr int kPrefetchAhead = 4;
+constexpr int kPrefetchScrubBehind = 2;
+constexpr int kPrefetchQueueDepth = 64;
+constexpr int kPrefetchIoThreads = 4;
+
+// Flags de mtp_stream_benchmark
+#define MTP_STREAM_IO_NO_URING 1 // sempre o pool de pread
+
+struct PrefetchConfig {
+    int chunkFrames = kPrefetchChunkFrames; // múltiplo de 4096 (chunk em páginas inteiras)
+    int ahead = kPrefetchAhead;             // chunks lidos à frente por stem
+    int queueDepth = kPrefetchQueueDepth;   // leituras em voo no AsyncIo
+    int ioThreads = kPrefetchIoThreads;     // threads do pool de pread
+    bool allowUring = true;
+};
+
+struct PrefetchStream;
+
+class StemPrefetcher {
+public:
+    // `misses`: contador externo de leituras feitas pelo render (opcional)
+    explicit StemPrefetcher(std::atomic<uint64_t>* misses = nullptr) : mMisses(misses) {}
+    ~StemPrefetcher();
+
+    // Vale para os stems abertos depois; o AsyncIo é recriado quando não
+    // houver nenhum aberto
+    void configure(const PrefetchConfig &config);
+    PrefetchConfig config() const;
+    // Backend em uso (None antes do primeiro open)
+    IoBackend backend() const { return (IoBackend)mBackend.load(); }
+
+    // nullptr se o arquivo não abrir ou não for PCM tocável. Com `waitForIo`
+    // (benchmark), readLanes espera o chunk em vez de ler por conta própria.
+    std::unique_ptr<TrackSource> open(const std::string &path, bool waitForIo = false);
+
+    uint64_t bytesRead() const { return mBytesRead.load(std::memory_order_relaxed); }
+
+private:
+    friend class PrefetchTrackSource;
+
+    void ensureThread();
+    void ioLoop();
+    // Chunk novo, cue, stem aberto ou fechado: acorda o Io. No render não
+    // trava nada a menos que o Io esteja dormindo (como no RenderPool).
+    void wakeIo();
+    int plan(PrefetchStream &s, std::vector<IoRequest> &batch, int budget);
+    void complete(const IoCompletion &c);
+
+    std::atomic<uint64_t>* mMisses;
+    mutable std::mutex mMutex;
+    std::condition_variable mWake;
+    PrefetchConfig mConfig;
+    uint32_t mConfigGeneration = 0;
+    std::vector<std::shared_ptr<PrefetchStream>> mStreams; // guardado por mMutex
+    std::atomic<int> mBackend{(int)IoBackend::None};
+    std::atomic<uint64_t> mBytesRead{0};
+    std::thread mThread;
+    bool mStop = false;
+    std::atomic<uint64_t> mWakeSeq{0};
+    std::atomic<bool> mIdle{false};
+    std::atomic<int64_t> mWokenAt{0}; // steady_clock do aviso que acordou o Io
+
+    // Só do thread Io
+    std::unique_ptr<AsyncIo> mIo;
+    uint32_t mIoGeneration = 0;
+};
+
+// Prefetcher do playback (misses vão para as engine stats)
+extern StemPrefetcher gStemPrefetcher;
+
+// Resultado de mtp_stream_benchmark
+typedef struct MtpStreamBenchmark {
+    int32_t streams;
+    int32_t backend;         // IoBackend
+    int32_t chunkFrames;
+    int32_t queueDepth;
+    int64_t bytesRead;
+    double audioSec;         // por stem
+    double wallSec;
+    double megabytesPerSec;
+    double realtimeFactor;   // segundos de áudio por segundo de relógio, por stem
+    double sustainedStems;   // streams * realtimeFactor
+} MtpStreamBenchmark;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lê `streams` stems ao mesmo tempo (os arquivos de `paths` em rodízio, cada
+// um começando num ponto diferente) o mais rápido que o prefetcher entregar,
+// `seconds` de áudio por stem, por um prefetcher próprio. As páginas dos
+// arquivos saem do cache antes (best effort), para medir o armazenamento e
+// não a RAM. Devolve 0 se falhar.
+MTP_EXPORT int32_t mtp_stream_benchmark(const char* const* paths, int32_t count, int32_t streams, double seconds,
+                                        int32_t chunkFrames, int32_t ahead, int32_t queueDepth, int32_t flags,
+                                        MtpStreamBenchmark* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,141 @@
+#include "thread_topology.h"
+#include "engine_log.h"
+#include "engine_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// nice das classes, nos valores que o Android usa para os mesmos papéis
+// (ANDROID_PRIORITY_URGENT_AUDIO, _NORMAL e _BACKGROUND)
+static const int kRenderNice = -19;
+static const int kIoNice = 0;
+static const int kAnalysisNice = 10;
+// SCHED_FIFO baixo: acima de todo thread normal, abaixo dos do sistema
+static const int kRenderFifoOffset = 2;
+
+static CpuTopology readCpuTopology() {
+    CpuTopology topo;
+    std::vector<std::pair<int, long>> freqs;
+    const long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+    for (int cpu = 0; cpu < ncpu; ++cpu) {
+        char path[128];
+        std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+        FILE* f = std::fopen(path, "r");
+        if (!f) continue;
+        long khz = 0;
+        if (std::fscanf(f, "%ld", &khz) == 1 && khz > 0) freqs.emplace_back(cpu, khz);
+        std::fclose(f);
+    }
+    if (freqs.empty()) return topo;
+    long maxKhz = 0;
+    for (const auto& p : freqs) maxKhz = std::max(maxKhz, p.second);
+    for (const auto& p : freqs) {
+        if (p.second == maxKhz) topo.bigCores.push_back(p.first);
+    }
+    // Em SoCs com um único "prime core", inclui o cluster logo abaixo
+    if (topo.bigCores.size() < 2) {
+        long second = 0;
+        for (const auto& p : freqs) if (p.second < maxKhz) second = std::max(second, p.second);
+        for (const auto& p : freqs) if (second > 0 && p.second == second) topo.bigCores.push_back(p.first);
+    }
+    for (const auto& p : freqs) {
+        if (std::find(topo.bigCores.begin(), topo.bigCores.end(), p.first) == topo.bigCores.end()) {
+            topo.otherCores.push_back(p.first);
+        }
+    }
+    return topo;
+}
+
+const CpuTopology& cpuTopology() {
+    static const CpuTopology topo = readCpuTopology();
+    return topo;
+}
+
+std::vector<int> detectBigCores() {
+    return cpuTopology().bigCores;
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) CPU_SET(c, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+int setCurrentThreadClass(ThreadClass cls) {
+    const CpuTopology& topo = cpuTopology();
+    // setpriority com PRIO_PROCESS/0 vale só para o thread atual no Linux
+    switch (cls) {
+        case ThreadClass::Render:
+        case ThreadClass::RenderWorker: {
+            pinCurrentThread(topo.bigCores);
+            sched_param param{};
+            param.sched_priority = std::min(sched_get_priority_max(SCHED_FIFO),
+                                            sched_get_priority_min(SCHED_FIFO) + kRenderFifoOffset);
+            if (sched_setscheduler(0, SCHED_FIFO, &param) == 0) return 1;
+            return setpriority(PRIO_PROCESS, 0, kRenderNice) == 0 ? 0 : -1;
+        }
+        case ThreadClass::Io:
+            return setpriority(PRIO_PROCESS, 0, kIoNice) == 0 ? 0 : -1;
+        case ThreadClass::Analysis:
+            // Em SoC homogêneo não há para onde tirar: só o nice
+            pinCurrentThread(topo.otherCores);
+            return setpriority(PRIO_PROCESS, 0, kAnalysisNice) == 0 ? 0 : -1;
+    }
+    return -1;
+}
+
+// Baixar o nice de volta pede CAP_SYS_NICE ou RLIMIT_NICE (que guarda 20 - o
+// menor nice permitido); sem isso um processo comum no Linux fica preso no
+// nice mais alto
+static bool canLowerNiceTo(int nice) {
+    if (geteuid() == 0) return true;
+    rlimit rl{};
+    if (getrlimit(RLIMIT_NICE, &rl) != 0) return false;
+    return rl.rlim_cur == RLIM_INFINITY || 20 - (long)rl.rlim_cur <= nice;
+}
+
+ScopedThreadClass::ScopedThreadClass(ThreadClass cls, std::chrono::steady_clock::time_point readyAt) {
+    if (readyAt != std::chrono::steady_clock::time_point{}) recordThreadWake(cls, readyAt);
+    mPolicy = sched_getscheduler(0);
+    errno = 0;
+    mNice = getpriority(PRIO_PROCESS, 0);
+    CPU_ZERO(&mAffinity);
+    mSaved = mPolicy >= 0 && errno == 0 && sched_getparam(0, &mParam) == 0 &&
+             sched_getaffinity(0, sizeof(mAffinity), &mAffinity) == 0;
+    // O thread é de quem chamou: sem como voltar o nice, a análise só sai dos
+    // big cores (o nice de fundo ficaria para o resto da vida do thread)
+    if (cls == ThreadClass::Analysis && (!mSaved || !canLowerNiceTo(mNice))) {
+        static std::atomic<bool> logged{false};
+        if (!logged.exchange(true)) LOGI("analysis: nice %d kept (no RLIMIT_NICE to restore it)", mNice);
+        pinCurrentThread(cpuTopology().otherCores);
+        mNiceChanged = false;
+        return;
+    }
+    setCurrentThreadClass(cls);
+    mNiceChanged = true;
+}
+
+ScopedThreadClass::~ScopedThreadClass() {
+    if (!mSaved) return;
+    if (sched_setaffinity(0, sizeof(mAffinity), &mAffinity) != 0) {
+        LOGE("ScopedThreadClass: affinity not restored: %s", std::strerror(errno));
+    }
+    if (sched_getscheduler(0) != mPolicy && sched_setscheduler(0, mPolicy, &mParam) != 0) {
+        LOGE("ScopedThreadClass: policy %d not restored: %s", mPolicy, std::strerror(errno));
+    }
+    if (mNiceChanged && setpriority(PRIO_PROCESS, 0, mNice) != 0) {
+        LOGE("ScopedThreadClass: nice %d not restored: %s", mNice, std::strerror(errno));
+    }
+}
+
+void recordThreadWake(ThreadClass cls, std::chrono::steady_clock::time_point due) {
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - due).count();
+    engineStatsRecordWake((int)cls, std::max(0.0, us));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <sched.h>
+#include <vector>
+
+// Topologia de threads do engine. Cada thread se declara numa classe, que
+// define prioridade e cores:
+//  - Render e RenderWorker: a maior prioridade que o sistema deixar
+//    (SCHED_FIFO; sem permissão, nice de áudio urgente), nos big cores;
+//  - Io (preload de músicas, writer da gravação): prioridade normal;
+//  - Analysis (importação, mapas de silêncio, waveform, loudness): fundo,
+//    fora dos big cores quando o SoC tem outros.
+// Cada classe mede com que atraso seus threads acordam (engine stats), para
+// ver se trabalho de fundo está atrasando o render.
+
+enum class ThreadClass { Render = 0, RenderWorker, Io, Analysis };
+constexpr int kThreadClassCount = 4;
+
+struct CpuTopology {
+    std::vector<int> bigCores;   // maior cpuinfo_max_freq (ou os dois clusters de cima)
+    std::vector<int> otherCores; // o resto; vazio em SoC homogêneo ou sem cpufreq
+};
+
+// Lida de /sys/devices/system/cpu na primeira chamada
+const CpuTopology& cpuTopology();
+
+// Lista de CPUs com a maior cpuinfo_max_freq (vazia se não der para detectar).
+std::vector<int> detectBigCores();
+
+// Fixa o thread atual nas CPUs indicadas (best effort).
+bool pinCurrentThread(const std::vector<int>& cpus);
+
+// Aplica a classe ao thread atual (best effort). Devolve 1 se ficou em
+// SCHED_FIFO, 0 se ficou no nice da classe, -1 se nada foi aceito.
+int setCurrentThreadClass(ThreadClass cls);
+
+// Classe só durante um trabalho num thread que não é do engine (worker de
+// isolate do Dart chamando a análise via FFI): política, nice e afinidade
+// voltam ao que eram na saída. Se o processo não puder baixar o nice de novo
+// (Linux sem RLIMIT_NICE), Analysis só muda a afinidade. Com `readyAt`,
+// registra o atraso de acordar desde esse instante (thread criado para o
+// trabalho).
+class ScopedThreadClass {
+public:
+    explicit ScopedThreadClass(ThreadClass cls, std::chrono::steady_clock::time_point readyAt = {});
+    ~ScopedThreadClass();
+    ScopedThreadClass(const ScopedThreadClass&) = delete;
+    ScopedThreadClass& operator=(const ScopedThreadClass&) = delete;
+
+private:
+    int mPolicy = SCHED_OTHER;
+    sched_param mParam{};
+    int mNice = 0;
+    cpu_set_t mAffinity;
+    bool mSaved = false;
+    bool mNiceChanged = false;
+};
+
+// Atraso (>= 0) entre `due`, quando o thread da classe devia rodar, e agora
+void recordThreadWake(ThreadClass cls, std::chrono::steady_clock::time_point due);
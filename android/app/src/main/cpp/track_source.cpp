@@ -0,0 +1,226 @@
+#include "track_source.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+bool isMixablePcm(const WavInfo &info) {
+    return info.audioFormat == 1 && (info.bitsPerSample == 16 || info.bitsPerSample == 24) &&
+           info.channels >= 1 && info.channels <= 2;
+}
+
+int64_t TrackSource::totalFrames() const {
+    const int frameBytes = mInfo.channels * (mInfo.bitsPerSample / 8);
+    return frameBytes > 0 ? (int64_t)(mInfo.dataSize / (size_t)frameBytes) : 0;
+}
+
+bool TrackSource::skipSilent(Lane8* grp, int lane, int64_t frame, int frames) {
+    if (!mSilence || !mSilence->silent(frame, frames)) return false;
+    for (int f = 0; f < frames; ++f) {
+        for (int c = 0; c < mInfo.channels; ++c) grp[f].v[lane + c] = 0.0f;
+    }
+    return true;
+}
+
+int TrackSource::readResident(Lane8* grp, int lane, int64_t frame, int frames) {
+    if (inMemory()) {
+        seekFrame(frame);
+        return readLanes(grp, lane, frames);
+    }
+    mLastSilent = false;
+    const int n = (int)std::max<int64_t>(0, std::min<int64_t>(frames, totalFrames() - frame));
+    if (n <= 0 || frame < 0 || !skipSilent(grp, lane, frame, n)) return 0;
+    mLastSilent = true;
+    return n;
+}
+
+void decodePcmToLanes(const uint8_t* src, int bytesPerSample, int channels,
+                      Lane8* grp, int lane, int frames) {
+    if (bytesPerSample == 2) {
+        for (int f = 0; f < frames; ++f) {
+            for (int c = 0; c < channels; ++c) {
+                int16_t s;
+                std::memcpy(&s, src, 2);
+                grp[f].v[lane + c] = (float)s * (1.0f / 32768.0f);
+                src += 2;
+            }
+        }
+    } else {
+        for (int f = 0; f < frames; ++f) {
+            for (int c = 0; c < channels; ++c) {
+                int v = (src[2] << 16) | (src[1] << 8) | src[0];
+                if (v & 0x800000) v |= ~0xFFFFFF; // sign extend
+                grp[f].v[lane + c] = (float)v * (1.0f / 8388608.0f);
+                src += 3;
+            }
+        }
+    }
+}
+
+namespace {
+
+// Leitura do arquivo em blocos; o scratch é alocado na abertura, não no render.
+// O cue guarda os primeiros frames do destino de um salto; depois do salto eles
+// são consumidos de `mHead` enquanto o arquivo já está posicionado logo após.
+// Trechos silenciosos (mapa) não são lidos: o arquivo fica para trás e só é
+// reposicionado na próxima leitura de verdade.
+class FileTrackSource : public TrackSource {
+public:
+    static constexpr int kScratchFrames = 1024;
+
+    bool open(const std::string &path) {
+        mIfs.open(path, std::ios::binary);
+        if (!mIfs.is_open() || !parseWavHeader(mIfs, mInfo) || !isMixablePcm(mInfo)) return false;
+        mFrameBytes = mInfo.channels * (mInfo.bitsPerSample / 8);
+        mScratch.resize((size_t)kScratchFrames * mFrameBytes);
+        mHead.resize(mScratch.size());
+        mCue.resize(mScratch.size());
+        seekFrame(0);
+        return true;
+    }
+
+    int readLanes(Lane8* grp, int lane, int frames) override {
+        mLastSilent = false;
+        int done = 0;
+        if (mHeadPos < mHeadFrames) {
+            const int n = std::min(frames, mHeadFrames - mHeadPos);
+            decodePcmToLanes(mHead.data() + (size_t)mHeadPos * mFrameBytes, mInfo.bitsPerSample / 8,
+                             mInfo.channels, grp, lane, n);
+            mHeadPos += n;
+            mPos += n;
+            done = n;
+        } else if (!mEnded) {
+            const int n = (int)std::min<int64_t>(frames, totalFrames() - mPos);
+            if (skipSilent(grp, lane, mPos, n)) {
+                mPos += n;
+                mFileBehind = true;
+                mEnded = mPos >= totalFrames();
+                mLastSilent = true;
+                return n;
+            }
+        }
+        if (done < frames && mFileBehind && !mEnded) seekFile(mPos);
+        while (done < frames && !mEnded) {
+            const int n = std::min(frames - done, kScratchFrames);
+            mIfs.read(reinterpret_cast<char*>(mScratch.data()), (std::streamsize)n * mFrameBytes);
+            const int got = (int)(mIfs.gcount() / mFrameBytes);
+            if (got <= 0) { mEnded = true; break; }
+            decodePcmToLanes(mScratch.data(), mInfo.bitsPerSample / 8, mInfo.channels, grp + done, lane, got);
+            done += got;
+            mPos += got;
+            if (got < n) mEnded = true;
+        }
+        return done;
+    }
+
+    void seekFrame(int64_t frame) override {
+        const int64_t total = totalFrames();
+        frame = std::max<int64_t>(0, std::min(frame, total));
+        // Início lido por prime() e ainda intacto: nada a fazer
+        if (frame == mHeadStart && mHeadPos == 0 && mHeadFrames > 0) return;
+        mPos = frame;
+        mHeadPos = mHeadFrames = 0;
+        mHeadStart = -1;
+        seekFile(frame);
+    }
+
+    bool inMemory() const override { return false; }
+
+    void cueFrame(int64_t frame) override {
+        const int64_t total = totalFrames();
+        frame = std::max<int64_t>(0, std::min(frame, total));
+        mCueFrame = frame;
+        // Destino em silêncio: nada a ler, a leitura normal (pelo mapa) cobre
+        if (mSilence && mSilence->silent(frame, (int)std::min<int64_t>(kScratchFrames, total - frame))) {
+            mCueFrames = 0;
+            return;
+        }
+        // Lê o destino e devolve o arquivo para onde a leitura normal estava
+        mIfs.clear();
+        const std::streampos here = mIfs.tellg();
+        mIfs.seekg((std::streamoff)(mInfo.dataOffset + (size_t)frame * mFrameBytes), std::ios::beg);
+        mIfs.read(reinterpret_cast<char*>(mCue.data()), (std::streamsize)kScratchFrames * mFrameBytes);
+        mCueFrames = (int)(mIfs.gcount() / mFrameBytes);
+        mIfs.clear();
+        if (here != std::streampos(-1)) mIfs.seekg(here);
+    }
+
+    void jumpToCue() override {
+        if (mCueFrame < 0) return;
+        mHead.swap(mCue);
+        mHeadFrames = mCueFrames;
+        mHeadPos = 0;
+        mHeadStart = mCueFrame;
+        mPos = mCueFrame;
+        seekFile(mCueFrame + mCueFrames);
+        mCueFrame = -1;
+    }
+
+private:
+    void seekFile(int64_t frame) {
+        mIfs.clear();
+        mIfs.seekg((std::streamoff)(mInfo.dataOffset + (size_t)frame * mFrameBytes), std::ios::beg);
+        mEnded = frame >= totalFrames();
+        mFileBehind = false;
+    }
+
+    std::ifstream mIfs;
+    std::vector<uint8_t> mScratch;
+    std::vector<uint8_t> mHead;
+    std::vector<uint8_t> mCue;
+    int mHeadFrames = 0;
+    int mHeadPos = 0;
+    int64_t mHeadStart = -1; // frame do arquivo em mHead[0]
+    int64_t mPos = 0;        // próximo frame entregue por readLanes
+    int mCueFrames = 0;
+    int mFrameBytes = 0;
+    bool mEnded = false;
+    bool mFileBehind = false; // leituras puladas pelo mapa; o arquivo está atrás de mPos
+};
+
+class MemoryTrackSource : public TrackSource {
+public:
+    explicit MemoryTrackSource(std::shared_ptr<const PcmImage> image) : mImage(std::move(image)) {
+        mInfo = mImage->info;
+        mFrameBytes = mInfo.channels * (mInfo.bitsPerSample / 8);
+        mFrames = (int64_t)(mImage->data.size() / (size_t)mFrameBytes);
+    }
+
+    int readLanes(Lane8* grp, int lane, int frames) override {
+        const int n = (int)std::max<int64_t>(0, std::min<int64_t>(frames, mFrames - mPos));
+        mLastSilent = false;
+        if (n <= 0) return 0;
+        mLastSilent = skipSilent(grp, lane, mPos, n);
+        if (!mLastSilent) {
+            decodePcmToLanes(mImage->data.data() + (size_t)mPos * mFrameBytes, mInfo.bitsPerSample / 8,
+                             mInfo.channels, grp, lane, n);
+        }
+        mPos += n;
+        return n;
+    }
+
+    void seekFrame(int64_t frame) override {
+        mPos = std::max<int64_t>(0, std::min(frame, mFrames));
+    }
+
+    bool inMemory() const override { return true; }
+
+private:
+    std::shared_ptr<const PcmImage> mImage;
+    int mFrameBytes = 0;
+    int64_t mFrames = 0;
+    int64_t mPos = 0;
+};
+
+} // namespace
+
+std::unique_ptr<TrackSource> openFileTrackSource(const std::string &path) {
+    std::unique_ptr<FileTrackSource> src(new FileTrackSource());
+    if (!src->open(path)) return nullptr;
+    return src;
+}
+
+std::unique_ptr<TrackSource> makeMemoryTrackSource(std::shared_ptr<const PcmImage> image) {
+    if (!image || !isMixablePcm(image->info) || image->data.empty()) return nullptr;
+    return std::unique_ptr<TrackSource>(new MemoryTrackSource(std::move(image)));
+}
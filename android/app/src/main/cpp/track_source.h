@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "insert_chain.h"
+#include "silence_map.h"
+#include "wav_io.h"
+
+// Origem do PCM de uma track do mixer. O formato fica empacotado como no
+// arquivo (int16 ou int24) e só vira float na hora do render, direto nas
+// lanes do grupo. Uma fonte pertence a uma única track e só o thread de
+// render (ou o worker do grupo dela) chama readLanes/seekFrame.
+
+// Arquivo inteiro em RAM (cache de preload), imutável depois de carregado
+struct PcmImage {
+    WavInfo info;
+    std::vector<uint8_t> data;
+};
+
+// PCM inteiro 16/24 bits, mono ou estéreo: o que o mixer sabe tocar
+bool isMixablePcm(const WavInfo &info);
+
+class TrackSource {
+public:
+    virtual ~TrackSource() = default;
+
+    const WavInfo& info() const { return mInfo; }
+    int64_t totalFrames() const;
+
+    // Lê até `frames` frames para grp[f].v[lane + c]; devolve os frames lidos
+    // (0 = fim do arquivo). Não zera o resto do bloco.
+    virtual int readLanes(Lane8* grp, int lane, int frames) = 0;
+    // Posiciona no frame (além do fim = fim)
+    virtual void seekFrame(int64_t frame) = 0;
+    // true se a leitura não toca disco
+    virtual bool inMemory() const = 0;
+    // Prepara um salto para `frame`: o início do destino fica lido antes,
+    // então jumpToCue() não espera disco. Um cue novo substitui o anterior.
+    virtual void cueFrame(int64_t frame) { mCueFrame = frame; }
+    // Continua a leitura no frame preparado por cueFrame (sem cue: nada muda)
+    virtual void jumpToCue() {
+        if (mCueFrame >= 0) seekFrame(mCueFrame);
+        mCueFrame = -1;
+    }
+    // Scrub: como seekFrame(frame) + readLanes, mas só com o que já está na
+    // memória (imagem do preload, chunk já lido, trecho silencioso no mapa),
+    // sem nunca esperar disco. Devolve os frames servidos a partir de `frame`;
+    // o resto (miss) fica para quem chama zerar.
+    virtual int readResident(Lane8* grp, int lane, int64_t frame, int frames);
+    // Scrub: alvo do gesto. Fontes que leem adiantado pedem o trecho ao Io;
+    // as outras ignoram (o cueFrame delas lê na hora).
+    virtual void scrubCue(int64_t frame) { (void)frame; }
+    // Posiciona em `frame` com o início já lido (prepare antes do play); um
+    // seekFrame para o mesmo frame antes da primeira leitura não descarta isso
+    void prime(int64_t frame) {
+        cueFrame(frame);
+        jumpToCue();
+    }
+    // Com mapa, leituras que caem inteiras em blocos silenciosos só zeram as
+    // lanes: nada é lido do disco nem decodificado
+    void setSilenceMap(std::shared_ptr<const SilenceMap> map) { mSilence = std::move(map); }
+    // A última readLanes foi servida pelo mapa (lanes em zero)
+    bool lastReadSilent() const { return mLastSilent; }
+
+protected:
+    // true (e lanes zeradas) se [frame, frame + frames) é silêncio no mapa
+    bool skipSilent(Lane8* grp, int lane, int64_t frame, int frames);
+
+    WavInfo mInfo;
+    int64_t mCueFrame = -1;
+    std::shared_ptr<const SilenceMap> mSilence;
+    bool mLastSilent = false;
+};
+
+// nullptr se o arquivo não abrir ou não for PCM tocável
+std::unique_ptr<TrackSource> openFileTrackSource(const std::string &path);
+std::unique_ptr<TrackSource> makeMemoryTrackSource(std::shared_ptr<const PcmImage> image);
+
+// Converte `frames` frames empacotados (`bytesPerSample` 2 ou 3) para float nas lanes
+void decodePcmToLanes(const uint8_t* src, int bytesPerSample, int channels,
+                      Lane8* grp, int lane, int frames);
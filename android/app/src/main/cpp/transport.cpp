@@ -0,0 +1,133 @@
+#include "transport.h"
+
+TransportControl gTransport;
+
+TransportEvent transportNextEvent(TransportState &state, int64_t position) {
+    TransportEvent ev;
+    if (state.jumpTarget >= 0) {
+        if (state.jumpAt < 0) {
+            int64_t at = position;
+            if (state.gridPeriod > 0) {
+                if (position <= state.gridOrigin) {
+                    at = state.gridOrigin;
+                } else {
+                    const int64_t k = (position - state.gridOrigin + state.gridPeriod - 1) / state.gridPeriod;
+                    at = state.gridOrigin + k * state.gridPeriod;
+                }
+            }
+            state.jumpAt = at;
+        }
+        ev.at = state.jumpAt < position ? position : state.jumpAt;
+        ev.target = state.jumpTarget;
+        ev.isJump = true;
+    }
+    const bool looping = state.loopStart >= 0 && state.loopEnd > state.loopStart;
+    // Empate com o fim do loop: o salto ganha (é o "sai do vamp")
+    if (looping && position < state.loopEnd && (ev.at < 0 || state.loopEnd < ev.at)) {
+        ev.at = state.loopEnd;
+        ev.target = state.loopStart;
+        ev.isJump = false;
+    }
+    return ev;
+}
+
+template <typename Fn>
+void TransportControl::edit(Fn fn) {
+    while (mLock.test_and_set(std::memory_order_acquire)) {
+    }
+    fn(mState);
+    mVersion.fetch_add(1, std::memory_order_release);
+    mLock.clear(std::memory_order_release);
+}
+
+bool TransportControl::setLoop(int64_t startFrame, int64_t endFrame) {
+    if (startFrame < 0 || endFrame - startFrame < kTransportMinLoopFrames) return false;
+    edit([&](TransportState &s) {
+        s.loopStart = startFrame;
+        s.loopEnd = endFrame;
+    });
+    return true;
+}
+
+void TransportControl::clearLoop() {
+    edit([](TransportState &s) {
+        s.loopStart = -1;
+        s.loopEnd = -1;
+    });
+}
+
+void TransportControl::scheduleJump(int64_t targetFrame, int64_t atFrame) {
+    if (targetFrame < 0) targetFrame = 0;
+    edit([&](TransportState &s) {
+        s.jumpTarget = targetFrame;
+        s.jumpAt = atFrame < 0 ? 0 : atFrame; // 0 = já passou = próximo bloco
+        s.gridOrigin = 0;
+        s.gridPeriod = 0;
+        ++s.jumpId;
+    });
+}
+
+bool TransportControl::scheduleJumpOnGrid(int64_t targetFrame, int64_t gridOrigin, int64_t gridPeriod) {
+    if (gridPeriod <= 0 || gridOrigin < 0) return false;
+    if (targetFrame < 0) targetFrame = 0;
+    edit([&](TransportState &s) {
+        s.jumpTarget = targetFrame;
+        s.jumpAt = -1;
+        s.gridOrigin = gridOrigin;
+        s.gridPeriod = gridPeriod;
+        ++s.jumpId;
+    });
+    return true;
+}
+
+void TransportControl::cancelJump() {
+    edit([](TransportState &s) { s.jumpTarget = -1; });
+}
+
+void TransportControl::reset() {
+    edit([](TransportState &s) {
+        const uint32_t id = s.jumpId;
+        s = TransportState();
+        s.jumpId = id;
+    });
+}
+
+bool TransportControl::poll(TransportState &out) {
+    const uint32_t v = mVersion.load(std::memory_order_acquire);
+    if (v == mSeen) return false;
+    if (mLock.test_and_set(std::memory_order_acquire)) return false;
+    out = mState;
+    mSeen = mVersion.load(std::memory_order_relaxed);
+    mLock.clear(std::memory_order_release);
+    if (out.jumpId == mDoneJumpId) out.jumpTarget = -1;
+    return true;
+}
+
+void TransportControl::jumpDone(TransportState &state) {
+    mDoneJumpId = state.jumpId;
+    state.jumpTarget = -1;
+}
+
+extern "C" {
+
+int32_t mtp_transport_set_loop(int64_t startFrame, int64_t endFrame) {
+    return gTransport.setLoop(startFrame, endFrame) ? 1 : 0;
+}
+
+void mtp_transport_clear_loop(void) {
+    gTransport.clearLoop();
+}
+
+void mtp_transport_jump(int64_t targetFrame, int64_t atFrame) {
+    gTransport.scheduleJump(targetFrame, atFrame);
+}
+
+int32_t mtp_transport_jump_on_grid(int64_t targetFrame, int64_t gridOrigin, int64_t gridPeriod) {
+    return gTransport.scheduleJumpOnGrid(targetFrame, gridOrigin, gridPeriod) ? 1 : 0;
+}
+
+void mtp_transport_cancel_jump(void) {
+    gTransport.cancelJump();
+}
+
+} // extern "C"
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "engine_shared.h"
+
+// Loop e saltos com precisão de amostra. O controle (JNI/dart:ffi) descreve
+// o que quer em frames da sessão; o render lê o estado no começo de cada
+// bloco, corta o bloco exatamente na fronteira e salta com um micro
+// crossfade, com o destino já lido antecipadamente (TrackSource::cueFrame).
+
+// Frames do crossfade entre o fim do trecho antigo e o início do destino
+static const int kTransportXfadeFrames = 128;
+// Loop mais curto aceito (cobre um bloco de render mais o crossfade)
+static const int64_t kTransportMinLoopFrames = 1024;
+
+struct TransportState {
+    // Loop ativo quando loopEnd > loopStart >= 0: ao chegar em loopEnd volta a loopStart
+    int64_t loopStart = -1;
+    int64_t loopEnd = -1;
+    // Salto pendente quando jumpTarget >= 0. Com jumpAt >= 0 ele acontece
+    // exatamente nesse frame (no passado = no próximo bloco); senão na próxima
+    // linha da grade gridOrigin + k * gridPeriod (ex.: próximo compasso).
+    int64_t jumpTarget = -1;
+    int64_t jumpAt = -1;
+    int64_t gridOrigin = 0;
+    int64_t gridPeriod = 0;
+    uint32_t jumpId = 0;
+};
+
+// Próxima fronteira a partir de `position`: em `at` a reprodução continua em `target`
+struct TransportEvent {
+    int64_t at = -1;
+    int64_t target = -1;
+    bool isJump = false; // false = volta do loop
+};
+
+// Resolve a próxima fronteira; um salto na grade fica fixado em state.jumpAt
+// na primeira resolução. at < 0 = nenhuma.
+TransportEvent transportNextEvent(TransportState &state, int64_t position);
+
+class TransportControl {
+public:
+    // Lado do controle; serializados entre si por um spinlock curto
+    bool setLoop(int64_t startFrame, int64_t endFrame);
+    void clearLoop();
+    void scheduleJump(int64_t targetFrame, int64_t atFrame);
+    bool scheduleJumpOnGrid(int64_t targetFrame, int64_t gridOrigin, int64_t gridPeriod);
+    void cancelJump();
+    // Início de sessão: sem loop nem salto
+    void reset();
+
+    // Lado do render: copia o estado se ele mudou desde a última cópia. Nunca
+    // espera; se o controle estiver escrevendo, tenta de novo no próximo bloco.
+    bool poll(TransportState &out);
+    // O render executou o salto de `state`; cópias futuras não o repetem
+    void jumpDone(TransportState &state);
+
+private:
+    template <typename Fn> void edit(Fn fn);
+
+    std::atomic_flag mLock = ATOMIC_FLAG_INIT;
+    TransportState mState;
+    std::atomic<uint32_t> mVersion{0};
+    // Só o render
+    uint32_t mSeen = 0;
+    uint32_t mDoneJumpId = 0;
+};
+
+extern TransportControl gTransport;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frames na taxa da sessão (mtp_status()[MTP_STATUS_SAMPLE_RATE]).
+// Devolve 0 se a região for menor que kTransportMinLoopFrames.
+MTP_EXPORT int32_t mtp_transport_set_loop(int64_t startFrame, int64_t endFrame);
+MTP_EXPORT void mtp_transport_clear_loop(void);
+// atFrame < 0 = no próximo bloco
+MTP_EXPORT void mtp_transport_jump(int64_t targetFrame, int64_t atFrame);
+// Salta na próxima linha da grade (gridPeriod > 0); devolve 0 se a grade for inválida
+MTP_EXPORT int32_t mtp_transport_jump_on_grid(int64_t targetFrame, int64_t gridOrigin, int64_t gridPeriod);
+MTP_EXPORT void mtp_transport_cancel_jump(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,400 @@
+#include "wav_analysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "file_probe.h"
+#include "thread_topology.h"
+
+// --- BPM detection utilities (simple envelope + autocorrelation) ---
+// Frames por leitura nas análises que abrem o arquivo
+static const size_t kAnalysisChunkFrames = 4096;
+// Versão do índice .mtpa; muda quando o layout ou os structs mudarem
+static const char kIndexMagic[4] = { 'M', 'T', 'P', 'A' };
+static const uint32_t kIndexVersion = 1;
+// Mais que isso indica índice corrompido
+static const uint32_t kMaxIndexPeaks = 1 << 20;
+
+void decodeAnalyzableFrames(const unsigned char* src, const WavInfo &info, size_t frames, float* out) {
+    const size_t samples = frames * (size_t)info.channels;
+    if (info.audioFormat == 1 && info.bitsPerSample == 16) {
+        for (size_t i = 0; i < samples; ++i, src += 2) {
+            int16_t s;
+            std::memcpy(&s, src, 2);
+            out[i] = (float)s / 32768.0f;
+        }
+    } else if (info.audioFormat == 1 && info.bitsPerSample == 24) {
+        for (size_t i = 0; i < samples; ++i, src += 3) {
+            int v = (src[2] << 16) | (src[1] << 8) | src[0];
+            if (v & 0x800000) v |= ~0xFFFFFF; // sign extend
+            out[i] = (float)((double)v / 8388608.0); // 2^23
+        }
+    } else {
+        std::memcpy(out, src, samples * sizeof(float));
+    }
+}
+
+EnvelopeBuilder::EnvelopeBuilder(int sampleRate) {
+    // Target envelope sampling rate ~200 Hz
+    const float targetFs = 200.0f;
+    mDecim = std::max(1, (int)std::floor((float)std::max(1, sampleRate) / targetFs));
+    mEnvFs = (float)std::max(1, sampleRate) / (float)mDecim;
+}
+
+void EnvelopeBuilder::add(const float* frames, int channels, size_t count) {
+    for (size_t f = 0; f < count; ++f, frames += channels) {
+        double sum = 0.0;
+        for (int ch = 0; ch < channels; ++ch) {
+            // clamp just in case (float32)
+            sum += (double)std::min(1.5f, std::max(-1.5f, frames[ch]));
+        }
+        mAcc += std::fabs(sum / (double)channels);
+        if (++mCount >= mDecim) {
+            mEnv.push_back((float)(mAcc / (double)mDecim));
+            mAcc = 0.0;
+            mCount = 0;
+        }
+    }
+}
+
+bool EnvelopeBuilder::finish(std::vector<float> &env, float &envFs) {
+    envFs = mEnvFs;
+    env.swap(mEnv);
+    mEnv.clear();
+    if (env.size() < (size_t)(envFs * 3)) {
+        // menos de 3s de envelope
+        return false;
+    }
+
+    // Smooth envelope with small moving average (~50 ms)
+    const int w = std::max(1, (int)std::round(envFs * 0.05f));
+    if (w > 1) {
+        std::vector<float> sm(env.size(), 0.0f);
+        double sum = 0.0;
+        for (size_t i = 0; i < env.size(); ++i) {
+            sum += env[i];
+            if (i >= (size_t)w) sum -= env[i - w];
+            sm[i] = (float)(sum / (double)std::min((size_t)w, i + 1));
+        }
+        env.swap(sm);
+    }
+    return true;
+}
+
+PeakBuilder::PeakBuilder(size_t framesTotal, int points) {
+    if (framesTotal == 0 || points <= 0) return;
+    mFramesPerBucket = std::max<size_t>(1, framesTotal / (size_t)points);
+    const size_t count = std::min<size_t>((size_t)points, (framesTotal + mFramesPerBucket - 1) / mFramesPerBucket);
+    mPeaks.assign(count, 0.0f);
+}
+
+void PeakBuilder::add(const float* frames, int channels, size_t count) {
+    for (size_t f = 0; f < count; ++f, frames += channels, ++mFrames) {
+        const size_t bucket = mFrames / mFramesPerBucket;
+        if (bucket >= mPeaks.size()) continue;
+        // Média de |x| dos canais, normalizada para 0..1
+        double sum = 0.0;
+        for (int ch = 0; ch < channels; ++ch) sum += std::min(1.0, (double)std::fabs(frames[ch]));
+        mPeaks[bucket] = std::max(mPeaks[bucket], (float)(sum / (double)channels));
+    }
+}
+
+std::vector<float> PeakBuilder::finish() {
+    const size_t used = std::min(mPeaks.size(), (mFrames + mFramesPerBucket - 1) / mFramesPerBucket);
+    std::vector<float> out(mPeaks.begin(), mPeaks.begin() + (std::ptrdiff_t)used);
+    for (float &v : out) v = std::min(1.0f, v);
+    return out;
+}
+
+bool buildEnvelopeDownsampled(std::ifstream &ifs, const WavInfo &info, std::vector<float> &env, float &envFs) {
+    const int bytesPerSample = info.bitsPerSample / 8; // 2 for 16-bit, 3 for 24-bit, 4 for float32
+    const int frameBytes = bytesPerSample * info.channels;
+    if (frameBytes <= 0 || info.sampleRate <= 0 || info.dataSize == 0) return false;
+    // Unsupported
+    if (!isAnalyzableWav(info)) return false;
+
+    const size_t totalFrames = info.dataSize / frameBytes;
+    if (totalFrames < (size_t)info.sampleRate) {
+        // menos de 1s de áudio
+        return false;
+    }
+
+    std::vector<unsigned char> buffer(kAnalysisChunkFrames * frameBytes);
+    std::vector<float> frames(kAnalysisChunkFrames * (size_t)info.channels);
+    ifs.seekg((std::streamoff)info.dataOffset, std::ios::beg);
+
+    EnvelopeBuilder builder(info.sampleRate);
+    size_t framesProcessed = 0;
+    while (framesProcessed < totalFrames) {
+        const size_t framesToRead = std::min(kAnalysisChunkFrames, totalFrames - framesProcessed);
+        ifs.read(reinterpret_cast<char*>(buffer.data()), (std::streamsize)(framesToRead * frameBytes));
+        if (!ifs) break;
+        decodeAnalyzableFrames(buffer.data(), info, framesToRead, frames.data());
+        builder.add(frames.data(), info.channels, framesToRead);
+        framesProcessed += framesToRead;
+    }
+    return builder.finish(env, envFs);
+}
+
+void autocorrelationRange(const std::vector<float> &env, float envFs, int lagMin, int lagMax, double &bestCorr, int &bestLag, double &avgCorr) {
+    // Zero-mean
+    double mean = 0.0;
+    for (float v : env) mean += v;
+    mean /= (double)env.size();
+
+    double var = 0.0;
+    std::vector<float> z(env.size());
+    for (size_t i = 0; i < env.size(); ++i) {
+        float d = env[i] - (float)mean;
+        z[i] = d;
+        var += (double)d * (double)d;
+    }
+    if (var <= 1e-12) { bestCorr = 0.0; bestLag = lagMin; avgCorr = 0.0; return; }
+
+    bestCorr = -1.0; bestLag = lagMin; avgCorr = 0.0;
+    int count = 0;
+    for (int L = lagMin; L <= lagMax; ++L) {
+        const size_t N = z.size() - (size_t)L;
+        if (N <= 10) continue;
+        double num = 0.0;
+        for (size_t i = 0; i < N; ++i) {
+            num += (double)z[i] * (double)z[i + L];
+        }
+        // Normalize by variance part (approx): var is sum(z^2)
+        double corr = num / var;
+        if (corr > bestCorr) { bestCorr = corr; bestLag = L; }
+        avgCorr += corr;
+        count++;
+    }
+    if (count > 0) avgCorr /= (double)count; else avgCorr = 0.0;
+}
+
+BpmEstimate estimateBpmFromEnvelope(const std::vector<float> &env, float envFs) {
+    BpmEstimate out;
+    // BPM range: 60..200
+    int lagMax = std::max(1, (int)std::round(envFs * 60.0f / 60.0f));
+    int lagMin = std::max(1, (int)std::round(envFs * 60.0f / 200.0f));
+    if (lagMax <= lagMin + 2) lagMax = lagMin + 3;
+
+    double bestCorr = 0.0, avgCorr = 0.0; int bestLag = lagMin;
+    autocorrelationRange(env, envFs, lagMin, lagMax, bestCorr, bestLag, avgCorr);
+    if (bestLag < 1) bestLag = std::max(1, lagMin);
+    out.bpm = 60.0 * (double)envFs / (double)bestLag;
+
+    // Confidence heuristic: ratio of bestCorr to avgCorr
+    if (bestCorr <= 1e-9) out.confidence = 0.2;
+    else if (avgCorr <= 1e-9) out.confidence = std::min(1.0, std::max(0.3, bestCorr));
+    else out.confidence = std::min(1.0, std::max(0.3, bestCorr / std::max(1e-6, avgCorr)));
+    return out;
+}
+
+bool isAnalyzableWav(const WavInfo &info) {
+    return (info.audioFormat == 1 && (info.bitsPerSample == 16 || info.bitsPerSample == 24))
+           || (info.audioFormat == 3 && info.bitsPerSample == 32);
+}
+
+static bool openAnalyzable(const char* path, std::ifstream &ifs, WavInfo &info) {
+    if (!path) return false;
+    ifs.open(path, std::ios::binary);
+    return ifs.is_open() && parseWavHeader(ifs, info) && isAnalyzableWav(info);
+}
+
+void beatGridFromEnvelope(const std::vector<float> &env, float envFs, double durationSec, MtpBeatGridInfo &out) {
+    out = MtpBeatGridInfo{};
+    const BpmEstimate est = estimateBpmFromEnvelope(env, envFs);
+    const double period = (double)envFs * 60.0 / est.bpm; // em amostras do envelope
+    const size_t n = env.size();
+    out.bpm = est.bpm;
+    out.confidence = est.confidence;
+    out.periodSec = 60.0 / est.bpm;
+
+    // Fase da grade: offset que maximiza a soma dos ataques (derivada positiva)
+    std::vector<float> onset(n, 0.0f);
+    for (size_t i = 1; i < n; ++i) onset[i] = std::max(0.0f, env[i] - env[i - 1]);
+    double bestPhase = 0.0, bestScore = -1.0;
+    for (int ph = 0; ph < (int)std::ceil(period); ++ph) {
+        double score = 0.0;
+        for (double pos = ph; pos < (double)n; pos += period) {
+            const size_t i = (size_t)std::lround(pos);
+            if (i < n) score += onset[i];
+        }
+        if (score > bestScore) { bestScore = score; bestPhase = ph; }
+    }
+    // A média móvel do envelope é causal: o ataque aparece no próprio bucket
+    double firstSec = bestPhase / (double)envFs;
+    while (firstSec < 0.0) firstSec += out.periodSec;
+    out.firstBeatSec = firstSec;
+    out.beats = std::max(0, (int)std::floor((durationSec - firstSec) / out.periodSec) + 1);
+}
+
+float* fillBeatGrid(const MtpBeatGridInfo &info) {
+    float* grid = static_cast<float*>(std::malloc(sizeof(float) * (size_t)std::max(1, info.beats)));
+    if (!grid) return nullptr;
+    for (int k = 0; k < info.beats; ++k) grid[k] = (float)(info.firstBeatSec + k * info.periodSec);
+    return grid;
+}
+
+std::string analysisIndexPath(const std::string &wavPath) {
+    return wavPath + ".mtpa";
+}
+
+bool loadAnalysisIndex(const std::string &wavPath, AnalysisIndex &out) {
+    MtpFileProbe probe;
+    if (!probeFile(wavPath, probe)) return false;
+    FILE* f = std::fopen(analysisIndexPath(wavPath).c_str(), "rb");
+    if (!f) return false;
+    char magic[4];
+    uint32_t version = 0, hasGrid = 0, count = 0;
+    bool ok = std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, kIndexMagic, 4) == 0 &&
+              std::fread(&version, sizeof(version), 1, f) == 1 && version == kIndexVersion &&
+              std::fread(&out.fileSize, sizeof(out.fileSize), 1, f) == 1 &&
+              std::fread(&out.mtimeNs, sizeof(out.mtimeNs), 1, f) == 1 &&
+              out.fileSize == probe.fileSize && out.mtimeNs == probe.mtimeNs &&
+              std::fread(&out.framesTotal, sizeof(out.framesTotal), 1, f) == 1 &&
+              std::fread(&out.wave, sizeof(out.wave), 1, f) == 1 &&
+              std::fread(&hasGrid, sizeof(hasGrid), 1, f) == 1 &&
+              std::fread(&out.grid, sizeof(out.grid), 1, f) == 1 &&
+              std::fread(&count, sizeof(count), 1, f) == 1 && count <= kMaxIndexPeaks;
+    if (ok) {
+        out.peaks.resize(count);
+        ok = std::fread(out.peaks.data(), sizeof(float), count, f) == count;
+    }
+    std::fclose(f);
+    out.hasGrid = hasGrid != 0;
+    out.wave.points = (int32_t)out.peaks.size();
+    return ok;
+}
+
+bool saveAnalysisIndex(const std::string &wavPath, const AnalysisIndex &index) {
+    // Temporário + rename, como o cache de file_probe
+    const std::string file = analysisIndexPath(wavPath);
+    const std::string tmp = file + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    const uint32_t hasGrid = index.hasGrid ? 1 : 0;
+    const uint32_t count = (uint32_t)index.peaks.size();
+    bool ok = std::fwrite(kIndexMagic, 1, 4, f) == 4 &&
+              std::fwrite(&kIndexVersion, sizeof(kIndexVersion), 1, f) == 1 &&
+              std::fwrite(&index.fileSize, sizeof(index.fileSize), 1, f) == 1 &&
+              std::fwrite(&index.mtimeNs, sizeof(index.mtimeNs), 1, f) == 1 &&
+              std::fwrite(&index.framesTotal, sizeof(index.framesTotal), 1, f) == 1 &&
+              std::fwrite(&index.wave, sizeof(index.wave), 1, f) == 1 &&
+              std::fwrite(&hasGrid, sizeof(hasGrid), 1, f) == 1 &&
+              std::fwrite(&index.grid, sizeof(index.grid), 1, f) == 1 &&
+              std::fwrite(&count, sizeof(count), 1, f) == 1 &&
+              std::fwrite(index.peaks.data(), sizeof(float), count, f) == count;
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Buckets pedidos a partir dos do índice: cada bucket do índice entra no
+// bucket pedido que contém o seu centro (igual à leitura quando `points` é o
+// mesmo do índice; nos outros casos a borda erra no máximo meio bucket do
+// índice). nullptr se o índice for mais grosso que o pedido.
+static float* peaksFromIndex(const AnalysisIndex &index, int32_t points, MtpWaveformInfo &out) {
+    const size_t framesTotal = (size_t)std::max<int64_t>(0, index.framesTotal);
+    if (framesTotal == 0 || index.peaks.empty()) return nullptr;
+    const size_t indexPerBucket = std::max<size_t>(1, framesTotal / index.peaks.size());
+    const size_t framesPerBucket = std::max<size_t>(1, framesTotal / (size_t)points);
+    if (framesPerBucket < indexPerBucket) return nullptr;
+    const size_t count = std::min<size_t>((size_t)points, (framesTotal + framesPerBucket - 1) / framesPerBucket);
+    float* peaks = static_cast<float*>(std::malloc(sizeof(float) * count));
+    if (!peaks) return nullptr;
+    std::vector<uint8_t> filled(count, 0);
+    std::fill(peaks, peaks + count, 0.0f);
+    for (size_t i = 0; i < index.peaks.size(); ++i) {
+        const size_t j = std::min(count - 1, (i * indexPerBucket + indexPerBucket / 2) / framesPerBucket);
+        peaks[j] = std::max(peaks[j], index.peaks[i]);
+        filled[j] = 1;
+    }
+    // O índice não cobre o resto da divisão no fim do arquivo
+    for (size_t j = 1; j < count; ++j) {
+        if (!filled[j]) peaks[j] = peaks[j - 1];
+    }
+    out = index.wave;
+    out.points = (int32_t)count;
+    return peaks;
+}
+
+extern "C" {
+
+float* mtp_waveform_peaks(const char* path, int32_t points, MtpWaveformInfo* info) {
+    MtpWaveformInfo local = {};
+    MtpWaveformInfo& out = info ? *info : local;
+    out = MtpWaveformInfo{};
+    if (points <= 0 || !path) return nullptr;
+    AnalysisIndex index;
+    if (loadAnalysisIndex(path, index)) {
+        if (float* peaks = peaksFromIndex(index, points, out)) return peaks;
+    }
+    // Sem índice: lê o arquivo todo, em prioridade de fundo
+    ScopedThreadClass background(ThreadClass::Analysis);
+    std::ifstream ifs;
+    WavInfo wi;
+    if (!openAnalyzable(path, ifs, wi)) return nullptr;
+    const int frameBytes = wi.channels * (wi.bitsPerSample / 8);
+    const size_t framesTotal = wi.dataSize / (size_t)frameBytes;
+    out.sampleRate = wi.sampleRate;
+    out.channels = wi.channels;
+    out.bitsPerSample = wi.bitsPerSample;
+    out.dataBytes = (int64_t)wi.dataSize;
+    out.durationSec = (double)framesTotal / (double)wi.sampleRate;
+    if (framesTotal == 0) return nullptr;
+
+    // Lê em blocos de até 4096 frames independentemente do tamanho do bucket
+    PeakBuilder builder(framesTotal, points);
+    std::vector<unsigned char> buf(kAnalysisChunkFrames * (size_t)frameBytes);
+    std::vector<float> frames(kAnalysisChunkFrames * (size_t)wi.channels);
+    ifs.clear();
+    ifs.seekg((std::streamoff)wi.dataOffset, std::ios::beg);
+    for (size_t done = 0; done < framesTotal;) {
+        const size_t n = std::min(kAnalysisChunkFrames, framesTotal - done);
+        ifs.read(reinterpret_cast<char*>(buf.data()), (std::streamsize)(n * frameBytes));
+        const size_t got = (size_t)ifs.gcount() / (size_t)frameBytes;
+        decodeAnalyzableFrames(buf.data(), wi, got, frames.data());
+        builder.add(frames.data(), wi.channels, got);
+        if (got < n) break;
+        done += n;
+    }
+    const std::vector<float> result = builder.finish();
+    float* peaks = static_cast<float*>(std::malloc(sizeof(float) * std::max<size_t>(1, result.size())));
+    if (!peaks) return nullptr;
+    std::copy(result.begin(), result.end(), peaks);
+    out.points = (int32_t)result.size();
+    return peaks;
+}
+
+float* mtp_beat_grid(const char* path, MtpBeatGridInfo* info) {
+    MtpBeatGridInfo local = {};
+    MtpBeatGridInfo& out = info ? *info : local;
+    out = MtpBeatGridInfo{};
+    if (!path) return nullptr;
+    AnalysisIndex index;
+    if (loadAnalysisIndex(path, index) && index.hasGrid) {
+        out = index.grid;
+        return fillBeatGrid(out);
+    }
+    ScopedThreadClass background(ThreadClass::Analysis);
+    std::ifstream ifs;
+    WavInfo wi;
+    if (!openAnalyzable(path, ifs, wi)) return nullptr;
+    std::vector<float> env;
+    float envFs = 200.0f;
+    if (!buildEnvelopeDownsampled(ifs, wi, env, envFs)) return nullptr;
+    const double durationSec = (double)wi.dataSize / ((double)wi.sampleRate * wi.channels * (wi.bitsPerSample / 8));
+    beatGridFromEnvelope(env, envFs, durationSec, out);
+    return fillBeatGrid(out);
+}
+
+void mtp_buffer_free(void* buffer) {
+    std::free(buffer);
+}
+
+} // extern "C"
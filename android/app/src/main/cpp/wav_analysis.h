@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "wav_io.h"
+#include "engine_shared.h"
+
+// Análise offline de arquivos WAV: envelope/BPM (usado pelo JNI) e buffers
+// de peaks/beat-grid entregues ao Dart via dart:ffi sem cópia. Peaks e grade
+// montados na importação (import_job.h) ficam num índice ao lado do WAV
+// (<arquivo>.mtpa) e são servidos dele enquanto o arquivo não mudar.
+
+// Envelope |x| médio decimado para ~200 Hz e suavizado (~50 ms)
+bool buildEnvelopeDownsampled(std::ifstream &ifs, const WavInfo &info, std::vector<float> &env, float &envFs);
+void autocorrelationRange(const std::vector<float> &env, float envFs, int lagMin, int lagMax, double &bestCorr, int &bestLag, double &avgCorr);
+
+struct BpmEstimate {
+    double bpm = 120.0;
+    double confidence = 0.2;
+};
+// BPM (60..200) pela autocorrelação do envelope
+BpmEstimate estimateBpmFromEnvelope(const std::vector<float> &env, float envFs);
+
+// PCM16/PCM24/Float32, os formatos que a análise sabe decodificar
+bool isAnalyzableWav(const WavInfo &info);
+// Frames do trecho de dados para float intercalado (float32 sem clamp)
+void decodeAnalyzableFrames(const unsigned char* src, const WavInfo &info, size_t frames, float* out);
+
+// Envelope de buildEnvelopeDownsampled montado por partes, a partir de frames
+// já decodificados
+class EnvelopeBuilder {
+public:
+    explicit EnvelopeBuilder(int sampleRate);
+    void add(const float* frames, int channels, size_t count);
+    // Suaviza e entrega o envelope; false com menos de 3 s
+    bool finish(std::vector<float> &env, float &envFs);
+
+private:
+    int mDecim = 1;
+    float mEnvFs = 200.0f;
+    int mCount = 0;
+    double mAcc = 0.0;
+    std::vector<float> mEnv;
+};
+
+// Buckets de mtp_waveform_peaks montados por partes; `framesTotal` vem do
+// cabeçalho, frames além do último bucket são ignorados
+class PeakBuilder {
+public:
+    PeakBuilder(size_t framesTotal, int points);
+    void add(const float* frames, int channels, size_t count);
+    // Buckets até o último frame recebido
+    std::vector<float> finish();
+
+private:
+    size_t mFramesPerBucket = 1;
+    size_t mFrames = 0;
+    std::vector<float> mPeaks;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct MtpWaveformInfo {
+    int32_t sampleRate;
+    int32_t channels;
+    int32_t bitsPerSample;
+    int32_t points;      // quantidade de valores no buffer devolvido
+    int64_t dataBytes;
+    double durationSec;
+} MtpWaveformInfo;
+
+typedef struct MtpBeatGridInfo {
+    double bpm;
+    double confidence;
+    double firstBeatSec;
+    double periodSec;
+    int32_t beats;       // quantidade de valores no buffer devolvido
+    int32_t reserved;
+} MtpBeatGridInfo;
+
+// Os buffers devolvidos são alocados aqui e pertencem ao chamador até
+// mtp_buffer_free; nullptr em caso de erro (info é preenchido quando possível).
+
+// Pico por bucket (0..1, média |x| dos canais), `points` buckets no máximo
+MTP_EXPORT float* mtp_waveform_peaks(const char* path, int32_t points, MtpWaveformInfo* info);
+// Instantes das batidas em segundos, em grade fixa a partir do BPM estimado
+MTP_EXPORT float* mtp_beat_grid(const char* path, MtpBeatGridInfo* info);
+MTP_EXPORT void mtp_buffer_free(void* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Grade a partir do envelope (BPM e fase pelos ataques); preenche tudo menos
+// o buffer, que fillBeatGrid monta
+void beatGridFromEnvelope(const std::vector<float> &env, float envFs, double durationSec, MtpBeatGridInfo &out);
+float* fillBeatGrid(const MtpBeatGridInfo &info);
+
+// Índice de análise gravado ao lado do WAV, válido para o tamanho e mtime
+// que o arquivo tinha quando foi montado
+struct AnalysisIndex {
+    int64_t fileSize = 0;
+    int64_t mtimeNs = 0;
+    int64_t framesTotal = 0;   // do cabeçalho, como em mtp_waveform_peaks
+    MtpWaveformInfo wave{};    // points = peaks.size()
+    std::vector<float> peaks;
+    bool hasGrid = false;
+    MtpBeatGridInfo grid{};
+};
+
+std::string analysisIndexPath(const std::string &wavPath);
+// false se não houver índice ou se o WAV mudou depois dele
+bool loadAnalysisIndex(const std::string &wavPath, AnalysisIndex &out);
+bool saveAnalysisIndex(const std::string &wavPath, const AnalysisIndex &index);
@@ -0,0 +1,78 @@
+#include "wav_io.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+bool parseWavHeader(std::ifstream &ifs, WavInfo &info) {
+    // Read RIFF header
+    char riff[12];
+    ifs.seekg(0, std::ios::beg);
+    ifs.read(riff, 12);
+    if (ifs.gcount() < 12) return false;
+    if (std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) return false;
+
+    bool haveFmt = false;
+    bool haveData = false;
+    while (ifs) {
+        char hdr[8];
+        ifs.read(hdr, 8);
+        if (!ifs || ifs.gcount() < 8) break;
+        int size = *(int32_t*)(hdr + 4);
+        // Ensure little-endian on Android; assuming LE
+        if (std::memcmp(hdr, "fmt ", 4) == 0) {
+            std::vector<char> buf(size);
+            ifs.read(buf.data(), size);
+            if ((int)ifs.gcount() < size) return false;
+            // Parse fmt
+            auto rd16 = [&](int off) { return *(int16_t*)(buf.data() + off); };
+            auto rd32 = [&](int off) { return *(int32_t*)(buf.data() + off); };
+            info.audioFormat = rd16(0);
+            info.channels = rd16(2);
+            info.sampleRate = rd32(4);
+            // byteRate = rd32(8);
+            // blockAlign = rd16(12);
+            if (size >= 16) info.bitsPerSample = rd16(14); else info.bitsPerSample = 0;
+            haveFmt = true;
+        } else if (std::memcmp(hdr, "data", 4) == 0) {
+            std::streampos pos = ifs.tellg();
+            info.dataOffset = (size_t)pos;
+            info.dataSize = (size_t)size;
+            // skip payload to continue scanning if needed
+            ifs.seekg(size, std::ios::cur);
+            haveData = true;
+        } else {
+            // skip unknown chunk
+            ifs.seekg(size, std::ios::cur);
+        }
+        if (haveFmt && haveData) break;
+    }
+    return haveFmt && haveData && info.sampleRate > 0 && info.channels > 0 && info.bitsPerSample > 0 && info.dataSize > 0;
+}
+
+void buildWavHeader(unsigned char* out, int sampleRate, int channels,
+                    int bitsPerSample, size_t dataBytes, size_t headerBytes) {
+    auto put16 = [&](size_t off, uint16_t v) { out[off] = v & 0xFF; out[off + 1] = v >> 8; };
+    auto put32 = [&](size_t off, uint32_t v) {
+        for (int i = 0; i < 4; ++i) out[off + i] = (v >> (8 * i)) & 0xFF;
+    };
+    if (headerBytes < kWavHeaderBytes + 8) headerBytes = kWavHeaderBytes;
+    const int blockAlign = channels * (bitsPerSample / 8);
+    std::memcpy(out, "RIFF", 4);
+    put32(4, (uint32_t)(headerBytes - 8 + dataBytes));
+    std::memcpy(out + 8, "WAVEfmt ", 8);
+    put32(16, 16);
+    put16(20, 1);
+    put16(22, (uint16_t)channels);
+    put32(24, (uint32_t)sampleRate);
+    put32(28, (uint32_t)(sampleRate * blockAlign));
+    put16(32, (uint16_t)blockAlign);
+    put16(34, (uint16_t)bitsPerSample);
+    if (headerBytes > kWavHeaderBytes) {
+        std::memcpy(out + 36, "JUNK", 4);
+        put32(40, (uint32_t)(headerBytes - kWavHeaderBytes - 8));
+        std::memset(out + 44, 0, headerBytes - kWavHeaderBytes - 8);
+    }
+    std::memcpy(out + headerBytes - 8, "data", 4);
+    put32(headerBytes - 4, (uint32_t)dataBytes);
+}
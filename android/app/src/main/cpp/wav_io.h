@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+
+// WAV information structure and header parser
+struct WavInfo {
+    int sampleRate = 44100;
+    int channels = 2;
+    int bitsPerSample = 16;
+    int audioFormat = 1; // 1=PCM, 3=IEEE float
+    size_t dataOffset = 0;
+    size_t dataSize = 0;
+};
+
+bool parseWavHeader(std::ifstream &ifs, WavInfo &info);
+
+// Cabeçalho canônico de 44 bytes (RIFF/fmt/data) para PCM inteiro. Com
+// headerBytes > 44 (mínimo 52) um chunk JUNK completa o espaço, para os dados
+// começarem num offset alinhado (ex.: 4096).
+static const size_t kWavHeaderBytes = 44;
+void buildWavHeader(unsigned char* out, int sampleRate, int channels,
+                    int bitsPerSample, size_t dataBytes, size_t headerBytes = kWavHeaderBytes);
@@ -1,7 +1,9 @@
 // Removed file-level Suppress to avoid tooling complaints in some setups
 package com.example.multitrack_app
 
+import android.Manifest
 import android.content.Context
+import android.content.pm.PackageManager
 import android.media.AudioDeviceInfo
 import android.media.AudioDeviceCallback
 import android.media.AudioFormat
@@ -55,6 +57,14 @@ class MainActivity : FlutterActivity() {
     )
     @Volatile private var currentKotlinTracks: MutableList<KTrackSrc>? = null
 
+    // startRecording à espera da resposta do pedido de permissão de microfone
+    private data class PendingRecording(
+        val directory: String,
+        val channels: List<Int>,
+        val result: MethodChannel.Result
+    )
+    private var pendingRecording: PendingRecording? = null
+
     // JNI nativo para suporte multicanal com AAudio
     private external fun nativePlayWavPreview(filePath: String, outputChannel: Int, deviceId: Int, deviceChannels: Int): Boolean
     private external fun nativeStopPreview()
@@ -68,11 +78,100 @@ class MainActivity : FlutterActivity() {
         deviceId: Int,
         deviceChannels: Int
     ): Boolean
+    private external fun nativeStopMixer()
+    private external fun nativeSetOutputDevice(deviceId: Int)
+    private external fun nativePrepareAllPreview(
+        filePaths: Array<String>,
+        outputChannels: IntArray,
+        deviceId: Int,
+        deviceChannels: Int
+    ): Boolean
     private external fun nativeSeekAllPreview(positionSec: Double)
     private external fun nativeDetectBpmFromWav(filePath: String): DoubleArray
+    private external fun nativeProbeSampleRate(filePath: String): Int
+    private external fun nativeSetTrackParam(trackIndex: Int, paramId: Int, value: Float): Boolean
+    private external fun nativeGetEngineStats(): DoubleArray
+    private external fun nativeSetBusParam(busIndex: Int, paramId: Int, value: Float): Boolean
+    private external fun nativeSetMixGraph(
+        trackBuses: IntArray,
+        busParents: IntArray,
+        busVolumes: FloatArray,
+        busPans: FloatArray,
+        busMutes: IntArray
+    )
+    private external fun nativeSetAuxSends(auxOutputs: IntArray, sends: FloatArray)
+    private external fun nativeSetAuxSend(trackIndex: Int, auxIndex: Int, level: Float): Boolean
+    private external fun nativeStartCapture(
+        directory: String,
+        deviceId: Int,
+        deviceChannels: Int,
+        armedChannels: IntArray
+    ): Boolean
+    private external fun nativeStopCapture(): LongArray
+    private external fun nativeStartOutputTap(directory: String, fileName: String, channels: Int, sampleRate: Int): Boolean
+    private external fun nativeStopOutputTap(): Array<String>
+    private external fun nativeGetOutputTapStats(): LongArray
 
     companion object {
         private const val TAG = "MultitrackPreview"
+        private const val REQUEST_RECORD_AUDIO = 4101
+
+        // Espelha o enum ParamId de param_queue.h
+        private const val PARAM_TRACK_VOLUME = 0
+        private const val PARAM_TRACK_PAN = 1
+        private const val PARAM_MUTE = 16
+        private val INSERT_PARAM_IDS = mapOf(
+            "hpfHz" to 2,
+            "lpfHz" to 3,
+            "eq1Hz" to 4,
+            "eq1GainDb" to 5,
+            "eq1Q" to 6,
+            "eq2Hz" to 7,
+            "eq2GainDb" to 8,
+            "eq2Q" to 9,
+            "compThresholdDb" to 10,
+            "compRatio" to 11,
+            "compAttackMs" to 12,
+            "compReleaseMs" to 13,
+            "compMakeupDb" to 14,
+            "limitCeilingDb" to 15
+        )
+
+        // Espelha EngineStatIndex de engine_stats.h; depois do cabeçalho vem o custo de inserts por track
+        private val ENGINE_STAT_KEYS = arrayOf(
+            "blocks",
+            "avgBlockUs",
+            "maxBlockUs",
+            "avgInsertUs",
+            "blockBudgetUs",
+            "paramsApplied",
+            "paramsDropped",
+            "trackCount",
+            "renderWorkers",
+            "inlineJobs",
+            "deadlineMisses",
+            "avgJoinWaitUs",
+            "busCount",
+            "busBuffers",
+            "firstSampleUs",
+            "preparedTracks",
+            "preparedStream",
+            "streamRecoveries",
+            "silentTrackBlocks",
+            "sharedOutput",
+            "outputConverted",
+            "renderRealtime",
+            "renderWakeAvgUs",
+            "renderWakeMaxUs",
+            "workerWakeAvgUs",
+            "workerWakeMaxUs",
+            "ioWakeAvgUs",
+            "ioWakeMaxUs",
+            "analysisWakeAvgUs",
+            "analysisWakeMaxUs",
+            "streamIoBackend",
+            "streamIoMisses"
+        )
         init {
             try { System.loadLibrary("multichannel_preview") } catch (_: Throwable) {}
         }
@@ -90,6 +189,8 @@ class MainActivity : FlutterActivity() {
         override fun onAudioDevicesAdded(addedDevices: Array<AudioDeviceInfo>) {
             if (addedDevices.any { isUsbAudioOutput(it) }) {
                 Log.d(TAG, "USB output device connected")
+                // Mixer esperando a interface voltar reabre o stream no novo id
+                try { nativeSetOutputDevice(getUsbOutputDevice()?.id ?: -1) } catch (_: Throwable) {}
                 eventSink?.success("connected")
             }
         }
@@ -97,6 +198,7 @@ class MainActivity : FlutterActivity() {
         override fun onAudioDevicesRemoved(removedDevices: Array<AudioDeviceInfo>) {
             if (removedDevices.any { isUsbAudioOutput(it) }) {
                 Log.d(TAG, "USB output device disconnected")
+                try { nativeSetOutputDevice(getUsbOutputDevice()?.id ?: -1) } catch (_: Throwable) {}
                 eventSink?.success("disconnected")
             }
         }
@@ -170,43 +272,10 @@ class MainActivity : FlutterActivity() {
                                 result.success(null)
                                 return@setMethodCallHandler
                             }
-                            val f = File(filePath)
-                            if (!f.exists()) {
-                                result.success(null)
-                                return@setMethodCallHandler
-                            }
-                            FileInputStream(f).use { fis ->
-                                val riffHead = ByteArray(12)
-                                val n0 = fis.read(riffHead)
-                                if (n0 < 12) {
-                                    result.success(null); return@setMethodCallHandler
-                                }
-                                val riffId = String(riffHead, 0, 4)
-                                val waveId = String(riffHead, 8, 4)
-                                if (riffId != "RIFF" || waveId != "WAVE") {
-                                    result.success(null); return@setMethodCallHandler
-                                }
-                                var sampleRate = -1
-                                val hdr8 = ByteArray(8)
-                                while (true) {
-                                    val n = fis.read(hdr8)
-                                    if (n < 8) break
-                                    val id = String(hdr8, 0, 4)
-                                    val size = ByteBuffer.wrap(hdr8, 4, 4).order(ByteOrder.LITTLE_ENDIAN).getInt()
-                                    if (id == "fmt ") {
-                                        val fmtBuf = ByteArray(size)
-                                        val m = fis.read(fmtBuf)
-                                        if (m < size) { sampleRate = -1; break }
-                                        val bb = ByteBuffer.wrap(fmtBuf).order(ByteOrder.LITTLE_ENDIAN)
-                                        sampleRate = bb.getInt(4)
-                                        break
-                                    } else {
-                                        fis.skip(size.toLong())
-                                    }
-                                }
-                                if (sampleRate > 0) result.success(sampleRate) else result.success(null)
-                            }
-                        } catch (e: Exception) {
+                            // Mesmo parser e cache do mixer nativo (file_probe.cpp)
+                            val sampleRate = nativeProbeSampleRate(filePath)
+                            if (sampleRate > 0) result.success(sampleRate) else result.success(null)
+                        } catch (e: Throwable) {
                             Log.e(TAG, "getFileSampleRateHz error: ${e.message}", e)
                             result.success(null)
                         }
@@ -237,8 +306,9 @@ class MainActivity : FlutterActivity() {
                             return@setMethodCallHandler
                         }
 
-                        // Limpa players anteriores
-                        try { nativeStopPreview() } catch (_: Throwable) {}
+                        // Limpa players anteriores; o stream AAudio fica aberto para
+                        // ser reaproveitado (fechado pelo nativo se não servir)
+                        try { nativeStopMixer() } catch (_: Throwable) {}
                         stopFlag = true
                         try { previewThread?.join(500) } catch (_: Throwable) {}
                         previewThread = null
@@ -260,6 +330,28 @@ class MainActivity : FlutterActivity() {
                             for (i in volumesList.indices) volArr[i] = clampFloat(volumesList[i], 0f, 1f)
                             val panArr = FloatArray(pansList.size)
                             for (i in pansList.indices) panArr[i] = clampFloat(pansList[i], -1f, 1f)
+                            // Buses opcionais (o mixer Kotlin de fallback os ignora)
+                            val trackBusesList = (args?.get("trackBuses") as? List<*>)?.map { (it as? Number)?.toInt() ?: -1 } ?: listOf<Int>()
+                            val busParentsList = (args?.get("busParents") as? List<*>)?.map { (it as? Number)?.toInt() ?: -1 } ?: listOf<Int>()
+                            val busVolumesList = (args?.get("busVolumes") as? List<*>)?.map { (it as? Number)?.toFloat() ?: 1f } ?: listOf<Float>()
+                            val busPansList = (args?.get("busPans") as? List<*>)?.map { (it as? Number)?.toFloat() ?: 0f } ?: listOf<Float>()
+                            val busMutesList = (args?.get("busMutes") as? List<*>)?.map { it == true } ?: listOf<Boolean>()
+                            val busCount = busParentsList.size
+                            val trackBusArr = IntArray(fpArr.size) { i -> if (i < trackBusesList.size) trackBusesList[i] else -1 }
+                            val busParentArr = IntArray(busCount) { b -> busParentsList[b] }
+                            val busVolArr = FloatArray(busCount) { b -> clampFloat(if (b < busVolumesList.size) busVolumesList[b] else 1f, 0f, 1f) }
+                            val busPanArr = FloatArray(busCount) { b -> clampFloat(if (b < busPansList.size) busPansList[b] else 0f, -1f, 1f) }
+                            val busMuteArr = IntArray(busCount) { b -> if (b < busMutesList.size && busMutesList[b]) 1 else 0 }
+                            try { nativeSetMixGraph(trackBusArr, busParentArr, busVolArr, busPanArr, busMuteArr) } catch (_: Throwable) {}
+                            // Mixes de in-ear opcionais: primeiro canal de cada par e
+                            // níveis track x mix (track-major)
+                            val auxOutputsList = (args?.get("auxOutputs") as? List<*>)?.map { (it as? Number)?.toInt() ?: -1 } ?: listOf<Int>()
+                            val auxSendsList = (args?.get("auxSends") as? List<*>)?.map { (it as? Number)?.toFloat() ?: 0f } ?: listOf<Float>()
+                            val auxOutArr = IntArray(auxOutputsList.size) { a -> auxOutputsList[a] }
+                            val auxSendArr = FloatArray(fpArr.size * auxOutArr.size) { k ->
+                                clampFloat(if (k < auxSendsList.size) auxSendsList[k] else 0f, 0f, 1f)
+                            }
+                            try { nativeSetAuxSends(auxOutArr, auxSendArr) } catch (_: Throwable) {}
                             val ok = nativePlayAllPreview(
                                 fpArr,
                                 chArr,
@@ -273,7 +365,13 @@ class MainActivity : FlutterActivity() {
                                 result.success(null)
                                 return@setMethodCallHandler
                             }
-                            // Fallback: mixer em Kotlin/AudioTrack estéreo
+                            // O engine nativo já cai para AAudio compartilhado e converte
+                            // taxa/canais; o mixer Kotlin/AudioTrack estéreo fica só para
+                            // aparelhos sem AAudio (abaixo da API 26)
+                            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.O) {
+                                result.error("play_error", "Falha ao iniciar mixer", null)
+                                return@setMethodCallHandler
+                            }
                             val ok2 = playAllWavPreviewKotlin(filePathsList, outputChannelsList, volumesList, pansList)
                             if (!ok2) {
                                 result.error("play_error", "Falha ao iniciar mixer", null)
@@ -286,6 +384,28 @@ class MainActivity : FlutterActivity() {
                             result.error("play_error", e.message, null)
                         }
                     }
+                    "prepareAllPreview" -> {
+                        val args = call.arguments as? Map<*, *>
+                        val filePathsList = (args?.get("filePaths") as? List<*>)?.mapNotNull { it as? String } ?: listOf<String>()
+                        val outputChannelsList = (args?.get("outputChannels") as? List<*>)?.mapNotNull { (it as? Number)?.toInt() } ?: listOf<Int>()
+                        if (filePathsList.isEmpty() || outputChannelsList.size != filePathsList.size) {
+                            result.error("bad_args", "Listas inválidas para prepareAllPreview", null)
+                            return@setMethodCallHandler
+                        }
+                        val usb = getUsbOutputDevice()
+                        val deviceId = usb?.id ?: -1
+                        val deviceCh = try { if (usb != null) computeOutputChannelCount(usb) else 2 } catch (_: Throwable) { 2 }
+                        // Abre arquivos e lê o início de cada um: fora do thread da UI
+                        Thread {
+                            val ok = try {
+                                nativePrepareAllPreview(filePathsList.toTypedArray(), outputChannelsList.toIntArray(), deviceId, deviceCh)
+                            } catch (e: Throwable) {
+                                Log.e(TAG, "prepareAllPreview error: ${e.message}", e)
+                                false
+                            }
+                            runOnUiThread { result.success(ok) }
+                        }.start()
+                    }
                     "getOutputChannelDetails" -> {
                         val device = getUsbOutputDevice()
                         if (device == null) {
@@ -329,6 +449,86 @@ class MainActivity : FlutterActivity() {
                             result.success(resp)
                         }
                     }
+                    "startRecording" -> {
+                        val args = call.arguments as? Map<*, *>
+                        val directory = args?.get("directory") as? String
+                        val channels = (args?.get("inputChannels") as? List<*>)?.mapNotNull { (it as? Number)?.toInt() }
+                        if (directory.isNullOrEmpty() || channels.isNullOrEmpty()) {
+                            result.error("bad_args", "directory/inputChannels ausentes", null)
+                            return@setMethodCallHandler
+                        }
+                        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.M &&
+                            checkSelfPermission(Manifest.permission.RECORD_AUDIO) != PackageManager.PERMISSION_GRANTED) {
+                            // O resultado fica pendente até o usuário responder (onRequestPermissionsResult)
+                            if (pendingRecording != null) {
+                                result.error("permission_pending", "Pedido de permissão de gravação em andamento", null)
+                                return@setMethodCallHandler
+                            }
+                            pendingRecording = PendingRecording(directory, channels, result)
+                            requestPermissions(arrayOf(Manifest.permission.RECORD_AUDIO), REQUEST_RECORD_AUDIO)
+                            return@setMethodCallHandler
+                        }
+                        startRecording(directory, channels, result)
+                    }
+                    "stopRecording" -> {
+                        val directory = (call.arguments as? Map<*, *>)?.get("directory") as? String ?: ""
+                        try {
+                            val raw = nativeStopCapture()
+                            val resp = HashMap<String, Any>()
+                            resp["framesWritten"] = raw.getOrElse(0) { 0L }
+                            resp["framesDropped"] = raw.getOrElse(1) { 0L }
+                            // Long.MIN_VALUE = a gravação não tocou junto com o mixer
+                            val startSongFrame = raw.getOrElse(2) { Long.MIN_VALUE }
+                            if (startSongFrame != Long.MIN_VALUE) resp["startSongFrame"] = startSongFrame
+                            resp["sampleRate"] = raw.getOrElse(3) { 0L }
+                            val files = ArrayList<HashMap<String, Any>>()
+                            var i = 4
+                            while (i < raw.size) {
+                                val ch = raw[i].toInt()
+                                val file = HashMap<String, Any>()
+                                file["inputChannel"] = ch
+                                file["path"] = "${directory}/in_${ch + 1}.wav"
+                                files.add(file)
+                                i++
+                            }
+                            resp["files"] = files
+                            result.success(resp)
+                        } catch (e: Throwable) {
+                            Log.e(TAG, "stopRecording error: ${e.message}", e)
+                            result.success(null)
+                        }
+                    }
+                    "startOutputTap" -> {
+                        val args = call.arguments as? Map<*, *>
+                        val directory = args?.get("directory") as? String
+                        val fileName = args?.get("fileName") as? String ?: "show"
+                        if (directory.isNullOrEmpty()) {
+                            result.error("bad_args", "directory ausente", null)
+                            return@setMethodCallHandler
+                        }
+                        try {
+                            File(directory).mkdirs()
+                            // Usados só se o mixer ainda não estiver tocando; a
+                            // próxima sessão corrige se nada foi gravado até ela
+                            val channels = getUsbOutputDevice()?.let { computeOutputChannelCount(it) } ?: 2
+                            val sampleRate = (args?.get("sampleRate") as? Number)?.toInt() ?: 48000
+                            result.success(nativeStartOutputTap(directory, fileName, channels, sampleRate))
+                        } catch (e: Throwable) {
+                            Log.e(TAG, "startOutputTap error: ${e.message}", e)
+                            result.error("record_error", e.message, null)
+                        }
+                    }
+                    "stopOutputTap" -> {
+                        try {
+                            val files = nativeStopOutputTap()
+                            val resp = outputTapStats()
+                            resp["files"] = files.toList()
+                            result.success(resp)
+                        } catch (e: Throwable) {
+                            Log.e(TAG, "stopOutputTap error: ${e.message}", e)
+                            result.success(null)
+                        }
+                    }
                     "playPreview" -> {
                         val args = call.arguments as? Map<*, *>
                         val filePath = args?.get("filePath") as? String
@@ -482,7 +682,10 @@ class MainActivity : FlutterActivity() {
                         val pan = ((args?.get("pan") as? Number)?.toFloat()) ?: 0.0f
                         val clamped = pan.coerceIn(-1.0f, 1.0f)
                         val tracks = currentKotlinTracks
-                        if (tracks != null && index in tracks.indices) {
+                        if (usingNative && index >= 0) {
+                            try { nativeSetTrackParam(index, PARAM_TRACK_PAN, clamped) } catch (_: Throwable) {}
+                            result.success(null)
+                        } else if (tracks != null && index in tracks.indices) {
                             tracks[index].pan = clamped
                             Log.d(TAG, "setTrackPan: trackIndex=${index} pan=${clamped}")
                             result.success(null)
@@ -500,7 +703,10 @@ class MainActivity : FlutterActivity() {
                         val vol = ((args?.get("volume") as? Number)?.toFloat()) ?: 1.0f
                         val clamped = vol.coerceIn(0.0f, 1.0f)
                         val tracks = currentKotlinTracks
-                        if (tracks != null && index in tracks.indices) {
+                        if (usingNative && index >= 0) {
+                            try { nativeSetTrackParam(index, PARAM_TRACK_VOLUME, clamped) } catch (_: Throwable) {}
+                            result.success(null)
+                        } else if (tracks != null && index in tracks.indices) {
                             tracks[index].volume = clamped
                             Log.d(TAG, "setTrackVolume: trackIndex=${index} volume=${clamped}")
                             result.success(null)
@@ -513,11 +719,151 @@ class MainActivity : FlutterActivity() {
                             result.success(null)
                         }
                     }
+                    "setTrackInserts" -> {
+                        val args = call.arguments as? Map<*, *>
+                        val index = ((args?.get("trackIndex") as? Number)?.toInt()) ?: -1
+                        val params = args?.get("params") as? Map<*, *>
+                        if (index < 0 || params == null) {
+                            result.error("bad_args", "trackIndex/params ausentes", null)
+                            return@setMethodCallHandler
+                        }
+                        if (!usingNative) {
+                            // Mixer Kotlin não possui cadeia de inserts
+                            Log.d(TAG, "setTrackInserts ignorado: mixer nativo inativo")
+                            result.success(false)
+                            return@setMethodCallHandler
+                        }
+                        var ok = true
+                        for ((key, value) in params) {
+                            val id = INSERT_PARAM_IDS[key as? String] ?: continue
+                            val v = (value as? Number)?.toFloat() ?: continue
+                            try {
+                                if (!nativeSetTrackParam(index, id, v)) ok = false
+                            } catch (_: Throwable) { ok = false }
+                        }
+                        result.success(ok)
+                    }
+                    "setTrackMute" -> {
+                        val args = call.arguments as? Map<*, *>
+                        val index = ((args?.get("trackIndex") as? Number)?.toInt()) ?: -1
+                        val mute = args?.get("mute") == true
+                        if (usingNative && index >= 0) {
+                            try { nativeSetTrackParam(index, PARAM_MUTE, if (mute) 1f else 0f) } catch (_: Throwable) {}
+                        } else {
+                            Log.d(TAG, "setTrackMute ignorado: mixer nativo inativo")
+                        }
+                        result.success(null)
+                    }
+                    "setBusParams" -> {
+                        val args = call.arguments as? Map<*, *>
+                        val index = ((args?.get("busIndex") as? Number)?.toInt()) ?: -1
+                        if (index < 0) {
+                            result.error("bad_args", "busIndex ausente", null)
+                            return@setMethodCallHandler
+                        }
+                        if (!usingNative) {
+                            Log.d(TAG, "setBusParams ignorado: mixer nativo inativo")
+                            result.success(false)
+                            return@setMethodCallHandler
+                        }
+                        var ok = true
+                        fun send(id: Int, v: Float) {
+                            try { if (!nativeSetBusParam(index, id, v)) ok = false } catch (_: Throwable) { ok = false }
+                        }
+                        (args?.get("volume") as? Number)?.let { send(PARAM_TRACK_VOLUME, clampFloat(it.toFloat(), 0f, 1f)) }
+                        (args?.get("pan") as? Number)?.let { send(PARAM_TRACK_PAN, clampFloat(it.toFloat(), -1f, 1f)) }
+                        (args?.get("mute") as? Boolean)?.let { send(PARAM_MUTE, if (it) 1f else 0f) }
+                        (args?.get("inserts") as? Map<*, *>)?.let { params ->
+                            for ((key, value) in params) {
+                                val id = INSERT_PARAM_IDS[key as? String] ?: continue
+                                val v = (value as? Number)?.toFloat() ?: continue
+                                send(id, v)
+                            }
+                        }
+                        result.success(ok)
+                    }
+                    "setAuxSend" -> {
+                        val args = call.arguments as? Map<*, *>
+                        val index = ((args?.get("trackIndex") as? Number)?.toInt()) ?: -1
+                        val mix = ((args?.get("mixIndex") as? Number)?.toInt()) ?: -1
+                        val level = ((args?.get("level") as? Number)?.toFloat()) ?: 0f
+                        if (index < 0 || mix < 0) {
+                            result.error("bad_args", "trackIndex/mixIndex ausentes", null)
+                            return@setMethodCallHandler
+                        }
+                        if (!usingNative) {
+                            // Mixer Kotlin não tem mixes auxiliares
+                            Log.d(TAG, "setAuxSend ignorado: mixer nativo inativo")
+                            result.success(false)
+                            return@setMethodCallHandler
+                        }
+                        val ok = try { nativeSetAuxSend(index, mix, clampFloat(level, 0f, 1f)) } catch (_: Throwable) { false }
+                        result.success(ok)
+                    }
+                    "getEngineStats" -> {
+                        try {
+                            val raw = nativeGetEngineStats()
+                            val resp = HashMap<String, Any>()
+                            for (i in ENGINE_STAT_KEYS.indices) {
+                                if (i < raw.size) resp[ENGINE_STAT_KEYS[i]] = raw[i]
+                            }
+                            val perTrack = ArrayList<Double>()
+                            var i = ENGINE_STAT_KEYS.size
+                            while (i < raw.size) { perTrack.add(raw[i]); i++ }
+                            resp["trackInsertUs"] = perTrack
+                            resp["native"] = usingNative
+                            resp["outputTap"] = outputTapStats()
+                            result.success(resp)
+                        } catch (e: Throwable) {
+                            Log.e(TAG, "getEngineStats error: ${e.message}")
+                            result.success(null)
+                        }
+                    }
                     else -> result.notImplemented()
                 }
             }
     }
 
+    private fun startRecording(directory: String, channels: List<Int>, result: MethodChannel.Result) {
+        try {
+            File(directory).mkdirs()
+            val device = getUsbInputDevice()
+            val deviceId = device?.id ?: 0
+            val deviceChannels = device?.let { computeInputChannelCount(it) } ?: 2
+            Log.d(TAG, "startRecording: dir=${directory} deviceId=${deviceId} channels=${channels}")
+            result.success(nativeStartCapture(directory, deviceId, deviceChannels, channels.toIntArray()))
+        } catch (e: Throwable) {
+            Log.e(TAG, "startRecording error: ${e.message}", e)
+            result.error("record_error", e.message, null)
+        }
+    }
+
+    override fun onRequestPermissionsResult(requestCode: Int, permissions: Array<out String>, grantResults: IntArray) {
+        super.onRequestPermissionsResult(requestCode, permissions, grantResults)
+        if (requestCode != REQUEST_RECORD_AUDIO) return
+        val pending = pendingRecording ?: return
+        pendingRecording = null
+        if (grantResults.isNotEmpty() && grantResults[0] == PackageManager.PERMISSION_GRANTED) {
+            startRecording(pending.directory, pending.channels, pending.result)
+        } else {
+            Log.w(TAG, "startRecording: permissão de gravação negada")
+            pending.result.error("permission_denied", "Permissão de gravação negada", null)
+        }
+    }
+
+    private fun outputTapStats(): HashMap<String, Any> {
+        val raw = nativeGetOutputTapStats()
+        val resp = HashMap<String, Any>()
+        resp["recording"] = raw.getOrElse(0) { 0L } != 0L
+        resp["channels"] = raw.getOrElse(1) { 0L }
+        resp["sampleRate"] = raw.getOrElse(2) { 0L }
+        resp["framesWritten"] = raw.getOrElse(3) { 0L }
+        resp["framesDropped"] = raw.getOrElse(4) { 0L }
+        resp["blocksDropped"] = raw.getOrElse(5) { 0L }
+        resp["formatMismatchBlocks"] = raw.getOrElse(6) { 0L }
+        return resp
+    }
+
     private fun playWavPreview(filePath: String, outputChannel: Int): Boolean {
         try {
             val file = File(filePath)
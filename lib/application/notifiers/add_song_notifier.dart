@@ -1,3 +1,4 @@
+import 'dart:async';
 import 'dart:io';
 
 import 'package:file_picker/file_picker.dart';
@@ -9,6 +10,7 @@ import '../../domain/models/staged_track_model.dart';
 import '../../domain/models/track_model.dart';
 import '../../domain/models/song_model.dart';
 import '../providers/database_provider.dart';
+import '../providers/device_provider.dart';
 import '../providers/songs_provider.dart';
 
 class AddSongState {
@@ -16,6 +18,8 @@ class AddSongState {
   final List<StagedTrack> stagedTracks;
   final bool isLoadingFiles;
   final bool isSaving;
+  // Fração dos stems já copiada (0..1) enquanto isSaving
+  final double? importProgress;
   final String? errorMessage;
 
   AddSongState({
@@ -23,6 +27,7 @@ class AddSongState {
     List<StagedTrack>? stagedTracks,
     this.isLoadingFiles = false,
     this.isSaving = false,
+    this.importProgress,
     this.errorMessage,
   }) : stagedTracks = stagedTracks ?? [];
 
@@ -31,6 +36,7 @@ class AddSongState {
     List<StagedTrack>? stagedTracks,
     bool? isLoadingFiles,
     bool? isSaving,
+    double? importProgress,
     String? errorMessage,
   }) {
     return AddSongState(
@@ -38,6 +44,7 @@ class AddSongState {
       stagedTracks: stagedTracks ?? this.stagedTracks,
       isLoadingFiles: isLoadingFiles ?? this.isLoadingFiles,
       isSaving: isSaving ?? this.isSaving,
+      importProgress: importProgress ?? this.importProgress,
       errorMessage: errorMessage,
     );
   }
@@ -143,22 +150,62 @@ class AddSongNotifier extends StateNotifier<AddSongState> {
       final tracks = <Track>[];
       final uuid = const Uuid();
 
-      for (final staged in state.stagedTracks) {
-        final ext = p.extension(staged.originalFilePath);
-        final uniqueName = '${uuid.v4()}$ext';
-        final newPath = p.join(appDir.path, 'audio', uniqueName);
-
-        final destDir = Directory(p.dirname(newPath));
-        if (!destDir.existsSync()) {
-          destDir.createSync(recursive: true);
+      final destDir = Directory(p.join(appDir.path, 'audio'));
+      if (!destDir.existsSync()) {
+        destDir.createSync(recursive: true);
+      }
+      final staged = state.stagedTracks;
+      final sources = [for (final t in staged) t.originalFilePath];
+      final destinations = [
+        for (final t in staged)
+          p.join(destDir.path, '${uuid.v4()}${p.extension(t.originalFilePath)}'),
+      ];
+
+      // Cópia e análise numa leitura só de cada stem, nomeado pelo hash do
+      // conteúdo (stem repetido entre músicas vira um arquivo só); sem suporte
+      // nativo, cópia simples e mapas de silêncio em segundo plano
+      final audio = ref.read(audioDeviceServiceProvider);
+      final imported = await audio.importStems(
+        sources,
+        destinations,
+        contentAddressed: true,
+        onProgress: (v) {
+          if (mounted) state = state.copyWith(importProgress: v);
+        },
+      );
+      if (imported == null) {
+        for (var i = 0; i < sources.length; i++) {
+          await File(sources[i]).copy(destinations[i]);
+          state = state.copyWith(importProgress: (i + 1) / sources.length);
         }
+        unawaited(audio
+            .buildSilenceMaps(destinations)
+            .catchError((_) => <String, double>{}));
+      } else {
+        final failed = [
+          for (final r in imported)
+            if (!r.isCopied) p.basename(r.source),
+        ];
+        if (failed.isNotEmpty) {
+          // Não deixa cópias soltas de uma música que não foi salva; arquivos
+          // compartilhados pertencem a outras músicas
+          for (final r in imported) {
+            if (!r.isCopied || r.isShared) continue;
+            for (final path in [r.destination, '${r.destination}.mtpa']) {
+              final f = File(path);
+              if (f.existsSync()) f.deleteSync();
+            }
+          }
+          throw FileSystemException(
+              'falha ao copiar ${failed.join(', ')}', destDir.path);
+        }
+      }
 
-        final srcFile = File(staged.originalFilePath);
-        await srcFile.copy(newPath);
-
+      for (var i = 0; i < staged.length; i++) {
         final track = Track()
-          ..name = staged.displayName
-          ..localFilePath = newPath;
+          ..name = staged[i].displayName
+          ..localFilePath =
+              imported != null ? imported[i].destination : destinations[i];
         tracks.add(track);
       }
 
@@ -174,6 +221,11 @@ class AddSongNotifier extends StateNotifier<AddSongState> {
       // Atualiza a lista na biblioteca ao retornar
       ref.invalidate(songsListProvider);
 
+      // Pacote da música (stems intercalados) em segundo plano
+      unawaited(audio
+          .prepareSongBundle(newSong.id, tracks)
+          .catchError((_) => false));
+
       // Reset state
       state = AddSongState();
     } catch (e) {
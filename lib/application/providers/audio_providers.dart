@@ -2,8 +2,8 @@ import 'package:flutter_riverpod/flutter_riverpod.dart';
 import 'device_provider.dart';
 import '../services/i_bpm_analyzer_service.dart';
 import '../../infrastructure/audio/naive_bpm_analyzer_service.dart';
-import 'dart:io' show Platform;
 import '../../infrastructure/audio/android_bpm_analyzer_service.dart';
+import '../../infrastructure/audio/native_engine_ffi.dart';
 
 // Controls which track is currently previewing (or null if none)
 final previewingTrackIdProvider =
@@ -27,7 +27,7 @@ final mixerBusyProvider = StateProvider<bool>((ref) => false);
 // BPM analyzer service: detects BPM from an audio file of the metronome track
 final bpmAnalyzerServiceProvider = Provider<IBpmAnalyzerService>((ref) {
   final audioSvc = ref.watch(audioDeviceServiceProvider);
-  if (Platform.isAndroid) {
+  if (hasNativeAudioEngine) {
     return AndroidNativeBpmAnalyzerService();
   }
   return NaiveBpmAnalyzerService(audioSvc);
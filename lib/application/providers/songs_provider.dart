@@ -4,6 +4,7 @@ import 'package:isar/isar.dart';
 import '../../domain/models/song_model.dart';
 import '../../domain/models/track_model.dart';
 import 'database_provider.dart';
+import 'device_provider.dart';
 
 // Provider para listar todas as músicas
 final songsListProvider = FutureProvider<List<Song>>((ref) async {
@@ -72,6 +73,7 @@ class SongService {
         await isar.songs.delete(songId);
       }
     });
+    await _ref.read(audioDeviceServiceProvider).deleteSongBundle(songId);
     _ref.invalidate(songsListProvider);
   }
 }
\ No newline at end of file
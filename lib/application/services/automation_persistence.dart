@@ -0,0 +1,47 @@
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:path/path.dart' as p;
+import 'package:path_provider/path_provider.dart';
+
+import '../../domain/models/automation_event_model.dart';
+
+class AutomationPersistence {
+  static Future<File> _fileForSong(int songId) async {
+    final dir = await getApplicationDocumentsDirectory();
+    return File(p.join(dir.path, 'automation', 'song_$songId.json'));
+  }
+
+  /// Salva a timeline da música em `automation/song_<id>.json`, ordenada por tempo.
+  static Future<File> saveForSong(
+      int songId, List<AutomationEvent> events) async {
+    final file = await _fileForSong(songId);
+    if (!await file.parent.exists()) {
+      await file.parent.create(recursive: true);
+    }
+    final sorted = [...events]..sort((a, b) => a.timeMs.compareTo(b.timeMs));
+    final payload = {
+      'songId': songId,
+      'events': sorted.map((e) => e.toJson()).toList(),
+    };
+    final jsonStr = const JsonEncoder.withIndent('  ').convert(payload);
+    await file.writeAsString(jsonStr, flush: true);
+    return file;
+  }
+
+  /// Timeline salva da música; vazia se não houver arquivo ou se ele for inválido.
+  static Future<List<AutomationEvent>> loadForSong(int songId) async {
+    try {
+      final file = await _fileForSong(songId);
+      if (!await file.exists()) return const [];
+      final obj = json.decode(await file.readAsString());
+      final raw = (obj['events'] as List?) ?? const [];
+      return raw
+          .whereType<Map<String, dynamic>>()
+          .map(AutomationEvent.fromJson)
+          .toList();
+    } catch (_) {
+      return const [];
+    }
+  }
+}
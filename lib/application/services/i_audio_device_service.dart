@@ -1,6 +1,16 @@
 import 'dart:async';
+import 'dart:typed_data';
 import '../../domain/models/audio_device_model.dart';
+import '../../domain/models/audio_file_info_model.dart';
 import '../../domain/models/track_model.dart';
+import '../../domain/models/track_inserts_model.dart';
+import '../../domain/models/mix_bus_model.dart';
+import '../../domain/models/monitor_mix_model.dart';
+import '../../domain/models/spectrum_tap_model.dart';
+import '../../domain/models/automation_event_model.dart';
+import '../../domain/models/recording_take_model.dart';
+import '../../domain/models/loudness_model.dart';
+import '../../domain/models/stem_import_model.dart';
 
 abstract class IAudioDeviceService {
   Stream<AudioDevice?> get onDeviceChanged;
@@ -11,8 +21,23 @@ abstract class IAudioDeviceService {
   Future<void> setPreviewPan(double pan);
   Future<void> setTrackVolume(int trackIndex, double volume);
   Future<void> setTrackPan(int trackIndex, double pan);
-  Future<void> playAllTracks(List<Track> tracks);
+  // buses/trackBuses são opcionais: trackBuses[i] é o índice em `buses` do bus
+  // da track i (null = direto na saída). monitorMixes são as mixes de in-ear,
+  // cada uma no seu par de saídas.
+  Future<void> playAllTracks(
+    List<Track> tracks, {
+    List<MixBus>? buses,
+    List<int?>? trackBuses,
+    List<MonitorMix>? monitorMixes,
+  });
   Future<void> seekPlayAll(double positionSec);
+  // Optional: scrub audível da sessão de playAllTracks. Entre begin e end o
+  // mixer toca em velocidade variável (inclusive de ré) seguindo scrubTo, que
+  // pode ser chamado a cada evento do gesto; no end o play continua na última
+  // posição. begin devolve false sem mixer nativo tocando.
+  bool scrubBegin();
+  void scrubTo(double positionSec);
+  void scrubEnd();
   // Optional optimizations (no-op on unsupported platforms)
   Future<void> prepareTracks(List<Track> tracks);
   Future<void> setOutputQuality({
@@ -25,6 +50,130 @@ abstract class IAudioDeviceService {
   });
   // Optional: query file metadata (sample rate) if supported
   Future<int?> getFileSampleRateHz(String filePath);
+  // Metadados de vários arquivos numa chamada, por caminho (inválidos com
+  // valid=false). Usa o cache persistente do nativo; mapa vazio sem suporte.
+  Future<Map<String, AudioFileInfo>> probeFiles(List<String> paths);
   // Optional: get recommended buffer size in frames for current device
   Future<int?> getRecommendedBufferSizeFrames();
-}
\ No newline at end of file
+  // Optional: insert chain (EQ/filtros/dinâmica) de uma track no mixer nativo.
+  // Vale para a sessão atual de playAllTracks; reenvie após iniciar outra.
+  Future<bool> setTrackInserts(int trackIndex, TrackInserts inserts);
+  // Optional: controle de grupo (um comando por bus, não por track)
+  Future<bool> setBusParams(
+    int busIndex, {
+    double? volume,
+    double? pan,
+    bool? mute,
+    TrackInserts? inserts,
+  });
+  Future<void> setTrackMute(int trackIndex, bool mute);
+  // Optional: nível (0..1) da track na mix de in-ear mixIndex da sessão atual
+  Future<bool> setAuxSend(int trackIndex, int mixIndex, double level);
+  // Optional: estatísticas do thread de render (tempo por bloco, custo por track)
+  Future<Map<String, dynamic>?> getEngineStats();
+  // Optional: leitura síncrona do mixer nativo (FFI), barata o bastante para
+  // chamar a cada frame da UI; null quando o mixer nativo não está tocando.
+  double? get enginePositionSec;
+  // true enquanto a interface de saída caiu e o mixer espera para retomar
+  bool get engineOutputLost;
+  // Picos pós-fader por track (0..1), view sem cópia da memória nativa
+  Float32List? get trackMeterPeaks;
+  // Optional: analisador de espectro para a passagem de som. tap null desliga
+  // o thread de análise; rateHz (30..60) é a taxa de atualização das bandas.
+  Future<bool> setSpectrumTap(SpectrumTap? tap, {int rateHz = 30});
+  // Bandas em dBFS (-90..0, 20 Hz a 20 kHz em escala log), view sem cópia;
+  // null sem analisador nativo
+  Float32List? get spectrumBins;
+  // Correlação de fase L/R do tap (-1..1)
+  double? get spectrumCorrelation;
+  // Optional: modo de preload em RAM. As músicas pedidas são carregadas em
+  // segundo plano até o orçamento; ao tocar, as tracks já carregadas não leem
+  // disco. Orçamento 0 desliga e libera a memória.
+  Future<void> setPreloadBudget(int budgetBytes);
+  Future<void> preloadSong(int songId, List<Track> tracks, {bool urgent = false});
+  // Marca a música como tocada agora (as menos recentes saem primeiro)
+  Future<void> markSongPlayed(int songId);
+  // Optional: loop e saltos com precisão de amostra no mixer em execução.
+  // Devolvem false sem suporte nativo (o chamador cai no seek com crossfade).
+  Future<bool> setLoopRegion(int startMs, int endMs);
+  Future<void> clearLoopRegion();
+  // Salta para targetMs na próxima linha da grade (ex.: próximo compasso);
+  // sem grade, salta no próximo bloco de áudio.
+  Future<bool> scheduleJump(int targetMs, {int? gridOriginMs, int? gridPeriodMs});
+  // Optional: timeline de automação da música a tocar (vale a partir do
+  // próximo bloco, inclusive em sessões seguintes); lista vazia limpa.
+  // false sem suporte nativo.
+  Future<bool> setAutomationTimeline(List<AutomationEvent> events);
+  // Optional: grava os canais de entrada (0-based) da interface USB em
+  // `directory`, um WAV por canal, no mesmo relógio do playback. Sem
+  // permissão de microfone, pede e só completa depois da resposta. false sem
+  // suporte, com a permissão negada ou se já estiver gravando.
+  Future<bool> startRecording({
+    required String directory,
+    required List<int> inputChannels,
+  });
+  // null se não havia gravação em andamento
+  Future<RecordingTake?> stopRecording();
+  // Optional: grava exatamente o que o mixer envia a cada saída (master/aux)
+  // num WAV multicanal em `directory`, para revisão depois do show. Continua
+  // entre as músicas; blocos perdidos aparecem em getEngineStats()['outputTap'].
+  // sampleRate é o da música que vai tocar (usado se o mixer estiver parado;
+  // sem áudio gravado ainda, a primeira sessão corrige). Músicas em outro
+  // formato depois disso não entram (OutputTapRecording.formatMismatchBlocks).
+  Future<bool> startOutputTap({
+    required String directory,
+    String fileName = 'show',
+    int? sampleRate,
+  });
+  Future<OutputTapRecording?> stopOutputTap();
+  // Optional: loudness (LUFS/true peak) dos stems e da música com a mix atual;
+  // o metrônomo fica fora da soma. Resultado em cache até arquivos ou mix
+  // mudarem. null sem análise nativa.
+  Future<SongLoudness?> analyzeSongLoudness(int songId, List<Track> tracks);
+  // Ganho da música inteira no master (dB, -24..+12), ex.: para normalizar
+  // o setlist; vale até ser trocado.
+  Future<void> setSongTrimDb(double db);
+  // Optional: mapa de silêncio dos arquivos (na importação): o mixer pula a
+  // leitura e a mixagem dos trechos vazios de cada stem. Devolve a fração
+  // silenciosa por caminho; vazio sem suporte nativo.
+  Future<Map<String, double>> buildSilenceMaps(List<String> paths);
+  // Optional: importa os stems numa passada só por arquivo: copia para
+  // destinations[i] e já deixa probe, peaks, beat-grid e mapa de silêncio
+  // prontos. onProgress recebe a fração copiada (0..1). null sem suporte
+  // nativo (o chamador copia por conta própria). Com contentAddressed o
+  // arquivo final é nomeado pelo hash do conteúdo (result.destination) e
+  // stems iguais entre músicas ficam num arquivo só.
+  Future<List<StemImportResult>?> importStems(
+    List<String> sources,
+    List<String> destinations, {
+    bool contentAddressed = false,
+    void Function(double progress)? onProgress,
+  });
+  // Optional: pacote da música (stems intercalados num arquivo só); o play
+  // passa a ler um chunk de todas as tracks por vez. Reaproveita o pacote
+  // atualizado; com build false não monta um novo. true se o engine tem o
+  // pacote registrado.
+  Future<bool> prepareSongBundle(int songId, List<Track> tracks,
+      {bool build = true});
+  Future<void> deleteSongBundle(int songId);
+}
+extension TrackSampleRates on IAudioDeviceService {
+  // Taxas de amostragem distintas entre os arquivos das tracks, num probe só;
+  // sem probe nativo cai na consulta arquivo a arquivo.
+  Future<Set<int>> sampleRatesOf(List<Track> tracks) async {
+    final paths = [
+      for (final t in tracks)
+        if (t.localFilePath.isNotEmpty) t.localFilePath,
+    ];
+    final rates = <int>{};
+    final probed = await probeFiles(paths);
+    for (final path in paths) {
+      final info = probed[path];
+      final sr = info != null
+          ? (info.valid ? info.sampleRate : null)
+          : await getFileSampleRateHz(path);
+      if (sr != null && sr > 0) rates.add(sr);
+    }
+    return rates;
+  }
+}
@@ -0,0 +1,45 @@
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:path/path.dart' as p;
+import 'package:path_provider/path_provider.dart';
+
+import '../../domain/models/monitor_mix_model.dart';
+
+class MonitorMixPersistence {
+  static Future<File> _fileForSong(int songId) async {
+    final dir = await getApplicationDocumentsDirectory();
+    return File(p.join(dir.path, 'monitor_mixes', 'song_$songId.json'));
+  }
+
+  /// Salva as mixes de in-ear da música em `monitor_mixes/song_<id>.json`.
+  static Future<File> saveForSong(int songId, List<MonitorMix> mixes) async {
+    final file = await _fileForSong(songId);
+    if (!await file.parent.exists()) {
+      await file.parent.create(recursive: true);
+    }
+    final payload = {
+      'songId': songId,
+      'mixes': mixes.map((m) => m.toJson()).toList(),
+    };
+    final jsonStr = const JsonEncoder.withIndent('  ').convert(payload);
+    await file.writeAsString(jsonStr, flush: true);
+    return file;
+  }
+
+  /// Mixes salvas da música; vazia se não houver arquivo ou se ele for inválido.
+  static Future<List<MonitorMix>> loadForSong(int songId) async {
+    try {
+      final file = await _fileForSong(songId);
+      if (!await file.exists()) return const [];
+      final obj = json.decode(await file.readAsString());
+      final raw = (obj['mixes'] as List?) ?? const [];
+      return raw
+          .whereType<Map<String, dynamic>>()
+          .map(MonitorMix.fromJson)
+          .toList();
+    } catch (_) {
+      return const [];
+    }
+  }
+}
@@ -46,6 +46,21 @@ class SetlistPersistence {
     return file;
   }
 
+  /// Pasta nova para gravar as saídas de um show deste setlist:
+  /// `recordings/<setlist>_<data-hora>/`.
+  static Future<Directory> newShowRecordingDirectory(String setlistName) async {
+    final dir = await getApplicationDocumentsDirectory();
+    final safeName = setlistName.replaceAll(RegExp(r'[^a-zA-Z0-9_-]+'), '_');
+    final stamp = DateTime.now()
+        .toIso8601String()
+        .split('.')
+        .first
+        .replaceAll(RegExp(r'[^0-9T]'), '');
+    final out = Directory(p.join(dir.path, 'recordings', '${safeName}_$stamp'));
+    await out.create(recursive: true);
+    return out;
+  }
+
   /// Lista todos os setlists salvos em `setlists/`.
   static Future<List<SetlistInfo>> listSetlists() async {
     final dir = await getApplicationDocumentsDirectory();
@@ -0,0 +1,40 @@
+// Metadados de um WAV lidos pelo probe nativo (file_probe.cpp), sem abrir o
+// arquivo de novo enquanto tamanho e data de modificação não mudarem.
+class AudioFileInfo {
+  final String path;
+  // false = não é um WAV legível (os outros campos ficam zerados)
+  final bool valid;
+  // 1 = PCM inteiro, 3 = float
+  final int audioFormat;
+  final int channels;
+  final int sampleRate;
+  final int bitsPerSample;
+  final int dataOffset;
+  final int dataBytes;
+  final int frames;
+  final double durationSec;
+
+  const AudioFileInfo({
+    required this.path,
+    required this.valid,
+    required this.audioFormat,
+    required this.channels,
+    required this.sampleRate,
+    required this.bitsPerSample,
+    required this.dataOffset,
+    required this.dataBytes,
+    required this.frames,
+    required this.durationSec,
+  });
+
+  const AudioFileInfo.invalid(this.path)
+      : valid = false,
+        audioFormat = 0,
+        channels = 0,
+        sampleRate = 0,
+        bitsPerSample = 0,
+        dataOffset = 0,
+        dataBytes = 0,
+        frames = 0,
+        durationSec = 0;
+}
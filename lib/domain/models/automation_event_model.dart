@@ -0,0 +1,46 @@
+// Evento agendado da timeline de uma música: automação de volume/pan, mute
+// ou parâmetro de insert/bus num instante exato. O mixer nativo consome a
+// timeline no frame certo, sem timer do lado Dart.
+class AutomationEvent {
+  // Ids de param_queue.h (os mesmos de INSERT_PARAM_IDS no MainActivity.kt)
+  static const int paramVolume = 0;
+  static const int paramPan = 1;
+  static const int paramMute = 16;
+
+  final int timeMs;
+  // true = bus de submix; false = track (índice na ordem de playAllTracks)
+  final bool isBus;
+  final int index;
+  final int param;
+  final double value;
+  // true = rampa linear desde o evento anterior do mesmo parâmetro
+  final bool ramp;
+
+  const AutomationEvent({
+    required this.timeMs,
+    this.isBus = false,
+    required this.index,
+    required this.param,
+    required this.value,
+    this.ramp = false,
+  });
+
+  Map<String, dynamic> toJson() => {
+        'timeMs': timeMs,
+        'bus': isBus,
+        'index': index,
+        'param': param,
+        'value': value,
+        'ramp': ramp,
+      };
+
+  factory AutomationEvent.fromJson(Map<String, dynamic> json) =>
+      AutomationEvent(
+        timeMs: (json['timeMs'] as num).toInt(),
+        isBus: json['bus'] == true,
+        index: (json['index'] as num).toInt(),
+        param: (json['param'] as num).toInt(),
+        value: (json['value'] as num).toDouble(),
+        ramp: json['ramp'] == true,
+      );
+}
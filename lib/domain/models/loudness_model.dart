@@ -0,0 +1,42 @@
+// Loudness medida no nativo (loudness.cpp, ITU-R BS.1770 / EBU R128), de um
+// stem ou da música somada com a mix atual.
+class LoudnessInfo {
+  // LUFS; -70 (gate absoluto) quando tudo é silêncio
+  final double integratedLufs;
+  // LU (EBU Tech 3342)
+  final double loudnessRange;
+  final double truePeakDbtp;
+  final double samplePeakDbfs;
+  final double durationSec;
+  // true = veio do cache de análise, sem ler o arquivo
+  final bool cached;
+
+  const LoudnessInfo({
+    required this.integratedLufs,
+    required this.loudnessRange,
+    required this.truePeakDbtp,
+    required this.samplePeakDbfs,
+    required this.durationSec,
+    this.cached = false,
+  });
+
+  bool get isSilent => integratedLufs <= -70.0;
+}
+
+class SongLoudness {
+  final LoudnessInfo song;
+  // Por caminho do arquivo; stems que não puderam ser lidos ficam de fora
+  final Map<String, LoudnessInfo> stems;
+
+  const SongLoudness({required this.song, required this.stems});
+
+  // Ganho (dB) que leva a música a targetLufs sem passar o true peak de
+  // ceilingDbtp; o engine aceita de -24 a +12 dB.
+  double trimDbFor(double targetLufs, {double ceilingDbtp = -1.0}) {
+    if (song.isSilent) return 0.0;
+    var trim = targetLufs - song.integratedLufs;
+    final headroom = ceilingDbtp - song.truePeakDbtp;
+    if (trim > headroom) trim = headroom;
+    return trim.clamp(-24.0, 12.0);
+  }
+}
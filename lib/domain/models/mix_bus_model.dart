@@ -0,0 +1,18 @@
+// Bus de submix do mixer nativo (ex.: "Bateria", "Backing vocals").
+// As tracks são atribuídas a buses por índice em playAllTracks; um bus pode
+// alimentar outro bus (parentIndex) ou a saída principal (null).
+class MixBus {
+  final String name;
+  final int? parentIndex;
+  final double volume;
+  final double pan;
+  final bool mute;
+
+  const MixBus({
+    required this.name,
+    this.parentIndex,
+    this.volume = 1.0,
+    this.pan = 0.0,
+    this.mute = false,
+  });
+}
@@ -0,0 +1,29 @@
+// Mix auxiliar de retorno (ex.: in-ear do baterista), independente da mix
+// principal. Sai no par de canais que começa em outputChannel (0-based) e
+// recebe de cada track o nível em sends[i] (0..1, pré-fader); tracks além do
+// tamanho da lista não entram na mix.
+class MonitorMix {
+  final String name;
+  final int outputChannel;
+  final List<double> sends;
+
+  const MonitorMix({
+    required this.name,
+    required this.outputChannel,
+    this.sends = const [],
+  });
+
+  Map<String, dynamic> toJson() => {
+        'name': name,
+        'outputChannel': outputChannel,
+        'sends': sends,
+      };
+
+  factory MonitorMix.fromJson(Map<String, dynamic> json) => MonitorMix(
+        name: (json['name'] as String?) ?? '',
+        outputChannel: (json['outputChannel'] as num).toInt(),
+        sends: ((json['sends'] as List?) ?? const [])
+            .map((v) => (v as num).toDouble())
+            .toList(),
+      );
+}
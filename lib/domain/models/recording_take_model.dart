@@ -0,0 +1,59 @@
+// Resultado de uma gravação da interface USB: um WAV mono 16-bit por canal
+// de entrada armado, todos começando no mesmo frame.
+class RecordedChannelFile {
+  // Canal de entrada (0-based) da interface
+  final int inputChannel;
+  final String path;
+
+  const RecordedChannelFile({required this.inputChannel, required this.path});
+}
+
+class RecordingTake {
+  final List<RecordedChannelFile> files;
+  final int sampleRate;
+  final int framesWritten;
+  // Frames que não couberam no buffer (disco lento); 0 numa gravação íntegra
+  final int framesDropped;
+  // Posição da música correspondente ao primeiro frame gravado; negativa se
+  // a gravação começou antes do play (a música começa -startPositionSec
+  // segundos dentro do take). null se o mixer não tocou durante a gravação.
+  final double? startPositionSec;
+
+  const RecordingTake({
+    required this.files,
+    required this.sampleRate,
+    required this.framesWritten,
+    required this.framesDropped,
+    this.startPositionSec,
+  });
+
+  double get durationSec => sampleRate > 0 ? framesWritten / sampleRate : 0.0;
+}
+
+// Gravação das saídas do mixer (tap pós-mix) de um show: WAVs intercalados
+// com todos os canais de saída, em segmentos de até ~4 GB.
+class OutputTapRecording {
+  final List<String> files;
+  final int channels;
+  final int sampleRate;
+  final int framesWritten;
+  // Blocos do render que não couberam no buffer do writer (áudio perdido na
+  // gravação; o que saiu para o PA não é afetado)
+  final int blocksDropped;
+  final int framesDropped;
+  // Blocos de músicas em outro formato (taxa/canais) que ficaram fora do
+  // arquivo: o tap grava num formato só
+  final int formatMismatchBlocks;
+
+  const OutputTapRecording({
+    required this.files,
+    required this.channels,
+    required this.sampleRate,
+    required this.framesWritten,
+    required this.blocksDropped,
+    required this.framesDropped,
+    this.formatMismatchBlocks = 0,
+  });
+
+  double get durationSec => sampleRate > 0 ? framesWritten / sampleRate : 0.0;
+}
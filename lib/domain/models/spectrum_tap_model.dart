@@ -0,0 +1,21 @@
+// Fonte do analisador de espectro: um par da saída (pós-master, a partir de
+// firstChannel, 0-based) ou uma track (pós-inserts, pré-fader).
+class SpectrumTap {
+  final bool isTrack;
+  final int index;
+
+  const SpectrumTap.output(int firstChannel)
+      : isTrack = false,
+        index = firstChannel;
+
+  const SpectrumTap.track(int trackIndex)
+      : isTrack = true,
+        index = trackIndex;
+
+  @override
+  bool operator ==(Object other) =>
+      other is SpectrumTap && other.isTrack == isTrack && other.index == index;
+
+  @override
+  int get hashCode => Object.hash(isTrack, index);
+}
@@ -0,0 +1,42 @@
+// Resultado da importação nativa de um stem (import_job.cpp): cópia e
+// análise feitas na mesma leitura do arquivo.
+enum StemImportStatus { analyzed, copied, readError, writeError, cancelled }
+
+class StemImportResult {
+  final String source;
+  final String destination;
+  final StemImportStatus status;
+  // 0 quando o arquivo não foi analisado (ex.: mp3)
+  final int sampleRate;
+  final int channels;
+  final int bitsPerSample;
+  final int bytes;
+  final double durationSec;
+  // 0 se o stem é curto demais para estimar
+  final double bpm;
+  // Fração do arquivo em silêncio; null sem mapa de silêncio
+  final double? silentFraction;
+  // XXH64 do arquivo em hex; null se não copiado
+  final String? contentHash;
+  // Importação endereçada por conteúdo: o stem já existia em destination
+  // (de outra música) e não foi gravado de novo
+  final bool isShared;
+
+  const StemImportResult({
+    required this.source,
+    required this.destination,
+    required this.status,
+    this.sampleRate = 0,
+    this.channels = 0,
+    this.bitsPerSample = 0,
+    this.bytes = 0,
+    this.durationSec = 0.0,
+    this.bpm = 0.0,
+    this.silentFraction,
+    this.contentHash,
+    this.isShared = false,
+  });
+
+  bool get isCopied =>
+      status == StemImportStatus.analyzed || status == StemImportStatus.copied;
+}
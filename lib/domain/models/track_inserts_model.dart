@@ -0,0 +1,54 @@
+// Configuração da cadeia de inserts de uma track no mixer nativo
+// (HPF -> EQ1 -> EQ2 -> LPF -> compressor/limitador).
+// Valores "desligados": hpfHz/lpfHz = 0, ganho de EQ = 0 dB, compRatio <= 1,
+// limitCeilingDb >= 0.
+class TrackInserts {
+  final double hpfHz;
+  final double lpfHz;
+  final double eq1Hz;
+  final double eq1GainDb;
+  final double eq1Q;
+  final double eq2Hz;
+  final double eq2GainDb;
+  final double eq2Q;
+  final double compThresholdDb;
+  final double compRatio;
+  final double compAttackMs;
+  final double compReleaseMs;
+  final double compMakeupDb;
+  final double limitCeilingDb;
+
+  const TrackInserts({
+    this.hpfHz = 0.0,
+    this.lpfHz = 0.0,
+    this.eq1Hz = 250.0,
+    this.eq1GainDb = 0.0,
+    this.eq1Q = 0.707,
+    this.eq2Hz = 3000.0,
+    this.eq2GainDb = 0.0,
+    this.eq2Q = 0.707,
+    this.compThresholdDb = 0.0,
+    this.compRatio = 1.0,
+    this.compAttackMs = 10.0,
+    this.compReleaseMs = 120.0,
+    this.compMakeupDb = 0.0,
+    this.limitCeilingDb = 0.0,
+  });
+
+  Map<String, double> toMap() => {
+        'hpfHz': hpfHz,
+        'lpfHz': lpfHz,
+        'eq1Hz': eq1Hz,
+        'eq1GainDb': eq1GainDb,
+        'eq1Q': eq1Q,
+        'eq2Hz': eq2Hz,
+        'eq2GainDb': eq2GainDb,
+        'eq2Q': eq2Q,
+        'compThresholdDb': compThresholdDb,
+        'compRatio': compRatio,
+        'compAttackMs': compAttackMs,
+        'compReleaseMs': compReleaseMs,
+        'compMakeupDb': compMakeupDb,
+        'limitCeilingDb': limitCeilingDb,
+      };
+}
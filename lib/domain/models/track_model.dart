@@ -2,6 +2,8 @@ import 'package:isar/isar.dart';
 
 part 'track_model.g.dart';
 
+final _kContentName = RegExp(r'(?:^|[/\\])([0-9a-f]{16})\.[^/\\.]*$');
+
 @collection
 class Track {
   Id id = Isar.autoIncrement;
@@ -14,6 +16,13 @@ class Track {
   int inputChannel = 0; // Canal de entrada (para gravação/roteamento)
   bool isMetronome = false; // Define se esta faixa é o metrônomo
 
+  // Hash do conteúdo (XXH64 em hex) dos stems importados endereçados por
+  // conteúdo: o próprio nome do arquivo (audio/<hash>.wav), compartilhado por
+  // todas as músicas com o mesmo stem. null para arquivos com nome UUID.
+  @ignore
+  String? get contentHash =>
+      _kContentName.firstMatch(localFilePath)?.group(1);
+
   Track copyWith({
     String? name,
     String? localFilePath,
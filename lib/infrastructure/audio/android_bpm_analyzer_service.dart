@@ -1,16 +1,16 @@
 import 'dart:async';
-import 'dart:io' show Platform;
 import 'package:flutter/services.dart';
 
 import '../../application/services/i_bpm_analyzer_service.dart';
+import 'native_engine_ffi.dart';
 
 class AndroidNativeBpmAnalyzerService implements IBpmAnalyzerService {
   static const MethodChannel _methodChannel = MethodChannel('audio_usb/methods');
 
   @override
   Future<BpmDetectionResult> detectFromFile(String filePath) async {
-    // Apenas Android possui implementação nativa real.
-    if (!Platform.isAndroid) {
+    // Apenas Android e Linux possuem implementação nativa real.
+    if (!hasNativeAudioEngine) {
       return _fallbackHeuristic(filePath);
     }
     try {
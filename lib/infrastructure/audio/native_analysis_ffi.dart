@@ -0,0 +1,661 @@
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart';
+
+import '../../domain/models/audio_file_info_model.dart';
+import '../../domain/models/loudness_model.dart';
+import '../../domain/models/stem_import_model.dart';
+import 'native_engine_ffi.dart';
+
+// Peaks de forma de onda e beat-grid calculados no nativo (wav_analysis.cpp)
+// e entregues como Float32List apontando para a memória nativa, sem boxing
+// nem cópia. A leitura do arquivo roda num isolate auxiliar; só o endereço do
+// buffer volta para o isolate da UI.
+
+const String _kLibName = 'libmultichannel_preview.so';
+
+final class _MtpWaveformInfo extends Struct {
+  @Int32()
+  external int sampleRate;
+  @Int32()
+  external int channels;
+  @Int32()
+  external int bitsPerSample;
+  @Int32()
+  external int points;
+  @Int64()
+  external int dataBytes;
+  @Double()
+  external double durationSec;
+}
+
+final class _MtpBeatGridInfo extends Struct {
+  @Double()
+  external double bpm;
+  @Double()
+  external double confidence;
+  @Double()
+  external double firstBeatSec;
+  @Double()
+  external double periodSec;
+  @Int32()
+  external int beats;
+  @Int32()
+  external int reserved;
+}
+
+// Espelha MtpFileProbe de file_probe.h (72 bytes)
+final class _MtpFileProbe extends Struct {
+  @Int32()
+  external int valid;
+  @Int32()
+  external int audioFormat;
+  @Int32()
+  external int channels;
+  @Int32()
+  external int sampleRate;
+  @Int32()
+  external int bitsPerSample;
+  @Int32()
+  external int cached;
+  @Int64()
+  external int dataOffset;
+  @Int64()
+  external int dataBytes;
+  @Int64()
+  external int frames;
+  @Int64()
+  external int fileSize;
+  @Int64()
+  external int mtimeNs;
+  @Double()
+  external double durationSec;
+}
+
+// Espelha MtpLoudness de loudness.h (48 bytes)
+final class _MtpLoudness extends Struct {
+  @Int32()
+  external int valid;
+  @Int32()
+  external int cached;
+  @Double()
+  external double integratedLufs;
+  @Double()
+  external double loudnessRange;
+  @Double()
+  external double truePeakDbtp;
+  @Double()
+  external double samplePeakDbfs;
+  @Double()
+  external double durationSec;
+}
+
+// Espelha MtpImportProgress de import_job.h
+final class _MtpImportProgress extends Struct {
+  @Int64()
+  external int bytesTotal;
+  @Int64()
+  external int bytesDone;
+  @Int32()
+  external int filesDone;
+  @Int32()
+  external int cancel;
+}
+
+// Espelha MtpImportResult de import_job.h (64 bytes)
+final class _MtpImportResult extends Struct {
+  @Int32()
+  external int status;
+  @Int32()
+  external int sampleRate;
+  @Int32()
+  external int channels;
+  @Int32()
+  external int bitsPerSample;
+  @Int64()
+  external int bytes;
+  @Double()
+  external double durationSec;
+  @Double()
+  external double bpm;
+  @Double()
+  external double silentFraction;
+  @Uint64()
+  external int contentHash;
+  @Int32()
+  external int shared;
+  @Int32()
+  external int reserved;
+}
+
+// MTP_IMPORT_CONTENT_ADDRESSED de import_job.h
+const int _kImportContentAddressed = 1;
+
+typedef _PeaksNative = Pointer<Float> Function(
+    Pointer<Utf8>, Int32, Pointer<_MtpWaveformInfo>);
+typedef _PeaksDart = Pointer<Float> Function(
+    Pointer<Utf8>, int, Pointer<_MtpWaveformInfo>);
+typedef _BeatGridNative = Pointer<Float> Function(
+    Pointer<Utf8>, Pointer<_MtpBeatGridInfo>);
+typedef _BeatGridDart = Pointer<Float> Function(
+    Pointer<Utf8>, Pointer<_MtpBeatGridInfo>);
+typedef _ProbeNative = Int32 Function(
+    Pointer<Pointer<Utf8>>, Int32, Pointer<_MtpFileProbe>);
+typedef _ProbeDart = int Function(
+    Pointer<Pointer<Utf8>>, int, Pointer<_MtpFileProbe>);
+typedef _LoudnessNative = Int32 Function(
+    Int32,
+    Pointer<Pointer<Utf8>>,
+    Pointer<Float>,
+    Pointer<Float>,
+    Pointer<Int32>,
+    Int32,
+    Pointer<_MtpLoudness>,
+    Pointer<_MtpLoudness>);
+typedef _LoudnessDart = int Function(
+    int,
+    Pointer<Pointer<Utf8>>,
+    Pointer<Float>,
+    Pointer<Float>,
+    Pointer<Int32>,
+    int,
+    Pointer<_MtpLoudness>,
+    Pointer<_MtpLoudness>);
+typedef _SilenceMapsNative = Int32 Function(
+    Pointer<Pointer<Utf8>>, Int32, Pointer<Float>);
+typedef _SilenceMapsDart = int Function(
+    Pointer<Pointer<Utf8>>, int, Pointer<Float>);
+typedef _ImportNative = Int32 Function(
+    Pointer<Pointer<Utf8>>,
+    Pointer<Pointer<Utf8>>,
+    Int32,
+    Int32,
+    Pointer<_MtpImportProgress>,
+    Pointer<_MtpImportResult>);
+typedef _ImportDart = int Function(
+    Pointer<Pointer<Utf8>>,
+    Pointer<Pointer<Utf8>>,
+    int,
+    int,
+    Pointer<_MtpImportProgress>,
+    Pointer<_MtpImportResult>);
+typedef _BundleNative = Int32 Function(
+    Pointer<Utf8>, Pointer<Pointer<Utf8>>, Int32);
+typedef _BundleDart = int Function(
+    Pointer<Utf8>, Pointer<Pointer<Utf8>>, int);
+typedef _CacheFileNative = Int32 Function(Pointer<Utf8>);
+typedef _CacheFileDart = int Function(Pointer<Utf8>);
+typedef _FreeNative = Void Function(Pointer<Void>);
+typedef _FreeDart = void Function(Pointer<Void>);
+
+// Buffer float alocado pelo nativo. `view` lê a memória nativa diretamente e
+// só vale até release(); quem guarda a view deve guardar também o buffer. Se
+// o dono esquecer de liberar, o NativeFinalizer devolve a memória quando o
+// buffer for coletado.
+class NativeFloat32Buffer implements Finalizable {
+  NativeFloat32Buffer._(this._ptr, int length)
+      : _view = _ptr.asTypedList(length) {
+    _finalizer.attach(this, _ptr.cast(), detach: this);
+  }
+
+  static final DynamicLibrary _lib = DynamicLibrary.open(_kLibName);
+  static final NativeFinalizer _finalizer = NativeFinalizer(
+      _lib.lookup<NativeFinalizerFunction>('mtp_buffer_free'));
+  static final _FreeDart _free =
+      _lib.lookupFunction<_FreeNative, _FreeDart>('mtp_buffer_free');
+
+  Pointer<Float> _ptr;
+  Float32List _view;
+
+  Float32List get view => _view;
+  bool get isReleased => _ptr == nullptr;
+
+  void release() {
+    if (_ptr == nullptr) return;
+    _finalizer.detach(this);
+    _free(_ptr.cast());
+    _ptr = nullptr;
+    _view = Float32List(0);
+  }
+}
+
+class NativeWaveformResult {
+  NativeWaveformResult._(this.buffer, this.sampleRate, this.channels,
+      this.bitsPerSample, this.dataBytes, this.durationSec);
+  final NativeFloat32Buffer buffer;
+  final int sampleRate;
+  final int channels;
+  final int bitsPerSample;
+  final int dataBytes;
+  final double durationSec;
+}
+
+class NativeBeatGridResult {
+  NativeBeatGridResult._(this.buffer, this.bpm, this.confidence,
+      this.firstBeatSec, this.periodSec);
+  // Instantes das batidas em segundos
+  final NativeFloat32Buffer buffer;
+  final double bpm;
+  final double confidence;
+  final double firstBeatSec;
+  final double periodSec;
+}
+
+class NativeAnalysisFfi {
+  static bool? _available;
+
+  static bool get isAvailable {
+    final cached = _available;
+    if (cached != null) return cached;
+    var ok = false;
+    if (hasNativeAudioEngine) {
+      try {
+        final lib = DynamicLibrary.open(_kLibName);
+        ok = lib.providesSymbol('mtp_waveform_peaks') &&
+            lib.providesSymbol('mtp_beat_grid') &&
+            lib.providesSymbol('mtp_probe_files');
+      } catch (e) {
+        debugPrint('NativeAnalysisFfi unavailable: $e');
+      }
+    }
+    return _available = ok;
+  }
+
+  // null se indisponível ou se o arquivo não puder ser analisado
+  static Future<NativeWaveformResult?> waveformPeaks(
+      String path, int points) async {
+    if (!isAvailable) return null;
+    final r = await Isolate.run(() => _peaksWorker(path, points));
+    if (r == null) return null;
+    return NativeWaveformResult._(
+      NativeFloat32Buffer._(Pointer<Float>.fromAddress(r.$1), r.$2),
+      r.$3,
+      r.$4,
+      r.$5,
+      r.$6,
+      r.$7,
+    );
+  }
+
+  static Future<NativeBeatGridResult?> beatGrid(String path) async {
+    if (!isAvailable) return null;
+    final r = await Isolate.run(() => _beatGridWorker(path));
+    if (r == null) return null;
+    return NativeBeatGridResult._(
+      NativeFloat32Buffer._(Pointer<Float>.fromAddress(r.$1), r.$2),
+      r.$3,
+      r.$4,
+      r.$5,
+      r.$6,
+    );
+  }
+
+  // Metadados de vários WAVs numa chamada (lidos em paralelo no nativo, com
+  // cache por caminho/tamanho/mtime); null se indisponível
+  static Future<List<AudioFileInfo>?> probeFiles(List<String> paths) async {
+    if (!isAvailable) return null;
+    if (paths.isEmpty) return const [];
+    return Isolate.run(() => _probeWorker(paths));
+  }
+
+  // Loudness dos stems e da soma com volume/pan/saída de cada um, numa
+  // passada só pelos arquivos; volta do cache (o mesmo do probe) enquanto
+  // arquivos e mix não mudarem. null se indisponível ou se nada foi lido.
+  static Future<SongLoudness?> songLoudness(
+    int songId,
+    List<String> paths,
+    List<double> volumes,
+    List<double> pans,
+    List<int> outputChannels,
+  ) async {
+    if (!isAvailable || paths.isEmpty) return null;
+    final lib = DynamicLibrary.open(_kLibName);
+    if (!lib.providesSymbol('mtp_loudness_song')) return null;
+    return Isolate.run(() =>
+        _loudnessWorker(songId, paths, volumes, pans, outputChannels));
+  }
+
+  // Mapa de silêncio de cada arquivo (o mixer não lê nem mistura os trechos
+  // vazios); só os que não estão no cache são lidos. Devolve a fração
+  // silenciosa por caminho; null se indisponível.
+  static Future<Map<String, double>?> buildSilenceMaps(
+      List<String> paths) async {
+    if (!isAvailable) return null;
+    if (paths.isEmpty) return const {};
+    final lib = DynamicLibrary.open(_kLibName);
+    if (!lib.providesSymbol('mtp_silence_maps_build')) return null;
+    return Isolate.run(() => _silenceMapsWorker(paths));
+  }
+
+  // Copia sources[i] para destinations[i] analisando na mesma leitura
+  // (peaks, beat-grid, mapa de silêncio e probe ficam prontos no cache);
+  // vários arquivos em paralelo. onProgress recebe a fração de bytes
+  // copiados (0..1) enquanto roda. Com contentAddressed, destinations[i] só
+  // dá diretório e extensão: o arquivo fica em <dir>/<hash><ext> e stems
+  // iguais a um já importado não são gravados de novo (ver
+  // StemImportResult.destination). null se indisponível.
+  static Future<List<StemImportResult>?> importFiles(
+    List<String> sources,
+    List<String> destinations, {
+    bool contentAddressed = false,
+    void Function(double progress)? onProgress,
+  }) async {
+    if (!isAvailable) return null;
+    if (sources.isEmpty) return const [];
+    final lib = DynamicLibrary.open(_kLibName);
+    if (!lib.providesSymbol('mtp_import_files')) return null;
+    // O worker escreve no struct pelo endereço; a UI lê por polling
+    final progress = calloc<_MtpImportProgress>();
+    final address = progress.address;
+    Timer? poll;
+    if (onProgress != null) {
+      poll = Timer.periodic(const Duration(milliseconds: 100), (_) {
+        final p = progress.ref;
+        if (p.bytesTotal > 0) onProgress(p.bytesDone / p.bytesTotal);
+      });
+    }
+    try {
+      return await Isolate.run(() =>
+          _importWorker(sources, destinations, contentAddressed, address));
+    } finally {
+      poll?.cancel();
+      calloc.free(progress);
+    }
+  }
+
+  // Pacote da música (song_bundle.cpp): os stems intercalados num arquivo
+  // só, para o play ler um chunk de todas as tracks por vez. O engine usa o
+  // pacote registrado sozinho quando ele cobre as tracks do play.
+  static Future<bool> buildSongBundle(String file, List<String> paths) async {
+    if (!isAvailable || paths.isEmpty) return false;
+    final lib = DynamicLibrary.open(_kLibName);
+    if (!lib.providesSymbol('mtp_bundle_build')) return false;
+    return Isolate.run(() => _bundleCall('mtp_bundle_build', file, paths) == 1);
+  }
+
+  // Registra um pacote já montado se ele tem exatamente esses stems e
+  // nenhum mudou; false = precisa remontar
+  static bool openSongBundle(String file, List<String> paths) {
+    if (!isAvailable || paths.isEmpty) return false;
+    final lib = DynamicLibrary.open(_kLibName);
+    if (!lib.providesSymbol('mtp_bundle_open')) return false;
+    return _bundleCall('mtp_bundle_open', file, paths) == 1;
+  }
+
+  static void forgetSongBundle(String file) {
+    if (!isAvailable) return;
+    final lib = DynamicLibrary.open(_kLibName);
+    if (!lib.providesSymbol('mtp_bundle_forget')) return;
+    _cacheFileCall('mtp_bundle_forget', file);
+  }
+
+  // Cache persistente do probe (o cache em memória é do processo inteiro)
+  static int loadProbeCache(String file) =>
+      _cacheFileCall('mtp_probe_cache_load', file);
+  static bool saveProbeCache(String file) =>
+      _cacheFileCall('mtp_probe_cache_save', file) == 1;
+
+  static int _cacheFileCall(String symbol, String file) {
+    if (!isAvailable) return 0;
+    final fn = DynamicLibrary.open(_kLibName)
+        .lookupFunction<_CacheFileNative, _CacheFileDart>(symbol);
+    final cFile = file.toNativeUtf8();
+    try {
+      return fn(cFile);
+    } finally {
+      malloc.free(cFile);
+    }
+  }
+}
+
+List<AudioFileInfo> _probeWorker(List<String> paths) {
+  final lib = DynamicLibrary.open(_kLibName);
+  final fn = lib.lookupFunction<_ProbeNative, _ProbeDart>('mtp_probe_files');
+  final cPaths = calloc<Pointer<Utf8>>(paths.length);
+  final out = calloc<_MtpFileProbe>(paths.length);
+  try {
+    for (var i = 0; i < paths.length; i++) {
+      cPaths[i] = paths[i].toNativeUtf8();
+    }
+    fn(cPaths, paths.length, out);
+    return [
+      for (var i = 0; i < paths.length; i++)
+        if (out[i].valid == 0)
+          AudioFileInfo.invalid(paths[i])
+        else
+          AudioFileInfo(
+            path: paths[i],
+            valid: true,
+            audioFormat: out[i].audioFormat,
+            channels: out[i].channels,
+            sampleRate: out[i].sampleRate,
+            bitsPerSample: out[i].bitsPerSample,
+            dataOffset: out[i].dataOffset,
+            dataBytes: out[i].dataBytes,
+            frames: out[i].frames,
+            durationSec: out[i].durationSec,
+          ),
+    ];
+  } finally {
+    for (var i = 0; i < paths.length; i++) {
+      if (cPaths[i] != nullptr) malloc.free(cPaths[i]);
+    }
+    calloc.free(cPaths);
+    calloc.free(out);
+  }
+}
+
+SongLoudness? _loudnessWorker(int songId, List<String> paths,
+    List<double> volumes, List<double> pans, List<int> outputChannels) {
+  final lib = DynamicLibrary.open(_kLibName);
+  final fn =
+      lib.lookupFunction<_LoudnessNative, _LoudnessDart>('mtp_loudness_song');
+  final n = paths.length;
+  final cPaths = calloc<Pointer<Utf8>>(n);
+  final cVolumes = calloc<Float>(n);
+  final cPans = calloc<Float>(n);
+  final cOutputs = calloc<Int32>(n);
+  final stems = calloc<_MtpLoudness>(n);
+  final song = calloc<_MtpLoudness>();
+  try {
+    for (var i = 0; i < n; i++) {
+      cPaths[i] = paths[i].toNativeUtf8();
+      cVolumes[i] = volumes[i];
+      cPans[i] = pans[i];
+      cOutputs[i] = outputChannels[i];
+    }
+    if (fn(songId, cPaths, cVolumes, cPans, cOutputs, n, stems, song) != 1) {
+      return null;
+    }
+    return SongLoudness(
+      song: _loudnessOf(song.ref),
+      stems: {
+        for (var i = 0; i < n; i++)
+          if (stems[i].valid != 0) paths[i]: _loudnessOf(stems[i]),
+      },
+    );
+  } finally {
+    for (var i = 0; i < n; i++) {
+      if (cPaths[i] != nullptr) malloc.free(cPaths[i]);
+    }
+    calloc.free(cPaths);
+    calloc.free(cVolumes);
+    calloc.free(cPans);
+    calloc.free(cOutputs);
+    calloc.free(stems);
+    calloc.free(song);
+  }
+}
+
+Map<String, double> _silenceMapsWorker(List<String> paths) {
+  final lib = DynamicLibrary.open(_kLibName);
+  final fn = lib.lookupFunction<_SilenceMapsNative, _SilenceMapsDart>(
+      'mtp_silence_maps_build');
+  final cPaths = calloc<Pointer<Utf8>>(paths.length);
+  final ratios = calloc<Float>(paths.length);
+  try {
+    for (var i = 0; i < paths.length; i++) {
+      cPaths[i] = paths[i].toNativeUtf8();
+    }
+    fn(cPaths, paths.length, ratios);
+    return {
+      for (var i = 0; i < paths.length; i++)
+        if (ratios[i] >= 0) paths[i]: ratios[i],
+    };
+  } finally {
+    for (var i = 0; i < paths.length; i++) {
+      if (cPaths[i] != nullptr) malloc.free(cPaths[i]);
+    }
+    calloc.free(cPaths);
+    calloc.free(ratios);
+  }
+}
+
+// Hash de conteúdo (XXH64) em 16 dígitos hex, como contentHashHex no nativo
+String contentHashHex(int hash) =>
+    BigInt.from(hash).toUnsigned(64).toRadixString(16).padLeft(16, '0');
+
+// Mesmo nome que contentAddressedPath (content_hash.cpp) dá ao arquivo
+String contentAddressedPath(String destination, String hashHex) {
+  final slash = destination.lastIndexOf('/');
+  final dot = destination.lastIndexOf('.');
+  final ext = dot > slash ? destination.substring(dot) : '';
+  return '${destination.substring(0, slash + 1)}$hashHex$ext';
+}
+
+List<StemImportResult> _importWorker(List<String> sources,
+    List<String> destinations, bool contentAddressed, int progressAddress) {
+  final lib = DynamicLibrary.open(_kLibName);
+  final fn = lib.lookupFunction<_ImportNative, _ImportDart>('mtp_import_files');
+  final n = sources.length;
+  final cSources = calloc<Pointer<Utf8>>(n);
+  final cDestinations = calloc<Pointer<Utf8>>(n);
+  final results = calloc<_MtpImportResult>(n);
+  try {
+    for (var i = 0; i < n; i++) {
+      cSources[i] = sources[i].toNativeUtf8();
+      cDestinations[i] = destinations[i].toNativeUtf8();
+    }
+    fn(
+        cSources,
+        cDestinations,
+        n,
+        contentAddressed ? _kImportContentAddressed : 0,
+        Pointer<_MtpImportProgress>.fromAddress(progressAddress),
+        results);
+    return [
+      for (var i = 0; i < n; i++)
+        StemImportResult(
+          source: sources[i],
+          destination: contentAddressed && results[i].contentHash != 0
+              ? contentAddressedPath(
+                  destinations[i], contentHashHex(results[i].contentHash))
+              : destinations[i],
+          contentHash: results[i].contentHash != 0
+              ? contentHashHex(results[i].contentHash)
+              : null,
+          isShared: results[i].shared != 0,
+          status: StemImportStatus.values[
+              results[i].status.clamp(0, StemImportStatus.values.length - 1)],
+          sampleRate: results[i].sampleRate,
+          channels: results[i].channels,
+          bitsPerSample: results[i].bitsPerSample,
+          bytes: results[i].bytes,
+          durationSec: results[i].durationSec,
+          bpm: results[i].bpm,
+          silentFraction:
+              results[i].silentFraction >= 0 ? results[i].silentFraction : null,
+        ),
+    ];
+  } finally {
+    for (var i = 0; i < n; i++) {
+      if (cSources[i] != nullptr) malloc.free(cSources[i]);
+      if (cDestinations[i] != nullptr) malloc.free(cDestinations[i]);
+    }
+    calloc.free(cSources);
+    calloc.free(cDestinations);
+    calloc.free(results);
+  }
+}
+
+int _bundleCall(String symbol, String file, List<String> paths) {
+  final lib = DynamicLibrary.open(_kLibName);
+  final fn = lib.lookupFunction<_BundleNative, _BundleDart>(symbol);
+  final cFile = file.toNativeUtf8();
+  final cPaths = calloc<Pointer<Utf8>>(paths.length);
+  try {
+    for (var i = 0; i < paths.length; i++) {
+      cPaths[i] = paths[i].toNativeUtf8();
+    }
+    return fn(cFile, cPaths, paths.length);
+  } finally {
+    for (var i = 0; i < paths.length; i++) {
+      if (cPaths[i] != nullptr) malloc.free(cPaths[i]);
+    }
+    calloc.free(cPaths);
+    malloc.free(cFile);
+  }
+}
+
+LoudnessInfo _loudnessOf(_MtpLoudness l) => LoudnessInfo(
+      integratedLufs: l.integratedLufs,
+      loudnessRange: l.loudnessRange,
+      truePeakDbtp: l.truePeakDbtp,
+      samplePeakDbfs: l.samplePeakDbfs,
+      durationSec: l.durationSec,
+      cached: l.cached != 0,
+    );
+
+// (endereço, pontos, sampleRate, canais, bits, dataBytes, duração)
+(int, int, int, int, int, int, double)? _peaksWorker(String path, int points) {
+  final lib = DynamicLibrary.open(_kLibName);
+  final fn = lib.lookupFunction<_PeaksNative, _PeaksDart>('mtp_waveform_peaks');
+  final cPath = path.toNativeUtf8();
+  final info = calloc<_MtpWaveformInfo>();
+  try {
+    final ptr = fn(cPath, points, info);
+    if (ptr == nullptr) return null;
+    final i = info.ref;
+    return (
+      ptr.address,
+      i.points,
+      i.sampleRate,
+      i.channels,
+      i.bitsPerSample,
+      i.dataBytes,
+      i.durationSec,
+    );
+  } finally {
+    malloc.free(cPath);
+    calloc.free(info);
+  }
+}
+
+// (endereço, batidas, bpm, confiança, primeira batida, período)
+(int, int, double, double, double, double)? _beatGridWorker(String path) {
+  final lib = DynamicLibrary.open(_kLibName);
+  final fn =
+      lib.lookupFunction<_BeatGridNative, _BeatGridDart>('mtp_beat_grid');
+  final cPath = path.toNativeUtf8();
+  final info = calloc<_MtpBeatGridInfo>();
+  try {
+    final ptr = fn(cPath, info);
+    if (ptr == nullptr) return null;
+    final i = info.ref;
+    return (
+      ptr.address,
+      i.beats,
+      i.bpm,
+      i.confidence,
+      i.firstBeatSec,
+      i.periodSec,
+    );
+  } finally {
+    malloc.free(cPath);
+    calloc.free(info);
+  }
+}
@@ -1,11 +1,25 @@
 import 'dart:async';
-import 'dart:io' show Platform;
+import 'dart:io' show Directory, File, Platform;
+import 'dart:typed_data';
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
+import 'package:path/path.dart' as p;
+import 'package:path_provider/path_provider.dart';
 
 import '../../application/services/i_audio_device_service.dart';
 import '../../domain/models/audio_device_model.dart';
+import '../../domain/models/audio_file_info_model.dart';
 import '../../domain/models/track_model.dart';
+import '../../domain/models/track_inserts_model.dart';
+import '../../domain/models/mix_bus_model.dart';
+import '../../domain/models/monitor_mix_model.dart';
+import '../../domain/models/spectrum_tap_model.dart';
+import '../../domain/models/automation_event_model.dart';
+import '../../domain/models/recording_take_model.dart';
+import '../../domain/models/loudness_model.dart';
+import '../../domain/models/stem_import_model.dart';
+import 'native_analysis_ffi.dart';
+import 'native_engine_ffi.dart';
 
 class NativeAudioDeviceService implements IAudioDeviceService {
   static const EventChannel _eventChannel = EventChannel('audio_usb/events');
@@ -15,11 +29,20 @@ class NativeAudioDeviceService implements IAudioDeviceService {
   final StreamController<AudioDevice?> _controller =
       StreamController<AudioDevice?>.broadcast();
   StreamSubscription? _nativeSubscription;
+  // Caminho direto para o mixer nativo; faders, seek e medidores não passam
+  // pelo MethodChannel enquanto ele está tocando.
+  final NativeEngineFfi? _ffi = NativeEngineFfi.tryLoad();
+  // Arquivo do cache de probe; carregado na primeira consulta
+  Future<String?>? _probeCacheFile;
+  // Pacotes sendo montados, por música
+  final Map<int, Future<bool>> _bundleJobs = {};
+  // Pasta da gravação em andamento (o nativo só devolve os canais gravados)
+  String? _recordingDirectory;
 
   NativeAudioDeviceService() {
-    // Somente Android possui implementação nativa destes canais; em outras
-    // plataformas (macOS, iOS, web, etc.) evitamos escutar para não quebrar.
-    if (Platform.isAndroid) {
+    // Somente Android e Linux possuem implementação nativa destes canais; em
+    // outras plataformas (macOS, iOS, web, etc.) evitamos escutar para não quebrar.
+    if (hasNativeAudioEngine) {
       _nativeSubscription =
           _eventChannel.receiveBroadcastStream().listen((event) async {
         if (event == 'connected') {
@@ -42,8 +65,8 @@ class NativeAudioDeviceService implements IAudioDeviceService {
 
   @override
   Future<List<AudioDevice>> getAvailableDevices() async {
-    // Apenas Android possui implementação destes métodos via MethodChannel.
-    if (!Platform.isAndroid) {
+    // Apenas Android e Linux possuem implementação destes métodos via MethodChannel.
+    if (!hasNativeAudioEngine) {
       return [];
     }
     try {
@@ -88,8 +111,8 @@ class NativeAudioDeviceService implements IAudioDeviceService {
 
   @override
   Future<void> playPreview(String filePath, int outputChannel) async {
-    if (!Platform.isAndroid) {
-      // Sem suporte nativo fora do Android
+    if (!hasNativeAudioEngine) {
+      // Sem suporte nativo fora do Android e do Linux
       debugPrint('playPreview ignorado: plataforma não suportada');
       return;
     }
@@ -110,8 +133,8 @@ class NativeAudioDeviceService implements IAudioDeviceService {
 
   @override
   Future<void> stopPreview() async {
-    if (!Platform.isAndroid) {
-      // Sem suporte nativo fora do Android; considerar como stopped
+    if (!hasNativeAudioEngine) {
+      // Sem suporte nativo fora do Android e do Linux; considerar como stopped
       debugPrint('stopPreview ignorado: plataforma não suportada');
       return;
     }
@@ -126,7 +149,7 @@ class NativeAudioDeviceService implements IAudioDeviceService {
   @override
   Future<void> setPreviewVolume(double volume) async {
     final v = volume.clamp(0.0, 1.0);
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('setPreviewVolume ignorado: plataforma não suportada');
       return;
     }
@@ -143,7 +166,7 @@ class NativeAudioDeviceService implements IAudioDeviceService {
   @override
   Future<void> setPreviewPan(double pan) async {
     final p = pan.clamp(-1.0, 1.0);
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('setPreviewPan ignorado: plataforma não suportada');
       return;
     }
@@ -159,10 +182,11 @@ class NativeAudioDeviceService implements IAudioDeviceService {
 
   @override
   Future<void> setTrackVolume(int trackIndex, double volume) async {
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('setTrackVolume ignorado: plataforma não suportada');
       return;
     }
+    if (_ffi?.setTrackVolume(trackIndex, volume) ?? false) return;
     try {
       await _methodChannel.invokeMethod('setTrackVolume', {
         'trackIndex': trackIndex,
@@ -177,10 +201,11 @@ class NativeAudioDeviceService implements IAudioDeviceService {
 
   @override
   Future<void> setTrackPan(int trackIndex, double pan) async {
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('setTrackPan ignorado: plataforma não suportada');
       return;
     }
+    if (_ffi?.setTrackPan(trackIndex, pan) ?? false) return;
     try {
       await _methodChannel.invokeMethod('setTrackPan', {
         'trackIndex': trackIndex,
@@ -194,9 +219,14 @@ class NativeAudioDeviceService implements IAudioDeviceService {
   }
 
   @override
-  Future<void> playAllTracks(List<Track> tracks) async {
+  Future<void> playAllTracks(
+    List<Track> tracks, {
+    List<MixBus>? buses,
+    List<int?>? trackBuses,
+    List<MonitorMix>? monitorMixes,
+  }) async {
     if (tracks.isEmpty) return;
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('playAllTracks ignorado: plataforma não suportada');
       return;
     }
@@ -210,6 +240,27 @@ class NativeAudioDeviceService implements IAudioDeviceService {
         'outputChannels': outputChannels,
         'volumes': volumes,
         'pans': pans,
+        if (buses != null && buses.isNotEmpty) ...{
+          'trackBuses': List<int>.generate(
+            tracks.length,
+            (i) => trackBuses != null && i < trackBuses.length
+                ? (trackBuses[i] ?? -1)
+                : -1,
+          ),
+          'busParents': buses.map((b) => b.parentIndex ?? -1).toList(),
+          'busVolumes': buses.map((b) => b.volume.clamp(0.0, 1.0)).toList(),
+          'busPans': buses.map((b) => b.pan.clamp(-1.0, 1.0)).toList(),
+          'busMutes': buses.map((b) => b.mute).toList(),
+        },
+        if (monitorMixes != null && monitorMixes.isNotEmpty) ...{
+          'auxOutputs': monitorMixes.map((m) => m.outputChannel).toList(),
+          // track-major: nível da track i na mix a em [i * mixes + a]
+          'auxSends': [
+            for (var i = 0; i < tracks.length; i++)
+              for (final m in monitorMixes)
+                i < m.sends.length ? m.sends[i].clamp(0.0, 1.0) : 0.0,
+          ],
+        },
       });
       debugPrint('Native playAllPreview invoked with ${tracks.length} tracks');
     } catch (e) {
@@ -218,13 +269,149 @@ class NativeAudioDeviceService implements IAudioDeviceService {
     }
   }
 
+  @override
+  Future<Map<String, AudioFileInfo>> probeFiles(List<String> paths) async {
+    if (!NativeAnalysisFfi.isAvailable) return {};
+    final cacheFile = await (_probeCacheFile ??= _openProbeCache());
+    final infos = await NativeAnalysisFfi.probeFiles(paths);
+    if (infos == null) return {};
+    // Só grava se algum arquivo foi lido de fato
+    if (cacheFile != null) NativeAnalysisFfi.saveProbeCache(cacheFile);
+    return {for (final info in infos) info.path: info};
+  }
+
+  @override
+  Future<SongLoudness?> analyzeSongLoudness(
+      int songId, List<Track> tracks) async {
+    if (!NativeAnalysisFfi.isAvailable) return null;
+    final playable = [
+      for (final t in tracks)
+        if (t.localFilePath.isNotEmpty) t,
+    ];
+    if (playable.isEmpty) return null;
+    // O cache de loudness mora no mesmo arquivo do probe
+    final cacheFile = await (_probeCacheFile ??= _openProbeCache());
+    final result = await NativeAnalysisFfi.songLoudness(
+      songId,
+      [for (final t in playable) t.localFilePath],
+      [for (final t in playable) t.isMetronome ? 0.0 : t.volume.clamp(0.0, 1.0)],
+      [for (final t in playable) t.pan.clamp(-1.0, 1.0)],
+      [for (final t in playable) t.outputChannel],
+    );
+    if (result != null && !result.song.cached && cacheFile != null) {
+      NativeAnalysisFfi.saveProbeCache(cacheFile);
+    }
+    return result;
+  }
+
+  @override
+  Future<Map<String, double>> buildSilenceMaps(List<String> paths) async {
+    if (!NativeAnalysisFfi.isAvailable || paths.isEmpty) return {};
+    // Os mapas moram no mesmo arquivo do probe
+    final cacheFile = await (_probeCacheFile ??= _openProbeCache());
+    final ratios = await NativeAnalysisFfi.buildSilenceMaps(paths);
+    if (ratios == null) return {};
+    if (cacheFile != null) NativeAnalysisFfi.saveProbeCache(cacheFile);
+    return ratios;
+  }
+
+  @override
+  Future<List<StemImportResult>?> importStems(
+    List<String> sources,
+    List<String> destinations, {
+    bool contentAddressed = false,
+    void Function(double progress)? onProgress,
+  }) async {
+    if (!NativeAnalysisFfi.isAvailable) return null;
+    // Probe e mapas de silêncio entram no cache do probe
+    final cacheFile = await (_probeCacheFile ??= _openProbeCache());
+    final results = await NativeAnalysisFfi.importFiles(
+      sources,
+      destinations,
+      contentAddressed: contentAddressed,
+      onProgress: onProgress,
+    );
+    if (results != null && cacheFile != null) {
+      NativeAnalysisFfi.saveProbeCache(cacheFile);
+    }
+    return results;
+  }
+
+  @override
+  Future<bool> prepareSongBundle(int songId, List<Track> tracks,
+      {bool build = true}) async {
+    if (!NativeAnalysisFfi.isAvailable) return false;
+    final paths = [
+      for (final t in tracks)
+        if (t.localFilePath.isNotEmpty) t.localFilePath,
+    ];
+    if (paths.isEmpty) return false;
+    final file = await _bundleFileFor(songId);
+    if (file == null) return false;
+    if (NativeAnalysisFfi.openSongBundle(file, paths)) return true;
+    if (!build) return false;
+    // Uma montagem por música de cada vez
+    final running = _bundleJobs[songId];
+    if (running != null) return running;
+    final job = NativeAnalysisFfi.buildSongBundle(file, paths);
+    _bundleJobs[songId] = job;
+    try {
+      return await job;
+    } finally {
+      _bundleJobs.remove(songId);
+    }
+  }
+
+  @override
+  Future<void> deleteSongBundle(int songId) async {
+    final file = await _bundleFileFor(songId);
+    if (file == null) return;
+    NativeAnalysisFfi.forgetSongBundle(file);
+    try {
+      final f = File(file);
+      if (await f.exists()) await f.delete();
+    } catch (e) {
+      debugPrint('deleteSongBundle error: $e');
+    }
+  }
+
+  Future<String?> _bundleFileFor(int songId) async {
+    try {
+      final dir = await getApplicationSupportDirectory();
+      final bundles = Directory(p.join(dir.path, 'bundles'));
+      if (!await bundles.exists()) await bundles.create(recursive: true);
+      return p.join(bundles.path, 'song_$songId.mtpb');
+    } catch (e) {
+      debugPrint('Song bundle unavailable: $e');
+      return null;
+    }
+  }
+
+  @override
+  Future<void> setSongTrimDb(double db) async {
+    _ffi?.setSongTrimDb(db);
+  }
+
+  Future<String?> _openProbeCache() async {
+    try {
+      final dir = await getApplicationSupportDirectory();
+      final file = p.join(dir.path, 'probe_cache.bin');
+      NativeAnalysisFfi.loadProbeCache(file);
+      return file;
+    } catch (e) {
+      debugPrint('Probe cache unavailable: $e');
+      return null;
+    }
+  }
+
   @override
   Future<void> seekPlayAll(double positionSec) async {
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('seekPlayAll ignorado: plataforma não suportada');
       return;
     }
     final p = positionSec.isFinite && positionSec >= 0 ? positionSec : 0.0;
+    if (_ffi?.seek(p) ?? false) return;
     try {
       await _methodChannel.invokeMethod('seekPlayAll', {
         'positionSec': p,
@@ -236,10 +423,23 @@ class NativeAudioDeviceService implements IAudioDeviceService {
     }
   }
 
+  // Só pelo FFI: a taxa dos eventos do gesto não caberia no MethodChannel
+  @override
+  bool scrubBegin() => _ffi?.scrubBegin() ?? false;
+
+  @override
+  void scrubTo(double positionSec) {
+    if (!positionSec.isFinite) return;
+    _ffi?.scrubTo(positionSec < 0 ? 0.0 : positionSec);
+  }
+
+  @override
+  void scrubEnd() => _ffi?.scrubEnd();
+
   @override
   Future<void> prepareTracks(List<Track> tracks) async {
     if (tracks.isEmpty) return;
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('prepareTracks ignorado: plataforma não suportada');
       return;
     }
@@ -266,7 +466,7 @@ class NativeAudioDeviceService implements IAudioDeviceService {
     bool? disableResample,
     bool? enableDither,
   }) async {
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('setOutputQuality ignorado: plataforma não suportada');
       return;
     }
@@ -288,10 +488,12 @@ class NativeAudioDeviceService implements IAudioDeviceService {
 
   @override
   Future<int?> getFileSampleRateHz(String filePath) async {
-    if (!Platform.isAndroid) {
+    if (!hasNativeAudioEngine) {
       debugPrint('getFileSampleRateHz ignorado: plataforma não suportada');
       return null;
     }
+    final probed = (await probeFiles([filePath]))[filePath];
+    if (probed != null) return probed.valid ? probed.sampleRate : null;
     try {
       final result = await _methodChannel.invokeMethod<dynamic>(
         'getFileSampleRateHz',
@@ -310,8 +512,8 @@ class NativeAudioDeviceService implements IAudioDeviceService {
 
   @override
   Future<int?> getRecommendedBufferSizeFrames() async {
-    // Apenas Android possui consulta nativa; em outras plataformas retornamos null
-    if (!Platform.isAndroid) {
+    // Apenas Android e Linux possuem consulta nativa; em outras plataformas retornamos null
+    if (!hasNativeAudioEngine) {
       debugPrint('getRecommendedBufferSizeFrames ignorado: plataforma não suportada');
       return null;
     }
@@ -329,6 +531,304 @@ class NativeAudioDeviceService implements IAudioDeviceService {
     }
   }
 
+  @override
+  Future<bool> setTrackInserts(int trackIndex, TrackInserts inserts) async {
+    if (!hasNativeAudioEngine) {
+      debugPrint('setTrackInserts ignorado: plataforma não suportada');
+      return false;
+    }
+    try {
+      final result = await _methodChannel.invokeMethod<dynamic>(
+        'setTrackInserts',
+        {
+          'trackIndex': trackIndex,
+          'params': inserts.toMap(),
+        },
+      );
+      return result == true;
+    } catch (e) {
+      debugPrint('Native setTrackInserts unavailable or error: $e');
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> setBusParams(
+    int busIndex, {
+    double? volume,
+    double? pan,
+    bool? mute,
+    TrackInserts? inserts,
+  }) async {
+    if (!hasNativeAudioEngine) {
+      debugPrint('setBusParams ignorado: plataforma não suportada');
+      return false;
+    }
+    final ffi = _ffi;
+    if (inserts == null && ffi != null && ffi.isMixing) {
+      var ok = true;
+      if (volume != null) ok = ffi.setBusVolume(busIndex, volume) && ok;
+      if (pan != null) ok = ffi.setBusPan(busIndex, pan) && ok;
+      if (mute != null) ok = ffi.setBusMute(busIndex, mute) && ok;
+      return ok;
+    }
+    try {
+      final result = await _methodChannel.invokeMethod<dynamic>(
+        'setBusParams',
+        {
+          'busIndex': busIndex,
+          if (volume != null) 'volume': volume.clamp(0.0, 1.0),
+          if (pan != null) 'pan': pan.clamp(-1.0, 1.0),
+          if (mute != null) 'mute': mute,
+          if (inserts != null) 'inserts': inserts.toMap(),
+        },
+      );
+      return result == true;
+    } catch (e) {
+      debugPrint('Native setBusParams unavailable or error: $e');
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> setAuxSend(int trackIndex, int mixIndex, double level) async {
+    if (!hasNativeAudioEngine) {
+      debugPrint('setAuxSend ignorado: plataforma não suportada');
+      return false;
+    }
+    if (_ffi?.setAuxSend(trackIndex, mixIndex, level) ?? false) return true;
+    try {
+      final result = await _methodChannel.invokeMethod<dynamic>('setAuxSend', {
+        'trackIndex': trackIndex,
+        'mixIndex': mixIndex,
+        'level': level.clamp(0.0, 1.0),
+      });
+      return result == true;
+    } catch (e) {
+      debugPrint('Native setAuxSend unavailable or error: $e');
+      return false;
+    }
+  }
+
+  @override
+  Future<void> setTrackMute(int trackIndex, bool mute) async {
+    if (!hasNativeAudioEngine) {
+      debugPrint('setTrackMute ignorado: plataforma não suportada');
+      return;
+    }
+    if (_ffi?.setTrackMute(trackIndex, mute) ?? false) return;
+    try {
+      await _methodChannel.invokeMethod('setTrackMute', {
+        'trackIndex': trackIndex,
+        'mute': mute,
+      });
+    } catch (e) {
+      debugPrint('Native setTrackMute error: $e');
+    }
+  }
+
+  @override
+  Future<Map<String, dynamic>?> getEngineStats() async {
+    if (!hasNativeAudioEngine) {
+      return null;
+    }
+    try {
+      final result =
+          await _methodChannel.invokeMethod<dynamic>('getEngineStats');
+      if (result is Map) return Map<String, dynamic>.from(result);
+      return null;
+    } catch (e) {
+      debugPrint('Native getEngineStats unavailable or error: $e');
+      return null;
+    }
+  }
+
+  @override
+  double? get enginePositionSec => _ffi?.positionSec;
+
+  @override
+  bool get engineOutputLost => _ffi?.isOutputLost ?? false;
+
+  @override
+  Float32List? get trackMeterPeaks =>
+      (_ffi?.isMixing ?? false) ? _ffi!.trackPeaks : null;
+
+  @override
+  Future<bool> setSpectrumTap(SpectrumTap? tap, {int rateHz = 30}) async {
+    final ffi = _ffi;
+    if (ffi == null) {
+      debugPrint('setSpectrumTap ignorado: engine nativo indisponível');
+      return false;
+    }
+    if (tap == null) return ffi.setSpectrumTap(0, 0, rateHz);
+    return ffi.setSpectrumTap(tap.isTrack ? 2 : 1, tap.index, rateHz);
+  }
+
+  @override
+  Float32List? get spectrumBins => _ffi?.spectrumBins;
+
+  @override
+  double? get spectrumCorrelation => _ffi?.spectrumCorrelation;
+
+  @override
+  Future<void> setPreloadBudget(int budgetBytes) async {
+    final ffi = _ffi;
+    if (ffi == null) {
+      debugPrint('setPreloadBudget ignorado: engine nativo indisponível');
+      return;
+    }
+    ffi.setPreloadBudget(budgetBytes);
+  }
+
+  @override
+  Future<void> preloadSong(int songId, List<Track> tracks,
+      {bool urgent = false}) async {
+    final ffi = _ffi;
+    if (ffi == null || tracks.isEmpty) return;
+    ffi.preloadSong(songId, tracks.map((t) => t.localFilePath).toList(),
+        urgent: urgent);
+  }
+
+  @override
+  Future<void> markSongPlayed(int songId) async {
+    _ffi?.touchPreloadedSong(songId);
+  }
+
+  int? _msToFrames(int ms) {
+    final rate = _ffi?.sampleRate;
+    return rate == null ? null : (ms * rate) ~/ 1000;
+  }
+
+  @override
+  Future<bool> setLoopRegion(int startMs, int endMs) async {
+    final start = _msToFrames(startMs);
+    final end = _msToFrames(endMs);
+    if (start == null || end == null) return false;
+    return _ffi!.setLoopFrames(start, end);
+  }
+
+  @override
+  Future<void> clearLoopRegion() async {
+    _ffi?.clearLoop();
+  }
+
+  @override
+  Future<bool> scheduleJump(int targetMs,
+      {int? gridOriginMs, int? gridPeriodMs}) async {
+    final ffi = _ffi;
+    final target = _msToFrames(targetMs);
+    if (ffi == null || target == null) return false;
+    if (gridOriginMs != null && gridPeriodMs != null && gridPeriodMs > 0) {
+      return ffi.jumpOnGrid(
+          target, _msToFrames(gridOriginMs)!, _msToFrames(gridPeriodMs)!);
+    }
+    return ffi.jumpAtFrame(target);
+  }
+
+  @override
+  Future<bool> setAutomationTimeline(List<AutomationEvent> events) async {
+    final ffi = _ffi;
+    if (ffi == null) return false;
+    ffi.setTimeline(events);
+    return true;
+  }
+
+  @override
+  Future<bool> startRecording({
+    required String directory,
+    required List<int> inputChannels,
+  }) async {
+    if (!Platform.isAndroid || inputChannels.isEmpty) return false;
+    try {
+      final ok = await _methodChannel.invokeMethod<bool>('startRecording', {
+        'directory': directory,
+        'inputChannels': inputChannels,
+      });
+      if (ok == true) _recordingDirectory = directory;
+      return ok == true;
+    } catch (e) {
+      debugPrint('Native startRecording unavailable or error: $e');
+      return false;
+    }
+  }
+
+  @override
+  Future<RecordingTake?> stopRecording() async {
+    final directory = _recordingDirectory;
+    if (!Platform.isAndroid || directory == null) return null;
+    _recordingDirectory = null;
+    try {
+      final result = await _methodChannel
+          .invokeMethod<dynamic>('stopRecording', {'directory': directory});
+      if (result is! Map) return null;
+      final sampleRate = (result['sampleRate'] as num?)?.toInt() ?? 0;
+      // Ausente sem playback; negativo se a gravação começou antes do play
+      final startFrame = (result['startSongFrame'] as num?)?.toInt();
+      final files = <RecordedChannelFile>[];
+      for (final f in (result['files'] as List?) ?? const []) {
+        if (f is! Map) continue;
+        files.add(RecordedChannelFile(
+          inputChannel: (f['inputChannel'] as num).toInt(),
+          path: f['path'] as String,
+        ));
+      }
+      return RecordingTake(
+        files: files,
+        sampleRate: sampleRate,
+        framesWritten: (result['framesWritten'] as num?)?.toInt() ?? 0,
+        framesDropped: (result['framesDropped'] as num?)?.toInt() ?? 0,
+        startPositionSec: startFrame != null && sampleRate > 0
+            ? startFrame / sampleRate
+            : null,
+      );
+    } catch (e) {
+      debugPrint('Native stopRecording unavailable or error: $e');
+      return null;
+    }
+  }
+
+  @override
+  Future<bool> startOutputTap({
+    required String directory,
+    String fileName = 'show',
+    int? sampleRate,
+  }) async {
+    if (!hasNativeAudioEngine) return false;
+    try {
+      final ok = await _methodChannel.invokeMethod<bool>('startOutputTap', {
+        'directory': directory,
+        'fileName': fileName,
+        if (sampleRate != null && sampleRate > 0) 'sampleRate': sampleRate,
+      });
+      return ok == true;
+    } catch (e) {
+      debugPrint('Native startOutputTap unavailable or error: $e');
+      return false;
+    }
+  }
+
+  @override
+  Future<OutputTapRecording?> stopOutputTap() async {
+    if (!hasNativeAudioEngine) return null;
+    try {
+      final result = await _methodChannel.invokeMethod<dynamic>('stopOutputTap');
+      if (result is! Map) return null;
+      int read(String key) => (result[key] as num?)?.toInt() ?? 0;
+      return OutputTapRecording(
+        files: ((result['files'] as List?) ?? const []).cast<String>(),
+        channels: read('channels'),
+        sampleRate: read('sampleRate'),
+        framesWritten: read('framesWritten'),
+        blocksDropped: read('blocksDropped'),
+        framesDropped: read('framesDropped'),
+        formatMismatchBlocks: read('formatMismatchBlocks'),
+      );
+    } catch (e) {
+      debugPrint('Native stopOutputTap unavailable or error: $e');
+      return null;
+    }
+  }
+
   void dispose() {
     _nativeSubscription?.cancel();
     _controller.close();
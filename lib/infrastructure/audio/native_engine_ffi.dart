@@ -0,0 +1,402 @@
+import 'dart:ffi';
+import 'dart:io' show Platform;
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart';
+
+import '../../domain/models/automation_event_model.dart';
+
+// Binding direto (dart:ffi) para o mixer nativo em libmultichannel_preview.so.
+// Volume, pan e mute são escritos direto no bloco compartilhado que o thread
+// de render lê a cada bloco (ver android/app/src/main/cpp/engine_shared.h),
+// sem MethodChannel nem JNI; posição e medidores são lidos do mesmo bloco.
+// As listas abaixo são views da memória nativa (sem cópia) e valem durante
+// toda a vida do processo: o bloco é estático na biblioteca.
+
+// Espelho de engine_shared.h; mudar junto com MTP_LAYOUT_VERSION
+const int _kLayoutVersion = 3;
+
+// Plataformas com o engine nativo e o MethodChannel audio_usb/methods:
+// Android (MainActivity + AAudio) e o runner GTK do Linux (plugin
+// linux/audio_engine + ALSA), este só quando o build incluiu o engine
+// (MTP_LINUX_AUDIO_ENGINE=ON) e a biblioteca está no bundle.
+bool get hasNativeAudioEngine =>
+    Platform.isAndroid || (Platform.isLinux && _linuxEngineBundled);
+
+final bool _linuxEngineBundled = () {
+  try {
+    DynamicLibrary.open('libmultichannel_preview.so');
+    return true;
+  } catch (_) {
+    return false;
+  }
+}();
+const int kEngineMaxTracks = 64;
+const int kEngineMaxBuses = 32;
+const int kEngineMaxOutChannels = 32;
+const int kEngineSpectrumBins = 64;
+const double kEngineSpectrumMinDb = -90.0;
+
+const int _kStatusMixing = 0;
+const int _kStatusSampleRate = 1;
+const int _kStatusOutputLost = 5;
+const int _kStatusCount = 6;
+
+// Mesmos ids de param_queue.h / MainActivity.kt
+const int _kParamVolume = 0;
+const int _kParamPan = 1;
+const int _kParamMute = 16;
+
+typedef _PtrFloatFn = Pointer<Float> Function();
+typedef _PtrInt32Fn = Pointer<Int32> Function();
+typedef _VersionNative = Uint32 Function();
+typedef _VersionDart = int Function();
+typedef _PositionNative = Int64 Function();
+typedef _PositionDart = int Function();
+typedef _SetParamNative = Int32 Function(Int32, Int32, Float);
+typedef _SetParamDart = int Function(int, int, double);
+typedef _SeekNative = Void Function(Double);
+typedef _SeekDart = void Function(double);
+typedef _SetLoopNative = Int32 Function(Int64, Int64);
+typedef _SetLoopDart = int Function(int, int);
+typedef _VoidNative = Void Function();
+typedef _VoidDart = void Function();
+typedef _JumpNative = Void Function(Int64, Int64);
+typedef _JumpDart = void Function(int, int);
+typedef _JumpOnGridNative = Int32 Function(Int64, Int64, Int64);
+typedef _JumpOnGridDart = int Function(int, int, int);
+typedef _SpectrumTapNative = Int32 Function(Int32, Int32, Int32);
+typedef _SpectrumTapDart = int Function(int, int, int);
+typedef _FloatNative = Float Function();
+typedef _FloatDart = double Function();
+typedef _Int32Native = Int32 Function();
+typedef _Int32Dart = int Function();
+
+// Espelho de MtpTimelineEvent (event_timeline.h)
+final class _MtpTimelineEvent extends Struct {
+  @Int64()
+  external int frame;
+  @Int32()
+  external int target;
+  @Int32()
+  external int index;
+  @Int32()
+  external int param;
+  @Int32()
+  external int curve;
+  @Float()
+  external double value;
+  @Int32()
+  external int reserved;
+}
+
+typedef _TimelineSetNative = Void Function(
+    Pointer<_MtpTimelineEvent>, Int32, Int32);
+typedef _TimelineSetDart = void Function(Pointer<_MtpTimelineEvent>, int, int);
+typedef _PreloadBudgetNative = Void Function(Int64);
+typedef _PreloadBudgetDart = void Function(int);
+typedef _PreloadSongNative = Void Function(
+    Int32, Pointer<Pointer<Utf8>>, Int32, Int32);
+typedef _PreloadSongDart = void Function(
+    int, Pointer<Pointer<Utf8>>, int, int);
+typedef _PreloadTouchNative = Void Function(Int32);
+typedef _PreloadTouchDart = void Function(int);
+typedef _PreloadStateNative = Int32 Function(Int32);
+typedef _PreloadStateDart = int Function(int);
+typedef _SongTrimNative = Void Function(Float);
+typedef _SongTrimDart = void Function(double);
+
+// Estados de preload_cache.h (PreloadState)
+enum PreloadState { none, queued, loading, ready, rejected }
+
+class NativeEngineFfi {
+  NativeEngineFfi._(DynamicLibrary lib)
+      : _status = lib
+            .lookupFunction<_PtrInt32Fn, _PtrInt32Fn>('mtp_status')()
+            .asTypedList(_kStatusCount),
+        _positionFrames = lib.lookupFunction<_PositionNative, _PositionDart>(
+            'mtp_position_frames'),
+        outputPeaks = _floats(lib, 'mtp_output_peaks', kEngineMaxOutChannels),
+        trackPeaks = _floats(lib, 'mtp_track_peaks', kEngineMaxTracks),
+        _trackVolumes = _floats(lib, 'mtp_track_volumes', kEngineMaxTracks),
+        _trackPans = _floats(lib, 'mtp_track_pans', kEngineMaxTracks),
+        _trackMutes = _floats(lib, 'mtp_track_mutes', kEngineMaxTracks),
+        _busVolumes = _floats(lib, 'mtp_bus_volumes', kEngineMaxBuses),
+        _busPans = _floats(lib, 'mtp_bus_pans', kEngineMaxBuses),
+        _busMutes = _floats(lib, 'mtp_bus_mutes', kEngineMaxBuses),
+        _setTrackParam = lib.lookupFunction<_SetParamNative, _SetParamDart>(
+            'mtp_set_track_param'),
+        _setBusParam = lib.lookupFunction<_SetParamNative, _SetParamDart>(
+            'mtp_set_bus_param'),
+        _setAuxSend = lib.lookupFunction<_SetParamNative, _SetParamDart>(
+            'mtp_set_aux_send'),
+        _seek = lib.lookupFunction<_SeekNative, _SeekDart>('mtp_seek_seconds'),
+        _setLoop = lib.lookupFunction<_SetLoopNative, _SetLoopDart>(
+            'mtp_transport_set_loop'),
+        _clearLoop =
+            lib.lookupFunction<_VoidNative, _VoidDart>('mtp_transport_clear_loop'),
+        _jump = lib.lookupFunction<_JumpNative, _JumpDart>('mtp_transport_jump'),
+        _jumpOnGrid = lib.lookupFunction<_JumpOnGridNative, _JumpOnGridDart>(
+            'mtp_transport_jump_on_grid'),
+        _cancelJump = lib.lookupFunction<_VoidNative, _VoidDart>(
+            'mtp_transport_cancel_jump'),
+        _scrubBegin =
+            lib.lookupFunction<_VoidNative, _VoidDart>('mtp_scrub_begin'),
+        _scrubTo = lib.lookupFunction<_SeekNative, _SeekDart>('mtp_scrub_to'),
+        _scrubEnd = lib.lookupFunction<_VoidNative, _VoidDart>('mtp_scrub_end'),
+        _timelineSet = lib.lookupFunction<_TimelineSetNative, _TimelineSetDart>(
+            'mtp_timeline_set'),
+        _timelineClear =
+            lib.lookupFunction<_VoidNative, _VoidDart>('mtp_timeline_clear'),
+        _preloadBudget =
+            lib.lookupFunction<_PreloadBudgetNative, _PreloadBudgetDart>(
+                'mtp_preload_set_budget'),
+        _preloadSong = lib.lookupFunction<_PreloadSongNative, _PreloadSongDart>(
+            'mtp_preload_song'),
+        _preloadTouch =
+            lib.lookupFunction<_PreloadTouchNative, _PreloadTouchDart>(
+                'mtp_preload_touch'),
+        _preloadState =
+            lib.lookupFunction<_PreloadStateNative, _PreloadStateDart>(
+                'mtp_preload_state'),
+        _songTrimDb = lib.lookupFunction<_SongTrimNative, _SongTrimDart>(
+            'mtp_set_song_trim_db'),
+        spectrumBins = _floats(lib, 'mtp_spectrum_bins', kEngineSpectrumBins),
+        _spectrumSetTap =
+            lib.lookupFunction<_SpectrumTapNative, _SpectrumTapDart>(
+                'mtp_spectrum_set_tap'),
+        _spectrumCorrelation = lib.lookupFunction<_FloatNative, _FloatDart>(
+            'mtp_spectrum_correlation'),
+        _spectrumFrame = lib.lookupFunction<_Int32Native, _Int32Dart>(
+            'mtp_spectrum_frame');
+
+  static Float32List _floats(DynamicLibrary lib, String symbol, int length) =>
+      lib.lookupFunction<_PtrFloatFn, _PtrFloatFn>(symbol)().asTypedList(length);
+
+  // Carrega a biblioteca do mixer; null sem engine nativo, se ela não estiver
+  // presente ou se o layout do bloco não bater com este binding.
+  static NativeEngineFfi? tryLoad() {
+    if (!hasNativeAudioEngine) return null;
+    try {
+      final lib = DynamicLibrary.open('libmultichannel_preview.so');
+      final version = lib
+          .lookupFunction<_VersionNative, _VersionDart>('mtp_layout_version')();
+      if (version != _kLayoutVersion) {
+        debugPrint('NativeEngineFfi: layout $version != $_kLayoutVersion');
+        return null;
+      }
+      return NativeEngineFfi._(lib);
+    } catch (e) {
+      debugPrint('NativeEngineFfi unavailable: $e');
+      return null;
+    }
+  }
+
+  final Int32List _status;
+  final _PositionDart _positionFrames;
+  // Picos (0..1, com queda) por canal de saída e por track, pós-fader
+  final Float32List outputPeaks;
+  final Float32List trackPeaks;
+  final Float32List _trackVolumes;
+  final Float32List _trackPans;
+  final Float32List _trackMutes;
+  final Float32List _busVolumes;
+  final Float32List _busPans;
+  final Float32List _busMutes;
+  final _SetParamDart _setTrackParam;
+  final _SetParamDart _setBusParam;
+  final _SetParamDart _setAuxSend;
+  final _SeekDart _seek;
+  final _SetLoopDart _setLoop;
+  final _VoidDart _clearLoop;
+  final _JumpDart _jump;
+  final _JumpOnGridDart _jumpOnGrid;
+  final _VoidDart _cancelJump;
+  final _VoidDart _scrubBegin;
+  final _SeekDart _scrubTo;
+  final _VoidDart _scrubEnd;
+  final _TimelineSetDart _timelineSet;
+  final _VoidDart _timelineClear;
+  final _PreloadBudgetDart _preloadBudget;
+  final _PreloadSongDart _preloadSong;
+  final _PreloadTouchDart _preloadTouch;
+  final _PreloadStateDart _preloadState;
+  final _SongTrimDart _songTrimDb;
+  // Bandas do analisador em dBFS (kEngineSpectrumMinDb..0), 20 Hz a 20 kHz
+  // em escala log; escritas pelo thread de análise nativo
+  final Float32List spectrumBins;
+  final _SpectrumTapDart _spectrumSetTap;
+  final _FloatDart _spectrumCorrelation;
+  final _Int32Dart _spectrumFrame;
+
+  // true enquanto o mixer nativo (nativePlayAllPreview) está renderizando
+  bool get isMixing => _status[_kStatusMixing] != 0;
+
+  // Interface de saída caiu e o mixer espera para reabrir o stream; a posição
+  // fica parada e a reprodução continua do mesmo ponto quando ela voltar
+  bool get isOutputLost => _status[_kStatusOutputLost] != 0;
+
+  // Taxa da sessão atual; frames de loop/salto são nessa taxa
+  int? get sampleRate {
+    final rate = _status[_kStatusSampleRate];
+    return isMixing && rate > 0 ? rate : null;
+  }
+
+  double? get positionSec {
+    final rate = _status[_kStatusSampleRate];
+    if (!isMixing || rate <= 0) return null;
+    return _positionFrames() / rate;
+  }
+
+  // Os setters devolvem false quando o mixer nativo não está ativo, para o
+  // chamador cair no caminho do MethodChannel (mixer Kotlin).
+  bool setTrackVolume(int track, double volume) =>
+      _write(_trackVolumes, track, volume.clamp(0.0, 1.0), _kParamVolume);
+
+  bool setTrackPan(int track, double pan) =>
+      _write(_trackPans, track, pan.clamp(-1.0, 1.0), _kParamPan);
+
+  bool setTrackMute(int track, bool mute) =>
+      _write(_trackMutes, track, mute ? 1.0 : 0.0, _kParamMute);
+
+  bool setBusVolume(int bus, double volume) =>
+      _write(_busVolumes, bus, volume.clamp(0.0, 1.0), _kParamVolume,
+          bus: true);
+
+  bool setBusPan(int bus, double pan) =>
+      _write(_busPans, bus, pan.clamp(-1.0, 1.0), _kParamPan, bus: true);
+
+  bool setBusMute(int bus, bool mute) =>
+      _write(_busMutes, bus, mute ? 1.0 : 0.0, _kParamMute, bus: true);
+
+  // Parâmetros discretos (inserts) vão pela fila do render
+  bool setTrackParam(int track, int paramId, double value) =>
+      isMixing && _setTrackParam(track, paramId, value) != 0;
+
+  bool setBusParam(int bus, int paramId, double value) =>
+      isMixing && _setBusParam(bus, paramId, value) != 0;
+
+  // Envio da track para a mix de in-ear `aux` (também pela fila)
+  bool setAuxSend(int track, int aux, double level) =>
+      isMixing && _setAuxSend(track, aux, level.clamp(0.0, 1.0)) != 0;
+
+  bool seek(double positionSec) {
+    if (!isMixing) return false;
+    _seek(positionSec);
+    return true;
+  }
+
+  // Loop e saltos com precisão de amostra (transport.cpp): o render corta o
+  // bloco na fronteira e salta com micro crossfade, sem timer do lado Dart.
+  bool setLoopFrames(int startFrame, int endFrame) =>
+      isMixing && _setLoop(startFrame, endFrame) != 0;
+
+  void clearLoop() => _clearLoop();
+
+  // Salta para targetFrame exatamente em atFrame (null = no próximo bloco)
+  bool jumpAtFrame(int targetFrame, {int? atFrame}) {
+    if (!isMixing) return false;
+    _jump(targetFrame, atFrame ?? -1);
+    return true;
+  }
+
+  // Salta na próxima linha da grade gridOrigin + k * gridPeriod
+  bool jumpOnGrid(int targetFrame, int gridOriginFrame, int gridPeriodFrames) =>
+      isMixing && _jumpOnGrid(targetFrame, gridOriginFrame, gridPeriodFrames) != 0;
+
+  void cancelJump() => _cancelJump();
+
+  // Scrub (scrub.cpp): entre begin e end o render toca um varispeed que
+  // persegue a última posição de scrubTo (pode ser chamado a cada evento do
+  // gesto, só grava o alvo). No end o play continua nesse alvo.
+  bool scrubBegin() {
+    if (!isMixing) return false;
+    _scrubBegin();
+    return true;
+  }
+
+  void scrubTo(double positionSec) => _scrubTo(positionSec);
+
+  void scrubEnd() => _scrubEnd();
+
+  // Timeline de automação (event_timeline.cpp) com tempos em ms: o render
+  // aplica cada evento no frame exato. Lista vazia limpa; a timeline vale
+  // também para as próximas sessões até ser trocada.
+  void setTimeline(List<AutomationEvent> events) {
+    if (events.isEmpty) {
+      _timelineClear();
+      return;
+    }
+    final buf = calloc<_MtpTimelineEvent>(events.length);
+    try {
+      for (int i = 0; i < events.length; i++) {
+        final e = events[i];
+        final r = buf[i];
+        r.frame = e.timeMs;
+        r.target = e.isBus ? 1 : 0;
+        r.index = e.index;
+        r.param = e.param;
+        r.curve = e.ramp ? 1 : 0;
+        r.value = e.value;
+      }
+      _timelineSet(buf, events.length, 1000);
+    } finally {
+      calloc.free(buf);
+    }
+  }
+
+  // Cache de preload em RAM (preload_cache.cpp). Orçamento 0 desliga e
+  // despeja tudo; músicas que não cabem ficam em PreloadState.rejected.
+  void setPreloadBudget(int bytes) => _preloadBudget(bytes < 0 ? 0 : bytes);
+
+  void preloadSong(int songId, List<String> paths, {bool urgent = false}) {
+    final array = calloc<Pointer<Utf8>>(paths.length);
+    try {
+      for (int i = 0; i < paths.length; i++) {
+        array[i] = paths[i].toNativeUtf8();
+      }
+      _preloadSong(songId, array, paths.length, urgent ? 1 : 0);
+    } finally {
+      for (int i = 0; i < paths.length; i++) {
+        if (array[i] != nullptr) malloc.free(array[i]);
+      }
+      calloc.free(array);
+    }
+  }
+
+  void touchPreloadedSong(int songId) => _preloadTouch(songId);
+
+  PreloadState preloadState(int songId) {
+    final s = _preloadState(songId);
+    return s >= 0 && s < PreloadState.values.length
+        ? PreloadState.values[s]
+        : PreloadState.none;
+  }
+
+  // Ganho da música inteira (normalização de loudness), aplicado no master
+  // com rampa; vale para a sessão atual e as próximas até ser trocado.
+  void setSongTrimDb(double db) => _songTrimDb(db.isFinite ? db : 0.0);
+
+  // Analisador de espectro (spectrum.cpp): kind 0 desliga, 1 = par da saída
+  // a partir de index, 2 = track index; rateHz limitado a 30..60
+  bool setSpectrumTap(int kind, int index, int rateHz) =>
+      _spectrumSetTap(kind, index, rateHz) != 0;
+
+  // Correlação L/R (-1..1) e contador de publicações das bandas
+  double get spectrumCorrelation => _spectrumCorrelation();
+  int get spectrumFrame => _spectrumFrame();
+
+  bool _write(Float32List slots, int index, double value, int paramId,
+      {bool bus = false}) {
+    if (!isMixing || index < 0) return false;
+    if (index < slots.length) {
+      slots[index] = value;
+      return true;
+    }
+    // Além da capacidade do bloco: o nativo encaminha pela fila
+    return bus
+        ? _setBusParam(index, paramId, value) != 0
+        : _setTrackParam(index, paramId, value) != 0;
+  }
+}
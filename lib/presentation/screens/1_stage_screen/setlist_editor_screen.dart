@@ -1,4 +1,5 @@
 import 'dart:async';
+import 'dart:typed_data';
 import 'package:flutter/material.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 
@@ -25,7 +26,7 @@ class _SetlistEditorScreenState extends ConsumerState<SetlistEditorScreen> {
   final Map<int, double> _durationCache = {};
   final Map<int, wf.WaveformData> _waveformCache = {};
   bool _isPlaying = false;
-  List<double> _timelinePeaks = const [];
+  Float32List _timelinePeaks = Float32List(0);
   double _timelineDurationSec = 0;
   double _playheadPositionSec = 0;
   final GlobalKey _waveformKey = GlobalKey();
@@ -107,7 +108,7 @@ class _SetlistEditorScreenState extends ConsumerState<SetlistEditorScreen> {
         _setlistSongIds.where((id) => _waveformCache.containsKey(id)).toList();
     if (ids.isEmpty) {
       setState(() {
-        _timelinePeaks = const [];
+        _timelinePeaks = Float32List(0);
         _timelineDurationSec = 0;
       });
       return;
@@ -116,19 +117,24 @@ class _SetlistEditorScreenState extends ConsumerState<SetlistEditorScreen> {
     final totalDur =
         durations.fold<double>(0.0, (a, b) => a + (b.isFinite ? b : 0.0));
     const totalPoints = 1000;
-    final List<double> combined = [];
-    for (int i = 0; i < ids.length; i++) {
-      final data = _waveformCache[ids[i]]!;
-      final src = data.peaks;
+    final pointsPerSong = <int>[];
+    for (final id in ids) {
+      final data = _waveformCache[id]!;
       int pointsForSong;
       if (totalDur <= 0) {
         pointsForSong = (totalPoints / ids.length).floor();
       } else {
         pointsForSong = ((data.durationSec / totalDur) * totalPoints).floor();
       }
-      pointsForSong = pointsForSong.clamp(20, totalPoints);
-      final resized = _resizePeaks(src, pointsForSong);
-      combined.addAll(resized);
+      pointsPerSong.add(pointsForSong.clamp(20, totalPoints));
+    }
+    final combined =
+        Float32List(pointsPerSong.fold<int>(0, (a, b) => a + b));
+    int offset = 0;
+    for (int i = 0; i < ids.length; i++) {
+      _resizePeaksInto(
+          _waveformCache[ids[i]]!.peaks, combined, offset, pointsPerSong[i]);
+      offset += pointsPerSong[i];
     }
     setState(() {
       _timelinePeaks = combined;
@@ -138,16 +144,15 @@ class _SetlistEditorScreenState extends ConsumerState<SetlistEditorScreen> {
     });
   }
 
-  List<double> _resizePeaks(List<double> src, int target) {
-    if (src.isEmpty || target <= 0) return List<double>.filled(target, 0.0);
-    if (src.length == target) return List<double>.from(src);
-    final out = <double>[];
+  // Reamostra `src` em dst[offset, offset + target); vazio vira silêncio
+  void _resizePeaksInto(
+      Float32List src, Float32List dst, int offset, int target) {
+    if (src.isEmpty || target <= 0) return;
     for (int i = 0; i < target; i++) {
-      final t = i / (target - 1);
+      final t = target == 1 ? 0.0 : i / (target - 1);
       final idx = (t * (src.length - 1)).round();
-      out.add(src[idx].clamp(0.0, 1.0));
+      dst[offset + i] = src[idx].clamp(0.0, 1.0);
     }
-    return out;
   }
 
   void _onWaveformTap(Offset localPosition) {
@@ -300,15 +305,7 @@ class _SetlistEditorScreenState extends ConsumerState<SetlistEditorScreen> {
   Future<void> _computeSampleRateMismatch(int songId, List<Track> tracks) async {
     if (tracks.isEmpty) return;
     final audioService = ref.read(audioDeviceServiceProvider);
-    final rates = <int>{};
-    for (final t in tracks) {
-      final path = t.localFilePath;
-      if (path.isEmpty) continue;
-      final sr = await audioService.getFileSampleRateHz(path);
-      if (sr != null && sr > 0) {
-        rates.add(sr);
-      }
-    }
+    final rates = await audioService.sampleRatesOf(tracks);
     final mismatch = rates.length > 1;
     if (mounted) {
       setState(() {
@@ -377,6 +374,10 @@ class _SetlistEditorScreenState extends ConsumerState<SetlistEditorScreen> {
   @override
   void dispose() {
     _playTimer?.cancel();
+    for (final data in _waveformCache.values) {
+      data.dispose();
+    }
+    _waveformCache.clear();
     super.dispose();
   }
 
@@ -712,7 +713,7 @@ extension on _SetlistEditorScreenState {
 }
 
 class _SetlistWaveformPainter extends CustomPainter {
-  final List<double> peaks;
+  final Float32List peaks;
   final double playheadPositionSec;
   final double totalDurationSec;
   final List<double> boundariesSec;
@@ -1,9 +1,13 @@
 import 'dart:async';
 import 'dart:math' as math;
+import 'dart:typed_data';
+import 'dart:ui' as ui;
 import 'package:flutter/material.dart';
 import 'package:flutter_riverpod/flutter_riverpod.dart';
 
 import '../../../application/services/setlist_persistence.dart';
+import '../../../application/services/automation_persistence.dart';
+import '../../../application/services/monitor_mix_persistence.dart';
 import '../../../application/providers/songs_provider.dart';
 import '../../../application/providers/device_provider.dart';
 import '../../../application/services/i_audio_device_service.dart';
@@ -30,7 +34,7 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
   double _waveAmpFactor = 3.5;
   final Map<int, wf.WaveformData> _waveformCache = {};
   final Map<int, double> _durationCache = {};
-  List<double> _timelinePeaks = const [];
+  Float32List _timelinePeaks = Float32List(0);
   double _timelineDurationSec = 0;
   final GlobalKey _waveformKey = GlobalKey();
   final ScrollController _scrollController = ScrollController();
@@ -43,6 +47,27 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
   Timer? _playheadTimer;
   int _currentSongIndex = -1;
   final Map<int, List<Track>> _tracksCache = {};
+  // Scrub (toque longo + arrastar na wave): o mixer toca em velocidade
+  // variável seguindo o dedo, dentro da música atual
+  bool _scrubGesture = false;
+  bool _scrubbing = false;
+  bool _scrubWasPlaying = false;
+  int _scrubSongIndex = -1;
+  double _scrubTargetSec = 0.0;
+  // Modo RAM: a música atual e a próxima ficam carregadas em memória no
+  // nativo, então a troca de música e os seeks não dependem do disco.
+  static const int _kRamPreloadBudgetBytes = 1536 * 1024 * 1024;
+  bool _ramPreload = false;
+  IAudioDeviceService? _preloadService;
+  // Gravação das saídas do mixer (tap pós-mix) durante o show
+  IAudioDeviceService? _tapService;
+  // Normalização: cada música toca com um ganho no master que a leva ao
+  // mesmo loudness integrado, sem passar o teto de true peak.
+  static const double _kTargetLufs = -14.0;
+  static const double _kTruePeakCeilingDbtp = -1.0;
+  bool _normalizeLoudness = false;
+  IAudioDeviceService? _loudnessService;
+  final Map<int, Future<double?>> _songTrimDb = {};
 
   List<int> get _songIds => widget.setlist.songIds;
 
@@ -79,7 +104,7 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
     final ids = _songIds;
     if (ids.isEmpty) {
       setState(() {
-        _timelinePeaks = const [];
+        _timelinePeaks = Float32List(0);
         _timelineDurationSec = 0;
       });
       return;
@@ -91,11 +116,10 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
         .fold<double>(0.0, (a, b) => a + (b.isFinite ? b : 0.0));
     // Exibir cada música com a mesma largura: usar pontos fixos por música
     const int pointsPerSong = 300;
-    final List<double> combined = [];
-    for (final id in ids) {
-      final src = _waveformCache[id]?.peaks ?? const <double>[];
-      final resized = _resizePeaks(src.isEmpty ? [0.0] : src, pointsPerSong);
-      combined.addAll(resized);
+    final combined = Float32List(ids.length * pointsPerSong);
+    for (int i = 0; i < ids.length; i++) {
+      final src = _waveformCache[ids[i]]?.peaks ?? Float32List(0);
+      _resizePeaksInto(src, combined, i * pointsPerSong, pointsPerSong);
     }
     setState(() {
       _timelinePeaks = combined;
@@ -103,16 +127,15 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
     });
   }
 
-  List<double> _resizePeaks(List<double> src, int target) {
-    if (src.isEmpty || target <= 0) return List<double>.filled(target, 0.0);
-    if (src.length == target) return List<double>.from(src);
-    final out = <double>[];
+  // Reamostra `src` em dst[offset, offset + target); vazio vira silêncio
+  void _resizePeaksInto(
+      Float32List src, Float32List dst, int offset, int target) {
+    if (src.isEmpty || target <= 0) return;
     for (int i = 0; i < target; i++) {
-      final t = i / (target - 1);
+      final t = target == 1 ? 0.0 : i / (target - 1);
       final idx = (t * (src.length - 1)).round();
-      out.add(src[idx].clamp(0.0, 1.0));
+      dst[offset + i] = src[idx].clamp(0.0, 1.0);
     }
-    return out;
   }
 
   List<double> _computeSongBoundariesSec() {
@@ -250,7 +273,10 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
         await audioService.stopPreview();
       } catch (_) {}
       await _setQualityForTracks(audioService, targetSongId, targetTracks);
-      await audioService.playAllTracks(targetTracks);
+      await _loadAutomation(audioService, targetSongId);
+      await _applyLoudnessTrim(audioService, targetSongId, targetTracks);
+      await audioService.playAllTracks(targetTracks,
+          monitorMixes: await MonitorMixPersistence.loadForSong(targetSongId));
       // start at reduced gain to avoid click
       final originals =
           targetTracks.map((t) => t.volume.clamp(0.0, 1.0)).toList();
@@ -314,7 +340,10 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
         await audioService.stopPreview();
       } catch (_) {}
       await _setQualityForTracks(audioService, targetSongId, targetTracks);
-      await audioService.playAllTracks(targetTracks);
+      await _loadAutomation(audioService, targetSongId);
+      await _applyLoudnessTrim(audioService, targetSongId, targetTracks);
+      await audioService.playAllTracks(targetTracks,
+          monitorMixes: await MonitorMixPersistence.loadForSong(targetSongId));
       // start at min gain, seek, then fade-in
       final targetVolumes =
           targetTracks.map((t) => t.volume.clamp(0.0, 1.0)).toList();
@@ -341,6 +370,70 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
     }
   }
 
+  // Scrub audível: o engine persegue a posição do dedo (varispeed, inclusive
+  // de ré) e, ao soltar, continua tocando dali. Parado antes do gesto, o play
+  // começa no ponto do toque e volta a pausar no fim.
+  Future<void> _beginScrub(double globalSec) async {
+    if (_timelineDurationSec <= 0 || _songIds.isEmpty || _scrubGesture) return;
+    _scrubGesture = true;
+    _scrubWasPlaying = _isPlaying;
+    final boundaries = _computeSongBoundariesSec();
+    final idx = _songIndexForPosition(globalSec, boundaries);
+    setState(() {
+      _playheadPositionSec = globalSec;
+      _startEpochMs = DateTime.now().millisecondsSinceEpoch -
+          (globalSec * 1000).round();
+    });
+    _scrubTargetSec = _offsetInSong(globalSec, idx, boundaries);
+    final audioService = ref.read(audioDeviceServiceProvider);
+    // O scrub parte do ponto do toque, não de onde a agulha estava
+    if (!_isPlaying) {
+      await _togglePlayPause();
+    } else if (idx != _currentSongIndex) {
+      await _ensurePlaybackForPosition(forceSeek: true);
+    } else {
+      await audioService.seekPlayAll(_scrubTargetSec);
+    }
+    // Soltou antes do play começar, ou sem mixer nativo: fica o salto
+    if (!_scrubGesture || !audioService.scrubBegin()) {
+      _scrubGesture = false;
+      return;
+    }
+    _scrubSongIndex = _currentSongIndex;
+    _scrubbing = true;
+    audioService.scrubTo(_scrubTargetSec);
+  }
+
+  void _moveScrub(double globalSec) {
+    if (!_scrubGesture) return;
+    final boundaries = _computeSongBoundariesSec();
+    final idx = _scrubbing
+        ? _scrubSongIndex
+        : _songIndexForPosition(globalSec, boundaries);
+    // A sessão do mixer é uma música: o scrub para nas bordas dela
+    final startSec = idx == 0 ? 0.0 : boundaries[idx - 1];
+    final endSec =
+        idx < boundaries.length ? boundaries[idx] : _timelineDurationSec;
+    final sec = globalSec.clamp(startSec, endSec);
+    _scrubTargetSec = sec - startSec;
+    if (_scrubbing) {
+      ref.read(audioDeviceServiceProvider).scrubTo(_scrubTargetSec);
+    }
+    setState(() => _playheadPositionSec = sec);
+  }
+
+  Future<void> _endScrub() async {
+    if (!_scrubGesture) return;
+    _scrubGesture = false;
+    if (!_scrubbing) return;
+    _scrubbing = false;
+    ref.read(audioDeviceServiceProvider).scrubEnd();
+    // O play continua no último alvo: o relógio da agulha parte dali
+    _startEpochMs = DateTime.now().millisecondsSinceEpoch -
+        (_playheadPositionSec * 1000).round();
+    if (!_scrubWasPlaying) await _togglePlayPause(stopOnly: true);
+  }
+
   int _xfadeToken = 0;
   Future<void> _seekWithCrossfade({
     required double positionSec,
@@ -397,6 +490,37 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
       appBar: AppBar(
         title: Text(widget.setlist.name),
         centerTitle: true,
+        actions: [
+          IconButton(
+            tooltip: _tapService != null
+                ? 'Parar gravação das saídas'
+                : 'Gravar saídas do show',
+            icon: Icon(
+              _tapService != null
+                  ? Icons.fiber_manual_record
+                  : Icons.fiber_manual_record_outlined,
+              color: _tapService != null ? Colors.redAccent : null,
+            ),
+            onPressed: _toggleOutputTap,
+          ),
+          IconButton(
+            tooltip: _normalizeLoudness
+                ? 'Normalização de volume ligada (${_kTargetLufs.round()} LUFS)'
+                : 'Normalizar volume entre as músicas',
+            icon: Icon(_normalizeLoudness
+                ? Icons.equalizer
+                : Icons.equalizer_outlined),
+            color: _normalizeLoudness ? Colors.lightGreenAccent : null,
+            onPressed: () => _setNormalizeLoudness(!_normalizeLoudness),
+          ),
+          IconButton(
+            tooltip: _ramPreload
+                ? 'Pré-carregamento em RAM ligado'
+                : 'Pré-carregar músicas em RAM',
+            icon: Icon(_ramPreload ? Icons.memory : Icons.sd_storage_outlined),
+            onPressed: () => _setRamPreload(!_ramPreload),
+          ),
+        ],
       ),
       body: ids.isEmpty
           ? const Center(child: Text('Setlist vazia'))
@@ -440,7 +564,9 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
                                   height: 180,
                                   child: GestureDetector(
                                     behavior: HitTestBehavior.opaque,
-                                    onTapDown: (details) async {
+                                    // No up: um toque longo vira scrub e
+                                    // não salta
+                                    onTapUp: (details) async {
                                       final local = details.localPosition;
                                       final t = _xToGlobalSec(
                                         x: local.dx,
@@ -450,6 +576,22 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
                                       await _handleWaveTapAt(
                                           t, combinedEndpoints);
                                     },
+                                    // Arrastar simples rola a wave; o scrub
+                                    // começa com toque longo e segue o dedo
+                                    onLongPressStart: (details) =>
+                                        _beginScrub(_xToGlobalSec(
+                                      x: details.localPosition.dx,
+                                      viewportWidth: constraints.maxWidth,
+                                      songWidthPx: songWidthPx,
+                                    ).clamp(0.0, _timelineDurationSec)),
+                                    onLongPressMoveUpdate: (details) =>
+                                        _moveScrub(_xToGlobalSec(
+                                      x: details.localPosition.dx,
+                                      viewportWidth: constraints.maxWidth,
+                                      songWidthPx: songWidthPx,
+                                    ).clamp(0.0, _timelineDurationSec)),
+                                    onLongPressEnd: (_) => _endScrub(),
+                                    onLongPressCancel: _endScrub,
                                     child: CustomPaint(
                                       key: _waveformKey,
                                       painter: _SetlistWaveformPainter(
@@ -725,9 +867,144 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
     final song = await ref.read(songWithTracksProvider(songId).future);
     final tracks = song?.tracks.toList() ?? const [];
     _tracksCache[songId] = tracks;
+    // Pacote montado na importação: o play lê todas as tracks de uma vez.
+    // Durante o show só registra; montar disputaria o disco com o play.
+    try {
+      await ref
+          .read(audioDeviceServiceProvider)
+          .prepareSongBundle(songId, tracks, build: false);
+    } catch (_) {}
     return tracks;
   }
 
+  Future<void> _setRamPreload(bool enabled) async {
+    final audioService = ref.read(audioDeviceServiceProvider);
+    setState(() => _ramPreload = enabled);
+    _preloadService = enabled ? audioService : null;
+    await audioService.setPreloadBudget(enabled ? _kRamPreloadBudgetBytes : 0);
+    if (enabled) {
+      await _preloadAround(_currentSongIndex < 0 ? 0 : _currentSongIndex);
+    }
+  }
+
+  Future<void> _setNormalizeLoudness(bool enabled) async {
+    final audioService = ref.read(audioDeviceServiceProvider);
+    setState(() => _normalizeLoudness = enabled);
+    _loudnessService = enabled ? audioService : null;
+    if (!enabled) {
+      await audioService.setSongTrimDb(0.0);
+      return;
+    }
+    if (_currentSongIndex >= 0 && _currentSongIndex < _songIds.length) {
+      final songId = _songIds[_currentSongIndex];
+      await _applyLoudnessTrim(
+          audioService, songId, await _getSongTracksCached(songId));
+    }
+  }
+
+  // Ganho de normalização da música (analisado uma vez; o nativo guarda o
+  // resultado em cache entre sessões). null se não há análise.
+  Future<double?> _trimDbForSong(
+      IAudioDeviceService audioService, int songId, List<Track> tracks) {
+    return _songTrimDb[songId] ??= audioService
+        .analyzeSongLoudness(songId, tracks)
+        .then((l) => l?.trimDbFor(_kTargetLufs,
+            ceilingDbtp: _kTruePeakCeilingDbtp))
+        .catchError((_) => null);
+  }
+
+  // Aplica o ganho da música que vai tocar. Se ela ainda não foi analisada,
+  // começa sem ganho e o engine faz a rampa quando a análise terminar.
+  Future<void> _applyLoudnessTrim(
+      IAudioDeviceService audioService, int songId, List<Track> tracks) async {
+    if (!_normalizeLoudness) return;
+    final pending = _trimDbForSong(audioService, songId, tracks);
+    final ready = await Future.any<double?>([
+      pending,
+      Future<double?>.delayed(const Duration(milliseconds: 20), () => null),
+    ]);
+    if (ready != null) {
+      await audioService.setSongTrimDb(ready);
+      return;
+    }
+    await audioService.setSongTrimDb(0.0);
+    unawaited(pending.then((db) async {
+      final current = _currentSongIndex >= 0 &&
+          _currentSongIndex < _songIds.length &&
+          _songIds[_currentSongIndex] == songId;
+      if (db != null && _normalizeLoudness && current) {
+        await audioService.setSongTrimDb(db);
+      }
+    }));
+  }
+
+  Future<void> _toggleOutputTap() async {
+    final running = _tapService;
+    if (running != null) {
+      setState(() => _tapService = null);
+      final rec = await running.stopOutputTap();
+      if (!mounted || rec == null) return;
+      final minutes = (rec.durationSec / 60).toStringAsFixed(1);
+      final lost = rec.blocksDropped > 0
+          ? ' — ${rec.blocksDropped} blocos perdidos'
+          : '';
+      final skipped = rec.formatMismatchBlocks > 0
+          ? ' — músicas em outra taxa ficaram de fora'
+          : '';
+      ScaffoldMessenger.of(context).showSnackBar(
+        SnackBar(
+            content: Text(
+                'Gravação salva: $minutes min, ${rec.channels} canais$lost$skipped')),
+      );
+      return;
+    }
+    final audioService = ref.read(audioDeviceServiceProvider);
+    final dir =
+        await SetlistPersistence.newShowRecordingDirectory(widget.setlist.name);
+    // Taxa da música atual (ou da primeira): com o mixer parado é o formato
+    // em que o tap abre
+    int? sampleRate;
+    if (_songIds.isNotEmpty) {
+      final idx = _currentSongIndex >= 0 ? _currentSongIndex : 0;
+      final tracks = await _getSongTracksCached(_songIds[idx]);
+      if (tracks.isNotEmpty) {
+        sampleRate =
+            await audioService.getFileSampleRateHz(tracks.first.localFilePath);
+      }
+    }
+    final ok = await audioService.startOutputTap(
+        directory: dir.path, sampleRate: sampleRate);
+    if (!mounted) return;
+    if (ok) {
+      setState(() => _tapService = audioService);
+    } else {
+      ScaffoldMessenger.of(context).showSnackBar(
+        const SnackBar(content: Text('Não foi possível gravar as saídas')),
+      );
+    }
+  }
+
+  // Pede ao nativo a música [index] (na frente da fila) e a seguinte
+  Future<void> _preloadAround(int index) async {
+    final audioService = _preloadService;
+    if (!_ramPreload || audioService == null) return;
+    for (int i = index; i <= index + 1 && i < _songIds.length; i++) {
+      final songId = _songIds[i];
+      final tracks = await _getSongTracksCached(songId);
+      if (tracks.isEmpty) continue;
+      await audioService.preloadSong(songId, tracks, urgent: i == index);
+    }
+  }
+
+  // Timeline de automação salva da música; o engine aplica no frame exato
+  Future<void> _loadAutomation(
+      IAudioDeviceService audioService, int songId) async {
+    try {
+      await audioService.setAutomationTimeline(
+          await AutomationPersistence.loadForSong(songId));
+    } catch (_) {}
+  }
+
   Future<void> _setQualityForTracks(
       IAudioDeviceService audioService, int songId, List<Track> tracks) async {
     try {
@@ -761,13 +1038,25 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
         await audioService.stopPreview();
       } catch (_) {}
       await _setQualityForTracks(audioService, songId, tracks);
-      await audioService.playAllTracks(tracks);
+      await _loadAutomation(audioService, songId);
+      await _applyLoudnessTrim(audioService, songId, tracks);
+      await audioService.playAllTracks(tracks,
+          monitorMixes: await MonitorMixPersistence.loadForSong(songId));
       await audioService.seekPlayAll(offsetSec);
       // Prepara próxima música
       final nextIndex = _currentSongIndex + 1;
-      if (nextIndex < _songIds.length) {
+      if (_ramPreload) {
+        await audioService.markSongPlayed(songId);
+        unawaited(_preloadAround(_currentSongIndex));
+      } else if (nextIndex < _songIds.length) {
         final nextId = _songIds[nextIndex];
-        unawaited(_getSongTracksCached(nextId));
+        unawaited(_getSongTracksCached(nextId).then(audioService.prepareTracks));
+      }
+      // Analisa a próxima antes da troca para o ganho já estar pronto
+      if (_normalizeLoudness && nextIndex < _songIds.length) {
+        final nextId = _songIds[nextIndex];
+        unawaited(_getSongTracksCached(nextId).then(
+            (t) => _trimDbForSong(audioService, nextId, t)));
       }
     } else if (forceSeek) {
       await audioService.seekPlayAll(offsetSec);
@@ -778,8 +1067,15 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
     _playheadTimer?.cancel();
     _playheadTimer =
         Timer.periodic(const Duration(milliseconds: 33), (_) async {
-      if (!_isPlaying) return;
+      // Durante o scrub a agulha segue o dedo
+      if (!_isPlaying || _scrubbing) return;
       final now = DateTime.now().millisecondsSinceEpoch;
+      // Interface caiu: o engine segura a posição até reabrir o stream, então
+      // a agulha também para (e não troca de música sozinha)
+      if (ref.read(audioDeviceServiceProvider).engineOutputLost) {
+        _startEpochMs = now - (_playheadPositionSec * 1000).round();
+        return;
+      }
       final start = _startEpochMs ?? now;
       final pos = ((now - start) / 1000.0).clamp(0.0, _timelineDurationSec);
       setState(() {
@@ -906,12 +1202,22 @@ class _SetlistPlayerScreenState extends ConsumerState<SetlistPlayerScreen> {
   @override
   void dispose() {
     _playheadTimer?.cancel();
+    // Libera as músicas carregadas em RAM ao sair do setlist
+    unawaited(_preloadService?.setPreloadBudget(0));
+    // Sair do setlist encerra a gravação e fecha o arquivo
+    unawaited(_tapService?.stopOutputTap());
+    // O ganho de normalização não vale fora do setlist
+    unawaited(_loudnessService?.setSongTrimDb(0.0));
+    for (final data in _waveformCache.values) {
+      data.dispose();
+    }
+    _waveformCache.clear();
     super.dispose();
   }
 }
 
 class _SetlistWaveformPainter extends CustomPainter {
-  final List<double> peaks;
+  final Float32List peaks;
   final double playheadPositionSec;
   final double totalDurationSec;
   final List<double> boundariesSec;
@@ -935,6 +1241,37 @@ class _SetlistWaveformPainter extends CustomPainter {
     this.strokeWidth = 2.0,
   });
 
+  // Linhas da wave (x, y0, x, y1 por pico) reaproveitadas entre frames: o
+  // playhead repinta a cada tick, mas peaks e tamanho quase nunca mudam.
+  static Float32List _geometry = Float32List(0);
+  static Float32List? _geometryPeaks;
+  static Size _geometrySize = Size.zero;
+  static double _geometryAmp = 0.0;
+
+  static Float32List _waveGeometry(Float32List peaks, Size size, double ampH) {
+    if (identical(peaks, _geometryPeaks) &&
+        size == _geometrySize &&
+        ampH == _geometryAmp) {
+      return _geometry;
+    }
+    final midY = size.height * 0.5;
+    final stepX = size.width / peaks.length;
+    final g = Float32List(peaks.length * 4);
+    for (int i = 0; i < peaks.length; i++) {
+      final x = i * stepX;
+      final h = ampH * peaks[i].clamp(0.0, 1.0);
+      g[i * 4] = x;
+      g[i * 4 + 1] = midY - h;
+      g[i * 4 + 2] = x;
+      g[i * 4 + 3] = midY + h;
+    }
+    _geometry = g;
+    _geometryPeaks = peaks;
+    _geometrySize = size;
+    _geometryAmp = ampH;
+    return g;
+  }
+
   @override
   void paint(Canvas canvas, Size size) {
     final bg = Paint()..color = const Color(0xFF1E1E1E);
@@ -1038,9 +1375,18 @@ class _SetlistWaveformPainter extends CustomPainter {
       segments.sort((a, b) => a.startSec.compareTo(b.startSec));
     }
 
-    // Draw waveform
+    // Draw waveform: trechos contíguos da mesma cor num único drawRawPoints
     if (peaks.isNotEmpty) {
-      final stepX = size.width / peaks.length;
+      final geometry = _waveGeometry(peaks, size, ampH);
+      int runStart = 0;
+      Color runColor = defaultWaveColor;
+      void flushRun(int end) {
+        if (end <= runStart) return;
+        wavePaint.color = runColor;
+        canvas.drawRawPoints(ui.PointMode.lines,
+            Float32List.sublistView(geometry, runStart * 4, end * 4), wavePaint);
+      }
+
       int segIndex = 0;
       double currentSegStart = segIndex < segments.length
           ? segments[segIndex].startSec
@@ -1052,8 +1398,6 @@ class _SetlistWaveformPainter extends CustomPainter {
           ? segments[segIndex].color
           : defaultWaveColor;
       for (int i = 0; i < peaks.length; i++) {
-        final x = i * stepX;
-        final h = ampH * peaks[i].clamp(0.0, 1.0);
         // Map index to time in seconds
         final t = timeAtIndex(i);
         // Advance segment if needed
@@ -1070,19 +1414,18 @@ class _SetlistWaveformPainter extends CustomPainter {
               : defaultWaveColor;
         }
         // Choose color: colored segment if t within [start, end), else default
-        if (segIndex < segments.length &&
-            t >= currentSegStart &&
-            t < currentSegEnd) {
-          if (wavePaint.color != currentSegColor) {
-            wavePaint.color = currentSegColor;
-          }
-        } else {
-          if (wavePaint.color != defaultWaveColor) {
-            wavePaint.color = defaultWaveColor;
-          }
+        final color = (segIndex < segments.length &&
+                t >= currentSegStart &&
+                t < currentSegEnd)
+            ? currentSegColor
+            : defaultWaveColor;
+        if (color != runColor) {
+          flushRun(i);
+          runStart = i;
+          runColor = color;
         }
-        canvas.drawLine(Offset(x, midY - h), Offset(x, midY + h), wavePaint);
       }
+      flushRun(peaks.length);
     } else {
       final line = Paint()
         ..color = const Color(0xFF4FC3F7)
@@ -173,18 +173,32 @@ class AddSongScreen extends ConsumerWidget {
           if (state.isLoading)
             Container(
               color: Colors.black.withOpacity(0.3),
-              child: const Center(
+              child: Center(
                 child: Card(
                   child: Padding(
-                    padding: EdgeInsets.all(20),
-                    child: Column(
-                      mainAxisSize: MainAxisSize.min,
-                      children: [
-                        CircularProgressIndicator(),
-                        SizedBox(height: 16),
-                        Text('Processando...'),
-                      ],
-                    ),
+                    padding: const EdgeInsets.all(20),
+                    child: (state.isSaving && state.importProgress != null)
+                        ? SizedBox(
+                            width: 240,
+                            child: Column(
+                              mainAxisSize: MainAxisSize.min,
+                              children: [
+                                LinearProgressIndicator(
+                                    value: state.importProgress),
+                                const SizedBox(height: 16),
+                                Text(
+                                    'Importando faixas... ${(state.importProgress! * 100).round()}%'),
+                              ],
+                            ),
+                          )
+                        : const Column(
+                            mainAxisSize: MainAxisSize.min,
+                            children: [
+                              CircularProgressIndicator(),
+                              SizedBox(height: 16),
+                              Text('Processando...'),
+                            ],
+                          ),
                   ),
                 ),
               ),
@@ -6,6 +6,10 @@ import 'package:flutter_riverpod/flutter_riverpod.dart';
 import '../../../application/providers/song_providers.dart';
 import '../../../application/providers/audio_providers.dart';
 import '../../../application/providers/device_provider.dart';
+import '../../../application/services/automation_persistence.dart';
+import '../../../application/services/monitor_mix_persistence.dart';
+import '../../../application/services/i_audio_device_service.dart';
+import '../../widgets/spectrum_analyzer_view.dart';
 import '../../widgets/track_control_tile.dart';
 import '../../widgets/waveform_timeline.dart';
 import '../../widgets/waveform_loader_io.dart'
@@ -76,10 +80,12 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
       );
       final path = track.localFilePath;
       if (path.isEmpty) return false;
-      final data = await wf.loadWaveform(path, targetPoints: 4000);
-      final peaks = data.peaks;
-      final durationSec = data.durationSec;
-      final beatsMs = _detectBeatTimesMs(peaks, durationSec);
+      var beatsMs = await wf.loadBeatGridMs(path) ?? const <int>[];
+      if (beatsMs.length < 2) {
+        final data = await wf.loadWaveform(path, targetPoints: 4000);
+        beatsMs = _detectBeatTimesMs(data.peaks, data.durationSec);
+        data.dispose();
+      }
       if (beatsMs.length < 2) return false;
       // Estima período pelo mediano dos intervalos
       final intervals = <int>[];
@@ -157,6 +163,9 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
   int? _startEpochMs;
   double _playheadSec = 0.0; // posição atual da agulha em segundos
   Timer? _playheadTimer;
+  // Endpoint que abre o loop ativo no engine (fecha no endpoint seguinte)
+  int? _loopEndpointId;
+  static const int _kBeatsPerBar = 4;
 
   @override
   Widget build(BuildContext context) {
@@ -215,6 +224,7 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
                                     now - (_playheadSec * 1000).round();
                               }
                               _isPlaying = false;
+                              _loopEndpointId = null;
                             });
                             _playheadTimer?.cancel();
                             ref
@@ -253,7 +263,11 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
                               lowLatency: false,
                             );
                           } catch (_) {}
-                          await audioService.playAllTracks(tracks);
+                          await _loadAutomation();
+                          await audioService.playAllTracks(tracks,
+                              monitorMixes:
+                                  await MonitorMixPersistence.loadForSong(
+                                      widget.songId));
                           try {
                             await audioService.seekPlayAll(_playheadSec);
                           } catch (_) {}
@@ -462,6 +476,11 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
                                         onGo: () async {
                                           await _goToEndpoint(ep);
                                         },
+                                        isLooping: _loopEndpointId == ep.id,
+                                        onLoop: () async {
+                                          await _toggleLoopFromEndpoint(
+                                              ep, list);
+                                        },
                                         onRename: () async {
                                           await _renameEndpoint(context, ep);
                                         },
@@ -485,6 +504,8 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
                                 ),
                               ),
                             ),
+                            const Divider(height: 1),
+                            SpectrumAnalyzerView(tracks: tracks),
                           ],
                         ),
                       ),
@@ -650,15 +671,7 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
   Future<bool> _hasSampleRateMismatch(List<Track> tracks) async {
     if (tracks.isEmpty) return false;
     final audioService = ref.read(audioDeviceServiceProvider);
-    final rates = <int>{};
-    for (final t in tracks) {
-      final path = t.localFilePath;
-      if (path.isEmpty) continue;
-      final sr = await audioService.getFileSampleRateHz(path);
-      if (sr != null && sr > 0) {
-        rates.add(sr);
-      }
-    }
+    final rates = await audioService.sampleRatesOf(tracks);
     return rates.length > 1;
   }
 
@@ -667,6 +680,13 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
     if (_isPlaying && _startEpochMs != null) {
       _playheadTimer = Timer.periodic(const Duration(milliseconds: 100), (_) {
         final now = DateTime.now().millisecondsSinceEpoch;
+        // Com o mixer nativo a agulha segue a posição do engine (loops e
+        // saltos agendados acontecem lá, não aqui)
+        final engineSec =
+            ref.read(audioDeviceServiceProvider).enginePositionSec;
+        if (engineSec != null) {
+          _startEpochMs = now - (engineSec * 1000).round();
+        }
         final sec =
             ((now - _startEpochMs!) / 1000.0).clamp(0.0, double.infinity);
         setState(() {
@@ -735,7 +755,58 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
     }
   }
 
+  // Timeline de automação salva da música; o engine aplica no frame exato
+  Future<void> _loadAutomation() async {
+    try {
+      await ref.read(audioDeviceServiceProvider).setAutomationTimeline(
+          await AutomationPersistence.loadForSong(widget.songId));
+    } catch (_) {}
+  }
+
+  // Salto pelo engine no próximo compasso da grade de batidas (ou no próximo
+  // bloco, sem grade); false se o mixer nativo não estiver tocando
+  Future<bool> _scheduleQuantizedJump(int targetMs) async {
+    final audioService = ref.read(audioDeviceServiceProvider);
+    final beats = _getCachedBeatGridMs(widget.songId);
+    final periodMs = _getCachedBeatPeriodMs(widget.songId);
+    if (beats != null && beats.isNotEmpty && periodMs != null && periodMs > 0) {
+      return audioService.scheduleJump(targetMs,
+          gridOriginMs: beats.first, gridPeriodMs: periodMs * _kBeatsPerBar);
+    }
+    return audioService.scheduleJump(targetMs);
+  }
+
+  Future<void> _toggleLoopFromEndpoint(
+      Endpoint ep, List<Endpoint> endpoints) async {
+    final audioService = ref.read(audioDeviceServiceProvider);
+    if (_loopEndpointId == ep.id) {
+      await audioService.clearLoopRegion();
+      setState(() => _loopEndpointId = null);
+      return;
+    }
+    final later = endpoints.where((e) => e.timeMs > ep.timeMs).toList()
+      ..sort((a, b) => a.timeMs.compareTo(b.timeMs));
+    String? error;
+    if (!_isPlaying) {
+      error = 'Toque a música para ativar o loop';
+    } else if (later.isEmpty) {
+      error = 'Crie um endpoint depois deste para fechar o loop';
+    } else if (!await audioService.setLoopRegion(
+        ep.timeMs, later.first.timeMs)) {
+      error = 'Loop indisponível neste dispositivo';
+    }
+    if (!mounted) return;
+    if (error != null) {
+      ScaffoldMessenger.of(context)
+          .showSnackBar(SnackBar(content: Text(error)));
+      return;
+    }
+    setState(() => _loopEndpointId = ep.id);
+  }
+
   Future<void> _goToEndpoint(Endpoint ep) async {
+    // Tocando: o engine salta com precisão de amostra e a agulha acompanha
+    if (_isPlaying && await _scheduleQuantizedJump(ep.timeMs)) return;
     final sec = ep.timeMs / 1000.0;
     setState(() {
       _playheadSec = sec;
@@ -782,7 +853,10 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
             lowLatency: false,
           );
         } catch (_) {}
-        await audioService.playAllTracks(tracks);
+        await _loadAutomation();
+        await audioService.playAllTracks(tracks,
+            monitorMixes:
+                await MonitorMixPersistence.loadForSong(widget.songId));
         // Inicia com ganho mínimo para evitar clique e silêncio perceptível
         final originals = tracks.map((t) => t.volume.clamp(0.0, 1.0)).toList();
         const double startGain = 0.35;
@@ -976,12 +1050,16 @@ class _MixerScreenState extends ConsumerState<MixerScreen> {
 class _EndpointTile extends ConsumerWidget {
   final Endpoint endpoint;
   final VoidCallback onGo;
+  final VoidCallback onLoop;
+  final bool isLooping;
   final VoidCallback onRename;
   final VoidCallback onPickColor;
   final VoidCallback onDelete;
   const _EndpointTile({
     required this.endpoint,
     required this.onGo,
+    required this.onLoop,
+    this.isLooping = false,
     required this.onRename,
     required this.onPickColor,
     required this.onDelete,
@@ -1074,6 +1152,11 @@ class _EndpointTile extends ConsumerWidget {
                 label: 'Ir',
                 onPressed: onGo,
               ),
+              _ActionButton(
+                icon: isLooping ? Icons.repeat_on : Icons.repeat,
+                label: isLooping ? 'Sair' : 'Loop',
+                onPressed: onLoop,
+              ),
               _ActionButton(
                 icon: Icons.edit,
                 label: 'Renomear',
@@ -0,0 +1,184 @@
+import 'dart:async';
+import 'dart:typed_data';
+import 'package:flutter/material.dart';
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+
+import '../../application/providers/audio_providers.dart';
+import '../../application/services/i_audio_device_service.dart';
+import '../../domain/models/spectrum_tap_model.dart';
+import '../../domain/models/track_model.dart';
+
+// Espectro e correlação L/R de um tap do mixer nativo (passagem de som).
+// As bandas vêm prontas do thread de análise nativo; aqui só se copia a view
+// a cada tick e desenha. O analisador fica ligado enquanto o widget existir.
+class SpectrumAnalyzerView extends ConsumerStatefulWidget {
+  final List<Track> tracks;
+  final double height;
+  final int rateHz;
+  const SpectrumAnalyzerView({
+    super.key,
+    required this.tracks,
+    this.height = 120,
+    this.rateHz = 30,
+  });
+
+  @override
+  ConsumerState<SpectrumAnalyzerView> createState() =>
+      _SpectrumAnalyzerViewState();
+}
+
+class _SpectrumAnalyzerViewState extends ConsumerState<SpectrumAnalyzerView> {
+  static const double _minDb = -90.0;
+  SpectrumTap _tap = const SpectrumTap.output(0);
+  Float32List _bins = Float32List(0);
+  double _correlation = 0.0;
+  bool _available = true;
+  Timer? _timer;
+  late final IAudioDeviceService _service;
+
+  @override
+  void initState() {
+    super.initState();
+    _service = ref.read(audioDeviceServiceProvider);
+    _applyTap();
+    _timer = Timer.periodic(
+      Duration(milliseconds: 1000 ~/ widget.rateHz),
+      (_) => _poll(),
+    );
+  }
+
+  @override
+  void dispose() {
+    _timer?.cancel();
+    _service.setSpectrumTap(null);
+    super.dispose();
+  }
+
+  Future<void> _applyTap() async {
+    final ok = await _service.setSpectrumTap(_tap, rateHz: widget.rateHz);
+    if (mounted && ok != _available) setState(() => _available = ok);
+  }
+
+  void _poll() {
+    final bins = _service.spectrumBins;
+    if (bins == null || !mounted) return;
+    setState(() {
+      // Cópia: a view nativa muda enquanto o quadro é desenhado
+      _bins = Float32List.fromList(bins);
+      _correlation = _service.spectrumCorrelation ?? 0.0;
+    });
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    if (!_available) return const SizedBox.shrink();
+    final items = <DropdownMenuItem<SpectrumTap>>[
+      const DropdownMenuItem(
+        value: SpectrumTap.output(0),
+        child: Text('Saída 1-2'),
+      ),
+      for (int i = 0; i < widget.tracks.length; i++)
+        DropdownMenuItem(
+          value: SpectrumTap.track(i),
+          child: Text(widget.tracks[i].name, overflow: TextOverflow.ellipsis),
+        ),
+    ];
+    return Padding(
+      padding: const EdgeInsets.fromLTRB(12, 6, 12, 12),
+      child: Column(
+        crossAxisAlignment: CrossAxisAlignment.stretch,
+        mainAxisSize: MainAxisSize.min,
+        children: [
+          Row(
+            children: [
+              const Text('Espectro'),
+              const SizedBox(width: 8),
+              Expanded(
+                child: DropdownButton<SpectrumTap>(
+                  value: items.any((e) => e.value == _tap)
+                      ? _tap
+                      : const SpectrumTap.output(0),
+                  isExpanded: true,
+                  isDense: true,
+                  items: items,
+                  onChanged: (tap) {
+                    if (tap == null) return;
+                    setState(() => _tap = tap);
+                    _applyTap();
+                  },
+                ),
+              ),
+            ],
+          ),
+          const SizedBox(height: 6),
+          SizedBox(
+            height: widget.height,
+            child: CustomPaint(
+              painter: _SpectrumPainter(bins: _bins, minDb: _minDb),
+            ),
+          ),
+          const SizedBox(height: 6),
+          SizedBox(
+            height: 10,
+            child: CustomPaint(
+              painter: _CorrelationPainter(value: _correlation),
+            ),
+          ),
+        ],
+      ),
+    );
+  }
+}
+
+class _SpectrumPainter extends CustomPainter {
+  final Float32List bins;
+  final double minDb;
+  _SpectrumPainter({required this.bins, required this.minDb});
+
+  @override
+  void paint(Canvas canvas, Size size) {
+    canvas.drawRect(
+        Offset.zero & size, Paint()..color = const Color(0xFF1E1E1E));
+    if (bins.isEmpty) return;
+    final w = size.width / bins.length;
+    final bar = Paint()..color = const Color(0xFF66BB6A);
+    for (int i = 0; i < bins.length; i++) {
+      final ratio = ((bins[i] - minDb) / -minDb).clamp(0.0, 1.0);
+      final h = size.height * ratio;
+      if (h <= 0) continue;
+      canvas.drawRect(
+        Rect.fromLTWH(i * w + 0.5, size.height - h, w - 1, h),
+        bar,
+      );
+    }
+  }
+
+  @override
+  bool shouldRepaint(covariant _SpectrumPainter oldDelegate) =>
+      !identical(oldDelegate.bins, bins);
+}
+
+class _CorrelationPainter extends CustomPainter {
+  final double value; // -1..1
+  _CorrelationPainter({required this.value});
+
+  @override
+  void paint(Canvas canvas, Size size) {
+    canvas.drawRect(
+        Offset.zero & size, Paint()..color = const Color(0xFF1E1E1E));
+    final mid = size.width / 2;
+    final x = mid + mid * value.clamp(-1.0, 1.0);
+    // Negativo (fase invertida) em vermelho
+    final paint = Paint()
+      ..color = value < 0 ? Colors.redAccent : const Color(0xFF66BB6A);
+    canvas.drawRect(
+        Rect.fromLTRB(x < mid ? x : mid, 0, x < mid ? mid : x, size.height),
+        paint);
+    canvas.drawLine(Offset(mid, 0), Offset(mid, size.height),
+        Paint()..color = Colors.white54);
+  }
+
+  @override
+  bool shouldRepaint(covariant _CorrelationPainter oldDelegate) =>
+      oldDelegate.value != value;
+}
@@ -37,6 +37,8 @@ class TrackLevelMeter extends ConsumerStatefulWidget {
 
 class _TrackLevelMeterState extends ConsumerState<TrackLevelMeter> {
   List<double> _peaks = const [];
+  // Dono da memória de _peaks (view nativa); liberado ao trocar de arquivo
+  wf.WaveformData? _waveform;
   double _durationSec = 0;
   double _smoothedAmp = 0.0;
 
@@ -60,19 +62,35 @@ class _TrackLevelMeterState extends ConsumerState<TrackLevelMeter> {
         _peaks = const [];
         _durationSec = 0;
       });
+      _waveform?.dispose();
+      _waveform = null;
       return;
     }
     try {
       final data = await wf.loadWaveform(widget.filePath, targetPoints: 1000);
+      if (!mounted) {
+        data.dispose();
+        return;
+      }
+      final previous = _waveform;
       setState(() {
+        _waveform = data;
         _peaks = data.peaks;
         _durationSec = data.durationSec;
       });
+      previous?.dispose();
     } catch (_) {
       // ignore
     }
   }
 
+  @override
+  void dispose() {
+    _waveform?.dispose();
+    _waveform = null;
+    super.dispose();
+  }
+
   @override
   Widget build(BuildContext context) {
     final playhead = ref.watch(playheadSecProvider);
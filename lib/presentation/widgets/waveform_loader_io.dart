@@ -1,13 +1,18 @@
 import 'dart:io';
 import 'dart:math' as math;
+import 'dart:typed_data';
+
+import '../../infrastructure/audio/native_analysis_ffi.dart';
 
 class WaveformData {
-  final List<double> peaks;
+  // Quando vem do nativo, é uma view da memória nativa: vale até dispose()
+  final Float32List peaks;
   final int sampleRate;
   final int channels;
   final int bitsPerSample;
   final int dataBytes;
   final double durationSec;
+  final NativeFloat32Buffer? _native;
   WaveformData({
     required this.peaks,
     required this.sampleRate,
@@ -15,14 +20,18 @@ class WaveformData {
     required this.bitsPerSample,
     required this.dataBytes,
     required this.durationSec,
-  });
+    NativeFloat32Buffer? native,
+  }) : _native = native;
+
+  // Devolve a memória nativa dos peaks; `peaks` não pode ser lido depois
+  void dispose() => _native?.release();
 }
 
 Future<WaveformData> loadWaveform(String path, {int targetPoints = 1000}) async {
   final file = File(path);
   if (!await file.exists()) {
     return WaveformData(
-      peaks: const [],
+      peaks: Float32List(0),
       sampleRate: 44100,
       channels: 2,
       bitsPerSample: 16,
@@ -31,13 +40,26 @@ Future<WaveformData> loadWaveform(String path, {int targetPoints = 1000}) async
     );
   }
 
+  final native = await NativeAnalysisFfi.waveformPeaks(path, targetPoints);
+  if (native != null) {
+    return WaveformData(
+      peaks: native.buffer.view,
+      sampleRate: native.sampleRate,
+      channels: native.channels,
+      bitsPerSample: native.bitsPerSample,
+      dataBytes: native.dataBytes,
+      durationSec: native.durationSec,
+      native: native.buffer,
+    );
+  }
+
   final raf = file.openSync(mode: FileMode.read);
   try {
     final header = raf.readSync(12);
     if (String.fromCharCodes(header.sublist(0, 4)) != 'RIFF' ||
         String.fromCharCodes(header.sublist(8, 12)) != 'WAVE') {
       return WaveformData(
-        peaks: const [],
+        peaks: Float32List(0),
         sampleRate: 44100,
         channels: 2,
         bitsPerSample: 16,
@@ -73,7 +95,7 @@ Future<WaveformData> loadWaveform(String path, {int targetPoints = 1000}) async
     }
     if (fmtAudioFormat != 1 || dataOffset < 0 || dataSize <= 0) {
       return WaveformData(
-        peaks: const [],
+        peaks: Float32List(0),
         sampleRate: sampleRate,
         channels: channels,
         bitsPerSample: bitsPerSample,
@@ -87,7 +109,8 @@ Future<WaveformData> loadWaveform(String path, {int targetPoints = 1000}) async
     final framesTotal = (dataSize / bytesPerFrame).floor();
     final framesPerBucket = math.max(1, (framesTotal / targetPoints).floor());
     final bucketBytes = framesPerBucket * bytesPerFrame;
-    final peaks = <double>[];
+    final peaks = Float32List(targetPoints);
+    int count = 0;
     raf.setPositionSync(dataOffset);
     final buf = List<int>.filled(bucketBytes, 0);
     for (int i = 0; i < targetPoints; i++) {
@@ -109,10 +132,10 @@ Future<WaveformData> loadWaveform(String path, {int targetPoints = 1000}) async
         for (int b = 0; b < read; b += bytesPerFrame) { sum += buf[b].abs(); }
         peak = (sum / read) / 255.0;
       }
-      peaks.add(peak);
+      peaks[count++] = peak;
     }
     return WaveformData(
-      peaks: peaks,
+      peaks: Float32List.sublistView(peaks, 0, count),
       sampleRate: sampleRate,
       channels: channels,
       bitsPerSample: bitsPerSample,
@@ -136,4 +159,18 @@ int _int16LE(List<int> buf, int offset) {
   int v = (hi << 8) | lo;
   if (v & 0x8000 != 0) v = v - 0x10000;
   return v;
-}
\ No newline at end of file
+}
+// Beat-grid nativo (instantes em ms); null quando a análise nativa não está
+// disponível e o chamador deve estimar a partir dos peaks.
+Future<List<int>?> loadBeatGridMs(String path) async {
+  final grid = await NativeAnalysisFfi.beatGrid(path);
+  if (grid == null) return null;
+  try {
+    final beats = grid.buffer.view;
+    return List<int>.generate(
+        beats.length, (i) => (beats[i] * 1000.0).round(),
+        growable: false);
+  } finally {
+    grid.buffer.release();
+  }
+}
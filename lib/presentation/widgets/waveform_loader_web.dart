@@ -1,5 +1,7 @@
+import 'dart:typed_data';
+
 class WaveformData {
-  final List<double> peaks;
+  final Float32List peaks;
   final int sampleRate;
   final int channels;
   final int bitsPerSample;
@@ -13,16 +15,19 @@ class WaveformData {
     required this.dataBytes,
     required this.durationSec,
   });
+
+  void dispose() {}
 }
 
 Future<WaveformData> loadWaveform(String path, {int targetPoints = 1000}) async {
   // Web stub: file IO indisponível. Retorna placeholder de linha reta.
   return WaveformData(
-    peaks: List<double>.filled(targetPoints, 0.2),
+    peaks: Float32List(targetPoints)..fillRange(0, targetPoints, 0.2),
     sampleRate: 44100,
     channels: 2,
     bitsPerSample: 16,
     dataBytes: 0,
     durationSec: 0,
   );
-}
\ No newline at end of file
+}
+Future<List<int>?> loadBeatGridMs(String path) async => null;
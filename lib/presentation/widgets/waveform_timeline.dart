@@ -29,6 +29,8 @@ class WaveformTimeline extends StatefulWidget {
 
 class _WaveformTimelineState extends State<WaveformTimeline> {
   List<double> _peaks = const [];
+  // Dono da memória de _peaks (view nativa); liberado ao trocar de arquivo
+  wf.WaveformData? _waveform;
   int _sampleRate = 44100;
   int _channels = 2;
   int _bitsPerSample = 16;
@@ -56,6 +58,8 @@ class _WaveformTimelineState extends State<WaveformTimeline> {
   @override
   void dispose() {
     _timer?.cancel();
+    _waveform?.dispose();
+    _waveform = null;
     super.dispose();
   }
 
@@ -81,12 +85,20 @@ class _WaveformTimelineState extends State<WaveformTimeline> {
       _bitsPerSample = 16;
       _dataBytes = 0;
     });
+    _waveform?.dispose();
+    _waveform = null;
 
     final path = widget.filePath;
     if (path == null || path.isEmpty) return;
     try {
       final data = await wf.loadWaveform(path, targetPoints: 1000);
+      if (!mounted || path != widget.filePath) {
+        data.dispose();
+        return;
+      }
+      _waveform?.dispose();
       setState(() {
+        _waveform = data;
         _peaks = data.peaks;
         _sampleRate = data.sampleRate;
         _channels = data.channels;
@@ -0,0 +1,820 @@
+#include "include/audio_engine/audio_engine_plugin.h"
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine_api.h"
+#include "engine_stats.h"
+#include "mixer_output.h"
+#include "param_queue.h"
+
+// Lado Linux dos canais audio_usb/* com o mesmo contrato do MainActivity.kt:
+// nomes de método, argumentos, códigos de erro e mapas de resposta iguais,
+// para o Dart não distinguir as plataformas. A interface é escolhida na
+// enumeração ALSA (listOutputDevices) como o getUsbOutputDevice do Kotlin; a
+// gravação da entrada continua só no Android. Experimental (ver
+// CMakeLists.txt): ainda sem build contra os headers reais.
+
+#define AUDIO_ENGINE_PLUGIN(obj)                                     \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), audio_engine_plugin_get_type(), \
+                              AudioEnginePlugin))
+
+// Sem aviso de hotplug no ALSA: neste intervalo, enquanto o Dart escuta
+// audio_usb/events, o thread da UI só compara as placas presentes
+// (outputCardsSignature); a lista com a sondagem de canais roda num thread à
+// parte, no estado inicial do listen e quando elas mudam
+static const guint kHotplugPollSeconds = 2;
+
+struct _AudioEnginePlugin {
+  GObject parent_instance;
+
+  FlEventChannel* events;
+  guint hotplug_source;
+  // Placas da última verificação aplicada; a troca dispara outra em background
+  std::string* polled_cards;
+  bool hotplug_checking;
+  // A próxima verificação avisa o Dart mesmo sem troca (estado inicial)
+  bool hotplug_force;
+  // PCM da interface avisada por último ao Dart; vazio = nenhuma
+  std::string* device_pcm;
+  bool using_native;
+  float preview_volume;
+  float preview_pan;
+};
+
+G_DEFINE_TYPE(AudioEnginePlugin, audio_engine_plugin, g_object_get_type())
+
+// Espelha INSERT_PARAM_IDS de MainActivity.kt
+static const struct {
+  const char* key;
+  ParamId id;
+} kInsertParams[] = {
+    {"hpfHz", PARAM_HPF_HZ},
+    {"lpfHz", PARAM_LPF_HZ},
+    {"eq1Hz", PARAM_EQ1_HZ},
+    {"eq1GainDb", PARAM_EQ1_GAIN_DB},
+    {"eq1Q", PARAM_EQ1_Q},
+    {"eq2Hz", PARAM_EQ2_HZ},
+    {"eq2GainDb", PARAM_EQ2_GAIN_DB},
+    {"eq2Q", PARAM_EQ2_Q},
+    {"compThresholdDb", PARAM_COMP_THRESHOLD_DB},
+    {"compRatio", PARAM_COMP_RATIO},
+    {"compAttackMs", PARAM_COMP_ATTACK_MS},
+    {"compReleaseMs", PARAM_COMP_RELEASE_MS},
+    {"compMakeupDb", PARAM_COMP_MAKEUP_DB},
+    {"limitCeilingDb", PARAM_LIMIT_CEILING_DB},
+};
+
+// Espelha EngineStatIndex de engine_stats.h (e ENGINE_STAT_KEYS do Kotlin)
+static const char* const kEngineStatKeys[] = {
+    "blocks",           "avgBlockUs",       "maxBlockUs",
+    "avgInsertUs",      "blockBudgetUs",    "paramsApplied",
+    "paramsDropped",    "trackCount",       "renderWorkers",
+    "inlineJobs",       "deadlineMisses",   "avgJoinWaitUs",
+    "busCount",         "busBuffers",       "firstSampleUs",
+    "preparedTracks",   "preparedStream",   "streamRecoveries",
+    "silentTrackBlocks", "sharedOutput",    "outputConverted",
+    "renderRealtime",   "renderWakeAvgUs",  "renderWakeMaxUs",
+    "workerWakeAvgUs",  "workerWakeMaxUs",  "ioWakeAvgUs",
+    "ioWakeMaxUs",      "analysisWakeAvgUs", "analysisWakeMaxUs",
+    "streamIoBackend",  "streamIoMisses",
+};
+static_assert(sizeof(kEngineStatKeys) / sizeof(kEngineStatKeys[0]) ==
+                  STAT_HEADER_COUNT,
+              "kEngineStatKeys fora de sincronia com EngineStatIndex");
+
+static float clamp_float(double x, float min, float max) {
+  return x < min ? min : (x > max ? max : (float)x);
+}
+
+static FlValue* arg(FlValue* args, const char* key) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return nullptr;
+  }
+  return fl_value_lookup_string(args, key);
+}
+
+static bool as_number(FlValue* value, double* out) {
+  if (value == nullptr) return false;
+  switch (fl_value_get_type(value)) {
+    case FL_VALUE_TYPE_INT:
+      *out = (double)fl_value_get_int(value);
+      return true;
+    case FL_VALUE_TYPE_FLOAT:
+      *out = fl_value_get_float(value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+static double arg_number(FlValue* args, const char* key, double fallback) {
+  double v = fallback;
+  return as_number(arg(args, key), &v) ? v : fallback;
+}
+
+static std::string arg_string(FlValue* args, const char* key) {
+  FlValue* value = arg(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return std::string();
+  }
+  return fl_value_get_string(value);
+}
+
+static bool arg_is_true(FlValue* args, const char* key) {
+  FlValue* value = arg(args, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL &&
+         fl_value_get_bool(value);
+}
+
+// Números de uma lista do codec (genérica ou tipada). Sem `fallback`, itens
+// que não são número saem da lista (mapNotNull do Kotlin); com ele, viram o
+// fallback (map { ... ?: x }).
+static std::vector<double> number_list(FlValue* value,
+                                       const double* fallback = nullptr) {
+  std::vector<double> out;
+  if (value == nullptr) return out;
+  switch (fl_value_get_type(value)) {
+    case FL_VALUE_TYPE_LIST:
+      for (size_t i = 0; i < fl_value_get_length(value); ++i) {
+        double v = 0.0;
+        if (as_number(fl_value_get_list_value(value, i), &v)) {
+          out.push_back(v);
+        } else if (fallback != nullptr) {
+          out.push_back(*fallback);
+        }
+      }
+      break;
+    case FL_VALUE_TYPE_INT32_LIST:
+      out.assign(fl_value_get_int32_list(value),
+                 fl_value_get_int32_list(value) + fl_value_get_length(value));
+      break;
+    case FL_VALUE_TYPE_INT64_LIST:
+      out.assign(fl_value_get_int64_list(value),
+                 fl_value_get_int64_list(value) + fl_value_get_length(value));
+      break;
+    case FL_VALUE_TYPE_FLOAT_LIST:
+      out.assign(fl_value_get_float_list(value),
+                 fl_value_get_float_list(value) + fl_value_get_length(value));
+      break;
+    default:
+      break;
+  }
+  return out;
+}
+
+static std::vector<std::string> string_list(FlValue* value) {
+  std::vector<std::string> out;
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_LIST) {
+    return out;
+  }
+  for (size_t i = 0; i < fl_value_get_length(value); ++i) {
+    FlValue* item = fl_value_get_list_value(value, i);
+    if (fl_value_get_type(item) == FL_VALUE_TYPE_STRING) {
+      out.push_back(fl_value_get_string(item));
+    }
+  }
+  return out;
+}
+
+static bool is_wav(const std::string& path) {
+  if (path.size() < 4) return false;
+  return g_ascii_strcasecmp(path.c_str() + path.size() - 4, ".wav") == 0;
+}
+
+// listOutputDevices abre cada PCM para saber os canais: só roda fora do
+// thread da UI (refresh_output_devices) e a lista fica guardada enquanto as
+// placas presentes forem as mesmas. Os métodos do canal leem só a cópia
+static std::mutex g_devices_lock;
+// Uma sondagem por vez (registro e listen podem coincidir)
+static std::mutex g_devices_probe_lock;
+static std::string g_devices_cards;
+static bool g_devices_valid = false;
+static std::vector<OutputDeviceInfo> g_devices;
+
+// Interface do app: MTP_ALSA_DEVICE (snd-aloop, "null", asoundrc) quando
+// definido, senão a placa USB com mais canais de saída
+static bool pick_output_device(const std::vector<OutputDeviceInfo>& devices,
+                               OutputDeviceInfo* out) {
+  const char* env = std::getenv("MTP_ALSA_DEVICE");
+  if (env != nullptr && *env != '\0' && !devices.empty()) {
+    *out = devices.front();
+    return true;
+  }
+  const OutputDeviceInfo* best = nullptr;
+  for (const OutputDeviceInfo& device : devices) {
+    if (device.usb && (best == nullptr || device.maxChannels > best->maxChannels)) {
+      best = &device;
+    }
+  }
+  if (best == nullptr) return false;
+  *out = *best;
+  return true;
+}
+
+// Sonda as interfaces se as placas mudaram; nunca no thread da UI
+static bool refresh_output_devices(OutputDeviceInfo* out, std::string* cards) {
+  std::lock_guard<std::mutex> probe(g_devices_probe_lock);
+  *cards = outputCardsSignature();
+  {
+    std::lock_guard<std::mutex> lock(g_devices_lock);
+    if (g_devices_valid && *cards == g_devices_cards) {
+      return pick_output_device(g_devices, out);
+    }
+  }
+  std::vector<OutputDeviceInfo> devices = listOutputDevices();
+  const bool found = pick_output_device(devices, out);
+  std::lock_guard<std::mutex> lock(g_devices_lock);
+  g_devices_cards = *cards;
+  g_devices = std::move(devices);
+  g_devices_valid = true;
+  return found;
+}
+
+// Interface da última sondagem, sem abrir PCM; antes da primeira (logo após o
+// registro) nenhuma, e o engine abre o "default" com 2 canais
+static bool select_output_device(OutputDeviceInfo* out) {
+  std::lock_guard<std::mutex> lock(g_devices_lock);
+  return g_devices_valid && pick_output_device(g_devices, out);
+}
+
+// Canais pedidos ao engine; 2 sem interface (ou com o hw ocupado desde antes
+// de o app abrir)
+static int device_channels(bool found, const OutputDeviceInfo& device) {
+  return found && device.maxChannels > 0 ? device.maxChannels : 2;
+}
+
+static FlValue* output_tap_stats() {
+  int64_t stats[7];
+  engineOutputTapStats(stats);
+  FlValue* resp = fl_value_new_map();
+  fl_value_set_string_take(resp, "recording", fl_value_new_bool(stats[0] != 0));
+  fl_value_set_string_take(resp, "channels", fl_value_new_int(stats[1]));
+  fl_value_set_string_take(resp, "sampleRate", fl_value_new_int(stats[2]));
+  fl_value_set_string_take(resp, "framesWritten", fl_value_new_int(stats[3]));
+  fl_value_set_string_take(resp, "framesDropped", fl_value_new_int(stats[4]));
+  fl_value_set_string_take(resp, "blocksDropped", fl_value_new_int(stats[5]));
+  fl_value_set_string_take(resp, "formatMismatchBlocks", fl_value_new_int(stats[6]));
+  return resp;
+}
+
+static FlMethodResponse* success(FlValue* result = nullptr) {
+  g_autoptr(FlValue) value = result != nullptr ? result : fl_value_new_null();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(value));
+}
+
+static FlMethodResponse* error(const char* code, const char* message) {
+  return FL_METHOD_RESPONSE(
+      fl_method_error_response_new(code, message, nullptr));
+}
+
+static void respond(FlMethodCall* method_call, FlMethodResponse* response) {
+  g_autoptr(GError) err = nullptr;
+  if (!fl_method_call_respond(method_call, response, &err)) {
+    g_warning("Failed to send method call response: %s", err->message);
+  }
+}
+
+static FlMethodResponse* play_all_preview(AudioEnginePlugin* self,
+                                          FlValue* args) {
+  const std::vector<std::string> paths = string_list(arg(args, "filePaths"));
+  const std::vector<double> outputs = number_list(arg(args, "outputChannels"));
+  const std::vector<double> volumes = number_list(arg(args, "volumes"));
+  const std::vector<double> pans = number_list(arg(args, "pans"));
+  if (paths.empty() || outputs.size() != paths.size() ||
+      volumes.size() != paths.size() || pans.size() != paths.size()) {
+    return error("bad_args", "Listas inválidas para playAllPreview");
+  }
+
+  // O stream fica aberto para ser reaproveitado (fechado pelo engine se não
+  // servir)
+  engineStopMixer();
+  self->using_native = false;
+
+  OutputDeviceInfo device;
+  const bool found = select_output_device(&device);
+  const int device_id = found ? device.id : -1;
+  const int channels = device_channels(found, device);
+
+  std::vector<EngineTrack> tracks(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    tracks[i].path = paths[i];
+    tracks[i].outputChannel = (int)outputs[i];
+    tracks[i].volume = clamp_float(volumes[i], 0.0f, 1.0f);
+    tracks[i].pan = clamp_float(pans[i], -1.0f, 1.0f);
+  }
+
+  // Buses opcionais
+  const double no_bus = -1.0;
+  const double unity = 1.0;
+  const double center = 0.0;
+  const std::vector<double> track_buses =
+      number_list(arg(args, "trackBuses"), &no_bus);
+  const std::vector<double> bus_parents =
+      number_list(arg(args, "busParents"), &no_bus);
+  const std::vector<double> bus_volumes =
+      number_list(arg(args, "busVolumes"), &unity);
+  const std::vector<double> bus_pans =
+      number_list(arg(args, "busPans"), &center);
+  FlValue* bus_mutes = arg(args, "busMutes");
+  std::vector<int> track_bus(paths.size(), -1);
+  for (size_t i = 0; i < paths.size() && i < track_buses.size(); ++i) {
+    track_bus[i] = (int)track_buses[i];
+  }
+  std::vector<MixBusConfig> buses(bus_parents.size());
+  for (size_t b = 0; b < buses.size(); ++b) {
+    buses[b].parent = (int)bus_parents[b];
+    buses[b].volume =
+        clamp_float(b < bus_volumes.size() ? bus_volumes[b] : 1.0, 0.0f, 1.0f);
+    buses[b].pan =
+        clamp_float(b < bus_pans.size() ? bus_pans[b] : 0.0, -1.0f, 1.0f);
+    if (bus_mutes != nullptr &&
+        fl_value_get_type(bus_mutes) == FL_VALUE_TYPE_LIST &&
+        b < fl_value_get_length(bus_mutes)) {
+      FlValue* mute = fl_value_get_list_value(bus_mutes, b);
+      buses[b].mute = fl_value_get_type(mute) == FL_VALUE_TYPE_BOOL &&
+                      fl_value_get_bool(mute);
+    }
+  }
+  engineSetMixGraph(std::move(track_bus), std::move(buses));
+
+  // Mixes de in-ear opcionais: primeiro canal de cada par e níveis
+  // track x mix (track-major)
+  const double muted = 0.0;
+  const std::vector<double> aux_outputs_arg =
+      number_list(arg(args, "auxOutputs"), &no_bus);
+  const std::vector<double> aux_sends_arg =
+      number_list(arg(args, "auxSends"), &muted);
+  std::vector<int> aux_outputs(aux_outputs_arg.begin(), aux_outputs_arg.end());
+  std::vector<float> aux_sends(paths.size() * aux_outputs.size());
+  for (size_t k = 0; k < aux_sends.size(); ++k) {
+    aux_sends[k] = clamp_float(
+        k < aux_sends_arg.size() ? aux_sends_arg[k] : 0.0, 0.0f, 1.0f);
+  }
+  engineSetAuxSends(aux_outputs, aux_sends);
+
+  if (!enginePlayAll(std::move(tracks), device_id, channels)) {
+    return error("play_error", "Falha ao iniciar mixer");
+  }
+  self->using_native = true;
+  return success();
+}
+
+struct PrepareJob {
+  FlMethodCall* method_call;
+  bool ok;
+};
+
+static gboolean prepare_done(gpointer data) {
+  PrepareJob* job = static_cast<PrepareJob*>(data);
+  g_autoptr(FlMethodResponse) response = success(fl_value_new_bool(job->ok));
+  respond(job->method_call, response);
+  g_object_unref(job->method_call);
+  delete job;
+  return G_SOURCE_REMOVE;
+}
+
+// Abre arquivos e lê o início de cada um: fora do thread da UI; a resposta
+// volta pelo loop do GTK
+static FlMethodResponse* prepare_all_preview(FlMethodCall* method_call,
+                                             FlValue* args) {
+  std::vector<std::string> paths = string_list(arg(args, "filePaths"));
+  const std::vector<double> outputs = number_list(arg(args, "outputChannels"));
+  if (paths.empty() || outputs.size() != paths.size()) {
+    return error("bad_args", "Listas inválidas para prepareAllPreview");
+  }
+  OutputDeviceInfo device;
+  const bool found = select_output_device(&device);
+  const int device_id = found ? device.id : -1;
+  const int channels = device_channels(found, device);
+  std::vector<int> output_channels(outputs.begin(), outputs.end());
+
+  PrepareJob* job = new PrepareJob{
+      FL_METHOD_CALL(g_object_ref(method_call)), false};
+  std::thread([job, paths = std::move(paths),
+               output_channels = std::move(output_channels), device_id,
+               channels]() mutable {
+    job->ok = enginePrepareAll(std::move(paths), std::move(output_channels),
+                               device_id, channels);
+    g_idle_add(prepare_done, job);
+  }).detach();
+  return nullptr;
+}
+
+static FlMethodResponse* output_channel_details() {
+  OutputDeviceInfo device;
+  const bool found = select_output_device(&device);
+  const int count = found ? device_channels(true, device) : 0;
+  FlValue* channels = fl_value_new_list();
+  for (int i = 1; i <= count; ++i) {
+    g_autofree gchar* label = g_strdup_printf("Canal de Saída %d", i);
+    fl_value_append_take(channels, fl_value_new_string(label));
+  }
+  FlValue* resp = fl_value_new_map();
+  fl_value_set_string_take(
+      resp, "deviceName",
+      fl_value_new_string(found ? device.name.c_str() : ""));
+  fl_value_set_string_take(resp, "outputChannelCount", fl_value_new_int(count));
+  fl_value_set_string_take(resp, "outputChannels", channels);
+  return success(resp);
+}
+
+// Sem captura no Linux: nenhuma entrada
+static FlMethodResponse* input_channel_details() {
+  FlValue* resp = fl_value_new_map();
+  fl_value_set_string_take(resp, "deviceName", fl_value_new_string(""));
+  fl_value_set_string_take(resp, "inputChannelCount", fl_value_new_int(0));
+  fl_value_set_string_take(resp, "inputChannels", fl_value_new_list());
+  return success(resp);
+}
+
+static FlMethodResponse* play_preview(AudioEnginePlugin* self, FlValue* args) {
+  const std::string path = arg_string(args, "filePath");
+  const int output_channel = (int)arg_number(args, "outputChannel", 0);
+  if (path.empty()) return error("bad_args", "filePath ausente");
+  if (!is_wav(path)) {
+    return error("unsupported_format", "Apenas WAV é suportado no preview");
+  }
+  OutputDeviceInfo device;
+  const bool found = select_output_device(&device);
+  if (!enginePlayPreview(path, output_channel, found ? device.id : -1,
+                         device_channels(found, device))) {
+    return error("play_error", "Falha ao iniciar preview");
+  }
+  engineSetPreviewVolume(self->preview_volume);
+  engineSetPreviewPan(self->preview_pan);
+  return success();
+}
+
+// Inserts da track (ou do bus) pelo mapa do TrackInserts; false se alguma
+// fila estava cheia
+static bool send_inserts(int index, FlValue* params, bool bus) {
+  bool ok = true;
+  for (size_t i = 0; i < fl_value_get_length(params); ++i) {
+    FlValue* key = fl_value_get_map_key(params, i);
+    double v = 0.0;
+    if (fl_value_get_type(key) != FL_VALUE_TYPE_STRING ||
+        !as_number(fl_value_get_map_value(params, i), &v)) {
+      continue;
+    }
+    for (const auto& param : kInsertParams) {
+      if (strcmp(param.key, fl_value_get_string(key)) != 0) continue;
+      const bool sent = bus ? engineSetBusParam(index, param.id, (float)v)
+                            : engineSetTrackParam(index, param.id, (float)v);
+      if (!sent) ok = false;
+    }
+  }
+  return ok;
+}
+
+static FlMethodResponse* set_bus_params(AudioEnginePlugin* self,
+                                        FlValue* args) {
+  const int index = (int)arg_number(args, "busIndex", -1);
+  if (index < 0) return error("bad_args", "busIndex ausente");
+  if (!self->using_native) return success(fl_value_new_bool(false));
+  bool ok = true;
+  double v = 0.0;
+  if (as_number(arg(args, "volume"), &v)) {
+    ok = engineSetBusParam(index, PARAM_TRACK_VOLUME, clamp_float(v, 0.0f, 1.0f)) && ok;
+  }
+  if (as_number(arg(args, "pan"), &v)) {
+    ok = engineSetBusParam(index, PARAM_TRACK_PAN, clamp_float(v, -1.0f, 1.0f)) && ok;
+  }
+  FlValue* mute = arg(args, "mute");
+  if (mute != nullptr && fl_value_get_type(mute) == FL_VALUE_TYPE_BOOL) {
+    ok = engineSetBusParam(index, PARAM_MUTE, fl_value_get_bool(mute) ? 1.0f : 0.0f) && ok;
+  }
+  FlValue* inserts = arg(args, "inserts");
+  if (inserts != nullptr && fl_value_get_type(inserts) == FL_VALUE_TYPE_MAP) {
+    ok = send_inserts(index, inserts, true) && ok;
+  }
+  return success(fl_value_new_bool(ok));
+}
+
+static FlMethodResponse* engine_stats(AudioEnginePlugin* self) {
+  double vals[STAT_HEADER_COUNT + kMaxStatTracks];
+  const int n = engineStatsSnapshot(vals, STAT_HEADER_COUNT + kMaxStatTracks);
+  FlValue* resp = fl_value_new_map();
+  for (int i = 0; i < STAT_HEADER_COUNT && i < n; ++i) {
+    fl_value_set_string_take(resp, kEngineStatKeys[i],
+                             fl_value_new_float(vals[i]));
+  }
+  FlValue* per_track = fl_value_new_list();
+  for (int i = STAT_HEADER_COUNT; i < n; ++i) {
+    fl_value_append_take(per_track, fl_value_new_float(vals[i]));
+  }
+  fl_value_set_string_take(resp, "trackInsertUs", per_track);
+  fl_value_set_string_take(resp, "native", fl_value_new_bool(self->using_native));
+  fl_value_set_string_take(resp, "outputTap", output_tap_stats());
+  return success(resp);
+}
+
+static FlMethodResponse* start_output_tap(FlValue* args) {
+  const std::string directory = arg_string(args, "directory");
+  if (directory.empty()) return error("bad_args", "directory ausente");
+  g_mkdir_with_parents(directory.c_str(), 0755);
+  CaptureConfig config;
+  config.directory = directory;
+  config.fileName = arg_string(args, "fileName");
+  if (config.fileName.empty()) config.fileName = "show";
+  // Usados só se o mixer ainda não estiver tocando; a próxima sessão corrige
+  // se nada foi gravado até ela
+  OutputDeviceInfo device;
+  const bool found = select_output_device(&device);
+  config.deviceChannels = device_channels(found, device);
+  config.sampleRate = (int)arg_number(args, "sampleRate", 48000);
+  return success(fl_value_new_bool(engineStartOutputTap(std::move(config))));
+}
+
+static FlMethodResponse* stop_output_tap() {
+  const CaptureResult r = engineStopOutputTap();
+  FlValue* resp = output_tap_stats();
+  FlValue* files = fl_value_new_list();
+  for (const std::string& path : r.files) {
+    fl_value_append_take(files, fl_value_new_string(path.c_str()));
+  }
+  fl_value_set_string_take(resp, "files", files);
+  return success(resp);
+}
+
+static FlMethodResponse* detect_bpm(FlValue* args) {
+  const std::string path = arg_string(args, "filePath");
+  if (path.empty()) return error("bad_args", "filePath ausente");
+  if (!is_wav(path)) {
+    return error("unsupported_format",
+                 "Apenas WAV PCM16 é suportado para detecção nativa");
+  }
+  double bpm = 120.0;
+  double confidence = 0.3;
+  engineDetectBpm(path, bpm, confidence);
+  FlValue* resp = fl_value_new_map();
+  fl_value_set_string_take(resp, "bpm", fl_value_new_float(bpm));
+  fl_value_set_string_take(resp, "confidence", fl_value_new_float(confidence));
+  return success(resp);
+}
+
+static FlMethodResponse* file_sample_rate(FlValue* args) {
+  const std::string path = arg_string(args, "filePath");
+  // Mesmo parser e cache do mixer nativo (file_probe.cpp)
+  const int rate = is_wav(path) ? engineProbeSampleRate(path) : 0;
+  return success(rate > 0 ? fl_value_new_int(rate) : nullptr);
+}
+
+static void audio_engine_plugin_handle_method_call(
+    AudioEnginePlugin* self, FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  if (strcmp(method, "detectBpmFromFile") == 0) {
+    response = detect_bpm(args);
+  } else if (strcmp(method, "getFileSampleRateHz") == 0) {
+    response = file_sample_rate(args);
+  } else if (strcmp(method, "seekPlayAll") == 0) {
+    const double pos = arg_number(args, "positionSec", 0.0);
+    if (self->using_native) engineSeek(std::isnan(pos) || pos < 0.0 ? 0.0 : pos);
+    response = success();
+  } else if (strcmp(method, "playAllPreview") == 0) {
+    response = play_all_preview(self, args);
+  } else if (strcmp(method, "prepareAllPreview") == 0) {
+    response = prepare_all_preview(method_call, args);
+    if (response == nullptr) return;  // responde do thread do prepare
+  } else if (strcmp(method, "getOutputChannelDetails") == 0) {
+    response = output_channel_details();
+  } else if (strcmp(method, "getInputChannelDetails") == 0) {
+    response = input_channel_details();
+  } else if (strcmp(method, "startOutputTap") == 0) {
+    response = start_output_tap(args);
+  } else if (strcmp(method, "stopOutputTap") == 0) {
+    response = stop_output_tap();
+  } else if (strcmp(method, "playPreview") == 0) {
+    response = play_preview(self, args);
+  } else if (strcmp(method, "stopPreview") == 0) {
+    engineStopPreview();
+    self->using_native = false;
+    response = success();
+  } else if (strcmp(method, "setPreviewVolume") == 0) {
+    self->preview_volume = clamp_float(arg_number(args, "volume", 1.0), 0.0f, 1.0f);
+    engineSetPreviewVolume(self->preview_volume);
+    response = success();
+  } else if (strcmp(method, "setPreviewPan") == 0) {
+    self->preview_pan = clamp_float(arg_number(args, "pan", 0.0), -1.0f, 1.0f);
+    engineSetPreviewPan(self->preview_pan);
+    response = success();
+  } else if (strcmp(method, "setTrackPan") == 0 ||
+             strcmp(method, "setTrackVolume") == 0) {
+    const bool pan = strcmp(method, "setTrackPan") == 0;
+    const int index = (int)arg_number(args, "trackIndex", -1);
+    const float value =
+        pan ? clamp_float(arg_number(args, "pan", 0.0), -1.0f, 1.0f)
+            : clamp_float(arg_number(args, "volume", 1.0), 0.0f, 1.0f);
+    if (self->using_native && index >= 0) {
+      engineSetTrackParam(index, pan ? PARAM_TRACK_PAN : PARAM_TRACK_VOLUME,
+                          value);
+    } else if (pan) {
+      // Sem mixer: vale para o preview
+      self->preview_pan = value;
+      engineSetPreviewPan(value);
+    } else {
+      self->preview_volume = value;
+      engineSetPreviewVolume(value);
+    }
+    response = success();
+  } else if (strcmp(method, "setTrackInserts") == 0) {
+    const int index = (int)arg_number(args, "trackIndex", -1);
+    FlValue* params = arg(args, "params");
+    if (index < 0 || params == nullptr ||
+        fl_value_get_type(params) != FL_VALUE_TYPE_MAP) {
+      response = error("bad_args", "trackIndex/params ausentes");
+    } else if (!self->using_native) {
+      response = success(fl_value_new_bool(false));
+    } else {
+      response = success(fl_value_new_bool(send_inserts(index, params, false)));
+    }
+  } else if (strcmp(method, "setTrackMute") == 0) {
+    const int index = (int)arg_number(args, "trackIndex", -1);
+    if (self->using_native && index >= 0) {
+      engineSetTrackParam(index, PARAM_MUTE,
+                          arg_is_true(args, "mute") ? 1.0f : 0.0f);
+    }
+    response = success();
+  } else if (strcmp(method, "setBusParams") == 0) {
+    response = set_bus_params(self, args);
+  } else if (strcmp(method, "setAuxSend") == 0) {
+    const int index = (int)arg_number(args, "trackIndex", -1);
+    const int mix = (int)arg_number(args, "mixIndex", -1);
+    const float level = clamp_float(arg_number(args, "level", 0.0), 0.0f, 1.0f);
+    if (index < 0 || mix < 0) {
+      response = error("bad_args", "trackIndex/mixIndex ausentes");
+    } else {
+      response = success(fl_value_new_bool(
+          self->using_native && engineSetAuxSend(index, mix, level)));
+    }
+  } else if (strcmp(method, "getEngineStats") == 0) {
+    response = engine_stats(self);
+  } else {
+    // startRecording/stopRecording: captura só no Android
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  respond(method_call, response);
+}
+
+// Avisa o engine e o Dart quando a interface escolhida muda
+static void audio_engine_plugin_apply_device(AudioEnginePlugin* self,
+                                             bool found,
+                                             const OutputDeviceInfo& device,
+                                             bool force) {
+  const std::string pcm = found ? device.pcm : std::string();
+  if (!force && pcm == *self->device_pcm) return;
+  *self->device_pcm = pcm;
+  // Mixer esperando a interface voltar reabre o stream no novo id
+  engineSetOutputDevice(found ? device.id : -1);
+  g_autoptr(FlValue) event =
+      fl_value_new_string(found ? "connected" : "disconnected");
+  g_autoptr(GError) err = nullptr;
+  if (!fl_event_channel_send(self->events, event, nullptr, &err)) {
+    g_warning("Failed to send device event: %s", err->message);
+  }
+}
+
+// Resultado da verificação em background, entregue no thread da UI
+struct HotplugCheck {
+  AudioEnginePlugin* self;
+  bool found;
+  OutputDeviceInfo device;
+  std::string cards;
+};
+
+static gboolean hotplug_checked_cb(gpointer user_data) {
+  HotplugCheck* check = static_cast<HotplugCheck*>(user_data);
+  AudioEnginePlugin* self = check->self;
+  self->hotplug_checking = false;
+  // Cancelado enquanto sondava: o próximo listen refaz o estado inicial
+  if (self->hotplug_source != 0) {
+    *self->polled_cards = check->cards;
+    audio_engine_plugin_apply_device(self, check->found, check->device,
+                                     self->hotplug_force);
+    self->hotplug_force = false;
+  }
+  g_object_unref(self);
+  delete check;
+  return G_SOURCE_REMOVE;
+}
+
+static void hotplug_check_start(AudioEnginePlugin* self) {
+  self->hotplug_checking = true;
+  HotplugCheck* check = new HotplugCheck();
+  check->self = AUDIO_ENGINE_PLUGIN(g_object_ref(self));
+  std::thread([check]() {
+    check->found = refresh_output_devices(&check->device, &check->cards);
+    g_idle_add(hotplug_checked_cb, check);
+  }).detach();
+}
+
+static gboolean hotplug_poll_cb(gpointer user_data) {
+  AudioEnginePlugin* self = AUDIO_ENGINE_PLUGIN(user_data);
+  if (self->hotplug_checking) return G_SOURCE_CONTINUE;
+  if (outputCardsSignature() == *self->polled_cards) return G_SOURCE_CONTINUE;
+  hotplug_check_start(self);
+  return G_SOURCE_CONTINUE;
+}
+
+static FlMethodErrorResponse* events_listen_cb(FlEventChannel* channel,
+                                               FlValue* args,
+                                               gpointer user_data) {
+  AudioEnginePlugin* self = AUDIO_ENGINE_PLUGIN(user_data);
+  // Estado inicial pela mesma verificação em background; uma já em curso
+  // serve, avisando o Dart mesmo sem troca
+  self->hotplug_force = true;
+  if (!self->hotplug_checking) hotplug_check_start(self);
+  if (self->hotplug_source == 0) {
+    self->hotplug_source =
+        g_timeout_add_seconds(kHotplugPollSeconds, hotplug_poll_cb, self);
+  }
+  return nullptr;
+}
+
+static FlMethodErrorResponse* events_cancel_cb(FlEventChannel* channel,
+                                               FlValue* args,
+                                               gpointer user_data) {
+  AudioEnginePlugin* self = AUDIO_ENGINE_PLUGIN(user_data);
+  if (self->hotplug_source != 0) {
+    g_source_remove(self->hotplug_source);
+    self->hotplug_source = 0;
+  }
+  return nullptr;
+}
+
+static void audio_engine_plugin_dispose(GObject* object) {
+  AudioEnginePlugin* self = AUDIO_ENGINE_PLUGIN(object);
+  if (self->hotplug_source != 0) {
+    g_source_remove(self->hotplug_source);
+    self->hotplug_source = 0;
+  }
+  engineStopPreview();
+  g_clear_object(&self->events);
+  delete self->device_pcm;
+  self->device_pcm = nullptr;
+  delete self->polled_cards;
+  self->polled_cards = nullptr;
+  G_OBJECT_CLASS(audio_engine_plugin_parent_class)->dispose(object);
+}
+
+static void audio_engine_plugin_class_init(AudioEnginePluginClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = audio_engine_plugin_dispose;
+}
+
+static void audio_engine_plugin_init(AudioEnginePlugin* self) {
+  self->events = nullptr;
+  self->hotplug_source = 0;
+  self->device_pcm = new std::string();
+  self->polled_cards = new std::string();
+  self->hotplug_checking = false;
+  self->hotplug_force = false;
+  self->using_native = false;
+  self->preview_volume = 1.0f;
+  self->preview_pan = 0.0f;
+}
+
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  AudioEnginePlugin* plugin = AUDIO_ENGINE_PLUGIN(user_data);
+  audio_engine_plugin_handle_method_call(plugin, method_call);
+}
+
+void audio_engine_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+  AudioEnginePlugin* plugin = AUDIO_ENGINE_PLUGIN(
+      g_object_new(audio_engine_plugin_get_type(), nullptr));
+
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_autoptr(FlMethodChannel) channel = fl_method_channel_new(
+      messenger, "audio_usb/methods", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(channel, method_call_cb,
+                                            g_object_ref(plugin),
+                                            g_object_unref);
+
+  plugin->events = fl_event_channel_new(messenger, "audio_usb/events",
+                                        FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(plugin->events, events_listen_cb,
+                                       events_cancel_cb, g_object_ref(plugin),
+                                       g_object_unref);
+
+  g_object_unref(plugin);
+
+  // Primeira sondagem já no registro, para os métodos chamados antes do listen
+  // acharem a interface
+  std::thread([]() {
+    OutputDeviceInfo device;
+    std::string cards;
+    refresh_output_devices(&device, &cards);
+  }).detach();
+}
@@ -0,0 +1,307 @@
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "event_timeline.h"
+#include "param_queue.h"
+#include "transport.h"
+
+// Testes do engine no host (alvo mtp_engine_tests, fora do build padrão, como
+// o mtp_bench). Cada CHECK que falha imprime a linha; sai com 1 se algum falhou.
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                      \
+  do {                                                                   \
+    if (!(cond)) {                                                       \
+      std::fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__,    \
+                   #cond);                                               \
+      ++gFailures;                                                       \
+    }                                                                    \
+  } while (0)
+
+static bool near(double a, double b) { return std::fabs(a - b) < 1e-5; }
+
+static MtpTimelineEvent event(int64_t frame, int32_t index, int32_t param,
+                              float value, int32_t curve = MTP_CURVE_STEP) {
+  MtpTimelineEvent e = {};
+  e.frame = frame;
+  e.target = PARAM_TARGET_TRACK;
+  e.index = index;
+  e.param = param;
+  e.curve = curve;
+  e.value = value;
+  return e;
+}
+
+struct Applied {
+  int32_t target, index, param;
+  float value;
+};
+
+// Coleta o que a timeline aplicou, na ordem (passado com std::ref: a
+// timeline recebe o Apply por valor)
+struct Recorder {
+  std::vector<Applied> calls;
+  void operator()(int32_t target, int32_t index, int32_t param, float value) {
+    calls.push_back(Applied{target, index, param, value});
+  }
+};
+
+// Eventos fora de ordem saem por frame; no mesmo frame, na ordem de entrada
+static void test_timeline_order() {
+  const MtpTimelineEvent events[] = {
+      event(300, 0, PARAM_TRACK_VOLUME, 0.3f),
+      event(100, 1, PARAM_TRACK_PAN, -1.0f),
+      event(200, 0, PARAM_TRACK_VOLUME, 0.1f),
+      event(200, 0, PARAM_TRACK_VOLUME, 0.2f),
+      event(-5, 0, PARAM_TRACK_VOLUME, 9.0f),      // frame negativo: fora
+      event(50, 0, PARAM_COUNT, 9.0f),             // parâmetro inválido: fora
+  };
+  EventTimeline timeline(events, 6, 48000);
+  Recorder r;
+  timeline.locate(0, std::ref(r));
+  CHECK(r.calls.empty());
+  CHECK(timeline.nextEventFrame() == 100);
+  timeline.processUpTo(1000, std::ref(r));
+  CHECK(r.calls.size() == 4);
+  if (r.calls.size() == 4) {
+    CHECK(r.calls[0].index == 1 && near(r.calls[0].value, -1.0));
+    CHECK(near(r.calls[1].value, 0.1));
+    CHECK(near(r.calls[2].value, 0.2));
+    CHECK(near(r.calls[3].value, 0.3));
+  }
+  CHECK(timeline.nextEventFrame() == -1);
+}
+
+// Rampa: valor interpolado entre o evento anterior e o de rampa, tanto no
+// locate quanto no fim de cada bloco (updateRamps)
+static void test_timeline_ramp() {
+  const MtpTimelineEvent events[] = {
+      event(1000, 0, PARAM_TRACK_VOLUME, 0.0f),
+      event(2000, 0, PARAM_TRACK_VOLUME, 1.0f, MTP_CURVE_RAMP),
+      // Mute é sempre degrau
+      event(1000, 3, PARAM_MUTE, 0.0f),
+      event(2000, 3, PARAM_MUTE, 1.0f, MTP_CURVE_RAMP),
+  };
+  EventTimeline timeline(events, 4, 48000);
+  Recorder r;
+  timeline.locate(1500, std::ref(r));
+  CHECK(r.calls.size() == 2);
+  for (const Applied& a : r.calls) {
+    if (a.index == 0) CHECK(near(a.value, 0.5));
+    if (a.index == 3) CHECK(near(a.value, 0.0));
+  }
+  r.calls.clear();
+  timeline.updateRamps(1750, std::ref(r));
+  CHECK(r.calls.size() == 1);
+  if (r.calls.size() == 1) CHECK(r.calls[0].index == 0 && near(r.calls[0].value, 0.75));
+  // Depois do fim da rampa, o valor fica no do ponto final
+  r.calls.clear();
+  timeline.processUpTo(2500, std::ref(r));
+  timeline.updateRamps(2500, std::ref(r));
+  float volume = -1.0f;
+  for (const Applied& a : r.calls) {
+    if (a.index == 0) volume = a.value;
+  }
+  CHECK(near(volume, 1.0));
+}
+
+// Seek: locate aplica o valor vigente de cada chave e o cursor continua no
+// primeiro evento em ou depois da posição
+static void test_timeline_locate() {
+  const MtpTimelineEvent events[] = {
+      event(100, 0, PARAM_TRACK_VOLUME, 0.1f),
+      event(200, 0, PARAM_TRACK_VOLUME, 0.2f),
+      event(300, 0, PARAM_TRACK_VOLUME, 0.3f),
+      event(250, 1, PARAM_TRACK_PAN, 0.5f),
+  };
+  EventTimeline timeline(events, 4, 48000);
+  Recorder r;
+  timeline.processUpTo(400, std::ref(r));
+  CHECK(timeline.nextEventFrame() == -1);
+
+  // Para trás: o evento exatamente na posição ainda não vale
+  r.calls.clear();
+  timeline.locate(200, std::ref(r));
+  CHECK(r.calls.size() == 1);
+  if (r.calls.size() == 1) CHECK(r.calls[0].index == 0 && near(r.calls[0].value, 0.1));
+  CHECK(timeline.nextEventFrame() == 200);
+  r.calls.clear();
+  timeline.processUpTo(260, std::ref(r));
+  CHECK(r.calls.size() == 2);
+  CHECK(timeline.nextEventFrame() == 300);
+
+  // Antes de tudo: nada aplicado
+  r.calls.clear();
+  timeline.locate(0, std::ref(r));
+  CHECK(r.calls.empty());
+  CHECK(timeline.nextEventFrame() == 100);
+}
+
+// Eventos em ms vão para o primeiro frame da sessão em que valem (arredonda
+// para cima)
+static void test_timeline_session_rate() {
+  const MtpTimelineEvent events[] = {
+      event(1, 0, PARAM_TRACK_VOLUME, 0.1f),
+      event(3, 0, PARAM_TRACK_VOLUME, 0.2f),
+      event(10, 0, PARAM_TRACK_VOLUME, 0.3f),
+  };
+  EventTimeline timeline(events, 3, 1000);
+  Recorder r;
+  timeline.setSessionRate(44100);
+  timeline.locate(0, std::ref(r));
+  CHECK(timeline.nextEventFrame() == 45);  // 44,1
+  timeline.processUpTo(44, std::ref(r));
+  CHECK(r.calls.empty());
+  timeline.processUpTo(45, std::ref(r));
+  CHECK(r.calls.size() == 1);
+  CHECK(timeline.nextEventFrame() == 133);  // 132,3
+  timeline.setSessionRate(48000);
+  timeline.locate(0, std::ref(r));
+  timeline.processUpTo(143, std::ref(r));
+  CHECK(timeline.nextEventFrame() == 144);  // exato
+  timeline.processUpTo(144, std::ref(r));
+  CHECK(timeline.nextEventFrame() == 480);
+}
+
+// Publicação do controle e troca no render: a pendente é pega uma vez, a
+// anterior fica aposentada até a próxima publicação, e uma pendente nunca
+// vista é substituída direto (ASan acusa se alguma vazar)
+static void test_timeline_slot() {
+  const MtpTimelineEvent one[] = {event(10, 0, PARAM_TRACK_VOLUME, 0.5f)};
+  TimelineSlot slot;
+  EventTimeline* current = nullptr;
+  CHECK(!slot.acquire(current));
+
+  EventTimeline* a = new EventTimeline(one, 1, 48000);
+  slot.publish(a);
+  CHECK(slot.acquire(current));
+  CHECK(current == a);
+  CHECK(!slot.acquire(current));
+
+  EventTimeline* b = new EventTimeline(one, 1, 48000);
+  slot.publish(b);
+  CHECK(slot.acquire(current));  // `a` aposentada
+  CHECK(current == b);
+
+  slot.publish(new EventTimeline(one, 1, 48000));  // libera `a`
+  EventTimeline* d = new EventTimeline(one, 1, 48000);
+  slot.publish(d);  // a anterior nunca foi vista: liberada direto
+  CHECK(slot.acquire(current));  // `b` aposentada
+  CHECK(current == d);
+
+  // nullptr limpa: o render recebe uma timeline vazia
+  slot.publish(nullptr);
+  CHECK(slot.acquire(current));
+  CHECK(current != nullptr && current->empty());
+
+  // Fim de sessão: a atual volta para a próxima sessão
+  EventTimeline* kept = current;
+  slot.release(current);
+  current = nullptr;
+  CHECK(slot.acquire(current));
+  CHECK(current == kept);
+
+  // Com outra já publicada, a devolvida é liberada
+  slot.publish(new EventTimeline(one, 1, 48000));
+  slot.release(current);
+  current = nullptr;
+  CHECK(slot.acquire(current));
+  CHECK(current != nullptr && !current->empty());
+  delete current;
+  slot.publish(nullptr);  // libera a aposentada
+  current = nullptr;
+  CHECK(slot.acquire(current));
+  delete current;
+}
+
+// Salto na grade: a próxima linha em ou depois da posição, fixada na
+// primeira resolução; antes da origem, a própria origem
+static void test_transport_grid() {
+  TransportState s;
+  s.jumpTarget = 0;
+  s.gridOrigin = 1000;
+  s.gridPeriod = 500;
+  TransportEvent ev = transportNextEvent(s, 1001);
+  CHECK(ev.isJump && ev.at == 1500 && ev.target == 0);
+  CHECK(s.jumpAt == 1500);
+  ev = transportNextEvent(s, 1600);  // já fixado: no passado = agora
+  CHECK(ev.at == 1600);
+
+  s.jumpAt = -1;
+  CHECK(transportNextEvent(s, 2000).at == 2000);  // em cima da linha
+  s.jumpAt = -1;
+  CHECK(transportNextEvent(s, 1000).at == 1000);
+  s.jumpAt = -1;
+  CHECK(transportNextEvent(s, 10).at == 1000);
+  s.jumpAt = -1;
+  s.gridOrigin = 0;
+  CHECK(transportNextEvent(s, 0).at == 0);
+}
+
+// Loop: volta em loopEnd; um salto no mesmo frame ganha o empate
+static void test_transport_loop() {
+  TransportState s;
+  s.loopStart = 1000;
+  s.loopEnd = 5000;
+  TransportEvent ev = transportNextEvent(s, 1200);
+  CHECK(!ev.isJump && ev.at == 5000 && ev.target == 1000);
+  CHECK(transportNextEvent(s, 5000).at < 0);  // já no fim: nada pela frente
+
+  s.jumpTarget = 9000;
+  s.jumpAt = 5000;
+  ev = transportNextEvent(s, 1200);
+  CHECK(ev.isJump && ev.at == 5000 && ev.target == 9000);
+  s.jumpAt = 6000;  // depois do fim do loop: o loop vem antes
+  ev = transportNextEvent(s, 1200);
+  CHECK(!ev.isJump && ev.at == 5000);
+}
+
+// Controle: loop curto recusado; salto executado não volta num poll seguinte
+static void test_transport_control() {
+  TransportControl control;
+  TransportState s;
+  CHECK(!control.poll(s));
+  CHECK(!control.setLoop(0, kTransportMinLoopFrames - 1));
+  CHECK(!control.setLoop(-1, kTransportMinLoopFrames));
+  CHECK(!control.poll(s));
+  CHECK(control.setLoop(0, kTransportMinLoopFrames));
+  CHECK(control.poll(s));
+  CHECK(s.loopStart == 0 && s.loopEnd == kTransportMinLoopFrames);
+
+  control.scheduleJump(4000, -1);
+  CHECK(control.poll(s));
+  CHECK(s.jumpTarget == 4000 && s.jumpAt == 0);
+  control.jumpDone(s);
+  CHECK(s.jumpTarget < 0);
+  control.clearLoop();  // outra mudança copia o estado de novo
+  CHECK(control.poll(s));
+  CHECK(s.jumpTarget < 0 && s.loopEnd < 0);
+  CHECK(transportNextEvent(s, 100).at < 0);
+
+  // Salto novo depois do executado vale normalmente
+  CHECK(!control.scheduleJumpOnGrid(4000, 0, 0));
+  CHECK(control.scheduleJumpOnGrid(4000, 0, 1000));
+  CHECK(control.poll(s));
+  CHECK(s.jumpTarget == 4000 && s.jumpAt < 0);
+  CHECK(transportNextEvent(s, 100).at == 1000);
+}
+
+int main() {
+  test_timeline_order();
+  test_timeline_ramp();
+  test_timeline_locate();
+  test_timeline_session_rate();
+  test_timeline_slot();
+  test_transport_grid();
+  test_transport_loop();
+  test_transport_control();
+  if (gFailures > 0) {
+    std::fprintf(stderr, "%d falha(s)\n", gFailures);
+    return 1;
+  }
+  std::printf("engine tests ok\n");
+  return 0;
+}
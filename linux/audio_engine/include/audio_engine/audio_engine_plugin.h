@@ -0,0 +1,24 @@
+#ifndef FLUTTER_PLUGIN_AUDIO_ENGINE_PLUGIN_H_
+#define FLUTTER_PLUGIN_AUDIO_ENGINE_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+G_BEGIN_DECLS
+
+#ifdef FLUTTER_PLUGIN_IMPL
+#define FLUTTER_PLUGIN_EXPORT __attribute__((visibility("default")))
+#else
+#define FLUTTER_PLUGIN_EXPORT
+#endif
+
+// Canais audio_usb/methods e audio_usb/events do MainActivity, servidos pelo
+// engine nativo (android/app/src/main/cpp) com saída ALSA.
+G_DECLARE_FINAL_TYPE(AudioEnginePlugin, audio_engine_plugin, AUDIO_ENGINE,
+                     PLUGIN, GObject)
+
+FLUTTER_PLUGIN_EXPORT void audio_engine_plugin_register_with_registrar(
+    FlPluginRegistrar* registrar);
+
+G_END_DECLS
+
+#endif  // FLUTTER_PLUGIN_AUDIO_ENGINE_PLUGIN_H_
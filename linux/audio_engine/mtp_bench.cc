@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "capture.h"
+#include "stem_prefetch.h"
+
+// Benchmarks do engine no host, fora do app (alvo mtp_bench, fora do build
+// padrão). Chamam os mesmos exports que o Dart abriria por FFI.
+//
+//   mtp_bench capture <dir> [canais=16] [taxa=48000] [segundos=60]
+//   mtp_bench stream <stems> <segundos> [--chunk N] [--ahead N] [--depth N]
+//                    [--no-uring] <wav>...
+
+static void usage() {
+  std::fprintf(stderr,
+               "uso: mtp_bench capture <dir> [canais] [taxa] [segundos]\n"
+               "     mtp_bench stream <stems> <segundos> [--chunk N] "
+               "[--ahead N] [--depth N] [--no-uring] <wav>...\n");
+}
+
+static int int_arg(int argc, char** argv, int i, int fallback) {
+  return i < argc ? std::atoi(argv[i]) : fallback;
+}
+
+static double double_arg(int argc, char** argv, int i, double fallback) {
+  return i < argc ? std::atof(argv[i]) : fallback;
+}
+
+static int run_capture(int argc, char** argv) {
+  if (argc < 3) {
+    usage();
+    return 2;
+  }
+  const int channels = int_arg(argc, argv, 3, 16);
+  const int rate = int_arg(argc, argv, 4, 48000);
+  const double seconds = double_arg(argc, argv, 5, 60.0);
+  // Como o MainActivity antes do startCapture: o writer não cria o diretório
+  mkdir(argv[2], 0755);
+  MtpCaptureBenchmark r;
+  std::memset(&r, 0, sizeof(r));
+  const int ok = mtp_capture_benchmark(argv[2], channels, rate, seconds, &r);
+  if (r.framesWritten == 0) {
+    std::fprintf(stderr, "capture: falhou ao gravar em %s\n", argv[2]);
+    return 1;
+  }
+  std::printf(
+      "capture %dch %dHz: %.1f s de áudio em %.2f s, %.1f MB/s, %.1fx tempo "
+      "real, %lld frames perdidos\n",
+      r.channels, r.sampleRate, r.audioSec, r.wallSec, r.megabytesPerSec,
+      r.realtimeFactor, (long long)r.framesDropped);
+  return ok ? 0 : 1;
+}
+
+static const char* backend_name(int backend) {
+  switch ((IoBackend)backend) {
+    case IoBackend::IoUring:
+      return "io_uring";
+    case IoBackend::PreadPool:
+      return "pread";
+    default:
+      return "nenhum";
+  }
+}
+
+static int run_stream(int argc, char** argv) {
+  if (argc < 5) {
+    usage();
+    return 2;
+  }
+  const int streams = std::atoi(argv[2]);
+  const double seconds = std::atof(argv[3]);
+  int chunk = 0, ahead = 0, depth = 0, flags = 0;
+  std::vector<const char*> paths;
+  for (int i = 4; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a == "--chunk" && i + 1 < argc) {
+      chunk = std::atoi(argv[++i]);
+    } else if (a == "--ahead" && i + 1 < argc) {
+      ahead = std::atoi(argv[++i]);
+    } else if (a == "--depth" && i + 1 < argc) {
+      depth = std::atoi(argv[++i]);
+    } else if (a == "--no-uring") {
+      flags |= MTP_STREAM_IO_NO_URING;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    usage();
+    return 2;
+  }
+  MtpStreamBenchmark r;
+  std::memset(&r, 0, sizeof(r));
+  if (!mtp_stream_benchmark(paths.data(), (int32_t)paths.size(), streams,
+                            seconds, chunk, ahead, depth, flags, &r)) {
+    std::fprintf(stderr, "stream: falhou (arquivos ilegíveis ou vazios?)\n");
+    return 1;
+  }
+  std::printf(
+      "stream %d stems (%s, chunk %d, depth %d): %.1f s de áudio em %.2f s, "
+      "%.1f MB/s, %.1fx tempo real, ~%.0f stems sustentados\n",
+      r.streams, backend_name(r.backend), r.chunkFrames, r.queueDepth,
+      r.audioSec, r.wallSec, r.megabytesPerSec, r.realtimeFactor,
+      r.sustainedStems);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  const std::string mode = argc > 1 ? argv[1] : "";
+  if (mode == "capture") return run_capture(argc, argv);
+  if (mode == "stream") return run_stream(argc, argv);
+  usage();
+  return 2;
+}
@@ -6,6 +6,9 @@
 #endif
 
 #include "flutter/generated_plugin_registrant.h"
+#ifdef MTP_LINUX_AUDIO_ENGINE
+#include "audio_engine/audio_engine_plugin.h"
+#endif
 
 struct _MyApplication {
   GtkApplication parent_instance;
@@ -58,6 +61,12 @@ static void my_application_activate(GApplication* application) {
   gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(view));
 
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+#ifdef MTP_LINUX_AUDIO_ENGINE
+  g_autoptr(FlPluginRegistrar) audio_engine_registrar =
+      fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                  "AudioEnginePlugin");
+  audio_engine_plugin_register_with_registrar(audio_engine_registrar);
+#endif
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }